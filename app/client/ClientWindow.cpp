@@ -12,6 +12,13 @@
 
 ClientWindow::ClientWindow(QWidget *parent)
     : QMainWindow(parent), client(std::make_unique<Client>()), currentPort(0), wasConnected(false) {
+    // Transfers run on worker threads; results come back as queued signals
+    transferManager = new TransferManager(this);
+    connect(transferManager, &TransferManager::transferQueued, this, &ClientWindow::onTransferQueued);
+    connect(transferManager, &TransferManager::transferStarted, this, &ClientWindow::onTransferStarted);
+    connect(transferManager, &TransferManager::transferProgress, this, &ClientWindow::onTransferProgress);
+    connect(transferManager, &TransferManager::transferFinished, this, &ClientWindow::onTransferFinished);
+    
     setupUI();
     
     // Setup status update timer
@@ -21,6 +28,10 @@ ClientWindow::ClientWindow(QWidget *parent)
 }
 
 ClientWindow::~ClientWindow() {
+    // Stop background transfers before the window goes away
+    transferManager->cancelAll();
+    disconnect(transferManager, nullptr, this, nullptr);
+    
     if (client && client->isConnected()) {
         client->disconnect();
     }
@@ -203,6 +214,10 @@ void ClientWindow::setupUI() {
     transferLogText->setReadOnly(true);
     tabWidget->addTab(transferLogText, "Transfer Log");
     
+    // Transfers tab (queued, running and finished background transfers)
+    transfersWidget = new QListWidget(this);
+    tabWidget->addTab(transfersWidget, "Transfers");
+    
     mainLayout->addWidget(tabWidget, 1);
     
     // Action buttons row 1
@@ -260,6 +275,11 @@ void ClientWindow::setupUI() {
     connect(uploadButton, &QPushButton::clicked, this, &ClientWindow::onUploadClicked);
     buttonsRow2->addWidget(uploadButton);
     
+    cancelTransferButton = new QPushButton("Cancel Transfer", this);
+    cancelTransferButton->setEnabled(false);
+    connect(cancelTransferButton, &QPushButton::clicked, this, &ClientWindow::onCancelTransferClicked);
+    buttonsRow2->addWidget(cancelTransferButton);
+    
     metricsButton = new QPushButton("Reset Metrics", this);
     metricsButton->setEnabled(false);
     connect(metricsButton, &QPushButton::clicked, this, &ClientWindow::onResetMetricsClicked);
@@ -365,6 +385,7 @@ void ClientWindow::connectToServer(const QString& ip, int port) {
         
         currentIP = ip;
         currentPort = port;
+        transferManager->setServer(ip, port);
         connectionStartTime = QDateTime::currentDateTime();
         appendLog(QString("✓ Successfully connected to %1:%2").arg(ip).arg(port), true);
         appendLog("Use 'List Files' button to view available files", true);
@@ -427,12 +448,7 @@ void ClientWindow::processCommand(const QString& command) {
         QString filename = command.mid(4).trimmed(); // Remove "get " prefix
         QString saveDir = QFileDialog::getExistingDirectory(this, "Select Download Directory", ".");
         if (!saveDir.isEmpty()) {
-            appendLog(QString("Downloading %1...").arg(filename), true);
-            if (client->getFile(filename.toStdString(), saveDir.toStdString())) {
-                appendLog(QString("Download completed: %1").arg(filename), true);
-            } else {
-                appendLog(QString("Download failed: %1").arg(filename), false);
-            }
+            startDownload(filename, saveDir);
         }
     }
     else if (cmd == "put") {
@@ -446,11 +462,7 @@ void ClientWindow::processCommand(const QString& command) {
         }
         // Get filepath (may contain spaces) - everything after "put "
         QString filepath = command.mid(4).trimmed(); // Remove "put " prefix
-        if (client->putFile(filepath.toStdString())) {
-            appendLog(QString("Uploaded: %1").arg(filepath), true);
-        } else {
-            appendLog(QString("Upload failed: %1").arg(filepath), false);
-        }
+        startUpload(filepath);
     }
     else if (cmd == "reset") {
         onResetMetricsClicked();
@@ -576,12 +588,7 @@ void ClientWindow::onDownloadClicked() {
     
     QString saveDir = QFileDialog::getExistingDirectory(this, "Select Download Directory", ".");
     if (!saveDir.isEmpty()) {
-        appendLog(QString("Downloading %1...").arg(filename), true);
-        if (client->getFile(filename.toStdString(), saveDir.toStdString())) {
-            appendLog(QString("Download completed: %1").arg(filename), true);
-        } else {
-            appendLog(QString("Download failed: %1").arg(filename), false);
-        }
+        startDownload(filename, saveDir);
     }
 }
 
@@ -591,18 +598,88 @@ void ClientWindow::onUploadClicked() {
         return;
     }
     
-    QString filepath = QFileDialog::getOpenFileName(this, "Select File to Upload");
-    if (!filepath.isEmpty()) {
-        QFileInfo fileInfo(filepath);
-        appendLog(QString("Uploading %1...").arg(fileInfo.fileName()), true);
-        if (client->putFile(filepath.toStdString())) {
-            appendLog(QString("Upload completed: %1").arg(fileInfo.fileName()), true);
-        } else {
-            appendLog("Upload failed", false);
-        }
+    QStringList filepaths = QFileDialog::getOpenFileNames(this, "Select File(s) to Upload");
+    for (const QString& filepath : filepaths) {
+        startUpload(filepath);
     }
 }
 
+void ClientWindow::startDownload(const QString& filename, const QString& saveDir) {
+    appendLog(QString("Queued download: %1").arg(filename), true);
+    transferManager->enqueueDownload(filename, saveDir);
+}
+
+void ClientWindow::startUpload(const QString& filepath) {
+    appendLog(QString("Queued upload: %1").arg(QFileInfo(filepath).fileName()), true);
+    transferManager->enqueueUpload(filepath);
+}
+
+void ClientWindow::onCancelTransferClicked() {
+    QListWidgetItem* item = transfersWidget->currentItem();
+    if (!item) {
+        QMessageBox::warning(this, "No Transfer Selected", "Please select a transfer in the Transfers tab");
+        return;
+    }
+    
+    int id = item->data(Qt::UserRole).toInt();
+    transferManager->cancel(id);
+}
+
+void ClientWindow::onTransferQueued(int id, const QString& name, bool upload) {
+    auto* item = new QListWidgetItem(QString("%1 %2 — queued").arg(upload ? "⬆" : "⬇").arg(name));
+    item->setData(Qt::UserRole, id);
+    transfersWidget->addItem(item);
+    transferRows[id] = TransferRow{item, name, upload, QDateTime()};
+    cancelTransferButton->setEnabled(true);
+}
+
+void ClientWindow::onTransferStarted(int id) {
+    auto it = transferRows.find(id);
+    if (it == transferRows.end()) return;
+    
+    it->second.started = QDateTime::currentDateTime();
+    it->second.item->setText(QString("%1 %2 — connecting...")
+        .arg(it->second.upload ? "⬆" : "⬇").arg(it->second.name));
+    appendLog(QString("%1 %2...").arg(it->second.upload ? "Uploading" : "Downloading").arg(it->second.name), true);
+}
+
+void ClientWindow::onTransferProgress(int id, quint64 bytesDone, quint64 bytesTotal) {
+    auto it = transferRows.find(id);
+    if (it == transferRows.end()) return;
+    
+    int percent = bytesTotal > 0 ? static_cast<int>(bytesDone * 100 / bytesTotal) : 100;
+    qint64 elapsedMs = it->second.started.msecsTo(QDateTime::currentDateTime());
+    double rateMBps = elapsedMs > 0 ? (bytesDone / 1024.0 / 1024.0) / (elapsedMs / 1000.0) : 0.0;
+    
+    it->second.item->setText(QString("%1 %2 — %3% (%4 / %5 MB, %6 MB/s)")
+        .arg(it->second.upload ? "⬆" : "⬇")
+        .arg(it->second.name)
+        .arg(percent)
+        .arg(bytesDone / 1024.0 / 1024.0, 0, 'f', 1)
+        .arg(bytesTotal / 1024.0 / 1024.0, 0, 'f', 1)
+        .arg(rateMBps, 0, 'f', 2));
+}
+
+void ClientWindow::onTransferFinished(int id, bool success, const QString& message) {
+    auto it = transferRows.find(id);
+    if (it == transferRows.end()) return;
+    
+    it->second.item->setText(QString("%1 %2 — %3")
+        .arg(success ? "✓" : "✗").arg(it->second.name).arg(message));
+    it->second.item->setForeground(QColor(success ? "#2e7d32" : "#c62828"));
+    appendLog(QString("%1: %2").arg(message).arg(it->second.name), success);
+    transferRows.erase(it);
+    
+    // Fold the worker connection's metrics into the session totals
+    ClientMetrics workerMetrics;
+    if (transferManager->takeMetrics(id, workerMetrics)) {
+        client->mergeMetrics(workerMetrics);
+        updateMetrics();
+    }
+    
+    cancelTransferButton->setEnabled(!transferRows.empty());
+}
+
 void ClientWindow::onResetMetricsClicked() {
     client->resetMetrics();
     updateMetrics();
@@ -625,6 +702,7 @@ void ClientWindow::onExportClicked() {
 }
 
 void ClientWindow::onQuitClicked() {
+    transferManager->cancelAll();
     if (client->isConnected()) {
         client->disconnect();
     }
@@ -710,12 +788,9 @@ void ClientWindow::updateMetrics() {
     bytesSentLabel->setText(QString("%1 KB").arg(bytesSent / 1024.0, 0, 'f', 2));
     bytesReceivedLabel->setText(QString("%1 KB").arg(bytesReceived / 1024.0, 0, 'f', 2));
     
-    // Count uploads/downloads from history
-    int uploads = 0, downloads = 0;
-    for (const auto& record : metrics.request_history) {
-        if (record.operation == "PUT") uploads++;
-        if (record.operation == "GET") downloads++;
-    }
+    // Count uploads/downloads from the per-operation aggregates
+    uint64_t uploads = metrics.request_history.statsFor("PUT").count;
+    uint64_t downloads = metrics.request_history.statsFor("GET").count;
     
     filesUploadedLabel->setText(QString::number(uploads));
     filesDownloadedLabel->setText(QString::number(downloads));
@@ -16,7 +16,9 @@
 #include <QListWidget>
 #include <QDateTime>
 #include <memory>
+#include <map>
 #include "../../include/client.h"
+#include "TransferManager.h"
 
 class ClientWindow : public QMainWindow {
     Q_OBJECT
@@ -37,6 +39,11 @@ private slots:
     void onQuitClicked();
     void updateStatus();
     void updateMetrics();
+    void onCancelTransferClicked();
+    void onTransferQueued(int id, const QString& name, bool upload);
+    void onTransferStarted(int id);
+    void onTransferProgress(int id, quint64 bytesDone, quint64 bytesTotal);
+    void onTransferFinished(int id, bool success, const QString& message);
 
 private:
     void setupUI();
@@ -45,6 +52,8 @@ private:
     void connectToServer(const QString& ip, int port);
     void updateStatusBar();
     void parseFileListResponse(const std::string& response);
+    void startDownload(const QString& filename, const QString& saveDir);
+    void startUpload(const QString& filepath);
     
     // UI Components
     QLabel* statusLabel;
@@ -56,6 +65,7 @@ private:
     QTabWidget* tabWidget;
     QListWidget* fileListWidget;
     QTextEdit* transferLogText;
+    QListWidget* transfersWidget;
     
     // Metrics labels
     QLabel* bytesSentLabel;
@@ -73,6 +83,7 @@ private:
     QPushButton* listFilesButton;
     QPushButton* downloadButton;
     QPushButton* uploadButton;
+    QPushButton* cancelTransferButton;
     QPushButton* metricsButton;
     QPushButton* exportButton;
     QPushButton* quitButton;
@@ -81,6 +92,16 @@ private:
     std::unique_ptr<Client> client;
     QTimer* statusTimer;
     
+    // Background transfers
+    TransferManager* transferManager;
+    struct TransferRow {
+        QListWidgetItem* item;
+        QString name;
+        bool upload;
+        QDateTime started;
+    };
+    std::map<int, TransferRow> transferRows;
+    
     // Connection info
     QString currentIP;
     int currentPort;
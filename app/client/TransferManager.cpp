@@ -0,0 +1,178 @@
+#include "TransferManager.h"
+#include <QRunnable>
+#include <QFileInfo>
+
+// Runs one queued transfer on a pool thread
+class TransferTask : public QRunnable {
+public:
+    TransferTask(TransferManager* manager, std::shared_ptr<TransferManager::Job> job)
+        : manager_(manager), job_(std::move(job)) {}
+
+    void run() override {
+        manager_->runJob(job_);
+    }
+
+private:
+    TransferManager* manager_;
+    std::shared_ptr<TransferManager::Job> job_;
+};
+
+TransferManager::TransferManager(QObject* parent)
+    : QObject(parent), port_(0), nextId_(1) {
+    pool_.setMaxThreadCount(3);
+}
+
+TransferManager::~TransferManager() {
+    cancelAll();
+    pool_.waitForDone();
+}
+
+void TransferManager::setServer(const QString& ip, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ip_ = ip;
+    port_ = port;
+}
+
+void TransferManager::setMaxConcurrent(int count) {
+    pool_.setMaxThreadCount(count > 0 ? count : 1);
+}
+
+int TransferManager::maxConcurrent() const {
+    return pool_.maxThreadCount();
+}
+
+int TransferManager::enqueueDownload(const QString& filename, const QString& saveDir) {
+    auto job = std::make_shared<Job>();
+    job->upload = false;
+    job->name = filename;
+    job->path = filename;
+    job->saveDir = saveDir;
+    return enqueue(job);
+}
+
+int TransferManager::enqueueUpload(const QString& filepath) {
+    auto job = std::make_shared<Job>();
+    job->upload = true;
+    job->name = QFileInfo(filepath).fileName();
+    job->path = filepath;
+    return enqueue(job);
+}
+
+int TransferManager::enqueue(std::shared_ptr<Job> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->id = nextId_++;
+        job->ip = ip_;
+        job->port = port_;
+        jobs_[job->id] = job;
+    }
+
+    emit transferQueued(job->id, job->name, job->upload);
+    pool_.start(new TransferTask(this, job));
+    return job->id;
+}
+
+void TransferManager::cancel(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return;
+    }
+
+    // Queued jobs see the flag when they start; running ones abort mid-transfer
+    it->second->cancelled = true;
+    if (it->second->client) {
+        it->second->client->cancelTransfer();
+    }
+}
+
+void TransferManager::cancelAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : jobs_) {
+        entry.second->cancelled = true;
+        if (entry.second->client) {
+            entry.second->client->cancelTransfer();
+        }
+    }
+}
+
+int TransferManager::activeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(jobs_.size());
+}
+
+bool TransferManager::takeMetrics(int id, ClientMetrics& metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = finishedMetrics_.find(id);
+    if (it == finishedMetrics_.end()) {
+        return false;
+    }
+    metrics = it->second;
+    finishedMetrics_.erase(it);
+    return true;
+}
+
+void TransferManager::runJob(const std::shared_ptr<Job>& job) {
+    auto finish = [this, &job](bool success, const QString& message, const ClientMetrics* metrics) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.erase(job->id);
+            if (metrics) {
+                finishedMetrics_[job->id] = *metrics;
+            }
+        }
+        emit transferFinished(job->id, success, message);
+    };
+
+    if (job->cancelled) {
+        finish(false, "Cancelled", nullptr);
+        return;
+    }
+
+    // Each transfer gets its own connection so transfers can run concurrently
+    Client client;
+    if (!client.connect(job->ip.toStdString(), static_cast<uint16_t>(job->port))) {
+        finish(false, QString("Unable to connect to %1:%2").arg(job->ip).arg(job->port), nullptr);
+        return;
+    }
+
+    const int id = job->id;
+    Job* rawJob = job.get();
+    client.setProgressCallback([this, id, rawJob, &client](uint64_t done, uint64_t total) {
+        // Catches a cancel that arrived before the transfer had started
+        if (rawJob->cancelled) {
+            client.cancelTransfer();
+        }
+        emit transferProgress(id, done, total);
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->client = &client;
+    }
+
+    emit transferStarted(id);
+
+    bool success = job->upload
+        ? client.putFile(job->path.toStdString())
+        : client.getFile(job->path.toStdString(), job->saveDir.toStdString());
+    bool cancelled = client.wasCancelled() || job->cancelled;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->client = nullptr;
+    }
+
+    client.disconnect();
+
+    QString message;
+    if (success) {
+        message = job->upload ? "Upload completed" : "Download completed";
+    } else if (cancelled) {
+        message = "Cancelled";
+    } else {
+        message = job->upload ? "Upload failed" : "Download failed";
+    }
+    ClientMetrics metrics = client.getMetrics();
+    finish(success, message, &metrics);
+}
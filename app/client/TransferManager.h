@@ -0,0 +1,83 @@
+#ifndef TRANSFERMANAGER_H
+#define TRANSFERMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "../../include/client.h"
+
+/**
+ * @class TransferManager
+ * @brief Runs GET/PUT transfers on worker threads so the GUI never blocks
+ *
+ * Each transfer opens its own connection to the server, so several transfers
+ * can run at once (up to the configured limit) while the rest wait in the
+ * queue. Progress, start and completion are reported through signals, which
+ * Qt delivers to the GUI thread as queued events. Progress is rate-limited by
+ * the Client callback itself, so a huge transfer produces a handful of events
+ * per second regardless of its size.
+ */
+class TransferManager : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TransferManager(QObject* parent = nullptr);
+    ~TransferManager();
+
+    void setServer(const QString& ip, int port);
+    void setMaxConcurrent(int count);
+    int maxConcurrent() const;
+
+    int enqueueDownload(const QString& filename, const QString& saveDir);
+    int enqueueUpload(const QString& filepath);
+    void cancel(int id);
+    void cancelAll();
+    int activeCount() const;
+
+    /**
+     * @brief Hand over the metrics collected by a finished transfer
+     * @param id Transfer id
+     * @param metrics Receives the worker connection's metrics
+     * @return true if the transfer has finished and metrics were available
+     */
+    bool takeMetrics(int id, ClientMetrics& metrics);
+
+signals:
+    void transferQueued(int id, const QString& name, bool upload);
+    void transferStarted(int id);
+    void transferProgress(int id, quint64 bytesDone, quint64 bytesTotal);
+    void transferFinished(int id, bool success, const QString& message);
+
+private:
+    struct Job {
+        int id = 0;
+        bool upload = false;
+        QString name;       // File name shown to the user
+        QString path;       // Local path (PUT) or remote file name (GET)
+        QString saveDir;    // Download directory (GET)
+        QString ip;
+        int port = 0;
+        std::atomic<bool> cancelled{false};
+        Client* client = nullptr; // Set while the transfer is running
+    };
+
+    friend class TransferTask;
+
+    int enqueue(std::shared_ptr<Job> job);
+    void runJob(const std::shared_ptr<Job>& job);
+
+    QThreadPool pool_;
+    QString ip_;
+    int port_;
+
+    mutable std::mutex mutex_;
+    std::map<int, std::shared_ptr<Job>> jobs_;
+    std::map<int, ClientMetrics> finishedMetrics_;
+    int nextId_;
+};
+
+#endif // TRANSFERMANAGER_H
@@ -14,10 +14,8 @@ ServerWindow::ServerWindow(QWidget *parent)
       serverThread(nullptr),
       currentPort(9000),
       currentSharedDir("./shared"),
-      verboseMode(false),
-      previousFilesSent_(0),
-      previousFilesReceived_(0),
-      previousTotalConnections_(0) {
+      verboseMode(false) {
+    qRegisterMetaType<ServerEvent>("ServerEvent");
     setupUI();
     
     // Setup status update timer
@@ -403,8 +401,8 @@ void ServerWindow::startServer(int port, const QString& sharedDir) {
         // Start server in separate thread
         serverThread = new ServerThread(server.get(), this);
         
-        // Connect signal to receive server logs
-        connect(serverThread, &ServerThread::logMessage, this, &ServerWindow::onServerLog, Qt::QueuedConnection);
+        // Connect signal to receive server events
+        connect(serverThread, &ServerThread::serverEvent, this, &ServerWindow::onServerEvent, Qt::QueuedConnection);
         
         serverThread->start();
         
@@ -647,31 +645,6 @@ void ServerWindow::updateMetrics() {
     uint64_t currentFilesReceived = metrics.filesUploaded.load();
     uint64_t currentTotalConnections = metrics.totalConnections.load();
     
-    // Detect file downloads (GET)
-    if (currentFilesSent > previousFilesSent_) {
-        uint64_t diff = currentFilesSent - previousFilesSent_;
-        appendLog(QString("✓ File(s) sent to client (GET): %1").arg(diff), "blue");
-        previousFilesSent_ = currentFilesSent;
-    }
-    
-    // Detect file uploads (PUT)
-    if (currentFilesReceived > previousFilesReceived_) {
-        uint64_t diff = currentFilesReceived - previousFilesReceived_;
-        appendLog(QString("✓ File(s) received from client (PUT): %1").arg(diff), "blue");
-        previousFilesReceived_ = currentFilesReceived;
-    }
-    
-    // Detect new requests (including LIST)
-    if (currentTotalConnections > previousTotalConnections_) {
-        // If total connections increased but no file transfer, it's likely a LIST request
-        bool noFileTransfer = (currentFilesSent == previousFilesSent_) && 
-                              (currentFilesReceived == previousFilesReceived_);
-        if (noFileTransfer && !previousClients_.empty()) {
-            appendLog(QString("✓ Client request received (LIST)"), "blue");
-        }
-        previousTotalConnections_ = currentTotalConnections;
-    }
-    
     activeClientsCountLabel->setText(QString::number(activeCount));
     totalConnectionsLabel->setText(QString::number(currentTotalConnections));
     filesSentLabel->setText(QString::number(currentFilesSent));
@@ -705,26 +678,6 @@ void ServerWindow::updateClientsList() {
     activeClientsWidget->clear();
     std::vector<std::string> clients = server->getActiveClients();
     
-    // Convert to set for easier comparison
-    std::set<std::string> currentClients(clients.begin(), clients.end());
-    
-    // Detect new connections
-    for (const auto& client : currentClients) {
-        if (previousClients_.find(client) == previousClients_.end()) {
-            appendLog(QString("Client connected: %1").arg(QString::fromStdString(client)), "green");
-        }
-    }
-    
-    // Detect disconnections
-    for (const auto& client : previousClients_) {
-        if (currentClients.find(client) == currentClients.end()) {
-            appendLog(QString("Client disconnected: %1").arg(QString::fromStdString(client)), "orange");
-        }
-    }
-    
-    // Update previous state
-    previousClients_ = currentClients;
-    
     if (clients.empty()) {
         QListWidgetItem* noClientsItem = new QListWidgetItem("No clients connected");
         noClientsItem->setForeground(QColor("#999"));
@@ -732,40 +685,81 @@ void ServerWindow::updateClientsList() {
         activeClientsWidget->addItem(noClientsItem);
     } else {
         for (const auto& client : clients) {
-            activeClientsWidget->addItem(QString("👤 %1").arg(QString::fromStdString(client)));
+            QString text = QString("👤 %1").arg(QString::fromStdString(client));
+            auto activity = clientActivity_.find(client);
+            if (activity != clientActivity_.end()) {
+                text += "  —  " + activity->second;
+            }
+            activeClientsWidget->addItem(text);
         }
     }
 }
 
-void ServerWindow::onServerLog(const QString& message) {
-    // Parse server log messages and add them to transfer log
-    QString cleanMsg = message.trimmed();
-    
-    // Determine color based on message content
-    QString color = "black";
-    if (cleanMsg.contains("Processing LIST", Qt::CaseInsensitive)) {
-        color = "blue";
-        appendLog("→ " + cleanMsg, color);
-    } else if (cleanMsg.contains("Processing GET", Qt::CaseInsensitive) || 
-               cleanMsg.contains("Sending file", Qt::CaseInsensitive)) {
-        color = "blue";
-        appendLog("→ " + cleanMsg, color);
-    } else if (cleanMsg.contains("Processing PUT", Qt::CaseInsensitive) || 
-               cleanMsg.contains("Receiving file", Qt::CaseInsensitive)) {
-        color = "blue";
-        appendLog("→ " + cleanMsg, color);
-    } else if (cleanMsg.contains("error", Qt::CaseInsensitive) || 
-               cleanMsg.contains("fail", Qt::CaseInsensitive)) {
-        color = "red";
-        appendLog("✗ " + cleanMsg, color);
-    } else if (cleanMsg.contains("success", Qt::CaseInsensitive) || 
-               cleanMsg.contains("completed", Qt::CaseInsensitive)) {
-        color = "green";
-        appendLog("✓ " + cleanMsg, color);
-    } else if (cleanMsg.startsWith("[Protocol]") || 
-               cleanMsg.startsWith("[Server]") || 
-               cleanMsg.startsWith("[Session]")) {
-        appendLog(cleanMsg, color);
+static QString commandName(uint8_t command) {
+    switch (command) {
+        case CMD_LIST: return "LIST";
+        case CMD_GET:  return "GET";
+        case CMD_PUT:  return "PUT";
+        case CMD_PING: return "PING";
+        case CMD_GET_FD: return "GET (fd)";
+        case CMD_SHM_ATTACH: return "SHM ATTACH";
+        default:       return QString("CMD 0x%1").arg(command, 2, 16, QChar('0'));
+    }
+}
+
+void ServerWindow::onServerEvent(const ServerEvent& event) {
+    QString client = QString::fromUtf8(event.clientAddr);
+    QString filename = QString::fromUtf8(event.filename);
+    
+    switch (event.type) {
+        case ServerEventType::SessionOpened:
+            appendLog(QString("Client connected: %1").arg(client), "green");
+            updateClientsList();
+            updateMetrics();
+            break;
+            
+        case ServerEventType::SessionClosed:
+            clientActivity_.erase(event.clientAddr);
+            appendLog(QString("Client disconnected: %1").arg(client), "orange");
+            updateClientsList();
+            updateMetrics();
+            break;
+            
+        case ServerEventType::TransferProgress: {
+            int percent = event.bytesTotal > 0
+                ? static_cast<int>(event.bytesTransferred * 100 / event.bytesTotal) : 100;
+            clientActivity_[event.clientAddr] = QString("%1 %2 %3%")
+                .arg(commandName(event.command))
+                .arg(filename)
+                .arg(percent);
+            updateClientsList();
+            break;
+        }
+            
+        case ServerEventType::CommandCompleted: {
+            clientActivity_.erase(event.clientAddr);
+            
+            QString what = commandName(event.command);
+            if (!filename.isEmpty()) {
+                what += " " + filename;
+            }
+            if (event.bytesTransferred > 0) {
+                what += QString(" (%1 bytes)").arg(event.bytesTransferred);
+            }
+            
+            if (event.success) {
+                appendLog(QString("✓ %1 → %2 completed in %3 ms")
+                              .arg(client).arg(what).arg(event.latency_ms, 0, 'f', 2), "blue");
+            } else {
+                appendLog(QString("✗ %1 → %2 failed after %3 ms")
+                              .arg(client).arg(what).arg(event.latency_ms, 0, 'f', 2), "red");
+            }
+            
+            if (event.command == CMD_GET || event.command == CMD_PUT || event.command == CMD_GET_FD) {
+                updateClientsList();
+                updateMetrics();
+            }
+            break;
+        }
     }
-    // Skip other messages to avoid clutter
 }
@@ -17,9 +17,11 @@
 #include <QListWidget>
 #include <QDateTime>
 #include <memory>
-#include <set>
+#include <map>
 #include "../../include/server.h"
 
+Q_DECLARE_METATYPE(ServerEvent)
+
 class ServerThread : public QThread {
     Q_OBJECT
 public:
@@ -30,7 +32,7 @@ public:
     void requestStop() { stopRequested_ = true; }
     
 signals:
-    void logMessage(const QString& message);
+    void serverEvent(const ServerEvent& event);
     
 private:
     Server* server_;
@@ -55,7 +57,7 @@ private slots:
     void onQuitClicked();
     void updateStatus();
     void updateMetrics();
-    void onServerLog(const QString& message);
+    void onServerEvent(const ServerEvent& event);
 
 private:
     void setupUI();
@@ -113,11 +115,8 @@ private:
     bool verboseMode;
     QDateTime serverStartTime;
     
-    // Track previous state for change detection
-    std::set<std::string> previousClients_;
-    uint64_t previousFilesSent_;
-    uint64_t previousFilesReceived_;
-    uint64_t previousTotalConnections_;
+    // Transfer in progress per client, shown next to the client address
+    std::map<std::string, QString> clientActivity_;
 };
 
 #endif // SERVERWINDOW_H
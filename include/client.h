@@ -3,6 +3,7 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
 #include "core/Client/client_metrics.h"
 #include "core/Client/client_socket.h"
 #include "core/Client/client_protocol.h"
@@ -29,8 +30,9 @@ public:
     // Connection Management
     /**
      * @brief Connect to the server
-     * @param ip Server IP address
-     * @param port Server port number
+     * @param ip Server IP address, or "unix:/path" for a server on this host
+     *           ("shm:/path" to also move the session onto shared memory)
+     * @param port Server port number (ignored for Unix sockets)
      * @return true if connection successful, false otherwise
      */
     bool connect(const std::string& ip, uint16_t port);
@@ -67,6 +69,19 @@ public:
      */
     bool getFile(const std::string& filename, const std::string& saveDir = ".");
 
+    /**
+     * @brief Open a server file directly (Unix socket connections only)
+     *
+     * The server passes an open read-only descriptor instead of sending the
+     * data, so the caller can read, mmap or sendfile() it without a copy
+     * through the socket. getFile() uses this automatically over Unix
+     * sockets. The caller must close() the descriptor.
+     * @param filename Name of the file on the server
+     * @param size Receives the file size
+     * @return Descriptor, or -1 if not found or not connected over a Unix socket
+     */
+    int openRemoteFile(const std::string& filename, uint64_t& size);
+
     /**
      * @brief Upload a file to server
      * @param filepath Path to file to upload
@@ -76,10 +91,61 @@ public:
 
     /**
      * @brief Send PING to server to measure RTT
+     *
+     * Over TCP, getMetrics().rtt_ms is then the kernel's smoothed RTT
+     * rather than the measured round trip, which includes the server's
+     * processing time.
      * @return RTT in milliseconds, or 0.0 on failure
      */
     double ping();
 
+    // Progress and Cancellation
+    /**
+     * @brief Register a callback for GET/PUT progress
+     * 
+     * The callback runs on the thread performing the transfer and is invoked
+     * at most once per interval (plus once on completion), so large transfers
+     * cannot flood the receiver.
+     * @param callback Called with (bytes transferred, total bytes); empty to disable
+     * @param intervalMs Minimum time between two progress reports
+     */
+    void setProgressCallback(ProgressCallback callback, int intervalMs = 100);
+
+    /**
+     * @brief Register an observer for GET/PUT progress
+     * 
+     * The observer receives bytes done, instantaneous and smoothed rate and
+     * ETA, throttled to one report per interval. It runs on the transfer
+     * thread and must outlive the client or be unregistered with nullptr.
+     * @param observer Observer to notify (nullptr to disable)
+     * @param intervalMs Minimum time between two progress reports
+     */
+    void setProgressObserver(TransferObserver* observer, int intervalMs = 100);
+
+    /**
+     * @brief Get the progress of the current (or last) transfer
+     * 
+     * Safe to call from any thread, e.g. a monitoring or scheduling thread,
+     * while a transfer is running. Never blocks the transfer.
+     * @return Consistent snapshot of the transfer progress
+     */
+    TransferProgress getTransferProgress() const;
+
+    /**
+     * @brief Cancel the transfer in progress
+     * 
+     * Safe to call from any thread. The running getFile()/putFile() returns
+     * false and the connection is closed, because the stream can no longer
+     * be resynchronised with the server.
+     */
+    void cancelTransfer();
+
+    /**
+     * @brief Check whether the last transfer ended because it was cancelled
+     * @return true if cancelled
+     */
+    bool wasCancelled() const;
+
     // Metrics and Statistics
     /**
      * @brief Get current client metrics
@@ -92,6 +158,12 @@ public:
      */
     void resetMetrics();
 
+    /**
+     * @brief Add counters and history from another client's metrics
+     * @param other Metrics of e.g. a worker connection that has finished
+     */
+    void mergeMetrics(const ClientMetrics& other);
+
     /**
      * @brief Export metrics to CSV file
      * @param filename CSV file path
@@ -117,6 +189,15 @@ public:
      */
     void setTimeout(int seconds);
 
+    /**
+     * @brief Set the TCP options of later connections
+     *
+     * Takes effect on the next connect(); Unix socket connections ignore
+     * it. With cork set, uploads go out corked.
+     * @param tuning Options (see SocketTuning::forProfile())
+     */
+    void setSocketTuning(const SocketTuning& tuning);
+
     /**
      * @brief Enable/disable verbose logging
      * @param enable true to enable, false to disable
@@ -133,8 +214,14 @@ private:
     int timeout_;
     bool verbose_;
 
+    // Progress reporting and cancellation
+    ProgressTracker progress_;
+    std::atomic<bool> cancelRequested_;
+    bool lastCancelled_;
+
     // Helper methods
     void updateMetrics();
+    bool refreshRtt(); // From TCP_INFO; false when not connected over TCP
     void logOperation(const std::string& operation, bool success);
 };
 
@@ -4,37 +4,26 @@
 #include <string>
 #include <chrono>
 #include <atomic>
-#include <vector>
-#include <ctime>
-
-/**
- * @struct RequestRecord
- * @brief Record of a single client request
- */
-struct RequestRecord {
-    std::time_t timestamp;           // When the request was made
-    std::string operation;           // GET, PUT, LIST
-    std::string filename;            // File name (empty for LIST)
-    bool success;                    // Whether request succeeded
-    uint64_t bytes_transferred;      // Bytes transferred
-    double duration_ms;              // Request duration in milliseconds
-    std::string error_msg;           // Error message if failed
-    
-    RequestRecord(const std::string& op, const std::string& file, bool succ, 
-                  uint64_t bytes, double dur, const std::string& err = "")
-        : timestamp(std::time(nullptr)), operation(op), filename(file),
-          success(succ), bytes_transferred(bytes), duration_ms(dur), error_msg(err) {}
-};
+#include "request_history.h"
 
 struct ClientMetrics {
-    double rtt_ms = 0.0;               // Round-trip time in milliseconds
-    double throughput_kbps = 0.0;      // Throughput in kilobits per second
-    double packet_loss_rate = 0.0;     // Packet loss percentage
-    double transfer_latency_ms = 0.0;   // Transfer latency in milliseconds
+    // Written by the transfer thread, safe to read from a monitoring thread.
+    // Over TCP, RTT and loss are the kernel's view of the connection
+    // (TCP_INFO); over a Unix socket, RTT is what ping() measured.
+    std::atomic<double> rtt_ms{0.0};               // Smoothed round-trip time in milliseconds
+    std::atomic<double> rtt_var_ms{0.0};           // RTT variation (TCP only)
+    std::atomic<double> throughput_kbps{0.0};      // Throughput in kilobits per second
+    std::atomic<double> packet_loss_rate{0.0};     // Retransmitted segments, % of segments sent
+    std::atomic<double> request_failure_rate{0.0}; // Failed requests, % of all requests
+    std::atomic<double> transfer_latency_ms{0.0};   // Transfer latency in milliseconds
     
-    // For packet loss calculation
+    // For request failure rate calculation
     std::atomic<uint64_t> total_requests{0};
     std::atomic<uint64_t> failed_requests{0};
+
+    // For packet loss calculation (GET/PUT over TCP)
+    std::atomic<uint64_t> tcp_segments_sent{0};
+    std::atomic<uint64_t> tcp_retransmits{0};
     
     // For throughput calculation
     std::atomic<uint64_t> total_bytes_sent{0};        // Total bytes uploaded (PUT)
@@ -42,18 +31,22 @@ struct ClientMetrics {
     std::atomic<uint64_t> total_transfer_time_ms{0};
     
     // Request history
-    std::vector<RequestRecord> request_history;
+    RequestHistory request_history;   // Bounded ring + per-operation aggregates
     
     // Custom copy constructor and assignment for atomic members
     ClientMetrics() = default;
     
     ClientMetrics(const ClientMetrics& other) 
-        : rtt_ms(other.rtt_ms),
-          throughput_kbps(other.throughput_kbps),
-          packet_loss_rate(other.packet_loss_rate),
-          transfer_latency_ms(other.transfer_latency_ms),
+        : rtt_ms(other.rtt_ms.load()),
+          rtt_var_ms(other.rtt_var_ms.load()),
+          throughput_kbps(other.throughput_kbps.load()),
+          packet_loss_rate(other.packet_loss_rate.load()),
+          request_failure_rate(other.request_failure_rate.load()),
+          transfer_latency_ms(other.transfer_latency_ms.load()),
           total_requests(other.total_requests.load()),
           failed_requests(other.failed_requests.load()),
+          tcp_segments_sent(other.tcp_segments_sent.load()),
+          tcp_retransmits(other.tcp_retransmits.load()),
           total_bytes_sent(other.total_bytes_sent.load()),
           total_bytes_received(other.total_bytes_received.load()),
           total_transfer_time_ms(other.total_transfer_time_ms.load()),
@@ -62,12 +55,16 @@ struct ClientMetrics {
     
     ClientMetrics& operator=(const ClientMetrics& other) {
         if (this != &other) {
-            rtt_ms = other.rtt_ms;
-            throughput_kbps = other.throughput_kbps;
-            packet_loss_rate = other.packet_loss_rate;
-            transfer_latency_ms = other.transfer_latency_ms;
+            rtt_ms.store(other.rtt_ms.load());
+            rtt_var_ms.store(other.rtt_var_ms.load());
+            throughput_kbps.store(other.throughput_kbps.load());
+            packet_loss_rate.store(other.packet_loss_rate.load());
+            request_failure_rate.store(other.request_failure_rate.load());
+            transfer_latency_ms.store(other.transfer_latency_ms.load());
             total_requests.store(other.total_requests.load());
             failed_requests.store(other.failed_requests.load());
+            tcp_segments_sent.store(other.tcp_segments_sent.load());
+            tcp_retransmits.store(other.tcp_retransmits.load());
             total_bytes_sent.store(other.total_bytes_sent.load());
             total_bytes_received.store(other.total_bytes_received.load());
             total_transfer_time_ms.store(other.total_transfer_time_ms.load());
@@ -77,6 +74,15 @@ struct ClientMetrics {
     }
 
     void log_csv(const std::string &filename) const; 
+
+    // Fold in the TCP statistics of one transfer (RTT and loss)
+    void add_transfer_tcp(const TcpTransferStats &tcp);
+
+    // Recompute the rates from the counters
+    void update_rates();
+
+    // Accumulate counters and history of another metrics instance
+    void merge(const ClientMetrics &other);
 };
 
 #endif 
\ No newline at end of file
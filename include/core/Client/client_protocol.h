@@ -3,8 +3,11 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <iosfwd>
 #include "client_socket.h"
 #include "client_metrics.h"
+#include "transfer_progress.h"
 
 class ClientProtocol {
 public: 
@@ -12,17 +15,43 @@ public:
     ~ClientProtocol() = default;
     
     void setMetrics(ClientMetrics* metrics);
+    void setProgressTracker(ProgressTracker* progress);
+    void setCancelFlag(const std::atomic<bool>* cancelFlag);
+    bool wasCancelled() const;
 
     void request_list();
     std::vector<std::string> requestFileList();
     bool request_get(const std::string &filename, 
                      const std::string &save_dir); 
     bool request_put(const std::string &filepath);
+
+    // Unix domain socket only: open a file on the server's side and
+    // receive the descriptor (caller closes it). -1 if not available.
+    int request_get_fd(const std::string &filename, uint64_t &fileSize);
     void request_ping();
     double measureRTT();
 
+    // TCP_INFO summary of the last GET/PUT (empty over Unix sockets);
+    // ends the sampling, so call it once after each transfer
+    TcpTransferStats takeTransferTcp();
+
+    // Size of the file the last GET fetched (0 if it never got that far)
+    uint64_t lastFileSize() const;
+
 private: 
     ClientSocket &socket_;
     ClientMetrics* metrics_;
+
+    // Progress reporting and cancellation
+    ProgressTracker* progress_;
+    const std::atomic<bool>* cancelFlag_;
+    bool cancelled_;
+    uint64_t lastFileSize_;
+
+    TcpTransferSampler tcp_;
+
+    bool cancelRequested();
+    bool getViaDescriptor(const std::string &filename, const std::string &save_dir);
+    bool putSmallFile(std::ifstream &inFile, const std::string &filename, uint64_t fileSize);
 };
 #endif // CLIENT_PROTOCOL_H
\ No newline at end of file
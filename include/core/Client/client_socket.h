@@ -4,23 +4,49 @@
 #include <string>
 #include <memory>
 #include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "core/shm_channel.h"
+#include "core/tcp_stats.h"
+#include "core/socket_tuning.h"
 
 class ClientSocket {
 public:
     ClientSocket();
     ~ClientSocket();
 
+    // "unix:/path" connects to a Unix domain socket and ignores the port;
+    // "shm:/path" does too, then moves the session onto shared-memory rings
     bool connectToServer(const std::string& ip, uint16_t port);
+    bool connectUnix(const std::string& path);
+    bool attachSharedMemory();
     void disconnect();
 
     ssize_t sendData(const uint8_t* data, size_t size);
+    ssize_t sendVectored(struct iovec* iov, int iovcnt);
     ssize_t receiveData(uint8_t* buffer, size_t size);
 
+    // Like receiveData; a descriptor passed along (SCM_RIGHTS) ends up in
+    // passedFd, which the caller must close. passedFd is -1 if none came.
+    ssize_t receiveWithFd(uint8_t* buffer, size_t size, int& passedFd);
+
     bool isConnected() const;
     int getSocketFd() const;
+    bool isLocal() const; // Connected over a Unix domain socket
+    bool usesSharedMemory() const;
+    bool sampleTcpStats(TcpStats& stats) const; // false unless connected over TCP
+
+    // Applied to TCP connections made afterwards, before connect()
+    void setTuning(const SocketTuning& tuning);
+    const SocketTuning& getTuning() const;
+    void setCork(bool on); // TCP_CORK, if the tuning asks for it
 
 private:
     int socketFd_;
+    bool local_;
+    std::unique_ptr<ShmChannel> channel_; // Carries all data once attached
+    SocketTuning tuning_;
 };
 
 
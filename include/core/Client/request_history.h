@@ -0,0 +1,156 @@
+#ifndef REQUEST_HISTORY_H
+#define REQUEST_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include "core/tcp_stats.h"
+
+/**
+ * @struct RequestRecord
+ * @brief Compact record of a single client request
+ *
+ * Operation names and error messages are interned (see internRequestString),
+ * and the file name is stored inline, so a record never owns heap memory.
+ */
+struct RequestRecord {
+    static constexpr size_t MAX_FILENAME = 64;
+
+    std::time_t timestamp = 0;       // When the request was made
+    uint64_t bytes_transferred = 0;  // Bytes transferred
+    float duration_ms = 0.0f;        // Request duration in milliseconds
+    uint16_t operation_id = 0;       // Interned GET, PUT, LIST, ...
+    uint16_t error_id = 0;           // Interned error message (0 = none)
+    bool success = false;            // Whether request succeeded
+    char filename[MAX_FILENAME] = {0}; // File name (empty for LIST), truncated
+    TcpTransferStats tcp;            // GET/PUT over TCP: RTT, cwnd, retransmits, bound
+
+    const std::string& operation() const;
+    const std::string& errorMessage() const;
+};
+
+/**
+ * @brief Intern a short string (operation name or error message)
+ * @param value String to intern
+ * @return Stable id; id 0 is the empty string. When the table is full the
+ *         id of "<other>" is returned.
+ */
+uint16_t internRequestString(const std::string& value);
+
+/**
+ * @brief Look up an interned string
+ * @param id Id returned by internRequestString
+ * @return The string, or an empty string for unknown ids
+ */
+const std::string& requestStringById(uint16_t id);
+
+/**
+ * @struct RequestStats
+ * @brief Streaming aggregate for one operation type
+ */
+struct RequestStats {
+    // Latency buckets: bucket i holds durations in [2^(i-1), 2^i) microseconds
+    static constexpr size_t LATENCY_BUCKETS = 40;
+
+    uint64_t count = 0;
+    uint64_t failures = 0;
+    uint64_t bytes = 0;
+    double total_duration_ms = 0.0;
+    double min_duration_ms = 0.0;
+    double max_duration_ms = 0.0;
+    uint64_t latency_histogram[LATENCY_BUCKETS] = {0};
+
+    void add(bool success, uint64_t bytes, double duration_ms);
+    void merge(const RequestStats& other);
+    double averageDurationMs() const;
+    double percentileMs(double percentile) const;
+};
+
+/**
+ * @class RequestHistory
+ * @brief Fixed-capacity ring buffer of recent requests plus per-op aggregates
+ *
+ * Only the most recent capacity() records are kept; older ones are
+ * overwritten. Aggregates (count, bytes, latency histogram) cover every
+ * request ever recorded, so summaries don't need the full history. Records
+ * can optionally be spilled to a binary log file for offline analysis.
+ *
+ * All methods are thread-safe.
+ */
+class RequestHistory {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    explicit RequestHistory(size_t capacity = DEFAULT_CAPACITY);
+    ~RequestHistory();
+    RequestHistory(const RequestHistory& other);
+    RequestHistory& operator=(const RequestHistory& other);
+
+    // Recording (same signature as the old vector-based history)
+    void emplace_back(const std::string& operation, const std::string& filename, bool success,
+                      uint64_t bytes, double duration_ms, const std::string& error = "",
+                      const TcpTransferStats& tcp = TcpTransferStats());
+
+    // Recent records, oldest first
+    size_t size() const;
+    bool empty() const;
+    size_t capacity() const;
+    RequestRecord at(size_t index) const;
+    std::vector<RequestRecord> recent(size_t limit = 0) const;
+
+    // Aggregates
+    uint64_t totalRecorded() const;
+    RequestStats statsFor(const std::string& operation) const;
+    std::vector<std::pair<std::string, RequestStats>> allStats() const;
+
+    // Configuration
+    void setCapacity(size_t capacity);
+    void clear();
+    void merge(const RequestHistory& other);
+
+    /**
+     * @brief Append every new record to a binary log file
+     *
+     * A new or empty file gets a header with the format version. An
+     * existing log is only appended to when its header carries the version
+     * this build writes; otherwise (an older layout, or not a log at all)
+     * this refuses with an error and leaves the file untouched.
+     * @param path Log file
+     * @return false if the file cannot be opened or has another format
+     */
+    bool enableSpill(const std::string& path);
+    void disableSpill();
+    bool isSpilling() const;
+
+    /**
+     * @brief Read back a spill log written by this build
+     *
+     * Names in the log are interned in this process, so the records'
+     * operation() and errorMessage() work as usual.
+     * @param path Log file
+     * @param records Receives the records, oldest first (those before any damage)
+     * @return false if the file is missing, has another format or is cut short
+     */
+    static bool readSpill(const std::string& path, std::vector<RequestRecord>& records);
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<RequestRecord> ring_;
+    size_t capacity_;
+    size_t head_;   // Next slot to write
+    size_t count_;  // Valid records in ring_
+    uint64_t totalRecorded_;
+    std::vector<RequestStats> stats_; // Indexed by operation_id
+
+    std::FILE* spillFile_;
+    std::vector<bool> spilledNames_;
+
+    void appendLocked(const RequestRecord& record);
+    void spillLocked(const RequestRecord& record);
+    void spillNameLocked(uint16_t id);
+};
+
+#endif // REQUEST_HISTORY_H
@@ -0,0 +1,110 @@
+#ifndef TRANSFER_PROGRESS_H
+#define TRANSFER_PROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// Called with (bytes transferred so far, total bytes) during GET/PUT
+using ProgressCallback = std::function<void(uint64_t, uint64_t)>;
+
+/**
+ * @enum TransferDirection
+ * @brief Direction of a file transfer
+ */
+enum class TransferDirection : uint8_t {
+    None,
+    Download,   // GET
+    Upload      // PUT
+};
+
+/**
+ * @struct TransferProgress
+ * @brief Point-in-time view of a GET/PUT transfer
+ */
+struct TransferProgress {
+    TransferDirection direction = TransferDirection::None;
+    uint64_t bytesDone = 0;
+    uint64_t bytesTotal = 0;
+    double instantRate_Bps = 0.0;   // Rate over the last sampling interval
+    double smoothedRate_Bps = 0.0;  // Exponentially smoothed rate
+    double eta_s = 0.0;             // Estimated time remaining (smoothed rate)
+    double elapsed_s = 0.0;
+    bool active = false;            // Transfer in progress
+    bool success = false;           // Valid once active is false
+};
+
+/**
+ * @class TransferObserver
+ * @brief Receives throttled progress reports for GET/PUT transfers
+ *
+ * Callbacks run on the transfer thread and must not block for long.
+ */
+class TransferObserver {
+public:
+    virtual ~TransferObserver() = default;
+    virtual void onTransferStarted(const TransferProgress& progress) { (void)progress; }
+    virtual void onTransferProgress(const TransferProgress& progress) = 0;
+    virtual void onTransferFinished(const TransferProgress& progress) { (void)progress; }
+};
+
+/**
+ * @class ProgressTracker
+ * @brief Tracks transfer progress and publishes it to observers and monitors
+ *
+ * The transfer thread calls update() once per chunk. That only stores the
+ * byte count; rates and ETA are recomputed once per sampling interval, which
+ * is also when the observer and callback are invoked. Nothing allocates on
+ * the per-chunk path.
+ *
+ * snapshot() may be called from any thread. The state is published through a
+ * sequence lock, so a monitor always sees a consistent record without ever
+ * blocking the transfer.
+ */
+class ProgressTracker {
+public:
+    ProgressTracker();
+
+    void setObserver(TransferObserver* observer);
+    void setCallback(ProgressCallback callback);
+    void setInterval(int intervalMs);
+    void setSmoothing(double alpha);
+
+    void begin(TransferDirection direction, uint64_t bytesTotal);
+    void update(uint64_t bytesDone);
+    void finish(bool success);
+
+    TransferProgress snapshot() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Transfer-thread state
+    TransferObserver* observer_;
+    ProgressCallback callback_;
+    int intervalMs_;
+    double alpha_;
+    TransferProgress current_;
+    Clock::time_point startTime_;
+    Clock::time_point lastSampleTime_;
+    uint64_t lastSampleBytes_;
+
+    // Published state (seqlock)
+    mutable std::atomic<uint64_t> sequence_;
+    std::atomic<uint8_t> pubDirection_;
+    std::atomic<uint64_t> pubBytesDone_;
+    std::atomic<uint64_t> pubBytesTotal_;
+    std::atomic<double> pubInstantRate_;
+    std::atomic<double> pubSmoothedRate_;
+    std::atomic<double> pubEta_;
+    std::atomic<double> pubElapsed_;
+    std::atomic<bool> pubActive_;
+    std::atomic<bool> pubSuccess_;
+
+    void sample(Clock::time_point now);
+    void publish();
+    void deliver();
+};
+
+#endif // TRANSFER_PROGRESS_H
@@ -6,7 +6,17 @@
 #include <memory>
 #include <atomic>
 #include <chrono>
+#include <vector>
+#include <mutex>
+#include <functional>
 #include "server_metrics.h"
+#include "server_events.h"
+#include "file_cache.h"
+#include "fd_cache.h"
+#include "session_reaper.h"
+#include "rate_limiter.h"
+#include "server_protocol.h"
+#include "core/tcp_stats.h"
 
 /**
  * @class ClientSession
@@ -14,31 +24,59 @@
  * 
  * Manages the lifecycle of a client connection, including
  * socket handling, protocol processing, and metrics tracking.
+ * The session thread keeps the session alive until it returns, and
+ * reports the end of the session through the callback set with
+ * setOnFinished(), so the owner never has to poll for finished sessions.
  */
-class ClientSession {
+class ClientSession : public std::enable_shared_from_this<ClientSession> {
 public:
-    ClientSession(int clientFd, const std::string& clientAddr, std::shared_ptr<std::string> sharedDir, ServerMetrics* metrics);
+    ClientSession(int clientFd, const std::string& clientAddr, std::shared_ptr<std::string> sharedDir, ServerMetrics* metrics,
+                  ServerEventQueue* events = nullptr, FileCache* cache = nullptr,
+                  FileDescriptorCache* fds = nullptr);
     ~ClientSession();
-    void start();
-    void stop();
+    void setCpuAffinity(const std::vector<int>& cpus);
+    void setWatch(std::shared_ptr<SessionWatch> watch);
+    void setRateLimiter(RateLimiter* limiter);
+    void setSharedMemory(size_t ringCapacity);
+    void setCommandProfiling(bool enable);
+    void setSessionStatsProvider(const SessionStatsProvider* provider); // Must outlive the session
+    void setCork(bool enable); // TCP_CORK around responses (TCP connections only)
+    void setOnFinished(std::function<void()> onFinished); // Runs last on the session thread
+    void start();  // Session must be owned by a std::shared_ptr
+    void stop();   // Shuts the socket down so a blocked session thread wakes
+    void drain();  // Finishes the command in flight, then closes
     bool isActive() const;
     std::string getClientAddress() const;
     std::chrono::system_clock::time_point getStartTime() const;
     size_t getBytesTransferred() const;
+    bool sampleTcpStats(TcpStats& stats); // false once closed, or not a TCP connection
 
 private:
     int clientFd_;
     std::string clientAddr_;
     std::shared_ptr<std::string> sharedDir_;
     ServerMetrics* metrics_;
-    std::unique_ptr<std::thread> thread_;
+    ServerEventQueue* events_;
+    FileCache* cache_;
+    FileDescriptorCache* fds_;
+    std::mutex fdMutex_; // stop() must not shut down an fd number cleanup() already released
     std::atomic<bool> active_;
+    std::atomic<bool> servedCommand_; // A drain closes idle sessions only once they have
     std::chrono::system_clock::time_point startTime_;
     std::atomic<size_t> bytesTransferred_;
+    std::vector<int> cpus_; // Applied by the session thread before it allocates anything
+    std::shared_ptr<SessionWatch> watch_; // Timeout enforcement (may be null)
+    RateLimiter* limiter_;                // Bandwidth limits (may be null)
+    size_t shmCapacity_;                  // Offered to Unix socket clients (0 = off)
+    bool commandProfiling_;               // perf counters per command
+    const SessionStatsProvider* sessionStats_; // Answers SESSION_STATS (may be null)
+    bool cork_;
+    std::function<void()> onFinished_;
 
     // Session handling
     void handleSession();
     void cleanup();
+    void publishSessionEvent(ServerEventType type);
 };
 
 #endif // CLIENT_SESSION_H
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @struct CpuInfo
+ * @brief Placement of one logical CPU
+ */
+struct CpuInfo {
+    int cpu = 0;          // Logical CPU number
+    int core = 0;         // core_id within the package
+    int package = 0;      // Physical socket
+    int node = 0;         // NUMA node
+    bool allowed = true;  // In this process's affinity mask (cgroups/taskset)
+};
+
+/**
+ * @class CpuTopology
+ * @brief CPU/NUMA layout read from sysfs, plus thread pinning helpers
+ *
+ * detect() reads /sys/devices/system/cpu and /sys/devices/system/node;
+ * when sysfs is unavailable every CPU in the process affinity mask is
+ * reported as its own core on node 0, so callers never need a special
+ * case for "no topology".
+ *
+ * CPU lists use the kernel's cpulist syntax: "0-3,8,10-11".
+ */
+class CpuTopology {
+public:
+    static CpuTopology detect();
+
+    const std::vector<CpuInfo>& cpus() const;
+    size_t nodeCount() const;
+
+    /**
+     * @brief NUMA node of a CPU (0 when the CPU is unknown)
+     */
+    int nodeOf(int cpu) const;
+
+    /**
+     * @brief Check that a CPU exists and this process may run on it
+     */
+    bool isUsable(int cpu) const;
+
+    /**
+     * @brief Human-readable table of CPUs grouped by node
+     */
+    std::string describe() const;
+
+    static bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+    static std::string formatCpuList(const std::vector<int>& cpus);
+
+    /**
+     * @brief Restrict the calling thread to the given CPUs
+     * @return false if the list is empty or the kernel rejected it
+     */
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+    /**
+     * @brief CPUs the calling thread may currently run on
+     */
+    static std::vector<int> currentAffinity();
+
+    /**
+     * @brief CPU the calling thread is running on right now (-1 if unknown)
+     */
+    static int currentCpu();
+
+private:
+    std::vector<CpuInfo> cpus_;
+    size_t nodeCount_ = 1;
+};
+
+#endif // CPU_TOPOLOGY_H
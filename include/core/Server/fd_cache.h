@@ -0,0 +1,100 @@
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <sys/stat.h>
+
+/**
+ * @class OpenFile
+ * @brief Owns a read-only file descriptor; closes it on destruction
+ *
+ * Shared between sessions through shared_ptr. Readers must use positional
+ * I/O (pread, sendfile with an explicit offset) so they never disturb each
+ * other's file position.
+ */
+class OpenFile {
+public:
+    explicit OpenFile(int fd);
+    ~OpenFile();
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+
+    int fd() const;
+
+private:
+    int fd_;
+};
+
+using OpenFilePtr = std::shared_ptr<OpenFile>;
+
+/**
+ * @class FileDescriptorCache
+ * @brief Bounded LRU of open descriptors for files in the shared directory
+ *
+ * Files are resolved relative to a cached descriptor of the shared directory
+ * (fstatat/openat), so a GET costs one fstatat() instead of building the
+ * full path and doing stat() + open() + close(). An entry is only reused
+ * while inode, size and mtime still match what fstatat() reports; PUT
+ * replaces files by rename, which gives them a new inode, and also calls
+ * invalidate() directly.
+ *
+ * Evicted or invalidated descriptors stay open until the last session using
+ * them lets go of its OpenFilePtr.
+ */
+class FileDescriptorCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    explicit FileDescriptorCache(size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Get an open descriptor for a file in the shared directory
+     * @param directory Shared directory (the cache follows directory changes)
+     * @param name File name inside the directory; empty names, ".", ".."
+     *             and anything with a '/' are refused
+     * @param st Receives the file's stat()
+     * @return Open file, or nullptr if it doesn't exist, isn't a regular file
+     *         or the name is refused
+     */
+    OpenFilePtr acquire(const std::string& directory, const std::string& name, struct stat& st);
+
+    /**
+     * @brief Open a file without caching (same contract as acquire)
+     */
+    static OpenFilePtr openUncached(const std::string& directory, const std::string& name, struct stat& st);
+
+    void invalidate(const std::string& name);
+    void clear();
+
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    struct Entry {
+        std::string name;
+        OpenFilePtr file;
+        ino_t inode;
+        off_t size;
+        struct timespec mtime;
+    };
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_; // Most recently used at the front
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t capacity_;
+    std::string directory_;
+    OpenFilePtr directoryFd_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+
+    OpenFilePtr directoryHandle(const std::string& directory);
+};
+
+#endif // FD_CACHE_H
@@ -0,0 +1,119 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <sys/stat.h>
+#include "server_metrics.h"
+
+/**
+ * @class FileCache
+ * @brief In-memory cache of hot file contents shared by all sessions
+ *
+ * Holds whole files up to maxFileSize() bytes within a byte budget. Eviction
+ * follows S3-FIFO: new files enter a small probationary FIFO (10% of the
+ * budget) and are only promoted to the main FIFO if they are read again
+ * before reaching its tail. A one-off scan over many files therefore cycles
+ * through the small queue without flushing the hot set. Keys evicted from
+ * the small queue are remembered in a ghost list, so a file that comes back
+ * soon afterwards goes straight to the main queue.
+ *
+ * Entries are keyed by full path (shared directory + name), so servers or
+ * directory switches sharing one cache never mix up equally named files.
+ *
+ * Entries are validated against the caller's stat() result (inode, size,
+ * mtime), so a file changed on disk behind the server's back is never served
+ * stale. Contents are handed out as shared_ptr so a session can keep sending
+ * a buffer while another session evicts or replaces it.
+ *
+ * Hit, miss and eviction counts go to ServerMetrics when one is attached.
+ */
+class FileCache {
+public:
+    static constexpr size_t DEFAULT_MAX_FILE_SIZE = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_CAPACITY_BYTES = 64 * 1024 * 1024;
+
+    using Buffer = std::shared_ptr<const std::string>;
+
+    explicit FileCache(size_t capacityBytes = DEFAULT_CAPACITY_BYTES,
+                       size_t maxFileSize = DEFAULT_MAX_FILE_SIZE);
+
+    void setMetrics(ServerMetrics* metrics);
+
+    /**
+     * @brief Change the byte budget and the largest cacheable file
+     *
+     * Shrinking the budget evicts immediately.
+     */
+    void configure(size_t capacityBytes, size_t maxFileSize);
+
+    /**
+     * @brief Look up a file
+     * @param path Full path of the file
+     * @param st Current stat() of the file
+     * @return Cached contents, or nullptr on miss or stale entry
+     */
+    Buffer lookup(const std::string& path, const struct stat& st);
+
+    /**
+     * @brief Insert or replace a file
+     * @param path Full path of the file
+     * @param st stat() of the file the contents were read from
+     * @param data File contents
+     */
+    void insert(const std::string& path, const struct stat& st, Buffer data);
+
+    /**
+     * @brief Drop a file (e.g. it is being overwritten by PUT)
+     * @param path Full path of the file
+     */
+    void invalidate(const std::string& path);
+
+    void clear();
+
+    size_t maxFileSize() const;
+    size_t capacityBytes() const;
+    size_t sizeBytes() const;
+    size_t entryCount() const;
+    size_t ghostCount() const; // Keys remembered after eviction from the small queue
+
+private:
+    enum class Queue : uint8_t { Small, Main };
+
+    struct Entry {
+        std::string path;
+        Buffer data;
+        ino_t inode;
+        off_t size;
+        struct timespec mtime;
+        Queue queue;
+        uint8_t freq; // Reads since insertion/promotion, saturating at 3
+    };
+
+    using EntryList = std::list<Entry>;
+
+    mutable std::mutex mutex_;
+    EntryList small_;  // Probationary FIFO, newest at the front
+    EntryList main_;   // Main FIFO with second chances, newest at the front
+    std::unordered_map<std::string, EntryList::iterator> index_;
+    std::list<std::string> ghostOrder_; // Oldest ghost at the front
+    std::unordered_map<std::string, std::list<std::string>::iterator> ghost_;
+
+    size_t capacityBytes_;
+    size_t maxFileSize_;
+    size_t smallBytes_;
+    size_t mainBytes_;
+    ServerMetrics* metrics_;
+
+    void evictLocked();
+    void evictSmallLocked();
+    void evictMainLocked();
+    void eraseLocked(EntryList::iterator it);
+    void addGhostLocked(const std::string& path);
+};
+
+#endif // FILE_CACHE_H
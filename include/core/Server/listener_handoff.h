@@ -0,0 +1,66 @@
+#ifndef LISTENER_HANDOFF_H
+#define LISTENER_HANDOFF_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @class ListenerHandoff
+ * @brief Passes listening sockets from a running server to its successor
+ *
+ * The running server keeps a control socket (a Unix socket) open. A new
+ * server process connects to it and asks for the listeners; the old one
+ * sends its listening sockets with SCM_RIGHTS and waits for an
+ * acknowledgement. Only after that does it stop accepting and drain, so
+ * the listening sockets never close: connections arriving in between
+ * queue in the backlog and are accepted by the new process.
+ *
+ * Exchange on the control socket:
+ *   successor   -> REQUEST (1 byte)
+ *   predecessor -> uint32 listener count, with the descriptors attached
+ *   successor   -> ACK (1 byte) once it has adopted them
+ *   predecessor closes its control listener, then the connection; the
+ *   successor binds the control socket path after seeing EOF.
+ *
+ * Only a process running as the same user may take the listeners.
+ */
+class ListenerHandoff {
+public:
+    static constexpr uint8_t REQUEST = 'H';
+    static constexpr uint8_t ACK = 'A';
+    static constexpr int EXCHANGE_TIMEOUT_SECONDS = 5;
+
+    ListenerHandoff();
+    ~ListenerHandoff();
+    ListenerHandoff(const ListenerHandoff&) = delete;
+    ListenerHandoff& operator=(const ListenerHandoff&) = delete;
+
+    /**
+     * @brief Successor: ask the server on path for its listeners
+     * @param path Control socket path
+     * @param listenerFds Receives the listening sockets
+     * @return false if no server answers there (nothing to inherit)
+     */
+    bool requestListeners(const std::string& path, std::vector<int>& listenerFds);
+
+    /**
+     * @brief Successor: confirm the listeners were adopted, then wait
+     *        until the predecessor has let go of the control socket
+     * @return false if the predecessor went away first
+     */
+    bool complete();
+
+    /**
+     * @brief Predecessor: answer one request on an accepted control connection
+     * @param connFd Accepted control connection (not closed here)
+     * @param listenerFds Listening sockets to hand over (stay open here)
+     * @return true if the successor acknowledged; stop accepting then
+     */
+    static bool serve(int connFd, const std::vector<int>& listenerFds);
+
+private:
+    int controlFd_;
+};
+
+#endif // LISTENER_HANDOFF_H
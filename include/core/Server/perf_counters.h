@@ -0,0 +1,65 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Events counted per command (indexes into the value arrays below)
+enum PerfCounter {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTER_COUNT
+};
+
+/**
+ * @class PerfCounterGroup
+ * @brief perf_event_open counters of the thread that created the group
+ *
+ * Opens cycles, instructions, cache misses, context switches and page
+ * faults as one group, so a single read() returns all of them. Counters
+ * the kernel or the VM does not offer are left out; kernel-mode counting
+ * is dropped when perf_event_paranoid forbids it. If nothing can be
+ * opened the group is simply unavailable, without logging, and later
+ * groups in the process do not try again.
+ *
+ * Must be read on the thread that created it.
+ */
+class PerfCounterGroup {
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    bool isAvailable() const;
+
+    /**
+     * @brief Which counters were opened
+     * @return Bit i set for PerfCounter i
+     */
+    unsigned getCounterMask() const;
+
+    /**
+     * @brief Read the running totals
+     *
+     * Totals are scaled up when the kernel had to multiplex the hardware
+     * counters. Counters that are not open read as 0.
+     * @param values Receives PERF_COUNTER_COUNT values
+     * @return false if unavailable or the read failed
+     */
+    bool read(uint64_t values[PERF_COUNTER_COUNT]) const;
+
+    static const char* counterName(PerfCounter counter);
+
+private:
+    int leaderFd_;
+    int fds_[PERF_COUNTER_COUNT];
+    PerfCounter order_[PERF_COUNTER_COUNT]; // Counter behind each value of a group read
+    size_t members_;
+    unsigned mask_;
+};
+
+#endif // PERF_COUNTERS_H
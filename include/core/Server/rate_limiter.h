@@ -0,0 +1,132 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "server_metrics.h"
+
+/**
+ * @class TokenBucket
+ * @brief Lock-free token bucket (GCRA form: one atomic "theoretical arrival time")
+ *
+ * reserve() debits the bucket and returns how long the caller must wait
+ * before sending, so concurrent senders never spin or retry on a lock:
+ * each CAS either wins a slot in the schedule or re-reads the new one.
+ * Up to burstBytes may go out back-to-back after the bucket has been idle.
+ */
+class TokenBucket {
+public:
+    explicit TokenBucket(uint64_t bytesPerSecond = 0);
+
+    /**
+     * @brief Change the rate; burst becomes 100 ms worth (at least 64 KB)
+     * @param bytesPerSecond New rate (0 = unlimited)
+     */
+    void setRate(uint64_t bytesPerSecond);
+    uint64_t rate() const;
+
+    /**
+     * @brief Take bytes from the bucket
+     * @param bytes Bytes about to be transferred
+     * @param nowNs Current steady-clock time in nanoseconds
+     * @return Nanoseconds to wait before transferring them (0 = go now)
+     */
+    int64_t reserve(uint64_t bytes, int64_t nowNs);
+
+private:
+    std::atomic<uint64_t> rate_;
+    std::atomic<int64_t> burstNs_;
+    std::atomic<int64_t> tat_; // When the bucket would be full again
+};
+
+using TokenBucketPtr = std::shared_ptr<TokenBucket>;
+
+/**
+ * @class TransferShaper
+ * @brief The buckets one session's transfers must pass: session, client IP, global
+ *
+ * Owned by the session thread. When no limit is set, active() is false
+ * and the transfer loops skip shaping entirely (no clock reads).
+ */
+class TransferShaper {
+public:
+    TransferShaper(TokenBucketPtr session, TokenBucketPtr client, TokenBucket* global, ServerMetrics* metrics);
+
+    bool active() const;
+
+    /**
+     * @brief Chunk size to use for the next transfer step
+     *
+     * Limited sessions move about 10 ms worth of their tightest limit per
+     * step, so the sender sleeps a few times per second in even steps
+     * instead of bursting a large chunk and then stalling.
+     * @param defaultChunk Chunk size used when unshaped
+     */
+    size_t chunkSize(size_t defaultChunk) const;
+
+    /**
+     * @brief Wait until bytes may be transferred
+     *
+     * Waits shorter than 1 ms are not slept; the debt stays in the buckets
+     * and is paid by a later, longer sleep.
+     * @return Nanoseconds spent sleeping
+     */
+    int64_t pace(size_t bytes);
+
+private:
+    TokenBucketPtr session_;
+    TokenBucketPtr client_;
+    TokenBucket* global_;
+    ServerMetrics* metrics_;
+};
+
+/**
+ * @class RateLimiter
+ * @brief Global, per-client-IP and per-session bandwidth limits
+ *
+ * Limits apply to file data in both directions and can be changed at
+ * any time; running transfers pick up a new rate on their next chunk.
+ * Client buckets are shared by all sessions from the same IP and dropped
+ * once no session uses them.
+ */
+class RateLimiter {
+public:
+    RateLimiter();
+
+    void setMetrics(ServerMetrics* metrics);
+
+    /**
+     * @brief Set all limits in bytes per second (0 = unlimited)
+     */
+    void setLimits(uint64_t globalBytesPerSecond, uint64_t perClientBytesPerSecond,
+                   uint64_t perSessionBytesPerSecond);
+
+    uint64_t globalLimit() const;
+    uint64_t perClientLimit() const;
+    uint64_t perSessionLimit() const;
+
+    /**
+     * @brief Create the shaper for a new session
+     * @param clientAddr "ip:port" of the client
+     */
+    TransferShaper shaperFor(const std::string& clientAddr);
+
+private:
+    TokenBucket global_;
+    std::atomic<uint64_t> perClient_;
+    std::atomic<uint64_t> perSession_;
+    std::atomic<ServerMetrics*> metrics_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, TokenBucketPtr> clients_;
+    std::vector<std::weak_ptr<TokenBucket>> sessions_;
+    size_t sinceSweep_;
+};
+
+#endif // RATE_LIMITER_H
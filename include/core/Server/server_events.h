@@ -0,0 +1,86 @@
+#ifndef SERVER_EVENTS_H
+#define SERVER_EVENTS_H
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "core/tcp_stats.h"
+
+/**
+ * @enum ServerEventType
+ * @brief Kinds of events published by the server
+ */
+enum class ServerEventType : uint8_t {
+    SessionOpened,
+    SessionClosed,
+    TransferProgress,
+    CommandCompleted
+};
+
+/**
+ * @struct ServerEvent
+ * @brief Typed server event delivered to in-process observers (e.g. the GUI)
+ *
+ * Strings are stored inline so that publishing an event never allocates.
+ */
+struct ServerEvent {
+    ServerEventType type = ServerEventType::CommandCompleted;
+    int64_t timestamp_ms = 0;        // Wall clock time (ms since epoch)
+    char clientAddr[64] = {0};       // "ip:port" of the client
+    uint8_t command = 0;             // CMD_* code (0 for session events)
+    char filename[256] = {0};        // File name for GET/PUT
+    uint64_t bytesTransferred = 0;   // Bytes done so far / in total
+    uint64_t bytesTotal = 0;         // Expected size of the transfer
+    double latency_ms = 0.0;         // Command latency (CommandCompleted)
+    bool success = true;
+    TcpTransferStats tcp;            // GET/PUT over TCP (CommandCompleted)
+
+    void setClientAddress(const std::string& addr);
+    void setFilename(const std::string& name);
+};
+
+/**
+ * @class ServerEventQueue
+ * @brief Bounded lock-free multi-producer queue of ServerEvent
+ *
+ * Session threads publish with push() without taking a lock. When the queue
+ * is full the event is dropped and counted, so a slow consumer can never
+ * stall a transfer. The consumer may block in waitPop(); producers only touch
+ * the wakeup mutex when a consumer is actually sleeping.
+ */
+class ServerEventQueue {
+public:
+    explicit ServerEventQueue(size_t capacity = 1024);
+    ~ServerEventQueue() = default;
+
+    ServerEventQueue(const ServerEventQueue&) = delete;
+    ServerEventQueue& operator=(const ServerEventQueue&) = delete;
+
+    bool push(const ServerEvent& event);
+    bool tryPop(ServerEvent& event);
+    bool waitPop(ServerEvent& event, int timeout_ms);
+    uint64_t droppedCount() const;
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        ServerEvent event;
+    };
+
+    std::unique_ptr<Cell[]> buffer_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+    std::atomic<uint64_t> dropped_;
+
+    // Consumer wakeup
+    std::mutex waitMutex_;
+    std::condition_variable waitCv_;
+    std::atomic<bool> consumerWaiting_;
+};
+
+#endif // SERVER_EVENTS_H
@@ -5,6 +5,8 @@
 #include <atomic>
 #include <chrono>
 #include <mutex>
+#include "perf_counters.h"
+#include "core/tcp_stats.h"
 
 /**
  * @struct ServerMetrics
@@ -18,12 +20,37 @@ struct ServerMetrics {
     std::atomic<uint64_t> totalConnections{0};
     std::atomic<uint64_t> activeConnections{0};
     std::atomic<uint64_t> failedConnections{0};
+    std::atomic<uint64_t> sessionsReaped{0};   // Closed by idle/progress/throughput timeouts
 
     // Transfer metrics
     std::atomic<uint64_t> totalBytesReceived{0};
     std::atomic<uint64_t> totalBytesSent{0};
     std::atomic<uint64_t> filesUploaded{0};
     std::atomic<uint64_t> filesDownloaded{0};
+    std::atomic<uint64_t> throttleMicros{0};   // Time transfers waited on bandwidth limits
+
+    // File content cache
+    std::atomic<uint64_t> cacheHits{0};
+    std::atomic<uint64_t> cacheMisses{0};
+    std::atomic<uint64_t> cacheEvictions{0};
+    std::atomic<uint64_t> cacheBytes{0};       // Bytes currently cached
+
+    // Per-command event counts, indexed by opcode (Server::setCommandProfiling)
+    static constexpr size_t COMMAND_PROFILE_SLOTS = 8;
+    struct CommandProfile {
+        std::atomic<uint64_t> commands;
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> events[PERF_COUNTER_COUNT];
+    };
+    CommandProfile commandProfiles[COMMAND_PROFILE_SLOTS];
+    std::atomic<unsigned> profiledCounters{0}; // Bit i: PerfCounter i was measured
+
+    // TCP_INFO over GET/PUT on TCP connections: retransmissions and what
+    // limited each transfer, indexed by TransferBound
+    std::atomic<uint64_t> tcpTransfers{0};
+    std::atomic<uint64_t> tcpSegmentsOut{0};
+    std::atomic<uint64_t> tcpRetransmits{0};
+    std::atomic<uint64_t> transferBounds[TRANSFER_BOUND_COUNT];
 
     // Performance metrics
     double averageThroughput_kbps = 0.0;
@@ -44,6 +71,12 @@ struct ServerMetrics {
      */
     double getUptimeSeconds() const;
 
+    /**
+     * @brief Get file cache hit ratio
+     * @return Hits / (hits + misses), 0 when there were no lookups
+     */
+    double getCacheHitRatio() const;
+
     /**
      * @brief Increment connection counter
      */
@@ -79,6 +112,28 @@ struct ServerMetrics {
      */
     void updateLatency(double latency_ms);
 
+    /**
+     * @brief Add the event counts of one command
+     * @param command Opcode (ignored if out of range)
+     * @param bytes File bytes the command moved
+     * @param events PERF_COUNTER_COUNT deltas
+     * @param counterMask Which of the deltas were measured
+     */
+    void addCommandProfile(uint8_t command, uint64_t bytes, const uint64_t events[PERF_COUNTER_COUNT],
+                           unsigned counterMask);
+
+    /**
+     * @brief Add the TCP statistics of one transfer
+     * @param tcp Result of TcpTransferSampler::end() (ignored if empty)
+     */
+    void addTransferTcp(const TcpTransferStats& tcp);
+
+    /**
+     * @brief Retransmitted share of the segments sent by transfers
+     * @return Percentage, 0 when nothing was sent over TCP
+     */
+    double getRetransmitRate() const;
+
     /**
      * @brief Reset all metrics to zero
      */
@@ -86,6 +141,9 @@ struct ServerMetrics {
 
     /**
      * @brief Export metrics to CSV file
+     *
+     * When commands were profiled, one row per opcode is also appended to
+     * the same name with "_commands" before ".csv".
      * @param filename CSV file path
      */
     void exportToCSV(const std::string& filename) const;
@@ -4,14 +4,55 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
 #include <cstdint>
 #include "server_metrics.h"
+#include "server_events.h"
+#include "file_cache.h"
+#include "fd_cache.h"
+#include "session_reaper.h"
+#include "rate_limiter.h"
+#include "perf_counters.h"
+#include "core/shm_channel.h"
+#include "core/tcp_stats.h"
 
 // Protocol command codes
 #define CMD_LIST 0x01
 #define CMD_GET  0x02
 #define CMD_PUT  0x03
 #define CMD_PING 0x04
+#define CMD_GET_FD 0x05 // Unix domain socket only: reply carries an open fd
+#define CMD_SHM_ATTACH 0x06 // Unix domain socket only: switch to shared-memory rings
+#define CMD_SESSION_STATS 0x07 // Unix domain socket, same user only: per-session TCP statistics
+
+// Files up to this size are always sent from memory with vectored writes
+// (header and data together); larger ones are too when the file cache is on and
+// can hold them
+#define SMALL_FILE_THRESHOLD (64 * 1024)
+
+// Uploads are written to "<prefix>XXXXXX" (mkostemp) in the target's
+// directory and renamed into place
+#define UPLOAD_TEMP_PREFIX ".ft-upload-"
+
+// SESSION_STATS reply: a header, then header.sessions records of
+// header.recordSize bytes each (a reader skips fields it doesn't know)
+struct SessionStatsHeader {
+    uint64_t bytesSent;     // Server totals, as in ServerMetrics
+    uint64_t bytesReceived;
+    uint32_t sessions;
+    uint32_t recordSize;
+};
+
+struct SessionStatsRecord {
+    char clientAddr[64];
+    uint64_t connectedMs;
+    uint32_t isTcp;         // 0: Unix domain socket, tcp is all zero
+    uint32_t reserved;
+    TcpStats tcp;
+};
+
+// Collects one record per open session (set by the owner of the sessions)
+using SessionStatsProvider = std::function<std::vector<SessionStatsRecord>()>;
 
 /**
  * @class ServerProtocol
@@ -19,6 +60,22 @@
  * 
  * Processes client requests according to the file transfer protocol,
  * including LIST, GET, and PUT commands.
+ *
+ * Clients on a Unix domain socket may use GET_FD instead of GET: the reply
+ * is the file size with a read-only descriptor of the file attached
+ * (SCM_RIGHTS), so no file data crosses the socket. Such reads bypass the
+ * bandwidth limits, which only shape data the server sends itself.
+ *
+ * SHM_ATTACH moves a Unix socket session onto a ShmChannel: the reply
+ * carries the ring memfd, and every later command and reply goes through
+ * the rings with unchanged framing. All socket I/O of the handlers goes
+ * through sendBytes()/receiveBytes() for that reason.
+ *
+ * GET and PUT on TCP connections sample TCP_INFO while the data moves;
+ * the summary goes into ServerMetrics and the CommandCompleted event.
+ *
+ * SESSION_STATS is a monitoring query: it answers with the TCP_INFO of
+ * every open session, for local tools running as the server's user.
  */
 class ServerProtocol {
 public:
@@ -27,21 +84,63 @@ public:
     void setSharedDirectory(const std::string& directory);
     void setSharedDirectoryPtr(std::shared_ptr<std::string> directoryPtr);
     void setMetrics(ServerMetrics* metrics);
+    void setEventQueue(ServerEventQueue* events, const std::string& clientAddr);
+    void setFileCache(FileCache* cache);
+    void setDescriptorCache(FileDescriptorCache* fds);
+    void setSessionWatch(SessionWatch* watch);
+    void setShaper(TransferShaper* shaper);
+    void setSharedMemoryCapacity(size_t capacity); // Ring size for SHM_ATTACH (0 = refuse)
+    void setCommandProfiling(bool enable); // perf counters per command into ServerMetrics
+    void setSessionStatsProvider(const SessionStatsProvider* provider); // Answers SESSION_STATS (null = refuse)
+    void setCork(bool enable); // TCP_CORK around multi-write responses (TCP sockets only)
     std::string getSharedDirectory() const;
     bool handleListCommand(int clientFd);
     bool handleGetCommand(int clientFd);
     bool handlePutCommand(int clientFd);
     bool handlePingCommand(int clientFd);
+    bool handleGetFdCommand(int clientFd);
+    bool handleShmAttachCommand(int clientFd);
+    bool handleSessionStatsCommand(int clientFd);
     bool processRequest(int clientFd);
 
 private:
     std::shared_ptr<std::string> sharedDirectory_;
     ServerMetrics* metrics_;
+    ServerEventQueue* events_;
+    std::string clientAddr_;
+    FileCache* cache_;
+    FileDescriptorCache* fds_;
+    SessionWatch* watch_;
+    TransferShaper* shaper_;
+    size_t shmCapacity_;
+    std::unique_ptr<ShmChannel> channel_; // Set once the session attached to rings
+    bool commandProfiling_;
+    std::unique_ptr<PerfCounterGroup> perf_; // Opened by the first command, on the session thread
+    const SessionStatsProvider* sessionStats_;
+    TcpTransferSampler tcp_; // TCP_INFO over each GET/PUT
+    bool cork_;
+
+    // State of the command in flight (for CommandCompleted events)
+    std::string currentFilename_;
+    uint64_t currentBytes_;
+
+    // Upload buffer, allocated by the first PUT on the session's own thread
+    // so its pages are placed on that thread's NUMA node
+    std::vector<uint8_t> receiveBuffer_;
 
     // Helper methods
+    ssize_t sendBytes(int clientFd, const uint8_t* data, size_t size, bool more = false);
+    ssize_t sendVectored(int clientFd, struct iovec* iov, int iovcnt);
+    ssize_t receiveBytes(int clientFd, uint8_t* buffer, size_t size);
+    void cork(int clientFd, bool on); // No-op unless setCork(true)
+    static bool writeAll(int fileFd, const uint8_t* data, size_t size); // Retries short writes and EINTR
     std::vector<std::string> listFiles();
     bool sendFile(int clientFd, const std::string& filename);
+    bool sendCachedFile(int clientFd, const std::string& filename, const std::string& path,
+                        const OpenFile& file, const struct stat& fileStat);
     bool receiveFile(int clientFd, const std::string& filename, uint64_t fileSize);
+    void publishProgress(uint8_t command, uint64_t done, uint64_t total);
+    void publishCompleted(uint8_t command, bool success, double latency_ms, const TcpTransferStats& tcp);
 };
 
 #endif // SERVER_PROTOCOL_H
\ No newline at end of file
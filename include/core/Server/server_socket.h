@@ -4,30 +4,100 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <vector>
+#include <atomic>
+#include <sys/uio.h>
+#include <sys/socket.h>
 
 /**
  * @class ServerSocket
  * @brief Manages server socket operations
  * 
  * Handles server socket creation, binding, listening,
- * and accepting client connections.
+ * and accepting client connections. The listening socket is non-blocking;
+ * acceptConnection() waits in poll() together with an eventfd, so
+ * interrupt() can wake it without touching the socket itself (which may
+ * be shared with another process after a listener handoff).
  */
 class ServerSocket {
 public:
+    static constexpr size_t MAX_PASSED_FDS = 64; // Per sendWithFds()/receiveWithFds() call
+
     ServerSocket();
     ~ServerSocket();
-    bool bind(uint16_t port, int backlog = 10);
+    bool bind(uint16_t port, int backlog = SOMAXCONN);
+
+    /**
+     * @brief Listen on a Unix domain socket instead of TCP
+     *
+     * A leftover socket file nobody listens on is replaced; a live one or
+     * any other kind of file is not. close() removes the socket file.
+     * @param path Filesystem path of the socket
+     * @return false if the path is in use or cannot be bound
+     */
+    bool bindUnix(const std::string& path, int backlog = SOMAXCONN);
+
+    /**
+     * @brief Take over a listening socket inherited from another process
+     * @param fd Listening TCP or Unix socket; owned by this object from now on
+     * @return false if fd is not a listening socket (fd is closed)
+     */
+    bool adopt(int fd);
+
     int acceptConnection(std::string& clientAddr);
+
+    /**
+     * @brief Make acceptConnection() return -1, now and from then on
+     */
+    void interrupt();
+
+    /**
+     * @brief Stop listening: shuts the socket down and removes the socket file
+     */
     void close();
+
+    /**
+     * @brief Close this descriptor only
+     *
+     * For a socket handed to another process: the listening socket stays
+     * up for the other holder, and the socket file stays in place.
+     * Call interrupt() first if a thread may be accepting.
+     */
+    void relinquish();
     bool isListening() const;
     int getSocketFd() const;
-    static ssize_t sendData(int fd, const uint8_t* data, size_t size);
+    uint16_t getPort() const;
+    const std::string& getUnixPath() const;
+    bool setIncomingCpu(int cpu);
+    static int getIncomingCpu(int fd);
+    static ssize_t sendData(int fd, const uint8_t* data, size_t size, bool more = false);
+    static ssize_t sendVectored(int fd, struct iovec* iov, int iovcnt);
     static ssize_t receiveData(int fd, uint8_t* buffer, size_t size);
 
+    /**
+     * @brief Send data with a file descriptor attached (SCM_RIGHTS)
+     *
+     * Only works on Unix domain sockets. The peer gets its own descriptor
+     * for the same open file; passFd stays open here.
+     */
+    static ssize_t sendWithFd(int fd, const uint8_t* data, size_t size, int passFd);
+    static ssize_t sendWithFds(int fd, const uint8_t* data, size_t size, const std::vector<int>& passFds);
+
+    /**
+     * @brief Receive exactly size bytes plus the descriptors sent with them
+     * @param passedFds Receives the descriptors (close-on-exec)
+     * @return size, or -1 (no descriptors are kept) on error or short read
+     */
+    static ssize_t receiveWithFds(int fd, uint8_t* buffer, size_t size, std::vector<int>& passedFds);
+    static bool isUnixSocket(int fd);
+
 private:
     int socketFd_;
     uint16_t port_;
     bool listening_;
+    std::string unixPath_; // Socket file to remove on close()
+    int wakeFd_;           // eventfd signalled by interrupt()
+    std::atomic<bool> interrupted_;
 };
 
 #endif // SERVER_SOCKET_H
\ No newline at end of file
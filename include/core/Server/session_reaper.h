@@ -0,0 +1,152 @@
+#ifndef SESSION_REAPER_H
+#define SESSION_REAPER_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include "server_metrics.h"
+
+/**
+ * @class SessionWatch
+ * @brief Activity record a session shares with the SessionReaper
+ *
+ * The session thread only stores timestamps and byte counts (relaxed
+ * atomics, no locks); the reaper reads them when the session's timer
+ * fires. The fd mutex is taken just twice per session: once by release()
+ * and, at most once, by the reaper when it shuts the socket down.
+ */
+class SessionWatch {
+public:
+    explicit SessionWatch(int fd);
+
+    /**
+     * @brief A command arrived: transfer deadlines apply until endCommand()
+     */
+    void beginCommand();
+
+    /**
+     * @brief Report progress of the command in flight
+     * @param bytes Bytes moved so far by this command
+     */
+    void progress(uint64_t bytes);
+
+    /**
+     * @brief The command finished: back to the idle deadline
+     */
+    void endCommand();
+
+    /**
+     * @brief Whether a command is in flight (between beginCommand() and endCommand())
+     */
+    bool isBusy() const;
+
+    /**
+     * @brief The session is about to close its fd; never touch it again
+     */
+    void release();
+
+    /**
+     * @brief Why the reaper shut this session down
+     * @return "idle", "stalled", "too slow", or nullptr if it wasn't reaped
+     */
+    const char* reapReason() const;
+
+private:
+    friend class SessionReaper;
+
+    std::mutex fdMutex_;
+    int fd_;
+    bool released_;
+    std::atomic<bool> busy_;
+    std::atomic<int64_t> lastActivityMs_;
+    std::atomic<int64_t> commandStartMs_;
+    std::atomic<uint64_t> bytes_;
+    std::atomic<const char*> reapReason_;
+};
+
+/**
+ * @class SessionReaper
+ * @brief Enforces idle, progress and minimum-throughput timeouts
+ *
+ * Every watched session has exactly one entry in a hashed timer wheel
+ * (100 ms ticks, 512 slots; entries further out than one revolution just
+ * stay in their slot until their tick comes round). Sessions never touch
+ * the wheel when they make progress: when an entry fires the reaper
+ * recomputes the real deadline from the activity record and either
+ * re-arms it or shuts the socket down, which unblocks the session thread's
+ * recv()/send()/sendfile(). Cost is O(expiring entries) per tick, so 100k
+ * mostly-idle sessions cost a few thousand checks per second.
+ *
+ * Busy sessions are re-checked at least every quarter of the progress
+ * timeout, so a session that goes from idle to stalled is caught within
+ * 1.25x the progress timeout.
+ */
+class SessionReaper {
+public:
+    SessionReaper();
+    ~SessionReaper();
+
+    SessionReaper(const SessionReaper&) = delete;
+    SessionReaper& operator=(const SessionReaper&) = delete;
+
+    /**
+     * @brief Set the limits; takes effect at each session's next check
+     * @param idleSeconds Max time between commands (0 = unlimited)
+     * @param progressSeconds Max time without progress inside a command (0 = unlimited)
+     * @param minBytesPerSecond Average rate a transfer must keep after the
+     *        first progressSeconds (or 5 s) of the command (0 = no floor)
+     */
+    void configure(int idleSeconds, int progressSeconds, uint64_t minBytesPerSecond);
+
+    void setMetrics(ServerMetrics* metrics);
+
+    void start();
+    void stop();
+
+    /**
+     * @brief Start watching a session's socket
+     * @param fd Connected socket owned by the session
+     * @return Activity record the session updates and releases
+     */
+    std::shared_ptr<SessionWatch> watch(int fd);
+
+    /**
+     * @brief Number of sessions with a pending timer
+     */
+    size_t watchedCount() const;
+
+private:
+    struct Timer {
+        std::shared_ptr<SessionWatch> watch;
+        uint64_t tick;
+    };
+
+    static constexpr int64_t TICK_MS = 100;
+    static constexpr size_t SLOTS = 512;
+
+    std::atomic<int> idleSeconds_;
+    std::atomic<int> progressSeconds_;
+    std::atomic<uint64_t> minBytesPerSecond_;
+    std::atomic<ServerMetrics*> metrics_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::vector<Timer>> wheel_;
+    uint64_t currentTick_;
+    int64_t epochMs_;
+    size_t watched_;
+    bool running_;
+    std::unique_ptr<std::thread> thread_;
+
+    void run();
+    void processTick(uint64_t tick);
+    int64_t nextCheck(SessionWatch& watch, int64_t nowMs, const char*& reason) const;
+    void reap(SessionWatch& watch, const char* reason);
+    void scheduleLocked(std::shared_ptr<SessionWatch> watch, int64_t atMs);
+};
+
+#endif // SESSION_REAPER_H
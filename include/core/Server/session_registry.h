@@ -0,0 +1,115 @@
+#ifndef SESSION_REGISTRY_H
+#define SESSION_REGISTRY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+class ClientSession;
+
+/**
+ * @class SessionRegistry
+ * @brief Slot map of running sessions with lock-free reads
+ *
+ * add() and remove() are O(1): a slot comes off a free list and goes back
+ * onto it, under a mutex that is never held for more than that. Sessions
+ * remove themselves when their thread finishes, so nobody has to poll
+ * for finished ones.
+ *
+ * size() is one atomic load. clientAddresses() scans the slots without
+ * taking the mutex: each slot keeps its client address in atomic words
+ * behind a sequence counter, and slot storage is allocated in chunks that
+ * never move, so readers (e.g. the GUI's periodic refresh) can never hold
+ * up an acceptor.
+ */
+class SessionRegistry {
+public:
+    using Handle = uint64_t; // Slot index (low 32 bits) + generation (high 32 bits)
+    static constexpr Handle INVALID_HANDLE = ~0ULL;
+
+    SessionRegistry();
+    ~SessionRegistry();
+    SessionRegistry(const SessionRegistry&) = delete;
+    SessionRegistry& operator=(const SessionRegistry&) = delete;
+
+    /**
+     * @brief Register a session
+     * @return Handle for remove(), or INVALID_HANDLE once closed (or full)
+     */
+    Handle add(std::shared_ptr<ClientSession> session, const std::string& clientAddr);
+
+    /**
+     * @brief Drop a session; stale or repeated handles are ignored
+     */
+    void remove(Handle handle);
+
+    size_t size() const;
+    std::vector<std::string> clientAddresses() const;
+
+    /**
+     * @brief The registered sessions right now
+     *
+     * Takes the mutex for the copy, unlike size() and clientAddresses();
+     * meant for occasional queries, not for polling.
+     */
+    std::vector<std::shared_ptr<ClientSession>> sessions() const;
+
+    /**
+     * @brief Refuse further add() calls and stop every registered session
+     */
+    void closeAndStopAll();
+
+    /**
+     * @brief Refuse further add() calls and let every session finish its
+     *        current command, then close
+     */
+    void closeAndDrainAll();
+
+    /**
+     * @brief Block until every session has removed itself
+     */
+    void waitEmpty();
+
+    /**
+     * @brief Like waitEmpty(), up to a deadline
+     * @return true if the registry is empty
+     */
+    bool waitEmptyUntil(std::chrono::steady_clock::time_point deadline);
+
+private:
+    static constexpr size_t CHUNK_SLOTS = 1024;
+    static constexpr size_t MAX_CHUNKS = 1024;  // Up to ~1M concurrent sessions
+    static constexpr size_t ADDRESS_WORDS = 8;  // 63 characters + terminator
+    static constexpr uint32_t NO_SLOT = ~0U;
+
+    struct Slot {
+        // Guarded by mutex_
+        std::shared_ptr<ClientSession> session;
+        uint32_t generation = 0;
+        uint32_t nextFree = NO_SLOT;
+
+        // Readable without the mutex; version is odd while being rewritten
+        std::atomic<uint32_t> version{0};
+        std::atomic<uint64_t> address[ADDRESS_WORDS] = {};
+    };
+
+    Slot& slotAt(uint32_t index) const;
+    std::vector<std::shared_ptr<ClientSession>> closeAndCollect();
+    void publishAddress(Slot& slot, const std::string& clientAddr);
+
+    mutable std::mutex mutex_;
+    std::condition_variable emptyCv_;
+    std::atomic<Slot*> chunks_[MAX_CHUNKS];
+    std::atomic<uint32_t> slotCount_; // Slots ever handed out; readers scan this far
+    uint32_t freeHead_;
+    std::atomic<size_t> size_;
+    bool closed_;
+};
+
+#endif // SESSION_REGISTRY_H
@@ -0,0 +1,147 @@
+#ifndef FAULT_INJECTION_H
+#define FAULT_INJECTION_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+/**
+ * @class FaultInjector
+ * @brief Makes socket and file calls fail on purpose, for robustness tests
+ *
+ * The ft*() wrappers below stand in for send/recv/sendmsg/recvmsg/sendfile
+ * on the data path and pread/write on transfer files. In a normal build
+ * they are the plain system calls. Configured with
+ * -DFILETRANSFER_FAULT_INJECTION=ON (which defines FT_FAULT_INJECTION),
+ * each call first draws its fate: it may move only part of the bytes, or
+ * fail with EINTR, EAGAIN (what a socket timeout looks like) or
+ * ECONNRESET. A reset also aborts the connection for real, so the peer
+ * sees it too. Files only get short counts and EINTR; a regular file
+ * never returns the other two.
+ *
+ * Probabilities come from configure() or, at the first call, from the
+ * FT_FAULTS environment variable, e.g.
+ *   FT_FAULTS="short=0.05,eintr=0.02,eagain=0.001,reset=0.0005,seed=1"
+ * All zero (the default) means no faults even when compiled in.
+ */
+class FaultInjector {
+public:
+    enum class Site { Socket, File };
+
+    struct Config {
+        double shortProbability = 0.0;  // Move a random part of the bytes only
+        double eintrProbability = 0.0;  // Fail with EINTR, nothing moved
+        double eagainProbability = 0.0; // Fail with EAGAIN (sockets only)
+        double resetProbability = 0.0;  // Abort the connection, fail with ECONNRESET (sockets only)
+        uint32_t seed = 0;              // Per-thread generators derive from it (0 = different every run)
+    };
+
+    struct Counts {
+        uint64_t calls = 0; // Calls that went through a draw
+        uint64_t shortCounts = 0;
+        uint64_t eintr = 0;
+        uint64_t eagain = 0;
+        uint64_t resets = 0;
+    };
+
+    /**
+     * @brief Check whether this build has the hooks (FT_FAULT_INJECTION)
+     */
+    static bool compiledIn();
+
+    /**
+     * @brief Set the fault probabilities for every thread
+     *
+     * Overrides FT_FAULTS. Every thread reseeds at its next draw, so with
+     * a fixed seed and the same thread start order a run repeats.
+     */
+    static void configure(const Config& config);
+    static Config getConfig();
+
+    /**
+     * @brief Parse "short=P,eintr=P,eagain=P,reset=P,seed=N" (any subset)
+     * @return false on an unknown key or a probability outside [0, 1]
+     */
+    static bool parse(const std::string& spec, Config& config);
+
+    static Counts getCounts();
+    static void resetCounts();
+
+    /**
+     * @brief Decide the fate of one call
+     * @param site Socket or file call
+     * @param fd Descriptor the call is about (a reset aborts it)
+     * @param len Bytes asked for; lowered for a short count
+     * @return 0 to make the call with len, otherwise the errno to fail with
+     */
+    static int draw(Site site, int fd, size_t& len);
+};
+
+#ifdef FT_FAULT_INJECTION
+#define FT_FAULT_POINT(site, fd, len)                                       \
+    do {                                                                    \
+        int ftError = FaultInjector::draw(FaultInjector::Site::site, fd, len); \
+        if (ftError != 0) {                                                 \
+            errno = ftError;                                                \
+            return -1;                                                      \
+        }                                                                   \
+    } while (0)
+#else
+#define FT_FAULT_POINT(site, fd, len) \
+    do {                              \
+    } while (0)
+#endif
+
+inline ssize_t ftSend(int fd, const void* buf, size_t len, int flags) {
+    FT_FAULT_POINT(Socket, fd, len);
+    return ::send(fd, buf, len, flags);
+}
+
+inline ssize_t ftRecv(int fd, void* buf, size_t len, int flags) {
+    FT_FAULT_POINT(Socket, fd, len);
+    return ::recv(fd, buf, len, flags);
+}
+
+inline ssize_t ftSendfile(int outFd, int inFd, off_t* offset, size_t count) {
+    FT_FAULT_POINT(Socket, outFd, count);
+    return ::sendfile(outFd, inFd, offset, count);
+}
+
+inline ssize_t ftPread(int fd, void* buf, size_t count, off_t offset) {
+    FT_FAULT_POINT(File, fd, count);
+    return ::pread(fd, buf, count, offset);
+}
+
+inline ssize_t ftWrite(int fd, const void* buf, size_t count) {
+    FT_FAULT_POINT(File, fd, count);
+    return ::write(fd, buf, count);
+}
+
+// A short count goes out as a prefix of the first non-empty buffer,
+// ancillary data (passed descriptors) included
+#ifdef FT_FAULT_INJECTION
+ssize_t ftMessageCall(bool sending, int fd, struct msghdr* msg, int flags);
+#endif
+
+inline ssize_t ftSendmsg(int fd, struct msghdr* msg, int flags) {
+#ifdef FT_FAULT_INJECTION
+    return ftMessageCall(true, fd, msg, flags);
+#else
+    return ::sendmsg(fd, msg, flags);
+#endif
+}
+
+inline ssize_t ftRecvmsg(int fd, struct msghdr* msg, int flags) {
+#ifdef FT_FAULT_INJECTION
+    return ftMessageCall(false, fd, msg, flags);
+#else
+    return ::recvmsg(fd, msg, flags);
+#endif
+}
+
+#endif // FAULT_INJECTION_H
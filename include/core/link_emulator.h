@@ -0,0 +1,142 @@
+#ifndef LINK_EMULATOR_H
+#define LINK_EMULATOR_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @struct LinkConditions
+ * @brief What a LinkEmulator does to the bytes crossing it, per direction
+ */
+struct LinkConditions {
+    double rttMs = 0.0;         // Round trip: half of it is added each way
+    double jitterMs = 0.0;      // Each chunk's one-way delay varies by up to this, either way
+    double bandwidthMbps = 0.0; // Bottleneck rate each way (0 = unlimited)
+    size_t queueBytes = 0;      // Bottleneck queue (0 = one BDP, at least 64 KB;
+                                // 4 MB when unlimited)
+    uint64_t resetMeanBytes = 0; // Reset a connection every this many bytes on average (0 = never)
+    uint32_t seed = 0;          // For jitter and resets; runs with the same seed and
+                                // traffic match (0 = different every run)
+};
+
+/**
+ * @class LinkEmulator
+ * @brief TCP relay that delays and rate-limits traffic, for tests on one host
+ *
+ * Listens on a loopback port and forwards every connection to the target,
+ * holding each chunk back until the link would have delivered it: chunks
+ * are serialized at the bandwidth, one after the other, then take half the
+ * RTT (give or take the jitter) to arrive. Jitter never reorders bytes, as
+ * TCP would not hand them over out of order either. When the queue is
+ * full the relay stops reading, so the sender feels the bottleneck as a
+ * full send buffer.
+ *
+ * A reset aborts both sides of a connection with an RST, the way a NAT
+ * or VPN path dropping its state does; data still queued is lost.
+ *
+ * The relay terminates TCP on both sides: each endpoint's kernel sees a
+ * loopback peer, so the added delay shows in request round trips and
+ * transfer times but not in the endpoints' TCP_INFO RTT or congestion
+ * window. No root or qdisc is needed (unlike netem); for RTT-driven kernel
+ * behaviour, use a real or netem link.
+ *
+ * Four threads per connection (a reader and a writer each way), so it is
+ * meant for tests with a handful of connections.
+ */
+class LinkEmulator {
+public:
+    LinkEmulator();
+    ~LinkEmulator();
+
+    /**
+     * @brief Start relaying to a server
+     * @param targetIp IPv4 address of the server
+     * @param targetPort Port of the server
+     * @param conditions Delay and bandwidth to apply
+     * @param listenPort Loopback port to listen on (0 = ephemeral, see getPort())
+     * @return false if the listener cannot be set up
+     */
+    bool start(const std::string& targetIp, uint16_t targetPort, const LinkConditions& conditions,
+               uint16_t listenPort = 0);
+
+    /**
+     * @brief Close the listener and every relayed connection
+     */
+    void stop();
+
+    uint16_t getPort() const;
+    const LinkConditions& getConditions() const;
+    uint64_t getConnectionCount() const; // Relayed since start()
+    uint64_t getBytesRelayed() const;    // Both directions, since start()
+    uint64_t getResetCount() const;      // Connections reset since start()
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Chunk {
+        Clock::time_point deliverAt;
+        std::vector<uint8_t> data;
+    };
+
+    // One direction of a connection: the reader fills the queue, the
+    // writer empties it on schedule
+    struct Direction {
+        int from = -1;
+        int to = -1;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Chunk> queue;
+        size_t queuedBytes = 0;
+        bool eof = false;        // Reader saw the end of the stream
+        bool broken = false;     // Writer could not deliver, or the connection was reset
+        Clock::time_point lineFree; // When the link finishes the last queued chunk
+        Clock::time_point lastDeliverAt; // Jitter must not overtake it
+        std::mt19937 random;     // Used by the reader only
+    };
+
+    struct Connection {
+        int clientFd = -1;
+        int serverFd = -1;
+        Direction up;   // client -> server
+        Direction down; // server -> client
+        std::vector<std::thread> threads;
+        std::atomic<int> running{0};
+        std::atomic<bool> reset{false};
+        ~Connection();
+    };
+
+    int listenFd_;
+    uint16_t port_;
+    std::string targetIp_;
+    uint16_t targetPort_;
+    LinkConditions conditions_;
+    size_t queueLimit_;
+    size_t chunkBytes_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> connections_;
+    std::atomic<uint64_t> bytesRelayed_;
+    std::atomic<uint64_t> resets_;
+    std::thread acceptThread_;
+    std::mutex connectionsMutex_;
+    std::vector<std::unique_ptr<Connection>> active_;
+
+    void acceptLoop();
+    int connectTarget() const;
+    void reapFinished(); // Joins connections whose threads all returned
+    void readLoop(Connection& connection, Direction& direction);
+    void writeLoop(Connection& connection, Direction& direction);
+    void reset(Connection& connection);
+    static void shutdownBoth(Connection& connection);
+};
+
+#endif // LINK_EMULATOR_H
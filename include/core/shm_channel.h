@@ -0,0 +1,124 @@
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * @class ShmChannel
+ * @brief Byte stream between two processes over a pair of shared-memory rings
+ *
+ * The server creates a memfd holding two single-producer/single-consumer
+ * rings, one per direction, and passes it to a client on the same host
+ * over the Unix socket the client connected with. From then on protocol
+ * bytes travel through the rings: a send or receive is a memcpy plus an
+ * index update, and a syscall (futex wake) is only made when the other
+ * side is asleep. On multi-CPU hosts a receiver spins briefly before it
+ * sleeps on the futex.
+ *
+ * The Unix socket stays open as a liveness signal: a sleeping side checks
+ * it regularly, so a peer that exits (or a socket the server shuts down)
+ * ends the wait the same way a closed TCP connection would.
+ *
+ * Each ring has exactly one writer and one reader thread. The indices
+ * live in memory the peer can write, so they are checked before use; a
+ * peer that corrupts them only breaks its own connection. The memfd is
+ * sealed against shrinking and growing before it is passed on, and the
+ * client refuses an unsealed one, so neither side can truncate the rings
+ * and make the other's next access fault (SIGBUS).
+ */
+class ShmChannel {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024 * 1024;
+    static constexpr size_t MIN_CAPACITY = 64 * 1024;
+    static constexpr size_t MAX_CAPACITY = 256 * 1024 * 1024;
+
+    /**
+     * @brief Create the rings (server side)
+     * @param capacity Bytes per direction, rounded up to a power of two
+     * @return Channel, or nullptr if the memfd can't be created or mapped
+     */
+    static std::unique_ptr<ShmChannel> create(size_t capacity);
+
+    /**
+     * @brief Map rings received from the server (client side)
+     * @param memfd Descriptor passed by the server; the channel owns it
+     * @param capacity Bytes per direction, as announced by the server
+     * @return Channel, or nullptr if memfd doesn't hold such rings or
+     *         isn't sealed against resizing
+     */
+    static std::unique_ptr<ShmChannel> attach(int memfd, size_t capacity);
+
+    ~ShmChannel();
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    int memfd() const;
+    size_t capacity() const;
+
+    /**
+     * @brief Socket whose hang-up ends waits on this channel (-1 = none)
+     */
+    void setPeerSocket(int fd);
+
+    /**
+     * @brief Send all bytes, waiting for ring space as needed
+     * @return size, or -1 if the channel was closed
+     */
+    ssize_t send(const uint8_t* data, size_t size);
+    ssize_t sendVectored(const struct iovec* iov, int iovcnt);
+
+    /**
+     * @brief Read file data straight into the ring (sendfile() counterpart)
+     * @param fileFd File to read with pread()
+     * @param offset File offset; advanced by the bytes sent
+     * @param count Maximum bytes to send
+     * @return Bytes sent (0 at end of file), -1 on error or closed channel
+     */
+    ssize_t sendFromFile(int fileFd, off_t* offset, size_t count);
+
+    /**
+     * @brief Receive exactly size bytes unless the channel closes first
+     * @return Bytes received: size, or fewer (possibly 0) if the peer
+     *         closed; -1 if the rings are corrupt
+     */
+    ssize_t receive(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Hang up: wakes the peer, whose pending and later calls fail
+     */
+    void close();
+    bool isClosed() const;
+
+private:
+    struct RingHeader;
+
+    struct Ring {
+        RingHeader* header;
+        uint8_t* data;
+    };
+
+    ShmChannel(int memfd, void* base, size_t mappedSize, size_t capacity, bool serverSide);
+
+    bool waitForData();
+    bool waitForSpace();
+    bool waitUntil(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting, bool forData);
+    bool ready(bool forData) const;
+    bool peerAlive() const;
+    void wake(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting);
+
+    int memfd_;
+    void* base_;
+    size_t mappedSize_;
+    size_t capacity_;
+    Ring tx_; // This side writes
+    Ring rx_; // This side reads
+    int peerFd_;
+    bool spin_;
+};
+
+#endif // SHM_CHANNEL_H
@@ -0,0 +1,79 @@
+#ifndef SOCKET_TUNING_H
+#define SOCKET_TUNING_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @struct SocketTuning
+ * @brief Per-connection TCP options, set once on a socket
+ *
+ * Everything defaults to "leave the kernel alone". Fixed buffer sizes
+ * switch off the kernel's buffer autotuning for that socket, so they only
+ * pay off when sized for the path: forProfile() derives them from the
+ * link's bandwidth-delay product. Options are applied to a listening
+ * socket (accepted connections inherit them) or to a client socket
+ * before connect(), which is when the window scale is chosen.
+ *
+ * cork is not a socket option that stays set: it tells the protocol code
+ * to hold partial segments back (TCP_CORK) while it writes a response or
+ * an upload, and release them when it is done.
+ */
+struct SocketTuning {
+    int sendBufferBytes = 0;     // SO_SNDBUF (0 = autotuning)
+    int receiveBufferBytes = 0;  // SO_RCVBUF (0 = autotuning)
+    bool noDelay = false;        // TCP_NODELAY: no Nagle delay for small writes
+    bool cork = false;           // TCP_CORK around each response and upload
+    std::string congestion;      // TCP_CONGESTION, e.g. "bbr" ("" = system default)
+    uint64_t maxPacingRate = 0;  // SO_MAX_PACING_RATE, bytes/s (0 = unpaced)
+    int notSentLowat = 0;        // TCP_NOTSENT_LOWAT, bytes (0 = unlimited)
+
+    /**
+     * @brief Names accepted by forProfile(), in order of aggressiveness
+     */
+    static std::vector<std::string> profileNames();
+
+    /**
+     * @brief Build a named profile for a link
+     *
+     *  - default:     kernel defaults
+     *  - interactive: TCP_NODELAY plus corked responses; no buffer changes
+     *  - bdp:         interactive, buffers sized to the link's BDP and a
+     *                 TCP_NOTSENT_LOWAT that keeps the unsent backlog small
+     *  - bbr:         bdp with BBR congestion control
+     *  - paced:       bdp paced at the link's bandwidth
+     *
+     * @param linkMbps Bottleneck bandwidth (needed from bdp on)
+     * @param rttMs Round-trip time of the path (needed from bdp on)
+     * @return false for an unknown name, or a link that is not given
+     */
+    static bool forProfile(const std::string& name, double linkMbps, double rttMs, SocketTuning& tuning);
+
+    /**
+     * @brief Bytes in flight that keep a link busy: bandwidth x RTT
+     */
+    static uint64_t bdpBytes(double linkMbps, double rttMs);
+
+    bool isDefault() const;
+    std::string describe() const; // "kernel defaults" or "sndbuf=... nodelay ..."
+
+    /**
+     * @brief Set the options on a TCP socket
+     *
+     * An option the kernel refuses (e.g. a congestion control module that
+     * is not loaded) is logged and skipped; the others are still set.
+     * @return false if any option was refused
+     */
+    bool apply(int fd) const;
+
+    /**
+     * @brief Switch TCP_CORK on or off
+     *
+     * Uncorking sends whatever partial segment is still held back.
+     * @return false if the socket refused it (e.g. not TCP)
+     */
+    static bool setCork(int fd, bool on);
+};
+
+#endif // SOCKET_TUNING_H
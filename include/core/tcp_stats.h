@@ -0,0 +1,127 @@
+#ifndef TCP_STATS_H
+#define TCP_STATS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+/**
+ * @struct TcpStats
+ * @brief Kernel view of one TCP connection (TCP_INFO plus queue sizes)
+ *
+ * Fixed-width fields only, so the struct can be copied between processes
+ * on the same host as it is. Fields an older kernel does not report stay 0.
+ *
+ * The *LimitedUs times tell what held a sender back: rwndLimitedUs grows
+ * while the receiver's window is full (the reader, e.g. its disk, is
+ * slow), sndbufLimitedUs while the send buffer is what runs out, and the
+ * rest of busyUs is the network (cwnd).
+ */
+struct TcpStats {
+    uint32_t rttUs = 0;             // Smoothed round-trip time
+    uint32_t rttVarUs = 0;          // Round-trip time variation
+    uint32_t minRttUs = 0;          // Lowest RTT seen on the connection
+    uint32_t cwnd = 0;              // Congestion window, in segments
+    uint32_t mss = 0;               // Send segment size
+    uint32_t retransmits = 0;       // Consecutive timeouts right now
+    uint32_t totalRetrans = 0;      // Segments retransmitted so far
+    uint32_t lost = 0;              // Segments currently considered lost
+    uint32_t unacked = 0;           // Segments in flight
+    uint32_t notSentBytes = 0;      // Written by the application, not yet sent
+    uint32_t sendQueueBytes = 0;    // Not yet acknowledged, unsent included
+    uint32_t receiveQueueBytes = 0; // Received, not yet read by the application
+    uint64_t deliveryRate = 0;      // Bytes/s, most recent estimate
+    uint64_t bytesAcked = 0;        // Bytes sent and acknowledged
+    uint64_t bytesReceived = 0;
+    uint64_t busyUs = 0;            // Time spent with data to send
+    uint64_t rwndLimitedUs = 0;     // ... of which limited by the receive window
+    uint64_t sndbufLimitedUs = 0;   // ... of which limited by the send buffer
+    uint32_t segmentsOut = 0;       // Segments sent, retransmissions included
+
+    /**
+     * @brief Read the statistics of a connected TCP socket
+     * @param fd Socket
+     * @param stats Receives the values
+     * @param queues Also read the queue sizes (two more syscalls)
+     * @return false if fd is not a TCP socket (e.g. a Unix socket)
+     */
+    static bool sample(int fd, TcpStats& stats, bool queues = true);
+};
+
+/**
+ * @enum TransferBound
+ * @brief What limited a transfer, judged on its sending side
+ */
+enum class TransferBound : uint8_t {
+    Unknown = 0, // Too short to tell, not TCP, or judged on the receiving side
+    Network,     // Data was in flight all along: cwnd and RTT set the pace
+    Receiver,    // The peer's receive window was full: its disk or CPU
+    SendBuffer,  // The local send buffer was full: too small for the path
+    Sender       // Often nothing to send: the sender's own disk or CPU
+};
+
+constexpr size_t TRANSFER_BOUND_COUNT = 5;
+
+const char* transferBoundName(TransferBound bound);
+
+/**
+ * @struct TcpTransferStats
+ * @brief TCP_INFO summary of one transfer (see TcpTransferSampler)
+ *
+ * RTT, cwnd and delivery rate are the last values seen; the counters are
+ * what the transfer added. All zero when the connection is not TCP.
+ */
+struct TcpTransferStats {
+    uint32_t samples = 0;
+    uint32_t rttUs = 0;
+    uint32_t rttVarUs = 0;
+    uint32_t cwnd = 0;
+    uint32_t retransmits = 0;       // Segments retransmitted during the transfer
+    uint32_t segmentsOut = 0;       // Segments sent during the transfer
+    uint32_t maxSendQueueBytes = 0; // Highest send queue seen (periodic samples only)
+    TransferBound bound = TransferBound::Unknown;
+    uint64_t deliveryRate = 0;      // Bytes/s
+    uint64_t busyUs = 0;
+    uint64_t rwndLimitedUs = 0;
+    uint64_t sndbufLimitedUs = 0;
+};
+
+/**
+ * @class TcpTransferSampler
+ * @brief Samples TCP_INFO over the course of one transfer
+ *
+ * begin() takes the baseline, poll() is called once per chunk and samples
+ * at most every INTERVAL_MS (queue sizes included), end() takes the last
+ * sample and classifies the transfer. A transfer costs two getsockopt()
+ * calls plus three syscalls per interval. On a socket that turns out not
+ * to be TCP the sampler stays idle for the rest of the connection.
+ */
+class TcpTransferSampler {
+public:
+    static constexpr int INTERVAL_MS = 100;
+
+    /**
+     * @param fd Connected socket
+     * @param sending true when this side sends the file data (decides
+     *                whether the transfer can be classified)
+     */
+    void begin(int fd, bool sending);
+    void poll();
+    TcpTransferStats end(); // Empty stats when begin() found no TCP socket
+    bool isActive() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int fd_ = -1;
+    int notTcpFd_ = -1; // Last fd that failed, not asked again
+    bool sending_ = false;
+    TcpStats first_;
+    TcpTransferStats result_;
+    Clock::time_point start_;
+    Clock::time_point last_;
+
+    void take(bool queues);
+};
+
+#endif // TCP_STATS_H
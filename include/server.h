@@ -7,10 +7,20 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include "core/Server/server_metrics.h"
 #include "core/Server/server_socket.h"
 #include "core/Server/server_protocol.h"
 #include "core/Server/client_session.h"
+#include "core/Server/session_registry.h"
+#include "core/Server/listener_handoff.h"
+#include "core/Server/server_events.h"
+#include "core/Server/file_cache.h"
+#include "core/Server/fd_cache.h"
+#include "core/Server/cpu_topology.h"
+#include "core/Server/session_reaper.h"
+#include "core/Server/rate_limiter.h"
+#include "core/socket_tuning.h"
 
 /**
  * @class Server
@@ -35,17 +45,73 @@ public:
     // Server Lifecycle
     /**
      * @brief Start the server on specified port
-     * @param port Port number to listen on
+     * @param port Port number to listen on (0 = pick an ephemeral port)
      * @param sharedDir Directory for file sharing
      * @return true if server started successfully, false otherwise
      */
     bool start(uint16_t port, const std::string& sharedDir = "./shared");
 
+    /**
+     * @brief Get the port the server is listening on
+     * @return Bound port (the kernel-chosen one when started on port 0)
+     */
+    uint16_t getPort() const;
+
     /**
      * @brief Stop the server and cleanup
+     *
+     * Closes the listeners, shuts down every session's connection and
+     * waits for the session threads to finish. Waits for a drain() in
+     * progress (e.g. after a listener handoff) instead.
      */
     void stop();
 
+    /**
+     * @brief Stop gracefully: stop accepting, let transfers finish, then stop
+     *
+     * Idle sessions are closed right away; a session in the middle of a
+     * command completes it and then closes. Sessions still busy when the
+     * deadline passes are cut off as by stop().
+     * @param timeoutSeconds Drain deadline
+     * @return true if every session finished before the deadline
+     */
+    bool drain(int timeoutSeconds);
+
+    /**
+     * @brief Enable hot restart through a control Unix socket
+     *
+     * On start(), if a server is running with the same control socket, its
+     * listening sockets (TCP shards and Unix socket) are taken over instead
+     * of binding new ones, so no connection is refused during the switch;
+     * that server then drains (see setDrainTimeout()). Either way this
+     * server then serves the control socket for its own successor.
+     * Must be called before start().
+     * @param path Control socket path ("" = off, the default)
+     * @return false if the server is already running
+     */
+    bool setHandoffSocket(const std::string& path);
+
+    /**
+     * @brief Get the control socket path for hot restart
+     * @return Path, "" when off
+     */
+    std::string getHandoffSocket() const;
+
+    /**
+     * @brief Set how long sessions may drain after a listener handoff
+     * @param seconds Drain deadline (default 30)
+     */
+    void setDrainTimeout(int seconds);
+
+    /**
+     * @brief Check whether the listeners went to a successor process
+     *
+     * run() returns as soon as they have; the drain continues on another
+     * thread and stop() waits for it.
+     * @return true after a handoff
+     */
+    bool wasHandedOff() const;
+
     /**
      * @brief Check if server is running
      * @return true if running, false otherwise
@@ -56,7 +122,9 @@ public:
      * @brief Run the server (blocking call)
      * 
      * This method will block and continuously accept client connections
-     * until stop() is called or an error occurs.
+     * until stop() is called or an error occurs. Shard 0 accepts on the
+     * calling thread; additional shards get their own threads, which are
+     * joined before run() returns.
      */
     void run();
 
@@ -86,6 +154,123 @@ public:
      */
     size_t getMaxConnections() const;
 
+    /**
+     * @brief Set the number of listener shards
+     *
+     * Each shard has its own SO_REUSEPORT listening socket, accept thread
+     * and session table; the kernel spreads incoming connections across
+     * them. Must be called before start().
+     * @param count Number of shards (at least 1)
+     * @return false if the server is already running
+     */
+    bool setListenerShards(size_t count);
+
+    /**
+     * @brief Get the number of listener shards
+     * @return Shard count
+     */
+    size_t getListenerShards() const;
+
+    /**
+     * @brief Get the number of connections accepted by each shard
+     * @return One counter per shard
+     */
+    std::vector<uint64_t> getAcceptedPerShard() const;
+
+    /**
+     * @brief Also accept same-host clients on a Unix domain socket
+     *
+     * The Unix socket gets its own listener shard next to the TCP ones
+     * (the last entry of getAcceptedPerShard()). Clients connect with the
+     * address "unix:<path>" and may receive files as open descriptors
+     * instead of streamed bytes. Must be called before start().
+     * @param path "unix:/path" or a plain path ("" = TCP only)
+     * @return false if the server is already running
+     */
+    bool setUnixSocket(const std::string& path);
+
+    /**
+     * @brief Get the Unix domain socket path
+     * @return Path without the "unix:" prefix, "" when not configured
+     */
+    std::string getUnixSocket() const;
+
+    /**
+     * @brief Offer shared-memory rings to Unix socket clients
+     *
+     * Clients connecting with "shm:<path>" ask to move their session onto
+     * a pair of memfd-backed rings, so commands and file data no longer
+     * cost a socket syscall each. Needs setUnixSocket(); applies to
+     * sessions accepted afterwards.
+     * @param ringBytes Capacity of each direction (0 = refuse, the default)
+     */
+    void setSharedMemoryRings(size_t ringBytes);
+
+    /**
+     * @brief Count CPU events per command with perf_event_open
+     *
+     * Each session thread counts cycles, instructions, cache misses,
+     * context switches and page faults around every command, and the
+     * totals per opcode show up in displayMetrics() and exportMetrics().
+     * Counters the kernel does not permit are left out without an error;
+     * if none are, nothing is recorded. Applies to sessions accepted
+     * afterwards. Off by default.
+     * @param enable true to enable
+     */
+    void setCommandProfiling(bool enable);
+    bool getCommandProfiling() const;
+
+    /**
+     * @brief Pin server threads to CPU sets
+     *
+     * Shard i's accept thread is pinned to the i-th acceptor CPU (wrapping
+     * around). Session threads are pinned to the worker CPUs on the same
+     * NUMA node as the CPU that accepted (or, with steering, received) the
+     * connection, falling back to all worker CPUs. Sessions allocate their
+     * transfer buffers after pinning, so the pages come from that node.
+     * Must be called before start().
+     * @param acceptorCpus CPU list such as "0,1" ("" = don't pin)
+     * @param workerCpus CPU list such as "2-15" ("" = don't pin)
+     * @return false on a malformed list, an unusable CPU, or while running
+     */
+    bool setCpuAffinity(const std::string& acceptorCpus, const std::string& workerCpus);
+
+    /**
+     * @brief Steer connections to the shard on the CPU that received them
+     *
+     * Sets SO_INCOMING_CPU on each shard's listener to its acceptor CPU, so
+     * connections stay on the CPU (and node) handling their interrupts.
+     * Only effective together with acceptor CPUs. Must be called before start().
+     * @param enable true to enable steering
+     */
+    void setIncomingCpuSteering(bool enable);
+
+    /**
+     * @brief Set the TCP options of client connections
+     *
+     * Applied to the TCP listeners, which accepted connections inherit
+     * them from, so a connection costs no extra syscalls. With cork set,
+     * LIST replies and GET responses go out corked. Unix socket
+     * connections are not affected. Must be called before start().
+     * @param tuning Options (see SocketTuning::forProfile())
+     * @return false while running
+     */
+    bool setSocketTuning(const SocketTuning& tuning);
+    const SocketTuning& getSocketTuning() const;
+
+    /**
+     * @brief Get the CPU/NUMA topology detected at construction
+     * @return Topology
+     */
+    const CpuTopology& getCpuTopology() const;
+
+    /**
+     * @brief Configure the in-memory file cache used by GET
+     * @param capacityBytes Total byte budget (0 disables caching)
+     * @param maxFileSize Largest file that may be cached
+     */
+    void setFileCacheLimits(size_t capacityBytes, size_t maxFileSize);
+
     /**
      * @brief Enable/disable verbose logging
      * @param enable true to enable, false to disable
@@ -93,11 +278,40 @@ public:
     void setVerbose(bool enable);
 
     /**
-     * @brief Set connection timeout
-     * @param seconds Timeout in seconds
+     * @brief Set the idle timeout
+     *
+     * A session that sends no command for this long is closed and counted
+     * in ServerMetrics::sessionsReaped. Takes effect while running.
+     * @param seconds Timeout in seconds (0 = never close idle sessions)
      */
     void setTimeout(int seconds);
 
+    /**
+     * @brief Set the limits that apply while a command is in flight
+     *
+     * A GET/PUT (or a half-sent request header) that makes no progress for
+     * progressSeconds is aborted, and so is a transfer whose average rate
+     * is still below minBytesPerSecond once it has run for progressSeconds.
+     * Takes effect while running.
+     * @param progressSeconds Max time without progress (0 = unlimited)
+     * @param minBytesPerSecond Throughput floor (0 = none)
+     */
+    void setTransferTimeouts(int progressSeconds, uint64_t minBytesPerSecond = 0);
+
+    /**
+     * @brief Limit file transfer bandwidth (GET and PUT data)
+     *
+     * Limits are hierarchical: a transfer goes only as fast as the tightest
+     * of the three allows. Takes effect for running transfers too.
+     * Note that a transfer throttled below the minimum throughput set with
+     * setTransferTimeouts() gets reaped.
+     * @param globalBytesPerSecond Whole server (0 = unlimited)
+     * @param perClientBytesPerSecond All sessions from one IP together (0 = unlimited)
+     * @param perSessionBytesPerSecond Each connection (0 = unlimited)
+     */
+    void setBandwidthLimits(uint64_t globalBytesPerSecond, uint64_t perClientBytesPerSecond = 0,
+                            uint64_t perSessionBytesPerSecond = 0);
+
     // Metrics and Statistics
     /**
      * @brief Get current server metrics
@@ -124,6 +338,8 @@ public:
 
     /**
      * @brief Get number of active client sessions
+     *
+     * Neither this nor getActiveClients() takes a lock the accept loops use.
      * @return Number of active sessions
      */
     size_t getActiveSessionCount() const;
@@ -134,31 +350,111 @@ public:
      */
     std::vector<std::string> getActiveClients() const;
 
+    /**
+     * @brief TCP statistics of every open session
+     *
+     * Samples TCP_INFO and the socket queues of each connection now. This
+     * is also what same-user clients on the Unix socket get with
+     * SESSION_STATS (see tests/server_metrics.cpp). Takes each shard's
+     * registry lock briefly, so don't call it in a tight loop.
+     * @return One record per session; Unix socket sessions have isTcp 0
+     */
+    std::vector<SessionStatsRecord> getSessionStats() const;
+
+    // Events
+    /**
+     * @brief Take the next server event without blocking
+     * @param event Receives the event
+     * @return true if an event was available
+     */
+    bool pollEvent(ServerEvent& event);
+
+    /**
+     * @brief Wait for the next server event
+     * @param event Receives the event
+     * @param timeout_ms Maximum time to wait in milliseconds
+     * @return true if an event was received before the timeout
+     */
+    bool waitEvent(ServerEvent& event, int timeout_ms);
+
+    /**
+     * @brief Get number of events dropped because the queue was full
+     * @return Dropped event count
+     */
+    uint64_t getDroppedEventCount() const;
+
 private:
+    /**
+     * @struct ListenerShard
+     * @brief One SO_REUSEPORT listener with its own accept loop and sessions
+     */
+    struct ListenerShard {
+        size_t index = 0;
+        std::unique_ptr<ServerSocket> socket;
+        SessionRegistry sessions; // Sessions deregister themselves when done
+        std::unique_ptr<std::thread> thread;
+        std::atomic<uint64_t> accepted{0};
+        int cpu = -1; // Acceptor CPU, -1 when not pinned
+        bool inherited = false; // Listener taken over from a predecessor
+        bool isUnix = false;
+    };
+
     // Core components
-    std::unique_ptr<ServerSocket> socket_;
     std::unique_ptr<ServerProtocol> protocol_;
     ServerMetrics metrics_;
+    ServerEventQueue events_;
+    FileCache fileCache_;
+    FileDescriptorCache fdCache_;
+    SessionReaper reaper_;
+    RateLimiter rateLimiter_;
+
+    // Listener shards (each owns its sessions)
+    std::vector<std::unique_ptr<ListenerShard>> shards_;
+    size_t shardCount_;
+    std::string unixSocketPath_;
+    size_t shmRingBytes_;
+    std::atomic<bool> commandProfiling_;
+    SessionStatsProvider sessionStatsProvider_; // Handed to sessions for SESSION_STATS
+    SocketTuning socketTuning_;                 // Set on the TCP listeners
 
-    // Session management
-    std::vector<std::unique_ptr<ClientSession>> sessions_;
-    mutable std::mutex sessionsMutex_;
+    // Thread placement
+    CpuTopology topology_;
+    std::vector<int> acceptorCpus_;
+    std::vector<int> workerCpus_;
+    std::vector<int> defaultCpus_; // Affinity of the thread that called start()
+    bool incomingCpuSteering_;
+
+    // Hot restart
+    std::string handoffPath_;
+    std::unique_ptr<ServerSocket> handoffSocket_;
+    std::unique_ptr<std::thread> handoffThread_;
+    std::atomic<bool> handedOff_;
+    int drainTimeout_;
 
     // Server state
+    std::mutex lifecycleMutex_; // Serializes stop(), drain() and handoffs
+    std::mutex acceptLoopsMutex_;
+    std::condition_variable acceptLoopsCv_;
+    size_t acceptLoops_; // Accept loops still running
     std::atomic<bool> running_;
     std::shared_ptr<std::string> sharedDirectory_;
     uint16_t port_;
     size_t maxConnections_;
     int timeout_;
+    int progressTimeout_;
+    uint64_t minTransferRate_;
     bool verbose_;
 
-    // Accept thread
-    std::unique_ptr<std::thread> acceptThread_;
-
     // Helper methods
-    void acceptLoop();
+    void acceptLoop(ListenerShard& shard);
     void handleClient(int clientFd, const std::string& clientAddr);
-    void cleanupFinishedSessions();
+    void joinShardThreads();
+    bool createShards(uint16_t port, std::vector<int>& inherited);
+    void handoffLoop();
+    void stopAccepting();
+    void stopSessions();
+    bool waitAcceptLoops(std::chrono::steady_clock::time_point deadline);
+    std::vector<int> workerCpusNear(int cpu) const;
     void logEvent(const std::string& event);
     bool createSharedDirectory(const std::string& directory);
 };
@@ -12,7 +12,9 @@ Client::Client()
       protocol_(nullptr),
       metrics_{},
       timeout_(30),
-      verbose_(false) {
+      verbose_(false),
+      cancelRequested_(false),
+      lastCancelled_(false) {
 }
 
 // Destructor
@@ -26,18 +28,17 @@ bool Client::connect(const std::string& ip, uint16_t port) {
         std::cout << "[Client] Connecting to " << ip << ":" << port << "...\n";
     }
 
-    auto startTime = std::chrono::high_resolution_clock::now();
-    
     bool success = socket_->connectToServer(ip, port);
     
     if (success) {
         // Initialize protocol after successful connection
         protocol_ = std::make_unique<ClientProtocol>(*socket_);
         protocol_->setMetrics(&metrics_);
+        protocol_->setProgressTracker(&progress_);
+        protocol_->setCancelFlag(&cancelRequested_);
         
-        auto endTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-        metrics_.rtt_ms = duration.count();
+        // The handshake gave the kernel its first RTT sample
+        refreshRtt();
         
         if (verbose_) {
             std::cout << "[Client] Connected successfully (RTT: " << metrics_.rtt_ms << " ms)\n";
@@ -90,12 +91,8 @@ bool Client::listFiles() {
         auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
         double duration_ms = duration_us.count() / 1000.0;
         
-        // Update RTT with exponential moving average
-        if (metrics_.rtt_ms == 0.0) {
-            metrics_.rtt_ms = duration_ms;
-        } else {
-            metrics_.rtt_ms = (metrics_.rtt_ms * 0.7) + (duration_ms * 0.3);
-        }
+        // RTT is the connection's, not this request's duration
+        refreshRtt();
         metrics_.transfer_latency_ms = duration_ms;
         
         // Log to history
@@ -130,12 +127,8 @@ std::vector<std::string> Client::getFileList() {
         auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
         double duration_ms = duration_us.count() / 1000.0;
         
-        // Update RTT with exponential moving average
-        if (metrics_.rtt_ms == 0.0) {
-            metrics_.rtt_ms = duration_ms;
-        } else {
-            metrics_.rtt_ms = (metrics_.rtt_ms * 0.7) + (duration_ms * 0.3);
-        }
+        // RTT is the connection's, not this request's duration
+        refreshRtt();
         metrics_.transfer_latency_ms = duration_ms;
         
         // Log to history
@@ -165,14 +158,22 @@ bool Client::getFile(const std::string& filename, const std::string& saveDir) {
 
     try {
         metrics_.total_requests++;
+        cancelRequested_ = false;
         auto startTime = std::chrono::high_resolution_clock::now();
         
         bool success = protocol_->request_get(filename, saveDir);
+        lastCancelled_ = protocol_->wasCancelled();
+        TcpTransferStats tcp = protocol_->takeTransferTcp();
+        metrics_.add_transfer_tcp(tcp);
         
         if (!success) {
             metrics_.failed_requests++;
-            metrics_.request_history.emplace_back("GET", filename, false, 0, 0.0, "Download failed");
+            metrics_.request_history.emplace_back("GET", filename, false, 0, 0.0,
+                                                  lastCancelled_ ? "Cancelled" : "Download failed", tcp);
             logOperation("get:" + filename, false);
+            if (lastCancelled_) {
+                disconnect();
+            }
             return false;
         }
         
@@ -180,16 +181,11 @@ bool Client::getFile(const std::string& filename, const std::string& saveDir) {
         auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
         double duration_ms = duration_us.count() / 1000.0;
         
-        // Update RTT with exponential moving average
-        if (metrics_.rtt_ms == 0.0) {
-            metrics_.rtt_ms = duration_ms;
-        } else {
-            metrics_.rtt_ms = (metrics_.rtt_ms * 0.7) + (duration_ms * 0.3);
-        }
         metrics_.transfer_latency_ms = duration_ms;
         
         // Log to history
-        metrics_.request_history.emplace_back("GET", filename, true, 0, duration_ms);
+        metrics_.request_history.emplace_back("GET", filename, true, protocol_->lastFileSize(), duration_ms, "",
+                                              tcp);
         
         updateMetrics();
         logOperation("get:" + filename, true);
@@ -203,6 +199,22 @@ bool Client::getFile(const std::string& filename, const std::string& saveDir) {
     }
 }
 
+int Client::openRemoteFile(const std::string& filename, uint64_t& size) {
+    size = 0;
+    if (!isConnected()) {
+        std::cerr << "[Client] Not connected to server\n";
+        return -1;
+    }
+
+    metrics_.total_requests++;
+    int fd = protocol_->request_get_fd(filename, size);
+    if (fd < 0) {
+        metrics_.failed_requests++;
+    }
+    logOperation("open:" + filename, fd >= 0);
+    return fd;
+}
+
 bool Client::putFile(const std::string& filepath) {
     if (!isConnected()) {
         std::cerr << "[Client] Not connected to server\n";
@@ -215,15 +227,23 @@ bool Client::putFile(const std::string& filepath) {
 
     try {
         metrics_.total_requests++;
+        cancelRequested_ = false;
         auto startTime = std::chrono::high_resolution_clock::now();
         
         bool success = protocol_->request_put(filepath);
+        lastCancelled_ = protocol_->wasCancelled();
+        TcpTransferStats tcp = protocol_->takeTransferTcp();
+        metrics_.add_transfer_tcp(tcp);
         
         if (!success) {
             metrics_.failed_requests++;
             std::string filename = filepath.substr(filepath.find_last_of("/\\") + 1);
-            metrics_.request_history.emplace_back("PUT", filename, false, 0, 0.0, "Upload failed");
+            metrics_.request_history.emplace_back("PUT", filename, false, 0, 0.0,
+                                                  lastCancelled_ ? "Cancelled" : "Upload failed", tcp);
             logOperation("put:" + filepath, false);
+            if (lastCancelled_) {
+                disconnect();
+            }
             return false;
         }
         
@@ -231,12 +251,6 @@ bool Client::putFile(const std::string& filepath) {
         auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
         double duration_ms = duration_us.count() / 1000.0;
         
-        // Update RTT with exponential moving average
-        if (metrics_.rtt_ms == 0.0) {
-            metrics_.rtt_ms = duration_ms;
-        } else {
-            metrics_.rtt_ms = (metrics_.rtt_ms * 0.7) + (duration_ms * 0.3);
-        }
         metrics_.transfer_latency_ms = duration_ms;
         
         // Get file size for history
@@ -249,7 +263,7 @@ bool Client::putFile(const std::string& filepath) {
         
         // Log to history
         std::string filename = filepath.substr(filepath.find_last_of("/\\") + 1);
-        metrics_.request_history.emplace_back("PUT", filename, true, fileSize, duration_ms, "");
+        metrics_.request_history.emplace_back("PUT", filename, true, fileSize, duration_ms, "", tcp);
         
         logOperation("put:" + filepath, true);
         return true;
@@ -274,8 +288,8 @@ double Client::ping() {
 
     try {
         double rtt = protocol_->measureRTT();
-        if (rtt > 0) {
-            // Update metrics with new RTT
+        if (rtt > 0 && !refreshRtt()) {
+            // No TCP estimate (Unix socket): smooth the measured round trips
             if (metrics_.rtt_ms == 0.0) {
                 metrics_.rtt_ms = rtt;
             } else {
@@ -289,6 +303,29 @@ double Client::ping() {
     }
 }
 
+// Progress and Cancellation
+void Client::setProgressCallback(ProgressCallback callback, int intervalMs) {
+    progress_.setCallback(std::move(callback));
+    progress_.setInterval(intervalMs);
+}
+
+void Client::setProgressObserver(TransferObserver* observer, int intervalMs) {
+    progress_.setObserver(observer);
+    progress_.setInterval(intervalMs);
+}
+
+TransferProgress Client::getTransferProgress() const {
+    return progress_.snapshot();
+}
+
+void Client::cancelTransfer() {
+    cancelRequested_ = true;
+}
+
+bool Client::wasCancelled() const {
+    return lastCancelled_;
+}
+
 // Metrics and Statistics
 const ClientMetrics& Client::getMetrics() const {
     return metrics_;
@@ -302,6 +339,10 @@ void Client::resetMetrics() {
     }
 }
 
+void Client::mergeMetrics(const ClientMetrics& other) {
+    metrics_.merge(other);
+}
+
 bool Client::exportMetrics(const std::string& filename) const {
     try {
         metrics_.log_csv(filename);
@@ -313,19 +354,25 @@ bool Client::exportMetrics(const std::string& filename) const {
 }
 
 void Client::displayMetrics() const {
-    // Calculate packet loss rate and success count
     uint64_t successful_requests = metrics_.total_requests - metrics_.failed_requests;
-    double packet_loss = 0.0;
+    double failure_rate = 0.0;
     if (metrics_.total_requests > 0) {
-        packet_loss = (static_cast<double>(metrics_.failed_requests) / 
-                      static_cast<double>(metrics_.total_requests)) * 100.0;
+        failure_rate = (static_cast<double>(metrics_.failed_requests) / 
+                       static_cast<double>(metrics_.total_requests)) * 100.0;
     }
     
     std::cout << "\n=== Client Metrics ===\n";
     std::cout << std::fixed << std::setprecision(3);
-    std::cout << "RTT:                 " << metrics_.rtt_ms << " ms\n";
+    std::cout << "RTT:                 " << metrics_.rtt_ms << " ms";
+    if (metrics_.rtt_var_ms > 0.0) {
+        std::cout << " (+/- " << metrics_.rtt_var_ms << " ms)";
+    }
+    std::cout << "\n";
     std::cout << "Throughput:          " << metrics_.throughput_kbps << " kbps\n";
-    std::cout << "Packet Loss Rate:    " << packet_loss << "% "
+    std::cout << "Packet Loss Rate:    " << metrics_.packet_loss_rate << "% "
+              << "(" << metrics_.tcp_retransmits << " retransmitted / "
+              << metrics_.tcp_segments_sent << " segments sent)\n";
+    std::cout << "Request Failures:    " << failure_rate << "% "
               << "(" << metrics_.failed_requests << " failed / " 
               << metrics_.total_requests << " total)\n";
     std::cout << "Transfer Latency:    " << metrics_.transfer_latency_ms << " ms\n";
@@ -345,9 +392,13 @@ void Client::displayHistory(size_t limit) const {
         return;
     }
     
+    // Most recent records, oldest first
+    std::vector<RequestRecord> records = history.recent(limit);
+    
     std::cout << "\n=== Request History ===\n";
-    std::cout << "Total Requests: " << history.size() << "\n";
-    std::cout << "Showing: " << (limit == 0 ? history.size() : std::min(limit, history.size())) << " most recent\n";
+    std::cout << "Total Requests: " << history.totalRecorded()
+              << " (last " << history.size() << " kept)\n";
+    std::cout << "Showing: " << records.size() << " most recent\n";
     std::cout << std::string(90, '-') << "\n";
     std::cout << std::left << std::setw(20) << "Timestamp"
               << std::setw(8) << "Type"
@@ -357,16 +408,8 @@ void Client::displayHistory(size_t limit) const {
               << std::setw(10) << "Duration\n";
     std::cout << std::string(90, '-') << "\n";
     
-    // Determine start position (show most recent first)
-    size_t start = 0;
-    if (limit > 0 && history.size() > limit) {
-        start = history.size() - limit;
-    }
-    
     // Display records
-    for (size_t i = start; i < history.size(); ++i) {
-        const auto& record = history[i];
-        
+    for (const auto& record : records) {
         // Format timestamp
         char time_buf[20];
         std::strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", std::localtime(&record.timestamp));
@@ -390,18 +433,45 @@ void Client::displayHistory(size_t limit) const {
         }
         
         std::cout << std::left << std::setw(20) << time_buf
-                  << std::setw(8) << record.operation
+                  << std::setw(8) << record.operation()
                   << std::setw(35) << display_name
                   << std::setw(10) << (record.success ? "✓ OK" : "✗ FAIL")
                   << std::setw(12) << size_str
                   << std::fixed << std::setprecision(2) << record.duration_ms << " ms\n";
         
-        if (!record.success && !record.error_msg.empty()) {
-            std::cout << "  Error: " << record.error_msg << "\n";
+        if (!record.success && record.error_id != 0) {
+            std::cout << "  Error: " << record.errorMessage() << "\n";
+        }
+        if (record.tcp.samples > 0) {
+            const TcpTransferStats& tcp = record.tcp;
+            std::cout << "  TCP: rtt " << std::setprecision(3) << tcp.rttUs / 1000.0
+                      << " ms +/- " << tcp.rttVarUs / 1000.0 << ", cwnd " << tcp.cwnd
+                      << ", retrans " << tcp.retransmits << "/" << tcp.segmentsOut
+                      << ", delivery " << std::setprecision(1) << tcp.deliveryRate / (1024.0 * 1024.0) << " MB/s"
+                      << ", max sendq " << tcp.maxSendQueueBytes / 1024 << " KB"
+                      << ", bound: " << transferBoundName(tcp.bound) << "\n";
         }
     }
     
     std::cout << std::string(90, '-') << "\n";
+    
+    // Aggregates cover every request, including those no longer in the ring
+    std::cout << std::left << std::setw(8) << "Type"
+              << std::setw(10) << "Count"
+              << std::setw(10) << "Failed"
+              << std::setw(12) << "Avg (ms)"
+              << std::setw(12) << "p50 (ms)"
+              << std::setw(12) << "p99 (ms)" << "\n";
+    for (const auto& entry : history.allStats()) {
+        const RequestStats& stats = entry.second;
+        std::cout << std::left << std::setw(8) << entry.first
+                  << std::setw(10) << stats.count
+                  << std::setw(10) << stats.failures
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(12) << stats.averageDurationMs()
+                  << std::setw(12) << stats.percentileMs(50.0)
+                  << std::setw(12) << stats.percentileMs(99.0) << "\n";
+    }
     std::cout << "=======================\n\n";
 }
 
@@ -414,6 +484,14 @@ void Client::setTimeout(int seconds) {
     }
 }
 
+void Client::setSocketTuning(const SocketTuning& tuning) {
+    socket_->setTuning(tuning);
+
+    if (verbose_) {
+        std::cout << "[Client] Socket tuning set to: " << tuning.describe() << "\n";
+    }
+}
+
 void Client::setVerbose(bool enable) {
     verbose_ = enable;
     
@@ -424,15 +502,7 @@ void Client::setVerbose(bool enable) {
 
 // Private Helper Methods
 void Client::updateMetrics() {
-    // Update packet loss rate
-    uint64_t total = metrics_.total_requests.load();
-    uint64_t failed = metrics_.failed_requests.load();
-    
-    if (total > 0) {
-        metrics_.packet_loss_rate = (failed * 100.0) / total;
-    } else {
-        metrics_.packet_loss_rate = 0.0;
-    }
+    metrics_.update_rates();
     
     if (verbose_) {
         std::cout << "[Client] Metrics updated - RTT: " << metrics_.rtt_ms 
@@ -440,6 +510,16 @@ void Client::updateMetrics() {
     }
 }
 
+bool Client::refreshRtt() {
+    TcpStats tcp;
+    if (!socket_->sampleTcpStats(tcp) || tcp.rttUs == 0) {
+        return false;
+    }
+    metrics_.rtt_ms = tcp.rttUs / 1000.0;
+    metrics_.rtt_var_ms = tcp.rttVarUs / 1000.0;
+    return true;
+}
+
 void Client::logOperation(const std::string& operation, bool success) {
     if (verbose_) {
         std::cout << "[Client] Operation '" << operation << "': " 
@@ -18,7 +18,8 @@ void ClientMetrics::log_csv(const std::string &filename) const {
 
     // Write CSV header if file is new
     if (!fileExists) {
-        outFile << "RTT_ms,Throughput_kbps,Packet_Loss_Rate,Transfer_Latency_ms\n";
+        outFile << "RTT_ms,Throughput_kbps,Packet_Loss_Rate,Transfer_Latency_ms,"
+                << "RTT_Var_ms,Request_Failure_Rate,TCP_Retransmits,TCP_Segments_Sent\n";
     }
 
     // Write metrics data
@@ -26,7 +27,11 @@ void ClientMetrics::log_csv(const std::string &filename) const {
             << rtt_ms << ","
             << throughput_kbps << ","
             << packet_loss_rate << ","
-            << transfer_latency_ms << "\n";
+            << transfer_latency_ms << ","
+            << rtt_var_ms << ","
+            << request_failure_rate << ","
+            << tcp_retransmits << ","
+            << tcp_segments_sent << "\n";
 
     outFile.close();
 
@@ -36,3 +41,47 @@ void ClientMetrics::log_csv(const std::string &filename) const {
         std::cerr << "[Metrics] Error writing to " << filename << "\n";
     }
 }
+
+void ClientMetrics::add_transfer_tcp(const TcpTransferStats &tcp) {
+    if (tcp.samples == 0) {
+        return;
+    }
+    rtt_ms = tcp.rttUs / 1000.0;
+    rtt_var_ms = tcp.rttVarUs / 1000.0;
+    tcp_segments_sent += tcp.segmentsOut;
+    tcp_retransmits += tcp.retransmits;
+    update_rates();
+}
+
+void ClientMetrics::update_rates() {
+    uint64_t total = total_requests.load();
+    request_failure_rate = total > 0 ? (failed_requests.load() * 100.0) / total : 0.0;
+
+    uint64_t segments = tcp_segments_sent.load();
+    packet_loss_rate = segments > 0 ? (tcp_retransmits.load() * 100.0) / segments : 0.0;
+}
+
+void ClientMetrics::merge(const ClientMetrics &other) {
+    total_requests += other.total_requests.load();
+    failed_requests += other.failed_requests.load();
+    tcp_segments_sent += other.tcp_segments_sent.load();
+    tcp_retransmits += other.tcp_retransmits.load();
+    total_bytes_sent += other.total_bytes_sent.load();
+    total_bytes_received += other.total_bytes_received.load();
+    total_transfer_time_ms += other.total_transfer_time_ms.load();
+
+    // Latest instantaneous values win
+    if (other.throughput_kbps > 0.0) {
+        throughput_kbps = other.throughput_kbps.load();
+    }
+    if (other.transfer_latency_ms > 0.0) {
+        transfer_latency_ms = other.transfer_latency_ms.load();
+    }
+    if (other.rtt_ms > 0.0) {
+        rtt_ms = other.rtt_ms.load();
+        rtt_var_ms = other.rtt_var_ms.load();
+    }
+    update_rates();
+
+    request_history.merge(other.request_history);
+}
@@ -4,22 +4,60 @@
 #include <fstream>
 #include <cstring>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <chrono>
+#include <cstdio>
+#include <cerrno>
 
 // Protocol command codes
 #define CMD_LIST 0x01
 #define CMD_GET  0x02
 #define CMD_PUT  0x03
 #define CMD_PING 0x04
+#define CMD_GET_FD 0x05
+
+// Files up to this size are uploaded with a single vectored write
+#define SMALL_FILE_THRESHOLD (64 * 1024)
 
 ClientProtocol::ClientProtocol(ClientSocket &socket) 
-    : socket_(socket), metrics_(nullptr) {
+    : socket_(socket), metrics_(nullptr),
+      progress_(nullptr), cancelFlag_(nullptr), cancelled_(false), lastFileSize_(0) {
 }
 
 void ClientProtocol::setMetrics(ClientMetrics* metrics) {
     metrics_ = metrics;
 }
 
+void ClientProtocol::setProgressTracker(ProgressTracker* progress) {
+    progress_ = progress;
+}
+
+void ClientProtocol::setCancelFlag(const std::atomic<bool>* cancelFlag) {
+    cancelFlag_ = cancelFlag;
+}
+
+bool ClientProtocol::wasCancelled() const {
+    return cancelled_;
+}
+
+TcpTransferStats ClientProtocol::takeTransferTcp() {
+    return tcp_.end();
+}
+
+uint64_t ClientProtocol::lastFileSize() const {
+    return lastFileSize_;
+}
+
+bool ClientProtocol::cancelRequested() {
+    if (cancelFlag_ && cancelFlag_->load(std::memory_order_relaxed)) {
+        cancelled_ = true;
+    }
+    return cancelled_;
+}
+
 void ClientProtocol::request_ping() {
     if (!socket_.isConnected()) {
         std::cerr << "[Protocol] Not connected to server\n";
@@ -67,7 +105,7 @@ double ClientProtocol::measureRTT() {
     ssize_t received = socket_.receiveData(&response, sizeof(response));
     std::cout << "[measureRTT] Received: " << received << " bytes, response: " << (int)response << "\n";
     
-    if (received < 0) {
+    if (received != sizeof(response)) {
         std::cerr << "[measureRTT] Failed to receive PONG\n";
         return 0.0;
     }
@@ -176,29 +214,39 @@ std::vector<std::string> ClientProtocol::requestFileList() {
 }
 
 bool ClientProtocol::request_get(const std::string &filename, const std::string &save_dir) {
+    cancelled_ = false;
+    lastFileSize_ = 0;
     if (!socket_.isConnected()) {
         std::cerr << "[Protocol] Not connected to server\n";
         return false;
     }
 
-    // Send GET command
-    uint8_t cmd = CMD_GET;
-    if (socket_.sendData(&cmd, sizeof(cmd)) < 0) {
-        std::cerr << "[Protocol] Failed to send GET command\n";
-        return false;
+    // Same host: copy from a descriptor the server hands over
+    if (socket_.isLocal() && !socket_.usesSharedMemory()) {
+        return getViaDescriptor(filename, save_dir);
+    }
+    if (!socket_.isLocal()) {
+        tcp_.begin(socket_.getSocketFd(), false);
     }
 
-    // Send filename
+    // Send GET command and filename in one write
+    uint8_t cmd = CMD_GET;
     char filenameBuf[256] = {0};
     std::strncpy(filenameBuf, filename.c_str(), sizeof(filenameBuf) - 1);
-    if (socket_.sendData(reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) < 0) {
-        std::cerr << "[Protocol] Failed to send filename\n";
+
+    struct iovec iov[2];
+    iov[0].iov_base = &cmd;
+    iov[0].iov_len = sizeof(cmd);
+    iov[1].iov_base = filenameBuf;
+    iov[1].iov_len = sizeof(filenameBuf);
+    if (socket_.sendVectored(iov, 2) < 0) {
+        std::cerr << "[Protocol] Failed to send GET request\n";
         return false;
     }
 
     // Receive file size
     uint64_t fileSize = 0;
-    if (socket_.receiveData(reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) < 0) {
+    if (socket_.receiveData(reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) != sizeof(fileSize)) {
         std::cerr << "[Protocol] Failed to receive file size\n";
         return false;
     }
@@ -207,6 +255,7 @@ bool ClientProtocol::request_get(const std::string &filename, const std::string
         std::cerr << "[Protocol] File not found on server\n";
         return false;
     }
+    lastFileSize_ = fileSize;
 
     // Create output file path
     std::string outputPath = save_dir.empty() ? filename : save_dir + "/" + filename;
@@ -217,6 +266,9 @@ bool ClientProtocol::request_get(const std::string &filename, const std::string
     }
 
     std::cout << "[Protocol] Downloading " << filename << " (" << fileSize << " bytes)\n";
+    if (progress_) {
+        progress_->begin(TransferDirection::Download, fileSize);
+    }
 
     // Receive file data
     const size_t BUFFER_SIZE = 1024*64;
@@ -227,17 +279,32 @@ bool ClientProtocol::request_get(const std::string &filename, const std::string
     auto lastUpdateTime = startTime;
 
     while (totalReceived < fileSize) {
+        if (cancelRequested()) {
+            std::cerr << "[Protocol] Download cancelled: " << filename << "\n";
+            outFile.close();
+            std::remove(outputPath.c_str());
+            if (progress_) progress_->finish(false);
+            return false;
+        }
+
         size_t toReceive = std::min(BUFFER_SIZE, static_cast<size_t>(fileSize - totalReceived));
         ssize_t received = socket_.receiveData(buffer, toReceive);
         
         if (received <= 0) {
             std::cerr << "[Protocol] Failed to receive file data\n";
             outFile.close();
+            // A truncated download must not pass for the file
+            std::remove(outputPath.c_str());
+            if (progress_) progress_->finish(false);
             return false;
         }
 
         outFile.write(reinterpret_cast<char*>(buffer), received);
         totalReceived += received;
+        if (progress_) {
+            progress_->update(totalReceived);
+        }
+        tcp_.poll();
 
         // Update metrics in real-time every 100ms
         auto currentTime = std::chrono::high_resolution_clock::now();
@@ -263,8 +330,17 @@ bool ClientProtocol::request_get(const std::string &filename, const std::string
         }
     }
 
-    std::cout << "\n[Protocol] Download completed: " << outputPath << "\n";
     outFile.close();
+    if (!outFile) {
+        std::cerr << "\n[Protocol] Failed to write file: " << outputPath << "\n";
+        std::remove(outputPath.c_str());
+        if (progress_) progress_->finish(false);
+        return false;
+    }
+    std::cout << "\n[Protocol] Download completed: " << outputPath << "\n";
+    if (progress_) {
+        progress_->finish(true);
+    }
     
     auto endTime = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
@@ -297,7 +373,131 @@ bool ClientProtocol::request_get(const std::string &filename, const std::string
     return true;
 }
 
+int ClientProtocol::request_get_fd(const std::string &filename, uint64_t &fileSize) {
+    fileSize = 0;
+    if (!socket_.isConnected() || !socket_.isLocal() || socket_.usesSharedMemory()) {
+        std::cerr << "[Protocol] Descriptor passing needs a plain Unix socket connection\n";
+        return -1;
+    }
+
+    uint8_t cmd = CMD_GET_FD;
+    char filenameBuf[256] = {0};
+    std::strncpy(filenameBuf, filename.c_str(), sizeof(filenameBuf) - 1);
+
+    struct iovec iov[2];
+    iov[0].iov_base = &cmd;
+    iov[0].iov_len = sizeof(cmd);
+    iov[1].iov_base = filenameBuf;
+    iov[1].iov_len = sizeof(filenameBuf);
+    if (socket_.sendVectored(iov, 2) < 0) {
+        std::cerr << "[Protocol] Failed to send GET_FD request\n";
+        return -1;
+    }
+
+    int fd = -1;
+    if (socket_.receiveWithFd(reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize), fd) < 0) {
+        std::cerr << "[Protocol] Failed to receive file size\n";
+        return -1;
+    }
+    if (fd < 0) {
+        std::cerr << "[Protocol] File not found on server\n";
+    }
+    return fd;
+}
+
+bool ClientProtocol::getViaDescriptor(const std::string &filename, const std::string &save_dir) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    uint64_t fileSize = 0;
+    int srcFd = request_get_fd(filename, fileSize);
+    if (srcFd < 0) {
+        return false;
+    }
+    lastFileSize_ = fileSize;
+
+    std::string outputPath = save_dir.empty() ? filename : save_dir + "/" + filename;
+    int outFd = open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (outFd < 0) {
+        std::cerr << "[Protocol] Failed to create file: " << outputPath << "\n";
+        close(srcFd);
+        return false;
+    }
+
+    std::cout << "[Protocol] Copying " << filename << " (" << fileSize << " bytes) from passed descriptor\n";
+    if (progress_) {
+        progress_->begin(TransferDirection::Download, fileSize);
+    }
+
+    // In-kernel copy; chunked so cancellation and progress still work
+    const size_t COPY_CHUNK = 8 * 1024 * 1024;
+    bool useCopyRange = true;
+    off_t offset = 0;
+    uint64_t totalCopied = 0;
+    bool ok = true;
+
+    while (totalCopied < fileSize) {
+        if (cancelRequested()) {
+            std::cerr << "[Protocol] Download cancelled: " << filename << "\n";
+            ok = false;
+            break;
+        }
+
+        size_t toCopy = std::min<uint64_t>(COPY_CHUNK, fileSize - totalCopied);
+        ssize_t copied;
+        if (useCopyRange) {
+            copied = copy_file_range(srcFd, &offset, outFd, nullptr, toCopy, 0);
+            if (copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useCopyRange = false; // Older kernel or unsupported filesystem pair
+                continue;
+            }
+        } else {
+            copied = sendfile(outFd, srcFd, &offset, toCopy);
+        }
+
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if (copied <= 0) {
+            // copied == 0: file was truncated on the server's side
+            std::cerr << "[Protocol] Failed to copy file data\n";
+            ok = false;
+            break;
+        }
+
+        totalCopied += copied;
+        if (progress_) {
+            progress_->update(totalCopied);
+        }
+    }
+
+    close(srcFd);
+    if (close(outFd) < 0) {
+        ok = false;
+    }
+    if (!ok) {
+        std::remove(outputPath.c_str());
+        if (progress_) progress_->finish(false);
+        return false;
+    }
+    if (progress_) {
+        progress_->finish(true);
+    }
+    std::cout << "[Protocol] Download completed: " << outputPath << "\n";
+
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - startTime);
+    uint64_t duration_ms = std::max<uint64_t>(duration.count() / 1000, 1);
+    if (metrics_) {
+        metrics_->transfer_latency_ms = duration_ms;
+        metrics_->total_bytes_received += fileSize;
+        metrics_->total_transfer_time_ms += duration_ms;
+        metrics_->throughput_kbps = (fileSize * 8.0) / duration_ms;
+    }
+    return true;
+}
+
 bool ClientProtocol::request_put(const std::string &filepath) {
+    cancelled_ = false;
     if (!socket_.isConnected()) {
         std::cerr << "[Protocol] Not connected to server\n";
         return false;
@@ -323,28 +523,36 @@ bool ClientProtocol::request_put(const std::string &filepath) {
         return false;
     }
 
-    // Send PUT command
-    uint8_t cmd = CMD_PUT;
-    if (socket_.sendData(&cmd, sizeof(cmd)) < 0) {
-        std::cerr << "[Protocol] Failed to send PUT command\n";
-        return false;
+    if (!socket_.isLocal()) {
+        tcp_.begin(socket_.getSocketFd(), true);
+    }
+    if (fileSize > 0 && fileSize <= SMALL_FILE_THRESHOLD) {
+        return putSmallFile(inFile, filename, fileSize);
     }
 
-    // Send filename
+    // Send PUT command, filename and file size in one write. Corked, the
+    // header shares a segment with the data and no segment is sent short.
+    socket_.setCork(true);
+    uint8_t cmd = CMD_PUT;
     char filenameBuf[256] = {0};
     std::strncpy(filenameBuf, filename.c_str(), sizeof(filenameBuf) - 1);
-    if (socket_.sendData(reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) < 0) {
-        std::cerr << "[Protocol] Failed to send filename\n";
-        return false;
-    }
 
-    // Send file size
-    if (socket_.sendData(reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) < 0) {
-        std::cerr << "[Protocol] Failed to send file size\n";
+    struct iovec iov[3];
+    iov[0].iov_base = &cmd;
+    iov[0].iov_len = sizeof(cmd);
+    iov[1].iov_base = filenameBuf;
+    iov[1].iov_len = sizeof(filenameBuf);
+    iov[2].iov_base = &fileSize;
+    iov[2].iov_len = sizeof(fileSize);
+    if (socket_.sendVectored(iov, 3) < 0) {
+        std::cerr << "[Protocol] Failed to send PUT request\n";
         return false;
     }
 
     std::cout << "[Protocol] Uploading " << filename << " (" << fileSize << " bytes)\n";
+    if (progress_) {
+        progress_->begin(TransferDirection::Upload, fileSize);
+    }
 
     // Send file data
     const size_t BUFFER_SIZE = 64*1024;
@@ -355,16 +563,29 @@ bool ClientProtocol::request_put(const std::string &filepath) {
     auto lastUpdateTime = startTime;
 
     while (inFile && totalSent < fileSize) {
+        if (cancelRequested()) {
+            std::cerr << "[Protocol] Upload cancelled: " << filename << "\n";
+            socket_.setCork(false);
+            inFile.close();
+            if (progress_) progress_->finish(false);
+            return false;
+        }
+
         inFile.read(buffer, BUFFER_SIZE);
         std::streamsize bytesRead = inFile.gcount();
 
         if (socket_.sendData(reinterpret_cast<uint8_t*>(buffer), bytesRead) < 0) {
             std::cerr << "[Protocol] Failed to send file data\n";
             inFile.close();
+            if (progress_) progress_->finish(false);
             return false;
         }
 
         totalSent += bytesRead;
+        if (progress_) {
+            progress_->update(totalSent);
+        }
+        tcp_.poll();
 
         // Update metrics in real-time every 100ms
         auto currentTime = std::chrono::high_resolution_clock::now();
@@ -390,8 +611,12 @@ bool ClientProtocol::request_put(const std::string &filepath) {
         }
     }
 
+    socket_.setCork(false);
     std::cout << "\n[Protocol] Upload completed\n";
     inFile.close();
+    if (progress_) {
+        progress_->finish(totalSent == fileSize);
+    }
     
     auto endTime = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
@@ -415,3 +640,63 @@ bool ClientProtocol::request_put(const std::string &filepath) {
     }
     return true;
 }
+
+bool ClientProtocol::putSmallFile(std::ifstream &inFile, const std::string &filename, uint64_t fileSize) {
+    std::string payload(fileSize, '\0');
+    if (!inFile.read(&payload[0], fileSize)) {
+        std::cerr << "[Protocol] Failed to read file: " << filename << "\n";
+        return false;
+    }
+    inFile.close();
+
+    std::cout << "[Protocol] Uploading " << filename << " (" << fileSize << " bytes)\n";
+    if (progress_) {
+        progress_->begin(TransferDirection::Upload, fileSize);
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Command, filename, size header and payload in one write
+    uint8_t cmd = CMD_PUT;
+    char filenameBuf[256] = {0};
+    std::strncpy(filenameBuf, filename.c_str(), sizeof(filenameBuf) - 1);
+
+    struct iovec iov[4];
+    iov[0].iov_base = &cmd;
+    iov[0].iov_len = sizeof(cmd);
+    iov[1].iov_base = filenameBuf;
+    iov[1].iov_len = sizeof(filenameBuf);
+    iov[2].iov_base = &fileSize;
+    iov[2].iov_len = sizeof(fileSize);
+    iov[3].iov_base = &payload[0];
+    iov[3].iov_len = payload.size();
+    if (socket_.sendVectored(iov, 4) < 0) {
+        std::cerr << "[Protocol] Failed to send file data\n";
+        if (progress_) progress_->finish(false);
+        return false;
+    }
+
+    if (progress_) {
+        progress_->update(fileSize);
+        progress_->finish(true);
+    }
+    std::cout << "[Protocol] Upload completed\n";
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+    uint64_t duration_ms = duration.count() / 1000;
+    if (duration_ms == 0 && duration.count() > 0) {
+        duration_ms = 1;
+    }
+
+    // Update metrics
+    if (metrics_) {
+        metrics_->transfer_latency_ms = duration_ms;
+        metrics_->total_bytes_sent += fileSize;
+        metrics_->total_transfer_time_ms += duration_ms;
+        if (duration_ms > 0) {
+            metrics_->throughput_kbps = (fileSize * 8.0) / duration_ms;
+        }
+    }
+    return true;
+}
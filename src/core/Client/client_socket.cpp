@@ -1,11 +1,17 @@
 #include "client_socket.h"
+#include "core/fault_injection.h"
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
+#include <cerrno>
 
-ClientSocket::ClientSocket() : socketFd_(-1) {
+// Asks the server to move this session onto shared-memory rings
+#define CMD_SHM_ATTACH 0x06
+
+ClientSocket::ClientSocket() : socketFd_(-1), local_(false) {
 }
 
 ClientSocket::~ClientSocket() {
@@ -13,6 +19,22 @@ ClientSocket::~ClientSocket() {
 }
 
 bool ClientSocket::connectToServer(const std::string& ip, uint16_t port) {
+    const std::string scheme = "unix:";
+    if (ip.compare(0, scheme.size(), scheme) == 0) {
+        return connectUnix(ip.substr(scheme.size()));
+    }
+    const std::string shmScheme = "shm:";
+    if (ip.compare(0, shmScheme.size(), shmScheme) == 0) {
+        if (!connectUnix(ip.substr(shmScheme.size()))) {
+            return false;
+        }
+        if (!attachSharedMemory()) {
+            disconnect();
+            return false;
+        }
+        return true;
+    }
+
     // Create socket
     socketFd_ = socket(AF_INET, SOCK_STREAM, 0);
     if (socketFd_ < 0) {
@@ -34,6 +56,11 @@ bool ClientSocket::connectToServer(const std::string& ip, uint16_t port) {
         return false;
     }
 
+    // Buffer sizes decide the window scale offered in the SYN
+    if (!tuning_.isDefault()) {
+        tuning_.apply(socketFd_);
+    }
+
     // Connect to server
     if (connect(socketFd_, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
         std::cerr << "[Socket] Connection failed to " << ip << ":" << port << "\n";
@@ -45,30 +72,135 @@ bool ClientSocket::connectToServer(const std::string& ip, uint16_t port) {
     return true;
 }
 
+bool ClientSocket::connectUnix(const std::string& path) {
+    struct sockaddr_un serverAddr;
+    std::memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(serverAddr.sun_path)) {
+        std::cerr << "[Socket] Invalid Unix socket path: " << path << "\n";
+        return false;
+    }
+    std::memcpy(serverAddr.sun_path, path.c_str(), path.size());
+
+    socketFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socketFd_ < 0) {
+        std::cerr << "[Socket] Failed to create socket\n";
+        return false;
+    }
+
+    if (connect(socketFd_, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        std::cerr << "[Socket] Connection failed to unix:" << path << ": " << strerror(errno) << "\n";
+        close(socketFd_);
+        socketFd_ = -1;
+        return false;
+    }
+
+    local_ = true;
+    return true;
+}
+
+bool ClientSocket::attachSharedMemory() {
+    if (!local_ || channel_) {
+        std::cerr << "[Socket] Shared memory needs a fresh Unix socket connection\n";
+        return false;
+    }
+
+    // Request and reply still go over the socket; the reply carries the memfd
+    uint8_t cmd = CMD_SHM_ATTACH;
+    uint64_t capacity = 0;
+    int memfd = -1;
+    if (sendData(&cmd, sizeof(cmd)) < 0 ||
+        receiveWithFd(reinterpret_cast<uint8_t*>(&capacity), sizeof(capacity), memfd) < 0) {
+        std::cerr << "[Socket] Shared-memory handshake failed\n";
+        return false;
+    }
+    if (memfd < 0) {
+        std::cerr << "[Socket] Server does not offer shared memory\n";
+        return false;
+    }
+
+    channel_ = ShmChannel::attach(memfd, capacity);
+    if (!channel_) {
+        return false;
+    }
+    channel_->setPeerSocket(socketFd_);
+    return true;
+}
+
 void ClientSocket::disconnect() {
+    // Hang up the rings first so the server sees a clean close
+    channel_.reset();
     if (socketFd_ >= 0) {
         close(socketFd_);
         socketFd_ = -1;
     }
+    local_ = false;
 }
 
 ssize_t ClientSocket::sendData(const uint8_t* data, size_t size) {
     if (socketFd_ < 0 || !data) {
         return -1;
     }
+    if (channel_) {
+        return channel_->send(data, size);
+    }
 
     size_t totalSent = 0;
     while (totalSent < size) {
-        ssize_t sent = send(socketFd_, data + totalSent, size - totalSent, 0);
+        ssize_t sent = ftSend(socketFd_, data + totalSent, size - totalSent, MSG_NOSIGNAL);
         if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             std::cerr << "[Socket] Send failed: " << strerror(errno) << "\n";
             return -1;
         }
         if (sent == 0) {
             std::cerr << "[Socket] Connection closed by peer\n";
-            return totalSent;
+            return -1;
+        }
+        totalSent += sent;
+    }
+
+    return totalSent;
+}
+
+ssize_t ClientSocket::sendVectored(struct iovec* iov, int iovcnt) {
+    if (socketFd_ < 0 || !iov || iovcnt <= 0) {
+        return -1;
+    }
+    if (channel_) {
+        return channel_->sendVectored(iov, iovcnt);
+    }
+
+    size_t totalSent = 0;
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t sent = ftSendmsg(socketFd_, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[Socket] Send failed: " << strerror(errno) << "\n";
+            return -1;
         }
+
+        // Skip fully written buffers, then advance into the partial one
         totalSent += sent;
+        size_t remaining = static_cast<size_t>(sent);
+        while (msg.msg_iovlen > 0 && remaining >= msg.msg_iov->iov_len) {
+            remaining -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<uint8_t*>(msg.msg_iov->iov_base) + remaining;
+            msg.msg_iov->iov_len -= remaining;
+        }
     }
 
     return totalSent;
@@ -78,17 +210,27 @@ ssize_t ClientSocket::receiveData(uint8_t* buffer, size_t size) {
     if (socketFd_ < 0 || !buffer) {
         return -1;
     }
+    if (channel_) {
+        return channel_->receive(buffer, size);
+    }
 
     size_t totalReceived = 0;
     while (totalReceived < size) {
-        ssize_t received = recv(socketFd_, buffer + totalReceived, size - totalReceived, 0);
+        ssize_t received = ftRecv(socketFd_, buffer + totalReceived, size - totalReceived, 0);
         if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             std::cerr << "[Socket] Receive failed: " << strerror(errno) << "\n";
             return -1;
         }
         if (received == 0) {
-            // Connection closed
-            return totalReceived;
+            // Connection closed: clean between messages, an error inside one
+            if (totalReceived == 0) {
+                return 0;
+            }
+            std::cerr << "[Socket] Unexpected disconnect (received " << totalReceived << "/" << size << " bytes)\n";
+            return -1;
         }
         totalReceived += received;
     }
@@ -96,6 +238,72 @@ ssize_t ClientSocket::receiveData(uint8_t* buffer, size_t size) {
     return totalReceived;
 }
 
+ssize_t ClientSocket::receiveWithFd(uint8_t* buffer, size_t size, int& passedFd) {
+    passedFd = -1;
+    if (socketFd_ < 0 || !buffer || channel_) {
+        return -1;
+    }
+
+    size_t totalReceived = 0;
+    while (totalReceived < size) {
+        struct iovec iov;
+        iov.iov_base = buffer + totalReceived;
+        iov.iov_len = size - totalReceived;
+
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } control;
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        ssize_t received = ftRecvmsg(socketFd_, &msg, MSG_CMSG_CLOEXEC);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[Socket] Receive failed: " << strerror(errno) << "\n";
+            break;
+        }
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            // Keep the first descriptor; anything beyond it is not ours to hold
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (passedFd < 0) {
+                    passedFd = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+        if (msg.msg_flags & MSG_CTRUNC) {
+            std::cerr << "[Socket] Passed descriptor was truncated\n";
+        }
+
+        if (received == 0) {
+            break; // Connection closed
+        }
+        totalReceived += received;
+    }
+
+    if (totalReceived < size && passedFd >= 0) {
+        close(passedFd);
+        passedFd = -1;
+    }
+    return totalReceived < size ? -1 : static_cast<ssize_t>(totalReceived);
+}
+
 bool ClientSocket::isConnected() const {
     return socketFd_ >= 0;
 }
@@ -104,6 +312,36 @@ int ClientSocket::getSocketFd() const {
     return socketFd_;
 }
 
+bool ClientSocket::isLocal() const {
+    return local_;
+}
+
+bool ClientSocket::usesSharedMemory() const {
+    return channel_ != nullptr;
+}
+
+bool ClientSocket::sampleTcpStats(TcpStats& stats) const {
+    if (local_ || socketFd_ < 0) {
+        stats = TcpStats();
+        return false;
+    }
+    return TcpStats::sample(socketFd_, stats);
+}
+
+
 
 
 
+void ClientSocket::setTuning(const SocketTuning& tuning) {
+    tuning_ = tuning;
+}
+
+const SocketTuning& ClientSocket::getTuning() const {
+    return tuning_;
+}
+
+void ClientSocket::setCork(bool on) {
+    if (tuning_.cork && !local_ && socketFd_ >= 0) {
+        SocketTuning::setCork(socketFd_, on);
+    }
+}
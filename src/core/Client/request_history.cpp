@@ -0,0 +1,541 @@
+#include "request_history.h"
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+// =========================
+// String interning
+// =========================
+namespace {
+
+constexpr size_t MAX_INTERNED = 1024;
+
+struct InternTable {
+    std::mutex mutex;
+    std::deque<std::string> strings;   // deque keeps references stable
+    std::unordered_map<std::string, uint16_t> ids;
+
+    InternTable() {
+        // Fixed ids for the common entries
+        for (const char* s : {"", "<other>", "LIST", "GET", "PUT", "PING"}) {
+            ids.emplace(s, static_cast<uint16_t>(strings.size()));
+            strings.emplace_back(s);
+        }
+    }
+};
+
+InternTable& internTable() {
+    static InternTable table;
+    return table;
+}
+
+const uint16_t OTHER_ID = 1;
+
+// Binary spill format
+const char SPILL_MAGIC[4] = {'F', 'T', 'R', 'H'};
+const uint32_t SPILL_VERSION = 2; // 2: TCP fields after the file name
+const uint8_t SPILL_TAG_NAME = 'N';
+const uint8_t SPILL_TAG_RECORD = 'R';
+
+// Reads the header at the start of a spill log; false if it is not one
+bool readSpillHeader(std::FILE* file, uint32_t& version) {
+    char magic[sizeof(SPILL_MAGIC)];
+    return std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+           std::memcmp(magic, SPILL_MAGIC, sizeof(magic)) == 0 &&
+           std::fread(&version, sizeof(version), 1, file) == 1;
+}
+
+size_t latencyBucket(double duration_ms) {
+    double us = duration_ms * 1000.0;
+    if (us < 1.0) {
+        return 0;
+    }
+    size_t bucket = static_cast<size_t>(std::log2(us)) + 1;
+    return std::min(bucket, RequestStats::LATENCY_BUCKETS - 1);
+}
+
+} // namespace
+
+uint16_t internRequestString(const std::string& value) {
+    InternTable& table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto it = table.ids.find(value);
+    if (it != table.ids.end()) {
+        return it->second;
+    }
+    if (table.strings.size() >= MAX_INTERNED) {
+        return OTHER_ID;
+    }
+
+    uint16_t id = static_cast<uint16_t>(table.strings.size());
+    table.strings.push_back(value);
+    table.ids.emplace(value, id);
+    return id;
+}
+
+const std::string& requestStringById(uint16_t id) {
+    InternTable& table = internTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    if (id >= table.strings.size()) {
+        return table.strings[0];
+    }
+    return table.strings[id];
+}
+
+// =========================
+// RequestRecord
+// =========================
+const std::string& RequestRecord::operation() const {
+    return requestStringById(operation_id);
+}
+
+const std::string& RequestRecord::errorMessage() const {
+    return requestStringById(error_id);
+}
+
+// =========================
+// RequestStats
+// =========================
+void RequestStats::add(bool success, uint64_t bytesTransferred, double duration_ms) {
+    if (count == 0 || duration_ms < min_duration_ms) {
+        min_duration_ms = duration_ms;
+    }
+    if (duration_ms > max_duration_ms) {
+        max_duration_ms = duration_ms;
+    }
+
+    count++;
+    if (!success) {
+        failures++;
+    }
+    bytes += bytesTransferred;
+    total_duration_ms += duration_ms;
+    latency_histogram[latencyBucket(duration_ms)]++;
+}
+
+void RequestStats::merge(const RequestStats& other) {
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0 || other.min_duration_ms < min_duration_ms) {
+        min_duration_ms = other.min_duration_ms;
+    }
+    max_duration_ms = std::max(max_duration_ms, other.max_duration_ms);
+
+    count += other.count;
+    failures += other.failures;
+    bytes += other.bytes;
+    total_duration_ms += other.total_duration_ms;
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        latency_histogram[i] += other.latency_histogram[i];
+    }
+}
+
+double RequestStats::averageDurationMs() const {
+    return count > 0 ? total_duration_ms / count : 0.0;
+}
+
+double RequestStats::percentileMs(double percentile) const {
+    if (count == 0) {
+        return 0.0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(count * percentile / 100.0));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += latency_histogram[i];
+        if (seen >= target) {
+            // Upper bound of the bucket, clamped to the observed range
+            double upper_ms = (i == 0) ? 0.001 : std::ldexp(1.0, static_cast<int>(i)) / 1000.0;
+            return std::min(std::max(upper_ms, min_duration_ms), max_duration_ms);
+        }
+    }
+    return max_duration_ms;
+}
+
+// =========================
+// RequestHistory
+// =========================
+RequestHistory::RequestHistory(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      head_(0),
+      count_(0),
+      totalRecorded_(0),
+      spillFile_(nullptr) {
+    ring_.resize(capacity_);
+}
+
+RequestHistory::~RequestHistory() {
+    disableSpill();
+}
+
+RequestHistory::RequestHistory(const RequestHistory& other)
+    : capacity_(1),
+      head_(0),
+      count_(0),
+      totalRecorded_(0),
+      spillFile_(nullptr) {
+    *this = other;
+}
+
+RequestHistory& RequestHistory::operator=(const RequestHistory& other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    std::vector<RequestRecord> records = other.recent();
+    std::lock_guard<std::mutex> lock(mutex_);
+    {
+        std::lock_guard<std::mutex> otherLock(other.mutex_);
+        capacity_ = other.capacity_;
+        totalRecorded_ = other.totalRecorded_;
+        stats_ = other.stats_;
+    }
+
+    // The copy gets the records but not the spill file
+    ring_.assign(capacity_, RequestRecord{});
+    head_ = 0;
+    count_ = 0;
+    for (const auto& record : records) {
+        ring_[head_] = record;
+        head_ = (head_ + 1) % capacity_;
+        count_ = std::min(count_ + 1, capacity_);
+    }
+    return *this;
+}
+
+void RequestHistory::emplace_back(const std::string& operation, const std::string& filename, bool success,
+                                  uint64_t bytes, double duration_ms, const std::string& error,
+                                  const TcpTransferStats& tcp) {
+    RequestRecord record;
+    record.timestamp = std::time(nullptr);
+    record.bytes_transferred = bytes;
+    record.duration_ms = static_cast<float>(duration_ms);
+    record.operation_id = internRequestString(operation);
+    record.error_id = error.empty() ? 0 : internRequestString(error);
+    record.success = success;
+    std::strncpy(record.filename, filename.c_str(), RequestRecord::MAX_FILENAME - 1);
+    record.tcp = tcp;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stats_.size() <= record.operation_id) {
+        stats_.resize(record.operation_id + 1);
+    }
+    stats_[record.operation_id].add(success, bytes, duration_ms);
+    totalRecorded_++;
+
+    appendLocked(record);
+    if (spillFile_) {
+        spillLocked(record);
+    }
+}
+
+void RequestHistory::appendLocked(const RequestRecord& record) {
+    ring_[head_] = record;
+    head_ = (head_ + 1) % capacity_;
+    if (count_ < capacity_) {
+        count_++;
+    }
+}
+
+size_t RequestHistory::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+bool RequestHistory::empty() const {
+    return size() == 0;
+}
+
+size_t RequestHistory::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+RequestRecord RequestHistory::at(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= count_) {
+        return RequestRecord{};
+    }
+    size_t oldest = (head_ + capacity_ - count_) % capacity_;
+    return ring_[(oldest + index) % capacity_];
+}
+
+std::vector<RequestRecord> RequestHistory::recent(size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = (limit == 0) ? count_ : std::min(limit, count_);
+
+    std::vector<RequestRecord> records;
+    records.reserve(n);
+    size_t start = (head_ + capacity_ - n) % capacity_;
+    for (size_t i = 0; i < n; ++i) {
+        records.push_back(ring_[(start + i) % capacity_]);
+    }
+    return records;
+}
+
+uint64_t RequestHistory::totalRecorded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalRecorded_;
+}
+
+RequestStats RequestHistory::statsFor(const std::string& operation) const {
+    uint16_t id = internRequestString(operation);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < stats_.size()) {
+        return stats_[id];
+    }
+    return RequestStats{};
+}
+
+std::vector<std::pair<std::string, RequestStats>> RequestHistory::allStats() const {
+    std::vector<std::pair<std::string, RequestStats>> result;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t id = 0; id < stats_.size(); ++id) {
+        if (stats_[id].count > 0) {
+            result.emplace_back(requestStringById(static_cast<uint16_t>(id)), stats_[id]);
+        }
+    }
+    return result;
+}
+
+void RequestHistory::setCapacity(size_t capacity) {
+    capacity = std::max<size_t>(capacity, 1);
+    std::vector<RequestRecord> records = recent(capacity);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    ring_.assign(capacity_, RequestRecord{});
+    head_ = 0;
+    count_ = 0;
+    for (const auto& record : records) {
+        appendLocked(record);
+    }
+}
+
+void RequestHistory::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    head_ = 0;
+    count_ = 0;
+    totalRecorded_ = 0;
+    stats_.clear();
+}
+
+void RequestHistory::merge(const RequestHistory& other) {
+    if (this == &other) {
+        return;
+    }
+
+    std::vector<RequestRecord> records = other.recent();
+    std::vector<RequestStats> otherStats;
+    uint64_t otherTotal = 0;
+    {
+        std::lock_guard<std::mutex> otherLock(other.mutex_);
+        otherStats = other.stats_;
+        otherTotal = other.totalRecorded_;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stats_.size() < otherStats.size()) {
+        stats_.resize(otherStats.size());
+    }
+    for (size_t id = 0; id < otherStats.size(); ++id) {
+        stats_[id].merge(otherStats[id]);
+    }
+    totalRecorded_ += otherTotal;
+
+    for (const auto& record : records) {
+        appendLocked(record);
+        if (spillFile_) {
+            spillLocked(record);
+        }
+    }
+}
+
+bool RequestHistory::enableSpill(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spillFile_) {
+        std::fclose(spillFile_);
+        spillFile_ = nullptr;
+    }
+
+    spillFile_ = std::fopen(path.c_str(), "ab+");
+    if (!spillFile_) {
+        std::cerr << "[History] Failed to open spill file: " << path << "\n";
+        return false;
+    }
+
+    // New or empty file gets a header
+    std::fseek(spillFile_, 0, SEEK_END);
+    if (std::ftell(spillFile_) == 0) {
+        std::fwrite(SPILL_MAGIC, 1, sizeof(SPILL_MAGIC), spillFile_);
+        std::fwrite(&SPILL_VERSION, sizeof(SPILL_VERSION), 1, spillFile_);
+    } else {
+        // A reader parses the whole file with the header's layout, so only
+        // append records of that same layout
+        std::rewind(spillFile_);
+        uint32_t version = 0;
+        bool isLog = readSpillHeader(spillFile_, version);
+        if (!isLog || version != SPILL_VERSION) {
+            std::cerr << "[History] Refusing to append to " << path << ": ";
+            if (isLog) {
+                std::cerr << "it holds format version " << version << ", this build writes " << SPILL_VERSION;
+            } else {
+                std::cerr << "not a request history log";
+            }
+            std::cerr << "; spill to a new file\n";
+            std::fclose(spillFile_);
+            spillFile_ = nullptr;
+            return false;
+        }
+        std::fseek(spillFile_, 0, SEEK_END);
+    }
+    spilledNames_.clear();
+    return true;
+}
+
+bool RequestHistory::readSpill(const std::string& path, std::vector<RequestRecord>& records) {
+    records.clear();
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "[History] Failed to open spill file: " << path << "\n";
+        return false;
+    }
+
+    uint32_t version = 0;
+    if (!readSpillHeader(file, version) || version != SPILL_VERSION) {
+        std::cerr << "[History] Not a version " << SPILL_VERSION << " request history log: " << path << "\n";
+        std::fclose(file);
+        return false;
+    }
+
+    auto read = [file](void* data, size_t size) { return std::fread(data, 1, size, file) == size; };
+    std::unordered_map<uint16_t, uint16_t> ids; // Id in the file -> id in this process
+    auto mapId = [&ids](uint16_t fileId, uint16_t& id) {
+        auto it = ids.find(fileId);
+        if (it == ids.end()) {
+            return fileId == 0; // The empty string is never written
+        }
+        id = it->second;
+        return true;
+    };
+
+    bool ok = true;
+    int tag;
+    while (ok && (tag = std::fgetc(file)) != EOF) {
+        if (tag == SPILL_TAG_NAME) {
+            uint16_t id = 0;
+            uint16_t len = 0;
+            std::string name;
+            ok = read(&id, sizeof(id)) && read(&len, sizeof(len));
+            name.resize(len);
+            ok = ok && read(&name[0], len);
+            if (ok) {
+                ids[id] = internRequestString(name);
+            }
+        } else if (tag == SPILL_TAG_RECORD) {
+            RequestRecord record;
+            int64_t timestamp = 0;
+            uint16_t operation = 0;
+            uint16_t error = 0;
+            uint8_t success = 0;
+            uint8_t nameLen = 0;
+            char name[UINT8_MAX];
+            uint8_t bound = 0;
+            ok = read(&timestamp, sizeof(timestamp)) &&
+                 read(&record.bytes_transferred, sizeof(record.bytes_transferred)) &&
+                 read(&record.duration_ms, sizeof(record.duration_ms)) && read(&operation, sizeof(operation)) &&
+                 read(&error, sizeof(error)) && read(&success, 1) && read(&nameLen, 1) && read(name, nameLen) &&
+                 read(&record.tcp.rttUs, sizeof(record.tcp.rttUs)) &&
+                 read(&record.tcp.rttVarUs, sizeof(record.tcp.rttVarUs)) &&
+                 read(&record.tcp.cwnd, sizeof(record.tcp.cwnd)) &&
+                 read(&record.tcp.retransmits, sizeof(record.tcp.retransmits)) &&
+                 read(&record.tcp.deliveryRate, sizeof(record.tcp.deliveryRate)) && read(&bound, 1) &&
+                 mapId(operation, record.operation_id) && mapId(error, record.error_id);
+            if (ok) {
+                record.timestamp = static_cast<std::time_t>(timestamp);
+                record.success = success != 0;
+                std::memcpy(record.filename, name, std::min<size_t>(nameLen, RequestRecord::MAX_FILENAME - 1));
+                record.tcp.bound = static_cast<TransferBound>(bound);
+                records.push_back(record);
+            }
+        } else {
+            ok = false;
+        }
+    }
+    std::fclose(file);
+
+    if (!ok) {
+        std::cerr << "[History] Spill file is truncated or corrupt after " << records.size() << " records: " << path
+                  << "\n";
+    }
+    return ok;
+}
+
+void RequestHistory::disableSpill() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spillFile_) {
+        std::fclose(spillFile_);
+        spillFile_ = nullptr;
+    }
+}
+
+bool RequestHistory::isSpilling() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spillFile_ != nullptr;
+}
+
+void RequestHistory::spillNameLocked(uint16_t id) {
+    if (id < spilledNames_.size() && spilledNames_[id]) {
+        return;
+    }
+    if (spilledNames_.size() <= id) {
+        spilledNames_.resize(id + 1, false);
+    }
+    spilledNames_[id] = true;
+
+    // Name entry: tag, id, length, bytes
+    const std::string& name = requestStringById(id);
+    uint16_t len = static_cast<uint16_t>(std::min<size_t>(name.size(), UINT16_MAX));
+    std::fwrite(&SPILL_TAG_NAME, 1, 1, spillFile_);
+    std::fwrite(&id, sizeof(id), 1, spillFile_);
+    std::fwrite(&len, sizeof(len), 1, spillFile_);
+    std::fwrite(name.data(), 1, len, spillFile_);
+}
+
+void RequestHistory::spillLocked(const RequestRecord& record) {
+    spillNameLocked(record.operation_id);
+    if (record.error_id != 0) {
+        spillNameLocked(record.error_id);
+    }
+
+    // Record entry: tag, timestamp, bytes, duration, op id, error id, success, name,
+    // then RTT, RTT variation, cwnd, retransmits (uint32 each), delivery rate
+    // (uint64) and bound (uint8)
+    int64_t timestamp = static_cast<int64_t>(record.timestamp);
+    uint8_t success = record.success ? 1 : 0;
+    uint8_t nameLen = static_cast<uint8_t>(strnlen(record.filename, RequestRecord::MAX_FILENAME));
+
+    std::fwrite(&SPILL_TAG_RECORD, 1, 1, spillFile_);
+    std::fwrite(&timestamp, sizeof(timestamp), 1, spillFile_);
+    std::fwrite(&record.bytes_transferred, sizeof(record.bytes_transferred), 1, spillFile_);
+    std::fwrite(&record.duration_ms, sizeof(record.duration_ms), 1, spillFile_);
+    std::fwrite(&record.operation_id, sizeof(record.operation_id), 1, spillFile_);
+    std::fwrite(&record.error_id, sizeof(record.error_id), 1, spillFile_);
+    std::fwrite(&success, 1, 1, spillFile_);
+    std::fwrite(&nameLen, 1, 1, spillFile_);
+    std::fwrite(record.filename, 1, nameLen, spillFile_);
+    uint8_t bound = static_cast<uint8_t>(record.tcp.bound);
+    std::fwrite(&record.tcp.rttUs, sizeof(record.tcp.rttUs), 1, spillFile_);
+    std::fwrite(&record.tcp.rttVarUs, sizeof(record.tcp.rttVarUs), 1, spillFile_);
+    std::fwrite(&record.tcp.cwnd, sizeof(record.tcp.cwnd), 1, spillFile_);
+    std::fwrite(&record.tcp.retransmits, sizeof(record.tcp.retransmits), 1, spillFile_);
+    std::fwrite(&record.tcp.deliveryRate, sizeof(record.tcp.deliveryRate), 1, spillFile_);
+    std::fwrite(&bound, 1, 1, spillFile_);
+}
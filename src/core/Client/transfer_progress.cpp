@@ -0,0 +1,161 @@
+#include "transfer_progress.h"
+
+ProgressTracker::ProgressTracker()
+    : observer_(nullptr),
+      intervalMs_(100),
+      alpha_(0.3),
+      lastSampleBytes_(0),
+      sequence_(0),
+      pubDirection_(static_cast<uint8_t>(TransferDirection::None)),
+      pubBytesDone_(0),
+      pubBytesTotal_(0),
+      pubInstantRate_(0.0),
+      pubSmoothedRate_(0.0),
+      pubEta_(0.0),
+      pubElapsed_(0.0),
+      pubActive_(false),
+      pubSuccess_(false) {
+}
+
+void ProgressTracker::setObserver(TransferObserver* observer) {
+    observer_ = observer;
+}
+
+void ProgressTracker::setCallback(ProgressCallback callback) {
+    callback_ = std::move(callback);
+}
+
+void ProgressTracker::setInterval(int intervalMs) {
+    intervalMs_ = intervalMs > 0 ? intervalMs : 100;
+}
+
+void ProgressTracker::setSmoothing(double alpha) {
+    if (alpha > 0.0 && alpha <= 1.0) {
+        alpha_ = alpha;
+    }
+}
+
+void ProgressTracker::begin(TransferDirection direction, uint64_t bytesTotal) {
+    startTime_ = Clock::now();
+    lastSampleTime_ = startTime_;
+    lastSampleBytes_ = 0;
+
+    current_ = TransferProgress{};
+    current_.direction = direction;
+    current_.bytesTotal = bytesTotal;
+    current_.active = true;
+    publish();
+
+    if (observer_) {
+        observer_->onTransferStarted(current_);
+    }
+}
+
+void ProgressTracker::update(uint64_t bytesDone) {
+    current_.bytesDone = bytesDone;
+
+    auto now = Clock::now();
+    auto sinceSample = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastSampleTime_);
+    if (sinceSample.count() < intervalMs_ && bytesDone != current_.bytesTotal) {
+        // Fast path: only the byte count changes between samples
+        uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        pubBytesDone_.store(bytesDone, std::memory_order_relaxed);
+        sequence_.store(seq + 2, std::memory_order_release);
+        return;
+    }
+
+    sample(now);
+    publish();
+    deliver();
+}
+
+void ProgressTracker::finish(bool success) {
+    sample(Clock::now());
+    current_.active = false;
+    current_.success = success;
+    if (success) {
+        current_.eta_s = 0.0;
+    }
+    publish();
+
+    if (observer_) {
+        observer_->onTransferFinished(current_);
+    }
+}
+
+TransferProgress ProgressTracker::snapshot() const {
+    TransferProgress progress;
+    uint64_t before = 0;
+    uint64_t after = 0;
+
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue; // Writer in progress
+        }
+        progress.direction = static_cast<TransferDirection>(pubDirection_.load(std::memory_order_relaxed));
+        progress.bytesDone = pubBytesDone_.load(std::memory_order_relaxed);
+        progress.bytesTotal = pubBytesTotal_.load(std::memory_order_relaxed);
+        progress.instantRate_Bps = pubInstantRate_.load(std::memory_order_relaxed);
+        progress.smoothedRate_Bps = pubSmoothedRate_.load(std::memory_order_relaxed);
+        progress.eta_s = pubEta_.load(std::memory_order_relaxed);
+        progress.elapsed_s = pubElapsed_.load(std::memory_order_relaxed);
+        progress.active = pubActive_.load(std::memory_order_relaxed);
+        progress.success = pubSuccess_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    return progress;
+}
+
+void ProgressTracker::sample(Clock::time_point now) {
+    double windowSec = std::chrono::duration<double>(now - lastSampleTime_).count();
+    current_.elapsed_s = std::chrono::duration<double>(now - startTime_).count();
+
+    if (windowSec > 0.0) {
+        current_.instantRate_Bps = (current_.bytesDone - lastSampleBytes_) / windowSec;
+        if (current_.smoothedRate_Bps == 0.0) {
+            current_.smoothedRate_Bps = current_.instantRate_Bps;
+        } else {
+            current_.smoothedRate_Bps = (current_.smoothedRate_Bps * (1.0 - alpha_)) +
+                                        (current_.instantRate_Bps * alpha_);
+        }
+    }
+
+    uint64_t remaining = current_.bytesTotal > current_.bytesDone
+        ? current_.bytesTotal - current_.bytesDone : 0;
+    current_.eta_s = current_.smoothedRate_Bps > 0.0 ? remaining / current_.smoothedRate_Bps : 0.0;
+
+    lastSampleTime_ = now;
+    lastSampleBytes_ = current_.bytesDone;
+}
+
+void ProgressTracker::publish() {
+    uint64_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    pubDirection_.store(static_cast<uint8_t>(current_.direction), std::memory_order_relaxed);
+    pubBytesDone_.store(current_.bytesDone, std::memory_order_relaxed);
+    pubBytesTotal_.store(current_.bytesTotal, std::memory_order_relaxed);
+    pubInstantRate_.store(current_.instantRate_Bps, std::memory_order_relaxed);
+    pubSmoothedRate_.store(current_.smoothedRate_Bps, std::memory_order_relaxed);
+    pubEta_.store(current_.eta_s, std::memory_order_relaxed);
+    pubElapsed_.store(current_.elapsed_s, std::memory_order_relaxed);
+    pubActive_.store(current_.active, std::memory_order_relaxed);
+    pubSuccess_.store(current_.success, std::memory_order_relaxed);
+
+    sequence_.store(seq + 2, std::memory_order_release);
+}
+
+void ProgressTracker::deliver() {
+    if (observer_) {
+        observer_->onTransferProgress(current_);
+    }
+    if (callback_) {
+        callback_(current_.bytesDone, current_.bytesTotal);
+    }
+}
@@ -1,28 +1,69 @@
 #include "client_session.h"
 #include "server_socket.h"
 #include "server_protocol.h"
+#include "cpu_topology.h"
 #include <iostream>
 #include <unistd.h>
+#include <sys/socket.h>
 #include <cstring>
+#include <csignal>
+#include <pthread.h>
 
-ClientSession::ClientSession(int clientFd, const std::string& clientAddr, std::shared_ptr<std::string> sharedDir, ServerMetrics* metrics)
+ClientSession::ClientSession(int clientFd, const std::string& clientAddr, std::shared_ptr<std::string> sharedDir, ServerMetrics* metrics,
+                             ServerEventQueue* events, FileCache* cache, FileDescriptorCache* fds)
     : clientFd_(clientFd),
       clientAddr_(clientAddr),
       sharedDir_(sharedDir),
       metrics_(metrics),
+      events_(events),
+      cache_(cache),
+      fds_(fds),
       active_(false),
-      bytesTransferred_(0) {
+      servedCommand_(false),
+      bytesTransferred_(0),
+      limiter_(nullptr),
+      shmCapacity_(0),
+      commandProfiling_(false),
+      sessionStats_(nullptr),
+      cork_(false) {
     startTime_ = std::chrono::system_clock::now();
 }
 
 ClientSession::~ClientSession() {
-    // Set flag to stop processing
-    active_ = false;
-    
-    // Detach thread if it's still running - let it clean up itself
-    if (thread_ && thread_->joinable()) {
-        thread_->detach();
-    }
+    // A session that never started still owns its socket
+    cleanup();
+}
+
+void ClientSession::setCpuAffinity(const std::vector<int>& cpus) {
+    cpus_ = cpus;
+}
+
+void ClientSession::setWatch(std::shared_ptr<SessionWatch> watch) {
+    watch_ = std::move(watch);
+}
+
+void ClientSession::setRateLimiter(RateLimiter* limiter) {
+    limiter_ = limiter;
+}
+
+void ClientSession::setSharedMemory(size_t ringCapacity) {
+    shmCapacity_ = ringCapacity;
+}
+
+void ClientSession::setCommandProfiling(bool enable) {
+    commandProfiling_ = enable;
+}
+
+void ClientSession::setSessionStatsProvider(const SessionStatsProvider* provider) {
+    sessionStats_ = provider;
+}
+
+void ClientSession::setCork(bool enable) {
+    cork_ = enable;
+}
+
+void ClientSession::setOnFinished(std::function<void()> onFinished) {
+    onFinished_ = std::move(onFinished);
 }
 
 void ClientSession::start() {
@@ -30,15 +71,34 @@ void ClientSession::start() {
         return;
     }
 
+    // The thread holds a reference, so the session outlives its owner's
+    // copy if need be; it is destroyed when the thread returns
     active_ = true;
-    thread_ = std::make_unique<std::thread>(&ClientSession::handleSession, this);
+    std::thread(&ClientSession::handleSession, shared_from_this()).detach();
 }
 
 void ClientSession::stop() {
-    // Just signal the thread to stop
     active_ = false;
-    
-    // Don't join or detach - let destructor handle it
+
+    // Wake the thread if it is blocked on the client; it then cleans up itself
+    std::lock_guard<std::mutex> lock(fdMutex_);
+    if (clientFd_ >= 0) {
+        shutdown(clientFd_, SHUT_RDWR);
+    }
+}
+
+void ClientSession::drain() {
+    // The request loop ends after the command in flight
+    active_ = false;
+
+    // An idle session is waiting for its next command: end that wait. The
+    // kernel still delivers bytes already received before reporting EOF,
+    // so a request that just arrived is served rather than dropped. A
+    // connection that has not sent its first request yet gets to send it.
+    std::lock_guard<std::mutex> lock(fdMutex_);
+    if (clientFd_ >= 0 && servedCommand_ && !(watch_ && watch_->isBusy())) {
+        shutdown(clientFd_, SHUT_RD);
+    }
 }
 
 bool ClientSession::isActive() const {
@@ -57,19 +117,52 @@ size_t ClientSession::getBytesTransferred() const {
     return bytesTransferred_;
 }
 
+bool ClientSession::sampleTcpStats(TcpStats& stats) {
+    std::lock_guard<std::mutex> lock(fdMutex_);
+    return TcpStats::sample(clientFd_, stats);
+}
+
 void ClientSession::handleSession() {
+    // sendfile() has no MSG_NOSIGNAL: writing to a peer that is gone (or a
+    // socket the reaper shut down) must fail with EPIPE, not kill the process
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+    pthread_setname_np(pthread_self(), "ft-session");
+
+    if (!cpus_.empty()) {
+        CpuTopology::pinCurrentThread(cpus_);
+    }
+
     std::cout << "[Session] Client connected: " << clientAddr_ << " (fd: " << clientFd_ << ")\n";
+    publishSessionEvent(ServerEventType::SessionOpened);
 
     try {
         // Create protocol handler for this session
         ServerProtocol protocol;
         protocol.setSharedDirectoryPtr(sharedDir_);
         protocol.setMetrics(metrics_);
+        protocol.setEventQueue(events_, clientAddr_);
+        protocol.setFileCache(cache_);
+        protocol.setDescriptorCache(fds_);
+        protocol.setSessionWatch(watch_.get());
+        protocol.setSharedMemoryCapacity(shmCapacity_);
+        protocol.setCommandProfiling(commandProfiling_);
+        protocol.setSessionStatsProvider(sessionStats_);
+        protocol.setCork(cork_);
+
+        std::unique_ptr<TransferShaper> shaper;
+        if (limiter_) {
+            shaper = std::make_unique<TransferShaper>(limiter_->shaperFor(clientAddr_));
+            protocol.setShaper(shaper.get());
+        }
 
         // Process client requests
         while (active_) {
             try {
                 bool continueSession = protocol.processRequest(clientFd_);
+                servedCommand_ = true;
                 
                 if (!continueSession) {
                     std::cout << "[Session] Session ended normally\n";
@@ -86,18 +179,42 @@ void ClientSession::handleSession() {
         std::cerr << "[Session] Unknown exception in session\n";
     }
 
-    // Cleanup must happen before marking inactive
+    if (watch_ && watch_->reapReason()) {
+        std::cout << "[Session] Closed by server timeout (" << watch_->reapReason() << "): " << clientAddr_ << "\n";
+    }
+
     cleanup();
     
     std::cout << "[Session] Client disconnected: " << clientAddr_ << "\n";
-    
-    // Mark inactive as last step - this signals to cleanup thread that we're done
+    publishSessionEvent(ServerEventType::SessionClosed);
     active_ = false;
+
+    // Last step: the owner may be gone once it has been told
+    if (onFinished_) {
+        onFinished_();
+    }
 }
 
 void ClientSession::cleanup() {
+    // The reaper must not shut down whatever reuses this fd number next
+    if (watch_) {
+        watch_->release();
+    }
+    std::lock_guard<std::mutex> lock(fdMutex_);
     if (clientFd_ >= 0) {
         close(clientFd_);
         clientFd_ = -1;
     }
-}
\ No newline at end of file
+}
+
+void ClientSession::publishSessionEvent(ServerEventType type) {
+    if (!events_) {
+        return;
+    }
+
+    ServerEvent event;
+    event.type = type;
+    event.setClientAddress(clientAddr_);
+    event.bytesTransferred = bytesTransferred_;
+    events_->push(event);
+}
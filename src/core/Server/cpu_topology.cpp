@@ -0,0 +1,250 @@
+#include "cpu_topology.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <cstdlib>
+#include <cctype>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+const char* CPU_SYSFS = "/sys/devices/system/cpu";
+const char* NODE_SYSFS = "/sys/devices/system/node";
+
+bool readLine(const std::string& path, std::string& line) {
+    std::ifstream in(path);
+    return in && std::getline(in, line);
+}
+
+int readInt(const std::string& path, int fallback) {
+    std::string line;
+    if (!readLine(path, line)) {
+        return fallback;
+    }
+    char* end = nullptr;
+    long value = std::strtol(line.c_str(), &end, 10);
+    return end != line.c_str() ? static_cast<int>(value) : fallback;
+}
+
+} // namespace
+
+CpuTopology CpuTopology::detect() {
+    CpuTopology topology;
+    std::vector<int> allowed = currentAffinity();
+    std::set<int> allowedSet(allowed.begin(), allowed.end());
+
+    std::vector<int> online;
+    std::string line;
+    if (!readLine(std::string(CPU_SYSFS) + "/online", line) || !parseCpuList(line, online)) {
+        online = allowed;
+    }
+
+    // NUMA nodes list their CPUs; machines without the node directory are one node
+    std::map<int, int> nodeOfCpu;
+    std::set<int> nodes;
+    if (DIR* dir = opendir(NODE_SYSFS)) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            int node = std::atoi(name.c_str() + 4);
+            std::vector<int> nodeCpus;
+            if (readLine(std::string(NODE_SYSFS) + "/" + name + "/cpulist", line) && parseCpuList(line, nodeCpus)) {
+                for (int cpu : nodeCpus) {
+                    nodeOfCpu[cpu] = node;
+                }
+                if (!nodeCpus.empty()) {
+                    nodes.insert(node);
+                }
+            }
+        }
+        closedir(dir);
+    }
+
+    for (int cpu : online) {
+        std::string base = std::string(CPU_SYSFS) + "/cpu" + std::to_string(cpu) + "/topology/";
+        CpuInfo info;
+        info.cpu = cpu;
+        info.core = readInt(base + "core_id", cpu);
+        info.package = readInt(base + "physical_package_id", 0);
+        auto found = nodeOfCpu.find(cpu);
+        info.node = found != nodeOfCpu.end() ? found->second : 0;
+        info.allowed = allowedSet.count(cpu) > 0;
+        topology.cpus_.push_back(info);
+    }
+
+    topology.nodeCount_ = std::max<size_t>(nodes.size(), 1);
+    return topology;
+}
+
+const std::vector<CpuInfo>& CpuTopology::cpus() const {
+    return cpus_;
+}
+
+size_t CpuTopology::nodeCount() const {
+    return nodeCount_;
+}
+
+int CpuTopology::nodeOf(int cpu) const {
+    for (const auto& info : cpus_) {
+        if (info.cpu == cpu) {
+            return info.node;
+        }
+    }
+    return 0;
+}
+
+bool CpuTopology::isUsable(int cpu) const {
+    for (const auto& info : cpus_) {
+        if (info.cpu == cpu) {
+            return info.allowed;
+        }
+    }
+    return false;
+}
+
+std::string CpuTopology::describe() const {
+    std::map<int, std::vector<const CpuInfo*>> byNode;
+    std::set<int> packages;
+    for (const auto& info : cpus_) {
+        byNode[info.node].push_back(&info);
+        packages.insert(info.package);
+    }
+
+    std::ostringstream out;
+    out << cpus_.size() << " CPU" << (cpus_.size() == 1 ? "" : "s") << ", "
+        << packages.size() << " package" << (packages.size() == 1 ? "" : "s") << ", "
+        << byNode.size() << " NUMA node" << (byNode.size() == 1 ? "" : "s") << "\n";
+
+    for (const auto& node : byNode) {
+        std::vector<int> all;
+        std::vector<int> usable;
+        std::map<std::pair<int, int>, std::vector<int>> cores;
+        for (const CpuInfo* info : node.second) {
+            all.push_back(info->cpu);
+            if (info->allowed) {
+                usable.push_back(info->cpu);
+            }
+            cores[{info->package, info->core}].push_back(info->cpu);
+        }
+
+        out << "  node " << node.first << ": cpus " << formatCpuList(all);
+        if (usable.size() != all.size()) {
+            out << " (usable " << (usable.empty() ? "none" : formatCpuList(usable)) << ")";
+        }
+        out << ", " << cores.size() << " core" << (cores.size() == 1 ? "" : "s");
+
+        // Show SMT siblings only when there are any
+        bool smt = false;
+        for (const auto& core : cores) {
+            smt = smt || core.second.size() > 1;
+        }
+        if (smt) {
+            out << ", siblings";
+            for (const auto& core : cores) {
+                out << " [" << formatCpuList(core.second) << "]";
+            }
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+bool CpuTopology::parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    std::set<int> result;
+    std::stringstream stream(text);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) {
+            continue;
+        }
+
+        size_t dash = item.find('-');
+        char* end = nullptr;
+        long first = std::strtol(item.c_str(), &end, 10);
+        if (end == item.c_str() || first < 0) {
+            return false;
+        }
+        long last = first;
+        if (dash != std::string::npos) {
+            const char* rest = item.c_str() + dash + 1;
+            last = std::strtol(rest, &end, 10);
+            if (end == rest) {
+                return false;
+            }
+        }
+        if (*end != '\0' || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            result.insert(static_cast<int>(cpu));
+        }
+    }
+
+    cpus.assign(result.begin(), result.end());
+    return true;
+}
+
+std::string CpuTopology::formatCpuList(const std::vector<int>& cpus) {
+    std::vector<int> sorted(cpus);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::ostringstream out;
+    for (size_t i = 0; i < sorted.size();) {
+        size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) {
+            ++j;
+        }
+        if (i > 0) {
+            out << ",";
+        }
+        out << sorted[i];
+        if (j > i) {
+            out << "-" << sorted[j];
+        }
+        i = j + 1;
+    }
+    return out.str();
+}
+
+bool CpuTopology::pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+std::vector<int> CpuTopology::currentAffinity() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+int CpuTopology::currentCpu() {
+    return sched_getcpu();
+}
@@ -0,0 +1,168 @@
+#include "fd_cache.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+OpenFile::OpenFile(int fd) : fd_(fd) {
+}
+
+OpenFile::~OpenFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+int OpenFile::fd() const {
+    return fd_;
+}
+
+namespace {
+
+bool sameFile(const struct stat& a, ino_t inode, off_t size, const struct timespec& mtime) {
+    return a.st_ino == inode && a.st_size == size &&
+           a.st_mtim.tv_sec == mtime.tv_sec && a.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+// openat()/fstatat() ignore the directory for an absolute name and follow
+// "..", so only a single plain component may reach them
+bool plainName(const std::string& name) {
+    return !name.empty() && name != "." && name != ".." && name.find('/') == std::string::npos;
+}
+
+OpenFilePtr openAt(int dirFd, const std::string& name, struct stat& st) {
+    if (!plainName(name)) {
+        return nullptr;
+    }
+    int fd = openat(dirFd, name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // Describe what was actually opened, not what the path pointed at earlier
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    return std::make_shared<OpenFile>(fd);
+}
+
+} // namespace
+
+FileDescriptorCache::FileDescriptorCache(size_t capacity)
+    : capacity_(capacity > 0 ? capacity : 1),
+      hits_(0),
+      misses_(0) {
+}
+
+OpenFilePtr FileDescriptorCache::directoryHandle(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (directoryFd_ && directory == directory_) {
+        return directoryFd_;
+    }
+
+    // Shared directory changed: every cached name now refers to another file
+    lru_.clear();
+    index_.clear();
+    directoryFd_.reset();
+    directory_ = directory;
+
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        directoryFd_ = std::make_shared<OpenFile>(fd);
+    }
+    return directoryFd_;
+}
+
+OpenFilePtr FileDescriptorCache::acquire(const std::string& directory, const std::string& name, struct stat& st) {
+    if (!plainName(name)) {
+        return nullptr;
+    }
+    OpenFilePtr dir = directoryHandle(directory);
+    if (!dir) {
+        return nullptr;
+    }
+
+    if (fstatat(dir->fd(), name.c_str(), &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = index_.find(name);
+        if (found != index_.end() && directoryFd_ == dir) {
+            auto it = found->second;
+            if (sameFile(st, it->inode, it->size, it->mtime)) {
+                lru_.splice(lru_.begin(), lru_, it);
+                hits_++;
+                return it->file;
+            }
+            // Replaced or modified since it was opened
+            index_.erase(found);
+            lru_.erase(it);
+        }
+    }
+
+    misses_++;
+    OpenFilePtr file = openAt(dir->fd(), name, st);
+    if (!file) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (directoryFd_ != dir) {
+        return file; // Directory switched meanwhile; don't cache under the new one
+    }
+
+    auto found = index_.find(name);
+    if (found != index_.end()) {
+        lru_.erase(found->second);
+        index_.erase(found);
+    }
+    lru_.push_front(Entry{name, file, st.st_ino, st.st_size, st.st_mtim});
+    index_[name] = lru_.begin();
+
+    while (lru_.size() > capacity_) {
+        index_.erase(lru_.back().name);
+        lru_.pop_back();
+    }
+    return file;
+}
+
+OpenFilePtr FileDescriptorCache::openUncached(const std::string& directory, const std::string& name, struct stat& st) {
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return nullptr;
+    }
+    OpenFilePtr file = openAt(dirFd, name, st);
+    close(dirFd);
+    return file;
+}
+
+void FileDescriptorCache::invalidate(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(name);
+    if (found != index_.end()) {
+        lru_.erase(found->second);
+        index_.erase(found);
+    }
+}
+
+void FileDescriptorCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    directoryFd_.reset();
+    directory_.clear();
+}
+
+size_t FileDescriptorCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+uint64_t FileDescriptorCache::hits() const {
+    return hits_;
+}
+
+uint64_t FileDescriptorCache::misses() const {
+    return misses_;
+}
@@ -0,0 +1,207 @@
+#include "file_cache.h"
+#include <algorithm>
+#include <iterator>
+
+FileCache::FileCache(size_t capacityBytes, size_t maxFileSize)
+    : capacityBytes_(capacityBytes),
+      maxFileSize_(maxFileSize),
+      smallBytes_(0),
+      mainBytes_(0),
+      metrics_(nullptr) {
+}
+
+void FileCache::setMetrics(ServerMetrics* metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_ = metrics;
+}
+
+void FileCache::configure(size_t capacityBytes, size_t maxFileSize) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacityBytes_ = capacityBytes;
+    maxFileSize_ = maxFileSize;
+
+    // Entries that are now too large can never be hit usefully again
+    for (auto* list : {&small_, &main_}) {
+        for (auto it = list->begin(); it != list->end();) {
+            auto next = std::next(it);
+            if (it->data->size() > maxFileSize_) {
+                eraseLocked(it);
+            }
+            it = next;
+        }
+    }
+    evictLocked();
+}
+
+FileCache::Buffer FileCache::lookup(const std::string& path, const struct stat& st) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto found = index_.find(path);
+    if (found == index_.end()) {
+        if (metrics_) metrics_->cacheMisses++;
+        return nullptr;
+    }
+
+    auto it = found->second;
+    if (it->inode != st.st_ino || it->size != st.st_size ||
+        it->mtime.tv_sec != st.st_mtim.tv_sec || it->mtime.tv_nsec != st.st_mtim.tv_nsec) {
+        // File changed on disk since it was cached
+        eraseLocked(it);
+        if (metrics_) metrics_->cacheMisses++;
+        return nullptr;
+    }
+
+    // No reordering on hit: FIFO queues only need the access count
+    if (it->freq < 3) {
+        it->freq++;
+    }
+    if (metrics_) metrics_->cacheHits++;
+    return it->data;
+}
+
+void FileCache::insert(const std::string& path, const struct stat& st, Buffer data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!data || data->size() > maxFileSize_ || data->size() > capacityBytes_) {
+        return;
+    }
+
+    auto found = index_.find(path);
+    if (found != index_.end()) {
+        eraseLocked(found->second);
+    }
+
+    // Recently evicted from the small queue: it is being reused, skip probation
+    Queue queue = Queue::Small;
+    auto ghost = ghost_.find(path);
+    if (ghost != ghost_.end()) {
+        ghostOrder_.erase(ghost->second);
+        ghost_.erase(ghost);
+        queue = Queue::Main;
+    }
+
+    size_t bytes = data->size();
+    EntryList& list = (queue == Queue::Small) ? small_ : main_;
+    list.push_front(Entry{path, std::move(data), st.st_ino, st.st_size, st.st_mtim, queue, 0});
+    index_[path] = list.begin();
+    (queue == Queue::Small ? smallBytes_ : mainBytes_) += bytes;
+
+    evictLocked();
+}
+
+void FileCache::invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(path);
+    if (found != index_.end()) {
+        eraseLocked(found->second);
+    }
+}
+
+void FileCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    small_.clear();
+    main_.clear();
+    index_.clear();
+    ghost_.clear();
+    ghostOrder_.clear();
+    smallBytes_ = 0;
+    mainBytes_ = 0;
+    if (metrics_) metrics_->cacheBytes = 0;
+}
+
+size_t FileCache::maxFileSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxFileSize_;
+}
+
+size_t FileCache::capacityBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacityBytes_;
+}
+
+size_t FileCache::sizeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return smallBytes_ + mainBytes_;
+}
+
+size_t FileCache::entryCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+}
+
+size_t FileCache::ghostCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ghost_.size();
+}
+
+void FileCache::evictLocked() {
+    while (smallBytes_ + mainBytes_ > capacityBytes_) {
+        if (!small_.empty() && (smallBytes_ > capacityBytes_ / 10 || main_.empty())) {
+            evictSmallLocked();
+        } else {
+            evictMainLocked();
+        }
+    }
+    if (metrics_) metrics_->cacheBytes = smallBytes_ + mainBytes_;
+}
+
+void FileCache::evictSmallLocked() {
+    auto it = std::prev(small_.end());
+
+    if (it->freq > 0) {
+        // Read again while on probation: promote to the main queue
+        size_t bytes = it->data->size();
+        smallBytes_ -= bytes;
+        mainBytes_ += bytes;
+        it->queue = Queue::Main;
+        it->freq = 0;
+        main_.splice(main_.begin(), small_, it);
+        return;
+    }
+
+    addGhostLocked(it->path);
+    eraseLocked(it);
+    if (metrics_) metrics_->cacheEvictions++;
+}
+
+void FileCache::evictMainLocked() {
+    auto it = std::prev(main_.end());
+
+    if (it->freq > 0) {
+        // Second chance: reinsert with one access consumed
+        it->freq--;
+        main_.splice(main_.begin(), main_, it);
+        return;
+    }
+
+    eraseLocked(it);
+    if (metrics_) metrics_->cacheEvictions++;
+}
+
+void FileCache::eraseLocked(EntryList::iterator it) {
+    size_t bytes = it->data->size();
+    index_.erase(it->path);
+    if (it->queue == Queue::Small) {
+        smallBytes_ -= bytes;
+        small_.erase(it);
+    } else {
+        mainBytes_ -= bytes;
+        main_.erase(it);
+    }
+    if (metrics_) metrics_->cacheBytes = smallBytes_ + mainBytes_;
+}
+
+void FileCache::addGhostLocked(const std::string& path) {
+    // Remember about as many evicted keys as the main queue holds entries
+    size_t limit = std::max<size_t>(main_.size(), 64);
+    auto found = ghost_.find(path);
+    if (found != ghost_.end()) {
+        ghostOrder_.erase(found->second);
+        ghost_.erase(found);
+    }
+    while (ghostOrder_.size() >= limit) {
+        ghost_.erase(ghostOrder_.front());
+        ghostOrder_.pop_front();
+    }
+    ghostOrder_.push_back(path);
+    ghost_[path] = std::prev(ghostOrder_.end());
+}
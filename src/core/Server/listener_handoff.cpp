@@ -0,0 +1,121 @@
+#include "listener_handoff.h"
+#include "server_socket.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+#include <errno.h>
+
+namespace {
+
+void setExchangeTimeout(int fd) {
+    struct timeval timeout = {ListenerHandoff::EXCHANGE_TIMEOUT_SECONDS, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+} // namespace
+
+ListenerHandoff::ListenerHandoff() : controlFd_(-1) {
+}
+
+ListenerHandoff::~ListenerHandoff() {
+    if (controlFd_ >= 0) {
+        close(controlFd_);
+    }
+}
+
+bool ListenerHandoff::requestListeners(const std::string& path, std::vector<int>& listenerFds) {
+    listenerFds.clear();
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[Handoff] Invalid control socket path: " << path << "\n";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    controlFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (controlFd_ < 0) {
+        return false;
+    }
+    if (connect(controlFd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        // No predecessor (or a stale socket file): start from scratch
+        close(controlFd_);
+        controlFd_ = -1;
+        return false;
+    }
+    setExchangeTimeout(controlFd_);
+
+    uint8_t request = REQUEST;
+    uint32_t count = 0;
+    if (ServerSocket::sendData(controlFd_, &request, sizeof(request)) != sizeof(request) ||
+        ServerSocket::receiveWithFds(controlFd_, reinterpret_cast<uint8_t*>(&count), sizeof(count),
+                                     listenerFds) != sizeof(count) ||
+        count != listenerFds.size() || count == 0) {
+        std::cerr << "[Handoff] Server on " << path << " did not hand over its listeners\n";
+        for (int fd : listenerFds) {
+            close(fd);
+        }
+        listenerFds.clear();
+        close(controlFd_);
+        controlFd_ = -1;
+        return false;
+    }
+
+    std::cout << "[Handoff] Received " << count << " listener" << (count > 1 ? "s" : "") << " from " << path << "\n";
+    return true;
+}
+
+bool ListenerHandoff::complete() {
+    if (controlFd_ < 0) {
+        return false;
+    }
+
+    uint8_t ack = ACK;
+    bool ok = ServerSocket::sendData(controlFd_, &ack, sizeof(ack)) == sizeof(ack);
+
+    // EOF means the predecessor closed its control listener
+    uint8_t byte;
+    ssize_t received;
+    while (ok && (received = recv(controlFd_, &byte, sizeof(byte), 0)) != 0) {
+        if (received < 0 && errno != EINTR) {
+            ok = false;
+        }
+    }
+
+    close(controlFd_);
+    controlFd_ = -1;
+    return ok;
+}
+
+bool ListenerHandoff::serve(int connFd, const std::vector<int>& listenerFds) {
+    struct ucred cred;
+    socklen_t credLen = sizeof(cred);
+    if (getsockopt(connFd, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) < 0 || cred.uid != geteuid()) {
+        std::cerr << "[Handoff] Refusing listener request from another user\n";
+        return false;
+    }
+    setExchangeTimeout(connFd);
+
+    uint8_t request = 0;
+    if (ServerSocket::receiveData(connFd, &request, sizeof(request)) != sizeof(request) || request != REQUEST) {
+        return false;
+    }
+
+    uint32_t count = static_cast<uint32_t>(listenerFds.size());
+    uint8_t ack = 0;
+    if (ServerSocket::sendWithFds(connFd, reinterpret_cast<const uint8_t*>(&count), sizeof(count), listenerFds) !=
+            sizeof(count) ||
+        ServerSocket::receiveData(connFd, &ack, sizeof(ack)) != sizeof(ack) || ack != ACK) {
+        std::cerr << "[Handoff] Successor (pid " << cred.pid << ") did not take over; still serving\n";
+        return false;
+    }
+
+    std::cout << "[Handoff] Listeners handed over to pid " << cred.pid << "\n";
+    return true;
+}
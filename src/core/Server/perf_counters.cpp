@@ -0,0 +1,136 @@
+#include "perf_counters.h"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+
+namespace {
+
+struct EventSpec {
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventSpec EVENTS[PERF_COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+// Set once a group came up empty: perf is not usable in this process
+std::atomic<bool> g_unavailable{false};
+
+// Kernel-mode counting stays off once it was refused
+std::atomic<bool> g_userOnly{false};
+
+int openEvent(const EventSpec& spec, int groupFd) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_hv = 1;
+    attr.exclude_kernel = g_userOnly ? 1 : 0;
+
+    // pid 0, cpu -1: this thread, on whichever CPU it runs
+    int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+    if (fd < 0 && (errno == EACCES || errno == EPERM) && !attr.exclude_kernel) {
+        g_userOnly = true;
+        attr.exclude_kernel = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+    }
+    return fd;
+}
+
+} // namespace
+
+PerfCounterGroup::PerfCounterGroup() : leaderFd_(-1), members_(0), mask_(0) {
+    for (int& fd : fds_) {
+        fd = -1;
+    }
+    if (g_unavailable) {
+        return;
+    }
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        int fd = openEvent(EVENTS[i], leaderFd_);
+        if (fd < 0) {
+            continue; // Not offered here (e.g. no PMU in a VM)
+        }
+        if (leaderFd_ < 0) {
+            leaderFd_ = fd;
+        }
+        fds_[i] = fd;
+        order_[members_++] = static_cast<PerfCounter>(i);
+        mask_ |= 1u << i;
+    }
+
+    if (leaderFd_ < 0) {
+        g_unavailable = true;
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounterGroup::isAvailable() const {
+    return leaderFd_ >= 0;
+}
+
+unsigned PerfCounterGroup::getCounterMask() const {
+    return mask_;
+}
+
+bool PerfCounterGroup::read(uint64_t values[PERF_COUNTER_COUNT]) const {
+    if (leaderFd_ < 0) {
+        return false;
+    }
+
+    // nr, time_enabled, time_running, then one value per member
+    uint64_t buffer[3 + PERF_COUNTER_COUNT];
+    ssize_t expected = static_cast<ssize_t>((3 + members_) * sizeof(uint64_t));
+    if (::read(leaderFd_, buffer, sizeof(buffer)) != expected || buffer[0] != members_) {
+        return false;
+    }
+
+    uint64_t enabled = buffer[1];
+    uint64_t running = buffer[2];
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        values[i] = 0;
+    }
+    for (size_t i = 0; i < members_; ++i) {
+        uint64_t value = buffer[3 + i];
+        if (running > 0 && running < enabled) {
+            value = static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+        }
+        values[order_[i]] = value;
+    }
+    return true;
+}
+
+const char* PerfCounterGroup::counterName(PerfCounter counter) {
+    switch (counter) {
+        case PERF_CYCLES:
+            return "cycles";
+        case PERF_INSTRUCTIONS:
+            return "instructions";
+        case PERF_CACHE_MISSES:
+            return "cache_misses";
+        case PERF_CONTEXT_SWITCHES:
+            return "context_switches";
+        case PERF_PAGE_FAULTS:
+            return "page_faults";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,169 @@
+#include "rate_limiter.h"
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+const int64_t NS_PER_SEC = 1000000000;
+
+// Sleeping less than this costs more in scheduler overhead than it shapes
+const int64_t MIN_SLEEP_NS = 1000000;
+
+// Sweep unused client buckets after this many new sessions
+const size_t SWEEP_INTERVAL = 256;
+
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+TokenBucket::TokenBucket(uint64_t bytesPerSecond)
+    : rate_(0),
+      burstNs_(0),
+      tat_(0) {
+    setRate(bytesPerSecond);
+}
+
+void TokenBucket::setRate(uint64_t bytesPerSecond) {
+    if (bytesPerSecond > 0) {
+        // 100 ms worth of data, but never less than one 64 KB buffer
+        uint64_t burstBytes = std::max<uint64_t>(bytesPerSecond / 10, 64 * 1024);
+        burstNs_.store(static_cast<int64_t>(burstBytes * static_cast<double>(NS_PER_SEC) / bytesPerSecond),
+                       std::memory_order_relaxed);
+    }
+    rate_.store(bytesPerSecond, std::memory_order_relaxed);
+}
+
+uint64_t TokenBucket::rate() const {
+    return rate_.load(std::memory_order_relaxed);
+}
+
+int64_t TokenBucket::reserve(uint64_t bytes, int64_t nowNs) {
+    uint64_t rate = rate_.load(std::memory_order_relaxed);
+    if (rate == 0) {
+        return 0;
+    }
+
+    int64_t cost = static_cast<int64_t>(bytes * static_cast<double>(NS_PER_SEC) / rate);
+    int64_t tat = tat_.load(std::memory_order_relaxed);
+    int64_t newTat;
+    do {
+        // An idle bucket doesn't bank more than its burst
+        newTat = std::max(tat, nowNs) + cost;
+    } while (!tat_.compare_exchange_weak(tat, newTat, std::memory_order_relaxed));
+
+    int64_t wait = newTat - burstNs_.load(std::memory_order_relaxed) - nowNs;
+    return wait > 0 ? wait : 0;
+}
+
+TransferShaper::TransferShaper(TokenBucketPtr session, TokenBucketPtr client, TokenBucket* global,
+                               ServerMetrics* metrics)
+    : session_(std::move(session)),
+      client_(std::move(client)),
+      global_(global),
+      metrics_(metrics) {
+}
+
+bool TransferShaper::active() const {
+    return global_->rate() > 0 || client_->rate() > 0 || session_->rate() > 0;
+}
+
+size_t TransferShaper::chunkSize(size_t defaultChunk) const {
+    uint64_t tightest = 0;
+    for (uint64_t rate : {global_->rate(), client_->rate(), session_->rate()}) {
+        if (rate > 0 && (tightest == 0 || rate < tightest)) {
+            tightest = rate;
+        }
+    }
+    if (tightest == 0) {
+        return defaultChunk;
+    }
+    return std::min<size_t>(defaultChunk, std::max<uint64_t>(tightest / 100, 4096));
+}
+
+int64_t TransferShaper::pace(size_t bytes) {
+    int64_t now = steadyNowNs();
+
+    // Every level is charged; the slowest one decides the wait
+    int64_t wait = session_->reserve(bytes, now);
+    wait = std::max(wait, client_->reserve(bytes, now));
+    wait = std::max(wait, global_->reserve(bytes, now));
+    if (wait < MIN_SLEEP_NS) {
+        return 0;
+    }
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    if (metrics_) {
+        metrics_->throttleMicros += static_cast<uint64_t>(wait / 1000);
+    }
+    return wait;
+}
+
+RateLimiter::RateLimiter()
+    : perClient_(0),
+      perSession_(0),
+      metrics_(nullptr),
+      sinceSweep_(0) {
+}
+
+void RateLimiter::setMetrics(ServerMetrics* metrics) {
+    metrics_ = metrics;
+}
+
+void RateLimiter::setLimits(uint64_t globalBytesPerSecond, uint64_t perClientBytesPerSecond,
+                            uint64_t perSessionBytesPerSecond) {
+    global_.setRate(globalBytesPerSecond);
+    perClient_ = perClientBytesPerSecond;
+    perSession_ = perSessionBytesPerSecond;
+
+    // Running sessions follow the new limits from their next chunk on
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : clients_) {
+        entry.second->setRate(perClientBytesPerSecond);
+    }
+    for (auto& weak : sessions_) {
+        if (auto bucket = weak.lock()) {
+            bucket->setRate(perSessionBytesPerSecond);
+        }
+    }
+}
+
+uint64_t RateLimiter::globalLimit() const {
+    return global_.rate();
+}
+
+uint64_t RateLimiter::perClientLimit() const {
+    return perClient_.load();
+}
+
+uint64_t RateLimiter::perSessionLimit() const {
+    return perSession_.load();
+}
+
+TransferShaper RateLimiter::shaperFor(const std::string& clientAddr) {
+    std::string ip = clientAddr.substr(0, clientAddr.rfind(':'));
+
+    // Created under the lock so a concurrent setLimits() can't miss it
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto session = std::make_shared<TokenBucket>(perSession_.load());
+    if (++sinceSweep_ >= SWEEP_INTERVAL) {
+        sinceSweep_ = 0;
+        sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                       [](const std::weak_ptr<TokenBucket>& weak) { return weak.expired(); }),
+                        sessions_.end());
+        for (auto it = clients_.begin(); it != clients_.end();) {
+            it = it->second.use_count() == 1 ? clients_.erase(it) : std::next(it);
+        }
+    }
+    sessions_.push_back(session);
+
+    TokenBucketPtr& client = clients_[ip];
+    if (!client) {
+        client = std::make_shared<TokenBucket>(perClient_.load());
+    }
+    return TransferShaper(session, client, &global_, metrics_.load());
+}
@@ -0,0 +1,116 @@
+#include "server_events.h"
+#include <cstring>
+#include <chrono>
+
+void ServerEvent::setClientAddress(const std::string& addr) {
+    std::strncpy(clientAddr, addr.c_str(), sizeof(clientAddr) - 1);
+    clientAddr[sizeof(clientAddr) - 1] = '\0';
+}
+
+void ServerEvent::setFilename(const std::string& name) {
+    std::strncpy(filename, name.c_str(), sizeof(filename) - 1);
+    filename[sizeof(filename) - 1] = '\0';
+}
+
+ServerEventQueue::ServerEventQueue(size_t capacity)
+    : mask_(0),
+      enqueuePos_(0),
+      dequeuePos_(0),
+      dropped_(0),
+      consumerWaiting_(false) {
+    // Round capacity up to a power of two so we can mask instead of modulo
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    buffer_ = std::make_unique<Cell[]>(size);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+        buffer_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool ServerEventQueue::push(const ServerEvent& event) {
+    Cell* cell = nullptr;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &buffer_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Queue full - drop rather than block the session thread
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->event = event;
+    if (cell->event.timestamp_ms == 0) {
+        cell->event.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    // Only pay for the mutex when the consumer is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerWaiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        waitCv_.notify_one();
+    }
+    return true;
+}
+
+bool ServerEventQueue::tryPop(ServerEvent& event) {
+    Cell* cell = nullptr;
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &buffer_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Empty
+        } else {
+            pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    event = cell->event;
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+bool ServerEventQueue::waitPop(ServerEvent& event, int timeout_ms) {
+    if (tryPop(event)) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(waitMutex_);
+    consumerWaiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Re-check after announcing that we are waiting to avoid a lost wakeup
+    bool got = tryPop(event);
+    if (!got) {
+        waitCv_.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+        got = tryPop(event);
+    }
+
+    consumerWaiting_.store(false, std::memory_order_relaxed);
+    return got;
+}
+
+uint64_t ServerEventQueue::droppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
@@ -1,11 +1,55 @@
 #include "server_metrics.h"
+#include "server_protocol.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <cstring>
 
+namespace {
+
+const char* commandName(size_t opcode) {
+    switch (opcode) {
+        case CMD_LIST:
+            return "LIST";
+        case CMD_GET:
+            return "GET";
+        case CMD_PUT:
+            return "PUT";
+        case CMD_PING:
+            return "PING";
+        case CMD_GET_FD:
+            return "GET_FD";
+        case CMD_SHM_ATTACH:
+            return "SHM_ATTACH";
+        case CMD_SESSION_STATS:
+            return "SESSION_STATS";
+        default:
+            return "OTHER";
+    }
+}
+
+void clearCommandProfiles(ServerMetrics::CommandProfile* profiles) {
+    for (size_t i = 0; i < ServerMetrics::COMMAND_PROFILE_SLOTS; ++i) {
+        profiles[i].commands = 0;
+        profiles[i].bytes = 0;
+        for (auto& events : profiles[i].events) {
+            events = 0;
+        }
+    }
+}
+
+void clearTransferBounds(std::atomic<uint64_t>* bounds) {
+    for (size_t i = 0; i < TRANSFER_BOUND_COUNT; ++i) {
+        bounds[i] = 0;
+    }
+}
+
+} // namespace
+
 ServerMetrics::ServerMetrics() {
     startTime = std::chrono::system_clock::now();
+    clearCommandProfiles(commandProfiles);
+    clearTransferBounds(transferBounds);
 }
 
 double ServerMetrics::getUptimeSeconds() const {
@@ -14,6 +58,12 @@ double ServerMetrics::getUptimeSeconds() const {
     return duration.count();
 }
 
+double ServerMetrics::getCacheHitRatio() const {
+    uint64_t hits = cacheHits.load();
+    uint64_t lookups = hits + cacheMisses.load();
+    return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+}
+
 void ServerMetrics::incrementConnections() {
     totalConnections++;
     activeConnections++;
@@ -67,14 +117,56 @@ void ServerMetrics::updateLatency(double latency_ms) {
     }
 }
 
+void ServerMetrics::addCommandProfile(uint8_t command, uint64_t bytes, const uint64_t events[PERF_COUNTER_COUNT],
+                                      unsigned counterMask) {
+    if (command >= COMMAND_PROFILE_SLOTS) {
+        return;
+    }
+    CommandProfile& profile = commandProfiles[command];
+    profile.commands++;
+    profile.bytes += bytes;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counterMask & (1u << i)) {
+            profile.events[i] += events[i];
+        }
+    }
+    profiledCounters |= counterMask;
+}
+
+void ServerMetrics::addTransferTcp(const TcpTransferStats& tcp) {
+    if (tcp.samples == 0) {
+        return;
+    }
+    tcpTransfers++;
+    tcpSegmentsOut += tcp.segmentsOut;
+    tcpRetransmits += tcp.retransmits;
+    transferBounds[static_cast<size_t>(tcp.bound)]++;
+}
+
+double ServerMetrics::getRetransmitRate() const {
+    uint64_t segments = tcpSegmentsOut.load();
+    return segments > 0 ? static_cast<double>(tcpRetransmits.load()) / segments * 100.0 : 0.0;
+}
+
 void ServerMetrics::reset() {
     totalConnections = 0;
     activeConnections = 0;
     failedConnections = 0;
+    sessionsReaped = 0;
     totalBytesReceived = 0;
     totalBytesSent = 0;
     filesUploaded = 0;
     filesDownloaded = 0;
+    throttleMicros = 0;
+    cacheHits = 0;
+    cacheMisses = 0;
+    cacheEvictions = 0;
+    clearCommandProfiles(commandProfiles);
+    profiledCounters = 0;
+    tcpTransfers = 0;
+    tcpSegmentsOut = 0;
+    tcpRetransmits = 0;
+    clearTransferBounds(transferBounds);
     
     std::lock_guard<std::mutex> lock(mutex_);
     averageThroughput_kbps = 0.0;
@@ -102,7 +194,9 @@ void ServerMetrics::exportToCSV(const std::string& filename) const {
     if (!fileExists) {
         outFile << "Timestamp,Uptime_s,Total_Connections,Active_Connections,Failed_Connections,"
                 << "Bytes_Received,Bytes_Sent,Files_Uploaded,Files_Downloaded,"
-                << "Avg_Throughput_kbps,Peak_Throughput_kbps,Avg_Latency_ms\n";
+                << "Avg_Throughput_kbps,Peak_Throughput_kbps,Avg_Latency_ms,"
+                << "Cache_Hits,Cache_Misses,Cache_Evictions,Cache_Bytes,Sessions_Reaped,Throttle_ms,"
+                << "Tcp_Transfers,Tcp_Segments_Out,Tcp_Retransmits\n";
     }
 
     // Get current timestamp
@@ -122,7 +216,16 @@ void ServerMetrics::exportToCSV(const std::string& filename) const {
             << std::fixed << std::setprecision(2)
             << averageThroughput_kbps << ","
             << peakThroughput_kbps << ","
-            << averageLatency_ms << "\n";
+            << averageLatency_ms << ","
+            << cacheHits.load() << ","
+            << cacheMisses.load() << ","
+            << cacheEvictions.load() << ","
+            << cacheBytes.load() << ","
+            << sessionsReaped.load() << ","
+            << throttleMicros.load() / 1000 << ","
+            << tcpTransfers.load() << ","
+            << tcpSegmentsOut.load() << ","
+            << tcpRetransmits.load() << "\n";
 
     outFile.close();
 
@@ -131,6 +234,55 @@ void ServerMetrics::exportToCSV(const std::string& filename) const {
     } else {
         std::cerr << "[Metrics] Error writing to " << filename << "\n";
     }
+
+    unsigned counters = profiledCounters.load();
+    if (counters == 0) {
+        return;
+    }
+
+    // metrics.csv -> metrics_commands.csv
+    std::string commandsFile = filename;
+    size_t dot = commandsFile.rfind(".csv");
+    if (dot != std::string::npos && dot + 4 == commandsFile.size()) {
+        commandsFile.insert(dot, "_commands");
+    } else {
+        commandsFile += "_commands.csv";
+    }
+    std::ifstream checkCommands(commandsFile);
+    bool commandsExist = checkCommands.good();
+    checkCommands.close();
+
+    std::ofstream commandsOut(commandsFile, std::ios::app);
+    if (!commandsOut) {
+        std::cerr << "[Metrics] Failed to open file: " << commandsFile << "\n";
+        return;
+    }
+    if (!commandsExist) {
+        commandsOut << "Timestamp,Command,Commands,Bytes,Cycles,Instructions,Cache_Misses,"
+                    << "Context_Switches,Page_Faults,Cycles_per_GB\n";
+    }
+    for (size_t op = 0; op < COMMAND_PROFILE_SLOTS; ++op) {
+        const CommandProfile& profile = commandProfiles[op];
+        uint64_t commands = profile.commands.load();
+        if (commands == 0) {
+            continue;
+        }
+        uint64_t bytes = profile.bytes.load();
+        commandsOut << std::put_time(std::localtime(&timestamp), "%Y-%m-%d %H:%M:%S") << ","
+                    << commandName(op) << "," << commands << "," << bytes;
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            commandsOut << ",";
+            if (counters & (1u << i)) {
+                commandsOut << profile.events[i].load(); // Empty field: not measurable here
+            }
+        }
+        commandsOut << ",";
+        if ((counters & (1u << PERF_CYCLES)) && bytes > 0) {
+            commandsOut << std::fixed << std::setprecision(0)
+                        << profile.events[PERF_CYCLES].load() / (bytes / 1e9);
+        }
+        commandsOut << "\n";
+    }
 }
 
 void ServerMetrics::display() const {
@@ -141,13 +293,75 @@ void ServerMetrics::display() const {
     std::cout << "Total Connections:   " << totalConnections.load() << "\n";
     std::cout << "Active Connections:  " << activeConnections.load() << "\n";
     std::cout << "Failed Connections:  " << failedConnections.load() << "\n";
+    std::cout << "Sessions Reaped:     " << sessionsReaped.load() << "\n";
     std::cout << "Bytes Received:      " << totalBytesReceived.load() << " bytes\n";
     std::cout << "Bytes Sent:          " << totalBytesSent.load() << " bytes\n";
     std::cout << "Files Uploaded:      " << filesUploaded.load() << "\n";
     std::cout << "Files Downloaded:    " << filesDownloaded.load() << "\n";
+    std::cout << "Throttle Time:       " << throttleMicros.load() / 1000 << " ms\n";
     std::cout << std::fixed << std::setprecision(2);
     std::cout << "Avg Throughput:      " << averageThroughput_kbps << " kbps\n";
     std::cout << "Peak Throughput:     " << peakThroughput_kbps << " kbps\n";
     std::cout << "Avg Latency:         " << averageLatency_ms << " ms\n";
+    std::cout << "Cache Hits/Misses:   " << cacheHits.load() << " / " << cacheMisses.load()
+              << " (" << (getCacheHitRatio() * 100.0) << "%)\n";
+    std::cout << "Cache Evictions:     " << cacheEvictions.load() << "\n";
+    std::cout << "Cache Size:          " << cacheBytes.load() << " bytes\n";
+    if (tcpTransfers.load() > 0) {
+        std::cout << "TCP Retransmits:     " << tcpRetransmits.load() << " / " << tcpSegmentsOut.load()
+                  << " segments (" << getRetransmitRate() << "%)\n";
+        std::cout << "Transfers Bound By:  ";
+        for (size_t i = 1; i < TRANSFER_BOUND_COUNT; ++i) {
+            std::cout << transferBoundName(static_cast<TransferBound>(i)) << " " << transferBounds[i].load() << ", ";
+        }
+        std::cout << "unknown " << transferBounds[0].load() << "\n";
+    }
+
+    unsigned counters = profiledCounters.load();
+    if (counters != 0) {
+        // Averages per command; "-" where the counter is not available
+        std::cout << "--- Per-command counters (avg per command) ---\n";
+        std::cout << std::left << std::setw(12) << "Command" << std::setw(10) << "Count" << std::setw(12) << "Cycles"
+                  << std::setw(12) << "Instr" << std::setw(7) << "IPC" << std::setw(11) << "CacheMiss"
+                  << std::setw(8) << "CtxSw" << std::setw(8) << "Faults" << "Cycles/GB\n";
+        for (size_t op = 0; op < COMMAND_PROFILE_SLOTS; ++op) {
+            const CommandProfile& profile = commandProfiles[op];
+            uint64_t commands = profile.commands.load();
+            if (commands == 0) {
+                continue;
+            }
+            auto perCommand = [&](PerfCounter counter, int width) {
+                std::cout << std::setw(width);
+                if (counters & (1u << counter)) {
+                    std::cout << static_cast<double>(profile.events[counter].load()) / commands;
+                } else {
+                    std::cout << "-";
+                }
+            };
+            std::cout << std::left << std::setw(12) << commandName(op) << std::setw(10) << commands
+                      << std::setprecision(0);
+            perCommand(PERF_CYCLES, 12);
+            perCommand(PERF_INSTRUCTIONS, 12);
+            uint64_t cycles = profile.events[PERF_CYCLES].load();
+            if ((counters & (1u << PERF_INSTRUCTIONS)) && cycles > 0) {
+                std::cout << std::setprecision(2) << std::setw(7)
+                          << static_cast<double>(profile.events[PERF_INSTRUCTIONS].load()) / cycles
+                          << std::setprecision(0);
+            } else {
+                std::cout << std::setw(7) << "-";
+            }
+            perCommand(PERF_CACHE_MISSES, 11);
+            perCommand(PERF_CONTEXT_SWITCHES, 8);
+            perCommand(PERF_PAGE_FAULTS, 8);
+            uint64_t bytes = profile.bytes.load();
+            if ((counters & (1u << PERF_CYCLES)) && bytes > 0) {
+                std::cout << profile.events[PERF_CYCLES].load() / (bytes / 1e9);
+            } else {
+                std::cout << "-";
+            }
+            std::cout << "\n";
+        }
+        std::cout << std::right << std::setprecision(2);
+    }
     std::cout << "=====================\n\n";
 }
\ No newline at end of file
@@ -1,17 +1,33 @@
 #include "server_protocol.h"
 #include "server_socket.h"
+#include "core/socket_tuning.h"
+#include "core/fault_injection.h"
 #include <iostream>
-#include <fstream>
 #include <cstring>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <cerrno>
 #include <chrono>
+#include <algorithm>
 
 ServerProtocol::ServerProtocol() 
     : sharedDirectory_(std::make_shared<std::string>("./shared")),
-      metrics_(nullptr) {
+      metrics_(nullptr),
+      events_(nullptr),
+      cache_(nullptr),
+      fds_(nullptr),
+      watch_(nullptr),
+      shaper_(nullptr),
+      shmCapacity_(0),
+      commandProfiling_(false),
+      sessionStats_(nullptr),
+      cork_(false),
+      currentBytes_(0) {
 }
 
 void ServerProtocol::setSharedDirectory(const std::string& directory) {
@@ -26,6 +42,43 @@ void ServerProtocol::setMetrics(ServerMetrics* metrics) {
     metrics_ = metrics;
 }
 
+void ServerProtocol::setEventQueue(ServerEventQueue* events, const std::string& clientAddr) {
+    events_ = events;
+    clientAddr_ = clientAddr;
+}
+
+void ServerProtocol::setFileCache(FileCache* cache) {
+    cache_ = cache;
+}
+
+void ServerProtocol::setDescriptorCache(FileDescriptorCache* fds) {
+    fds_ = fds;
+}
+
+void ServerProtocol::setSessionWatch(SessionWatch* watch) {
+    watch_ = watch;
+}
+
+void ServerProtocol::setShaper(TransferShaper* shaper) {
+    shaper_ = shaper;
+}
+
+void ServerProtocol::setSharedMemoryCapacity(size_t capacity) {
+    shmCapacity_ = capacity;
+}
+
+void ServerProtocol::setCommandProfiling(bool enable) {
+    commandProfiling_ = enable;
+}
+
+void ServerProtocol::setSessionStatsProvider(const SessionStatsProvider* provider) {
+    sessionStats_ = provider;
+}
+
+void ServerProtocol::setCork(bool enable) {
+    cork_ = enable;
+}
+
 std::string ServerProtocol::getSharedDirectory() const {
     return *sharedDirectory_;
 }
@@ -35,7 +88,7 @@ bool ServerProtocol::processRequest(int clientFd) {
     
     // Read command from client
     uint8_t cmd = 0;
-    ssize_t received = ServerSocket::receiveData(clientFd, &cmd, sizeof(cmd));
+    ssize_t received = receiveBytes(clientFd, &cmd, sizeof(cmd));
     
     if (received == 0) {
         // Clean disconnect
@@ -49,6 +102,31 @@ bool ServerProtocol::processRequest(int clientFd) {
     }
 
     bool result = false;
+    currentFilename_.clear();
+    currentBytes_ = 0;
+
+    // From here on the progress timeout applies instead of the idle one
+    if (watch_) {
+        watch_->beginCommand();
+    }
+
+    // Counters are per thread, so the group is opened here rather than in
+    // the constructor; it stays unavailable where perf is not permitted
+    uint64_t eventsBefore[PERF_COUNTER_COUNT];
+    bool profiled = false;
+    if (commandProfiling_ && metrics_) {
+        if (!perf_) {
+            perf_ = std::make_unique<PerfCounterGroup>();
+        }
+        profiled = perf_->read(eventsBefore);
+    }
+
+    // Data over the rings never touches the socket
+    bool transfer = (cmd == CMD_GET || cmd == CMD_PUT) && !channel_;
+    if (transfer) {
+        tcp_.begin(clientFd, cmd == CMD_GET);
+    }
+
     // Process command
     switch (cmd) {
         case CMD_LIST:
@@ -63,17 +141,49 @@ bool ServerProtocol::processRequest(int clientFd) {
         case CMD_PING:
             result = handlePingCommand(clientFd);
             break;
+        case CMD_GET_FD:
+            result = handleGetFdCommand(clientFd);
+            break;
+        case CMD_SHM_ATTACH:
+            result = handleShmAttachCommand(clientFd);
+            break;
+        case CMD_SESSION_STATS:
+            result = handleSessionStatsCommand(clientFd);
+            break;
         default:
             std::cerr << "[Protocol] Unknown command: " << (int)cmd << "\n";
             return false;
     }
     
+    uint64_t eventsAfter[PERF_COUNTER_COUNT];
+    if (profiled && perf_->read(eventsAfter)) {
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            eventsAfter[i] -= eventsBefore[i];
+        }
+        metrics_->addCommandProfile(cmd, currentBytes_, eventsAfter, perf_->getCounterMask());
+    }
+
+    TcpTransferStats tcp;
+    if (transfer) {
+        tcp = tcp_.end();
+        if (metrics_ && result) {
+            metrics_->addTransferTcp(tcp);
+        }
+    }
+
     // Calculate and update latency
+    auto endTime = std::chrono::high_resolution_clock::now();
     if (metrics_ && result) {
-        auto endTime = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
         metrics_->updateLatency(duration.count());
     }
+
+    auto latency_us = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+    publishCompleted(cmd, result, latency_us.count() / 1000.0, tcp);
+
+    if (watch_) {
+        watch_->endCommand();
+    }
     
     return result;
 }
@@ -84,8 +194,12 @@ bool ServerProtocol::handleListCommand(int clientFd) {
     auto files = listFiles();
     uint32_t fileCount = files.size();
 
+    // The count and the names are separate writes: corked, they leave as
+    // full segments instead of waiting on Nagle for the client's ACK
+    cork(clientFd, true);
+
     // Send file count
-    if (ServerSocket::sendData(clientFd, reinterpret_cast<uint8_t*>(&fileCount), sizeof(fileCount)) < 0) {
+    if (sendBytes(clientFd, reinterpret_cast<uint8_t*>(&fileCount), sizeof(fileCount)) < 0) {
         std::cerr << "[Protocol] Failed to send file count\n";
         return false;
     }
@@ -95,12 +209,13 @@ bool ServerProtocol::handleListCommand(int clientFd) {
         char filenameBuf[256] = {0};
         std::strncpy(filenameBuf, filename.c_str(), sizeof(filenameBuf) - 1);
         
-        if (ServerSocket::sendData(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) < 0) {
+        if (sendBytes(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) < 0) {
             std::cerr << "[Protocol] Failed to send filename\n";
             return false;
         }
     }
 
+    cork(clientFd, false);
     std::cout << "[Protocol] Sent " << fileCount << " files\n";
     return true;
 }
@@ -110,7 +225,7 @@ bool ServerProtocol::handlePingCommand(int clientFd) {
     // Respond immediately with PONG (echo back CMD_PING)
     uint8_t response = CMD_PING;
     std::cout << "[Protocol] Sending PONG: " << (int)response << "\n";
-    if (ServerSocket::sendData(clientFd, &response, sizeof(response)) < 0) {
+    if (sendBytes(clientFd, &response, sizeof(response)) < 0) {
         std::cerr << "[Protocol] Failed to send PONG\n";
         return false;
     }
@@ -123,7 +238,7 @@ bool ServerProtocol::handleGetCommand(int clientFd) {
 
     // Receive filename
     char filenameBuf[256] = {0};
-    if (ServerSocket::receiveData(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) <= 0) {
+    if (receiveBytes(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) <= 0) {
         std::cerr << "[Protocol] Failed to receive filename\n";
         return false;
     }
@@ -143,23 +258,130 @@ bool ServerProtocol::handleGetCommand(int clientFd) {
     }
     
     std::cout << "[Protocol] Client requested file: '" << filename << "' (length: " << filename.length() << ")\n";
+    currentFilename_ = filename;
 
     return sendFile(clientFd, filename);
 }
 
+bool ServerProtocol::handleGetFdCommand(int clientFd) {
+    std::cout << "[Protocol] Processing GET_FD command\n";
+
+    char filenameBuf[256] = {0};
+    if (receiveBytes(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) <= 0) {
+        std::cerr << "[Protocol] Failed to receive filename\n";
+        return false;
+    }
+    std::string filename(filenameBuf, strnlen(filenameBuf, sizeof(filenameBuf)));
+    currentFilename_ = filename;
+
+    // A reply without a descriptor means "not found", as size 0 does for GET
+    uint64_t fileSize = 0;
+    if (channel_ || !ServerSocket::isUnixSocket(clientFd)) {
+        std::cerr << "[Protocol] GET_FD is only served over plain Unix domain sockets\n";
+        sendBytes(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize));
+        return true;
+    }
+
+    // Not the fd cache: the client gets its own open file description,
+    // so its read() offset can't move under anyone else
+    struct stat fileStat;
+    OpenFilePtr file = FileDescriptorCache::openUncached(*sharedDirectory_, filename, fileStat);
+    if (!file) {
+        std::cerr << "[Protocol] File not found: " << filename << "\n";
+        sendBytes(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize));
+        return true;
+    }
+
+    fileSize = fileStat.st_size;
+    if (ServerSocket::sendWithFd(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize), file->fd()) < 0) {
+        std::cerr << "[Protocol] Failed to pass file descriptor\n";
+        return false;
+    }
+
+    if (metrics_) {
+        metrics_->filesDownloaded++;
+    }
+    currentBytes_ = fileSize;
+    std::cout << "[Protocol] Passed descriptor for " << filename << " (" << fileSize << " bytes)\n";
+    return true;
+}
+
+bool ServerProtocol::handleShmAttachCommand(int clientFd) {
+    std::cout << "[Protocol] Processing SHM_ATTACH command\n";
+
+    // Refused (capacity 0, no descriptor) when off, remote, or already attached
+    uint64_t capacity = 0;
+    if (shmCapacity_ == 0 || channel_ || !ServerSocket::isUnixSocket(clientFd)) {
+        std::cerr << "[Protocol] Shared-memory transport not available for this client\n";
+        return sendBytes(clientFd, reinterpret_cast<uint8_t*>(&capacity), sizeof(capacity)) >= 0;
+    }
+
+    std::unique_ptr<ShmChannel> channel = ShmChannel::create(shmCapacity_);
+    if (!channel) {
+        return sendBytes(clientFd, reinterpret_cast<uint8_t*>(&capacity), sizeof(capacity)) >= 0;
+    }
+
+    capacity = channel->capacity();
+    if (ServerSocket::sendWithFd(clientFd, reinterpret_cast<uint8_t*>(&capacity), sizeof(capacity),
+                                 channel->memfd()) < 0) {
+        std::cerr << "[Protocol] Failed to pass shared-memory rings\n";
+        return false;
+    }
+
+    // Everything after the reply goes through the rings
+    channel->setPeerSocket(clientFd);
+    channel_ = std::move(channel);
+    std::cout << "[Protocol] Session switched to shared-memory rings (" << capacity << " bytes each way)\n";
+    return true;
+}
+
+bool ServerProtocol::handleSessionStatsCommand(int clientFd) {
+    std::cout << "[Protocol] Processing SESSION_STATS command\n";
+
+    SessionStatsHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.recordSize = sizeof(SessionStatsRecord);
+
+    // Client addresses are not for anyone who can reach the socket: only
+    // a process of the server's own user gets records (an empty reply else)
+    struct ucred peer;
+    socklen_t peerLen = sizeof(peer);
+    bool allowed = sessionStats_ && !channel_ && ServerSocket::isUnixSocket(clientFd) &&
+                   getsockopt(clientFd, SOL_SOCKET, SO_PEERCRED, &peer, &peerLen) == 0 &&
+                   peer.uid == geteuid();
+    if (!allowed) {
+        std::cerr << "[Protocol] Session statistics not available for this client\n";
+        return sendBytes(clientFd, reinterpret_cast<uint8_t*>(&header), sizeof(header)) >= 0;
+    }
+
+    std::vector<SessionStatsRecord> records = (*sessionStats_)();
+    if (metrics_) {
+        header.bytesSent = metrics_->totalBytesSent;
+        header.bytesReceived = metrics_->totalBytesReceived;
+    }
+    header.sessions = static_cast<uint32_t>(records.size());
+
+    struct iovec iov[2];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = records.data();
+    iov[1].iov_len = records.size() * sizeof(SessionStatsRecord);
+    return sendVectored(clientFd, iov, records.empty() ? 1 : 2) >= 0;
+}
+
 bool ServerProtocol::handlePutCommand(int clientFd) {
     std::cout << "[Protocol] Processing PUT command\n";
 
     // Receive filename
     char filenameBuf[256] = {0};
-    if (ServerSocket::receiveData(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) <= 0) {
+    if (receiveBytes(clientFd, reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) <= 0) {
         std::cerr << "[Protocol] Failed to receive filename\n";
         return false;
     }
 
     // Receive file size
     uint64_t fileSize = 0;
-    if (ServerSocket::receiveData(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) <= 0) {
+    if (receiveBytes(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) <= 0) {
         std::cerr << "[Protocol] Failed to receive file size\n";
         return false;
     }
@@ -179,6 +401,7 @@ bool ServerProtocol::handlePutCommand(int clientFd) {
     }
     
     std::cout << "[Protocol] Receiving file: '" << filename << "' (" << fileSize << " bytes)\n";
+    currentFilename_ = filename;
 
     return receiveFile(clientFd, filename, fileSize);
 }
@@ -205,6 +428,11 @@ std::vector<std::string> ServerProtocol::listFiles() {
             continue;
         }
 
+        // Skip uploads still in progress
+        if (strncmp(entry->d_name, UPLOAD_TEMP_PREFIX, strlen(UPLOAD_TEMP_PREFIX)) == 0) {
+            continue;
+        }
+
         // Check if it's a regular file
         std::string filepath = currentDir + "/" + entry->d_name;
         struct stat fileStat;
@@ -228,53 +456,75 @@ std::vector<std::string> ServerProtocol::listFiles() {
 }
 
 bool ServerProtocol::sendFile(int clientFd, const std::string& filename) {
-    std::string filepath = *sharedDirectory_ + "/" + filename;
-
-    // Check if file exists
+    // Resolve relative to the shared directory; the fd cache skips open() for hot files
+    std::string directory = *sharedDirectory_;
     struct stat fileStat;
     uint64_t fileSize = 0;
-    
-    if (stat(filepath.c_str(), &fileStat) != 0) {
-        std::cerr << "[Protocol] File not found: " << filepath << "\n";
+    OpenFilePtr file = fds_ ? fds_->acquire(directory, filename, fileStat)
+                            : FileDescriptorCache::openUncached(directory, filename, fileStat);
+
+    if (!file) {
+        std::cerr << "[Protocol] File not found: " << filename << "\n";
         // Send zero file size to indicate file not found
-        ServerSocket::sendData(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize));
+        sendBytes(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize));
         return true; // Continue session, client will handle gracefully
     }
 
     fileSize = fileStat.st_size;
 
-    // Send file size
-    if (ServerSocket::sendData(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) < 0) {
-        std::cerr << "[Protocol] Failed to send file size\n";
-        return false;
+    // Small and cacheable files go out from memory, the size header in the first write.
+    // A file the cache can't hold (or a disabled cache) would only cost a read and a
+    // copy of the whole file per GET, so above the threshold that leaves sendfile().
+    uint64_t memoryLimit = SMALL_FILE_THRESHOLD;
+    if (cache_ && cache_->capacityBytes() > 0 && fileSize <= cache_->capacityBytes()) {
+        memoryLimit = std::max<uint64_t>(memoryLimit, cache_->maxFileSize());
+    }
+    if (fileSize > 0 && fileSize <= memoryLimit) {
+        return sendCachedFile(clientFd, filename, directory + "/" + filename, *file, fileStat);
     }
 
-    // Open file
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file) {
-        std::cerr << "[Protocol] Failed to open file: " << filepath << "\n";
+    // Send file size; MSG_MORE lets it share a segment with the first data.
+    // Corked, sendfile() never sends a short segment before the last one.
+    cork(clientFd, true);
+    if (sendBytes(clientFd, reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize), true) < 0) {
+        std::cerr << "[Protocol] Failed to send file size\n";
         return false;
     }
 
-    // Send file data
-    const size_t BUFFER_SIZE = 64*1024;
-    char buffer[BUFFER_SIZE];
+    // Send file data straight from the page cache
+    const size_t CHUNK_SIZE = 512 * 1024;
+    off_t offset = 0;
     uint64_t totalSent = 0;
     
     auto startTime = std::chrono::high_resolution_clock::now();
     auto lastUpdateTime = startTime;
 
-    while (file && totalSent < fileSize) {
-        file.read(buffer, BUFFER_SIZE);
-        std::streamsize bytesRead = file.gcount();
+    while (totalSent < fileSize) {
+        size_t toSend = std::min<uint64_t>(CHUNK_SIZE, fileSize - totalSent);
+        if (shaper_ && shaper_->active()) {
+            toSend = std::min<uint64_t>(shaper_->chunkSize(CHUNK_SIZE), fileSize - totalSent);
+            // Time spent throttled is not a stall
+            if (shaper_->pace(toSend) > 0 && watch_) {
+                watch_->progress(totalSent);
+            }
+        }
+        ssize_t sent = channel_ ? channel_->sendFromFile(file->fd(), &offset, toSend)
+                                : ftSendfile(clientFd, file->fd(), &offset, toSend);
 
-        if (ServerSocket::sendData(clientFd, reinterpret_cast<uint8_t*>(buffer), bytesRead) < 0) {
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            // sent == 0: file was truncated underneath us
             std::cerr << "[Protocol] Failed to send file data\n";
-            file.close();
             return false;
         }
 
-        totalSent += bytesRead;
+        totalSent += sent;
+        if (watch_) {
+            watch_->progress(totalSent);
+        }
+        tcp_.poll();
         
         // Update metrics in real-time every 100ms
         auto currentTime = std::chrono::high_resolution_clock::now();
@@ -286,12 +536,12 @@ bool ServerProtocol::sendFile(int clientFd, const std::string& filename) {
             if (metrics_ && totalElapsed.count() > 0) {
                 metrics_->updateThroughput(totalSent, totalElapsed.count());
             }
+            publishProgress(CMD_GET, totalSent, fileSize);
             
             lastUpdateTime = currentTime;
         }
     }
-
-    file.close();
+    cork(clientFd, false);
     
     auto endTime = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
@@ -303,47 +553,154 @@ bool ServerProtocol::sendFile(int clientFd, const std::string& filename) {
         
         // Calculate and update throughput
         if (duration.count() > 0) {
-            double throughput_kbps = (totalSent * 8.0) / duration.count();
             metrics_->updateThroughput(totalSent, duration.count());
         }
     }
     
+    currentBytes_ = totalSent;
     std::cout << "[Protocol] File sent successfully: " << filename << " (" << totalSent << " bytes)\n";
     return true;
 }
 
+bool ServerProtocol::sendCachedFile(int clientFd, const std::string& filename, const std::string& path,
+                                    const OpenFile& file, const struct stat& fileStat) {
+    uint64_t fileSize = fileStat.st_size;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    FileCache::Buffer data;
+    if (cache_) {
+        data = cache_->lookup(path, fileStat);
+    }
+
+    if (!data) {
+        auto contents = std::make_shared<std::string>(fileSize, '\0');
+        size_t totalRead = 0;
+        while (totalRead < fileSize) {
+            ssize_t n = ftPread(file.fd(), &(*contents)[totalRead], fileSize - totalRead, totalRead);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            totalRead += n;
+        }
+
+        if (totalRead != fileSize) {
+            std::cerr << "[Protocol] Short read on file: " << filename << "\n";
+            return false;
+        }
+
+        data = contents;
+        if (cache_) {
+            cache_->insert(path, fileStat, data);
+        }
+    }
+
+    // Header and payload go in BUFFER_SIZE steps (the first carries both), or
+    // smaller paced chunks under bandwidth limits; every step counts as
+    // progress, so a slow reader of a large cached file is not taken for stalled
+    const size_t BUFFER_SIZE = 64 * 1024;
+    bool shaped = shaper_ && shaper_->active();
+    size_t step = shaped ? shaper_->chunkSize(BUFFER_SIZE) : BUFFER_SIZE;
+    size_t offset = 0;
+    do {
+        size_t len = std::min(step, data->size() - offset);
+        if (shaped) {
+            shaper_->pace(len);
+        }
+
+        struct iovec iov[2];
+        int iovcnt = 0;
+        if (offset == 0) {
+            iov[iovcnt].iov_base = &fileSize;
+            iov[iovcnt++].iov_len = sizeof(fileSize);
+        }
+        iov[iovcnt].iov_base = const_cast<char*>(data->data()) + offset;
+        iov[iovcnt++].iov_len = len;
+
+        if (sendVectored(clientFd, iov, iovcnt) < 0) {
+            std::cerr << "[Protocol] Failed to send file data\n";
+            return false;
+        }
+        offset += len;
+        if (watch_) {
+            watch_->progress(offset);
+        }
+        tcp_.poll();
+    } while (offset < data->size());
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+
+    // Update metrics
+    if (metrics_) {
+        metrics_->addBytesSent(fileSize);
+        metrics_->filesDownloaded++;
+        if (duration.count() > 0) {
+            metrics_->updateThroughput(fileSize, duration.count());
+        }
+    }
+    publishProgress(CMD_GET, fileSize, fileSize);
+
+    currentBytes_ = fileSize;
+    std::cout << "[Protocol] File sent successfully: " << filename << " (" << fileSize << " bytes)\n";
+    return true;
+}
+
 bool ServerProtocol::receiveFile(int clientFd, const std::string& filename, uint64_t fileSize) {
     std::string filepath = *sharedDirectory_ + "/" + filename;
 
-    // Create output file
-    std::ofstream file(filepath, std::ios::binary);
-    if (!file) {
-        std::cerr << "[Protocol] Failed to create file: " << filepath << "\n";
+    // Write to a temporary file and rename it over the target when complete,
+    // so readers (and cached descriptors) never see a half-written file.
+    // It sits in the target's own directory under a short fixed-length
+    // name, so every name that can be stored can be staged too.
+    std::string tempPath = filepath.substr(0, filepath.find_last_of('/') + 1) + UPLOAD_TEMP_PREFIX + "XXXXXX";
+    int fileFd = mkostemp(&tempPath[0], O_CLOEXEC);
+    if (fileFd < 0) {
+        std::cerr << "[Protocol] Failed to create file: " << tempPath << " (" << strerror(errno) << ")\n";
         return false;
     }
+    fchmod(fileFd, 0644); // mkostemp() creates it 0600
 
     // Receive file data
     const size_t BUFFER_SIZE = 64*1024;
-    uint8_t buffer[BUFFER_SIZE];
+    if (receiveBuffer_.size() < BUFFER_SIZE) {
+        receiveBuffer_.resize(BUFFER_SIZE);
+    }
+    uint8_t* buffer = receiveBuffer_.data();
     uint64_t totalReceived = 0;
+    // A file that fits is assembled in the buffer, even when shaping splits
+    // it into several receives, so it can go to the cache afterwards
+    bool fitsBuffer = fileSize <= BUFFER_SIZE;
     
     auto startTime = std::chrono::high_resolution_clock::now();
     auto lastUpdateTime = startTime;
 
     while (totalReceived < fileSize) {
         size_t toReceive = std::min(BUFFER_SIZE, static_cast<size_t>(fileSize - totalReceived));
-        ssize_t received = ServerSocket::receiveData(clientFd, buffer, toReceive);
+        if (shaper_ && shaper_->active()) {
+            // Reading slower lets TCP flow control slow the uploader down
+            toReceive = std::min(shaper_->chunkSize(BUFFER_SIZE), static_cast<size_t>(fileSize - totalReceived));
+            if (shaper_->pace(toReceive) > 0 && watch_) {
+                watch_->progress(totalReceived);
+            }
+        }
+        uint8_t* chunk = fitsBuffer ? buffer + totalReceived : buffer;
+        ssize_t received = receiveBytes(clientFd, chunk, toReceive);
         
-        if (received <= 0) {
-            std::cerr << "[Protocol] Failed to receive file data\n";
-            file.close();
-            // Delete partial file on error
-            unlink(filepath.c_str());
+        if (received <= 0 || !writeAll(fileFd, chunk, received)) {
+            std::cerr << "[Protocol] Failed to " << (received <= 0 ? "receive" : "write") << " file data\n";
+            close(fileFd);
+            // Delete partial file on error; the previous version stays intact
+            unlink(tempPath.c_str());
             return false;
         }
-
-        file.write(reinterpret_cast<char*>(buffer), received);
         totalReceived += received;
+        if (watch_) {
+            watch_->progress(totalReceived);
+        }
+        tcp_.poll();
         
         // Update metrics in real-time every 100ms
         auto currentTime = std::chrono::high_resolution_clock::now();
@@ -355,12 +712,34 @@ bool ServerProtocol::receiveFile(int clientFd, const std::string& filename, uint
             if (metrics_ && totalElapsed.count() > 0) {
                 metrics_->updateThroughput(totalReceived, totalElapsed.count());
             }
+            publishProgress(CMD_PUT, totalReceived, fileSize);
             
             lastUpdateTime = currentTime;
         }
     }
 
-    file.close();
+    if (close(fileFd) != 0 || rename(tempPath.c_str(), filepath.c_str()) != 0) {
+        std::cerr << "[Protocol] Failed to store file: " << filepath << " (" << strerror(errno) << ")\n";
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    // The replaced file has a new inode; drop anything cached for the old one
+    if (fds_) {
+        fds_->invalidate(filename);
+    }
+    if (cache_) {
+        cache_->invalidate(filepath);
+    }
+
+    // An upload that fit in the buffer is still entirely in memory; make it hot for GET
+    if (cache_ && fileSize > 0 && fileSize <= cache_->maxFileSize() && fitsBuffer) {
+        struct stat fileStat;
+        if (stat(filepath.c_str(), &fileStat) == 0 && static_cast<uint64_t>(fileStat.st_size) == fileSize) {
+            cache_->insert(filepath, fileStat,
+                           std::make_shared<const std::string>(reinterpret_cast<char*>(buffer), fileSize));
+        }
+    }
     
     auto endTime = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
@@ -372,11 +751,94 @@ bool ServerProtocol::receiveFile(int clientFd, const std::string& filename, uint
         
         // Calculate and update throughput
         if (duration.count() > 0) {
-            double throughput_kbps = (totalReceived * 8.0) / duration.count();
             metrics_->updateThroughput(totalReceived, duration.count());
         }
     }
     
+    currentBytes_ = totalReceived;
     std::cout << "[Protocol] File received successfully: " << filename << " (" << totalReceived << " bytes)\n";
     return true;
-}
\ No newline at end of file
+}
+
+void ServerProtocol::publishProgress(uint8_t command, uint64_t done, uint64_t total) {
+    if (!events_) {
+        return;
+    }
+
+    ServerEvent event;
+    event.type = ServerEventType::TransferProgress;
+    event.setClientAddress(clientAddr_);
+    event.command = command;
+    event.setFilename(currentFilename_);
+    event.bytesTransferred = done;
+    event.bytesTotal = total;
+    events_->push(event);
+}
+
+void ServerProtocol::publishCompleted(uint8_t command, bool success, double latency_ms,
+                                      const TcpTransferStats& tcp) {
+    if (!events_) {
+        return;
+    }
+
+    ServerEvent event;
+    event.type = ServerEventType::CommandCompleted;
+    event.setClientAddress(clientAddr_);
+    event.command = command;
+    event.setFilename(currentFilename_);
+    event.bytesTransferred = currentBytes_;
+    event.bytesTotal = currentBytes_;
+    event.latency_ms = latency_ms;
+    event.success = success;
+    event.tcp = tcp;
+    events_->push(event);
+}
+
+void ServerProtocol::cork(int clientFd, bool on) {
+    if (cork_ && !channel_) {
+        SocketTuning::setCork(clientFd, on);
+    }
+}
+
+bool ServerProtocol::writeAll(int fileFd, const uint8_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ftWrite(fileFd, data + written, size - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+ssize_t ServerProtocol::sendBytes(int clientFd, const uint8_t* data, size_t size, bool more) {
+    if (channel_) {
+        return channel_->send(data, size);
+    }
+    return ServerSocket::sendData(clientFd, data, size, more);
+}
+
+ssize_t ServerProtocol::sendVectored(int clientFd, struct iovec* iov, int iovcnt) {
+    if (channel_) {
+        return channel_->sendVectored(iov, iovcnt);
+    }
+    return ServerSocket::sendVectored(clientFd, iov, iovcnt);
+}
+
+ssize_t ServerProtocol::receiveBytes(int clientFd, uint8_t* buffer, size_t size) {
+    if (!channel_) {
+        return ServerSocket::receiveData(clientFd, buffer, size);
+    }
+
+    // Same contract as ServerSocket::receiveData: 0 = clean close, -1 = cut short
+    ssize_t received = channel_->receive(buffer, size);
+    if (received == 0 && size > 0) {
+        std::cout << "[Protocol] Shared-memory peer closed\n";
+        return 0;
+    }
+    return received == static_cast<ssize_t>(size) ? received : -1;
+}
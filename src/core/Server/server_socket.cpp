@@ -1,8 +1,14 @@
 #include "server_socket.h"
+#include "core/fault_injection.h"
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <cstring>
 #include <iostream>
 #include <errno.h>
@@ -10,16 +16,21 @@
 ServerSocket::ServerSocket() 
     : socketFd_(-1),
       port_(0),
-      listening_(false) {
+      listening_(false),
+      wakeFd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      interrupted_(false) {
 }
 
 ServerSocket::~ServerSocket() {
     close();
+    if (wakeFd_ >= 0) {
+        ::close(wakeFd_);
+    }
 }
 
 bool ServerSocket::bind(uint16_t port, int backlog) {
     // Create socket
-    socketFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    socketFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     if (socketFd_ < 0) {
         std::cerr << "[ServerSocket] Failed to create socket: " << strerror(errno) << "\n";
         return false;
@@ -65,44 +76,197 @@ bool ServerSocket::bind(uint16_t port, int backlog) {
         return false;
     }
 
-    port_ = port;
+    // Port 0 asks the kernel for an ephemeral port; report the real one
+    struct sockaddr_in boundAddr;
+    socklen_t boundLen = sizeof(boundAddr);
+    if (getsockname(socketFd_, (struct sockaddr*)&boundAddr, &boundLen) == 0) {
+        port_ = ntohs(boundAddr.sin_port);
+    } else {
+        port_ = port;
+    }
     listening_ = true;
 
     std::cout << "[ServerSocket] Server listening on port " << port_ << "\n";
     return true;
 }
 
+bool ServerSocket::bindUnix(const std::string& path, int backlog) {
+    struct sockaddr_un serverAddr;
+    std::memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(serverAddr.sun_path)) {
+        std::cerr << "[ServerSocket] Invalid Unix socket path: " << path << "\n";
+        return false;
+    }
+    std::memcpy(serverAddr.sun_path, path.c_str(), path.size());
+
+    socketFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socketFd_ < 0) {
+        std::cerr << "[ServerSocket] Failed to create socket: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    // A socket file left behind by a crashed server refuses connections;
+    // only that case may be replaced
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        bool stale = false;
+        if (S_ISSOCK(existing.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            stale = probe >= 0 && connect(probe, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0 &&
+                    errno == ECONNREFUSED;
+            if (probe >= 0) {
+                ::close(probe);
+            }
+        }
+        if (!stale || unlink(path.c_str()) < 0) {
+            std::cerr << "[ServerSocket] Unix socket path is in use: " << path << "\n";
+            ::close(socketFd_);
+            socketFd_ = -1;
+            return false;
+        }
+    }
+
+    if (::bind(socketFd_, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        std::cerr << "[ServerSocket] Failed to bind to " << path << ": " << strerror(errno) << "\n";
+        ::close(socketFd_);
+        socketFd_ = -1;
+        return false;
+    }
+
+    if (listen(socketFd_, backlog) < 0) {
+        std::cerr << "[ServerSocket] Failed to listen: " << strerror(errno) << "\n";
+        ::close(socketFd_);
+        socketFd_ = -1;
+        unlink(path.c_str());
+        return false;
+    }
+
+    unixPath_ = path;
+    port_ = 0;
+    listening_ = true;
+
+    std::cout << "[ServerSocket] Server listening on unix:" << unixPath_ << "\n";
+    return true;
+}
+
+bool ServerSocket::adopt(int fd) {
+    int accepting = 0;
+    socklen_t len = sizeof(accepting);
+    struct sockaddr_storage boundAddr;
+    socklen_t boundLen = sizeof(boundAddr);
+    if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) < 0 || !accepting ||
+        getsockname(fd, (struct sockaddr*)&boundAddr, &boundLen) < 0 ||
+        (boundAddr.ss_family != AF_INET && boundAddr.ss_family != AF_UNIX)) {
+        std::cerr << "[ServerSocket] Inherited descriptor is not a listening socket\n";
+        ::close(fd);
+        return false;
+    }
+
+    // The open file is shared with the previous owner, flags included
+    int flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    socketFd_ = fd;
+    if (boundAddr.ss_family == AF_UNIX) {
+        const struct sockaddr_un* unixAddr = reinterpret_cast<const struct sockaddr_un*>(&boundAddr);
+        unixPath_ = std::string(unixAddr->sun_path, strnlen(unixAddr->sun_path, sizeof(unixAddr->sun_path)));
+        port_ = 0;
+        std::cout << "[ServerSocket] Inherited listener on unix:" << unixPath_ << "\n";
+    } else {
+        port_ = ntohs(reinterpret_cast<const struct sockaddr_in*>(&boundAddr)->sin_port);
+        std::cout << "[ServerSocket] Inherited listener on port " << port_ << "\n";
+    }
+    listening_ = true;
+    return true;
+}
+
 int ServerSocket::acceptConnection(std::string& clientAddr) {
     if (!listening_) {
         return -1;
     }
 
-    struct sockaddr_in clientAddrStruct;
+    struct sockaddr_storage clientAddrStruct;
     socklen_t clientAddrLen = sizeof(clientAddrStruct);
 
-    int clientFd = accept(socketFd_, (struct sockaddr*)&clientAddrStruct, &clientAddrLen);
-    
+    // Accept straight away while connections are queued; wait only when
+    // there are none (the accepted socket itself is blocking)
+    int clientFd;
+    while (true) {
+        if (interrupted_.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        clientAddrLen = sizeof(clientAddrStruct);
+        clientFd = accept4(socketFd_, (struct sockaddr*)&clientAddrStruct, &clientAddrLen, 0);
+        if (clientFd >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            break;
+        }
+        struct pollfd fds[2] = {{socketFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+        poll(fds, wakeFd_ >= 0 ? 2 : 1, -1);
+    }
+
     if (clientFd < 0) {
-        if (errno != EINTR) { // Ignore interrupt errors
+        if (errno != EINTR && !interrupted_) { // Ignore interrupt errors
             std::cerr << "[ServerSocket] Accept failed: " << strerror(errno) << "\n";
         }
         return -1;
     }
 
+    if (clientAddrStruct.ss_family == AF_UNIX) {
+        // Local peers have no address; "unix:<uid>:<pid>" groups them per
+        // user the way "ip:port" groups remote ones per host
+        struct ucred cred;
+        socklen_t credLen = sizeof(cred);
+        if (getsockopt(clientFd, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) == 0) {
+            clientAddr = "unix:" + std::to_string(cred.uid) + ":" + std::to_string(cred.pid);
+        } else {
+            clientAddr = "unix:?:" + std::to_string(clientFd);
+        }
+        return clientFd;
+    }
+
     // Get client IP address
+    const struct sockaddr_in* inetAddr = reinterpret_cast<const struct sockaddr_in*>(&clientAddrStruct);
     char ipStr[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &clientAddrStruct.sin_addr, ipStr, sizeof(ipStr));
-    clientAddr = std::string(ipStr) + ":" + std::to_string(ntohs(clientAddrStruct.sin_port));
+    inet_ntop(AF_INET, &inetAddr->sin_addr, ipStr, sizeof(ipStr));
+    clientAddr = std::string(ipStr) + ":" + std::to_string(ntohs(inetAddr->sin_port));
 
     return clientFd;
 }
 
+void ServerSocket::interrupt() {
+    interrupted_.store(true, std::memory_order_release);
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof(one));
+        (void)written;
+    }
+}
+
 void ServerSocket::close() {
     if (socketFd_ >= 0) {
+        // Wake a thread waiting in acceptConnection(); shutdown() also stops
+        // the kernel queueing connections nobody will accept
+        interrupt();
+        ::shutdown(socketFd_, SHUT_RDWR);
         ::close(socketFd_);
         socketFd_ = -1;
         listening_ = false;
     }
+    if (!unixPath_.empty()) {
+        unlink(unixPath_.c_str());
+        unixPath_.clear();
+    }
+}
+
+void ServerSocket::relinquish() {
+    if (socketFd_ >= 0) {
+        ::close(socketFd_);
+        socketFd_ = -1;
+        listening_ = false;
+    }
+    unixPath_.clear();
 }
 
 bool ServerSocket::isListening() const {
@@ -113,14 +277,50 @@ int ServerSocket::getSocketFd() const {
     return socketFd_;
 }
 
-ssize_t ServerSocket::sendData(int fd, const uint8_t* data, size_t size) {
+uint16_t ServerSocket::getPort() const {
+    return port_;
+}
+
+const std::string& ServerSocket::getUnixPath() const {
+    return unixPath_;
+}
+
+bool ServerSocket::setIncomingCpu(int cpu) {
+#ifdef SO_INCOMING_CPU
+    // With SO_REUSEPORT the kernel prefers the listener whose CPU matches
+    // the one that processed the incoming SYN
+    if (setsockopt(socketFd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0) {
+        return true;
+    }
+    std::cerr << "[ServerSocket] Warning: Failed to set SO_INCOMING_CPU: " << strerror(errno) << "\n";
+#else
+    (void)cpu;
+#endif
+    return false;
+}
+
+int ServerSocket::getIncomingCpu(int fd) {
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) {
+        return cpu;
+    }
+#else
+    (void)fd;
+#endif
+    return -1;
+}
+
+ssize_t ServerSocket::sendData(int fd, const uint8_t* data, size_t size, bool more) {
     if (fd < 0 || !data) {
         return -1;
     }
 
     size_t totalSent = 0;
     while (totalSent < size) {
-        ssize_t sent = send(fd, data + totalSent, size - totalSent, MSG_NOSIGNAL);
+        // MSG_MORE: more data follows immediately, don't push a partial segment
+        ssize_t sent = ftSend(fd, data + totalSent, size - totalSent, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
         if (sent < 0) {
             if (errno == EINTR) {
                 continue; // Interrupted, retry
@@ -142,6 +342,48 @@ ssize_t ServerSocket::sendData(int fd, const uint8_t* data, size_t size) {
     return totalSent;
 }
 
+ssize_t ServerSocket::sendVectored(int fd, struct iovec* iov, int iovcnt) {
+    if (fd < 0 || !iov || iovcnt <= 0) {
+        return -1;
+    }
+
+    size_t totalSent = 0;
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t sent = ftSendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue; // Interrupted, retry
+            }
+            if (errno == EPIPE || errno == ECONNRESET) {
+                std::cout << "[ServerSocket] Client disconnected during send\n";
+                return -1;
+            }
+            std::cerr << "[ServerSocket] Send failed: " << strerror(errno) << "\n";
+            return -1;
+        }
+        totalSent += sent;
+
+        // Skip fully written buffers, then advance into the partial one
+        size_t remaining = static_cast<size_t>(sent);
+        while (msg.msg_iovlen > 0 && remaining >= msg.msg_iov->iov_len) {
+            remaining -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = static_cast<uint8_t*>(msg.msg_iov->iov_base) + remaining;
+            msg.msg_iov->iov_len -= remaining;
+        }
+    }
+
+    return totalSent;
+}
+
 ssize_t ServerSocket::receiveData(int fd, uint8_t* buffer, size_t size) {
     if (fd < 0 || !buffer) {
         return -1;
@@ -149,7 +391,7 @@ ssize_t ServerSocket::receiveData(int fd, uint8_t* buffer, size_t size) {
 
     size_t totalReceived = 0;
     while (totalReceived < size) {
-        ssize_t received = recv(fd, buffer + totalReceived, size - totalReceived, 0);
+        ssize_t received = ftRecv(fd, buffer + totalReceived, size - totalReceived, 0);
         if (received < 0) {
             if (errno == EINTR) {
                 continue; // Interrupted, retry
@@ -172,4 +414,119 @@ ssize_t ServerSocket::receiveData(int fd, uint8_t* buffer, size_t size) {
     }
 
     return totalReceived;
-}
\ No newline at end of file
+}
+
+ssize_t ServerSocket::sendWithFd(int fd, const uint8_t* data, size_t size, int passFd) {
+    return sendWithFds(fd, data, size, std::vector<int>(1, passFd));
+}
+
+ssize_t ServerSocket::sendWithFds(int fd, const uint8_t* data, size_t size, const std::vector<int>& passFds) {
+    if (fd < 0 || !data || size == 0 || passFds.empty() || passFds.size() > MAX_PASSED_FDS) {
+        return -1;
+    }
+    for (int passFd : passFds) {
+        if (passFd < 0) {
+            return -1;
+        }
+    }
+
+    struct iovec iov;
+    iov.iov_base = const_cast<uint8_t*>(data);
+    iov.iov_len = size;
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+        struct cmsghdr align;
+    } control;
+    std::memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * passFds.size());
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * passFds.size());
+    std::memcpy(CMSG_DATA(cmsg), passFds.data(), sizeof(int) * passFds.size());
+
+    ssize_t sent;
+    do {
+        sent = ftSendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent <= 0) {
+        std::cerr << "[ServerSocket] Failed to pass descriptor: " << strerror(errno) << "\n";
+        return -1;
+    }
+
+    // The descriptor travelled with the first byte; the rest is plain data
+    if (static_cast<size_t>(sent) < size) {
+        if (sendData(fd, data + sent, size - sent) < 0) {
+            return -1;
+        }
+    }
+    return size;
+}
+
+ssize_t ServerSocket::receiveWithFds(int fd, uint8_t* buffer, size_t size, std::vector<int>& passedFds) {
+    passedFds.clear();
+    if (fd < 0 || !buffer || size == 0) {
+        return -1;
+    }
+
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = size;
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+        struct cmsghdr align;
+    } control;
+    std::memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t received;
+    do {
+        received = ftRecvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i) {
+                int passed;
+                std::memcpy(&passed, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                passedFds.push_back(passed);
+            }
+        }
+    }
+
+    // The descriptors came with the first byte; the rest is plain data
+    if (received > 0 && static_cast<size_t>(received) < size && !(msg.msg_flags & MSG_CTRUNC)) {
+        ssize_t rest = receiveData(fd, buffer + received, size - received);
+        received = (rest == static_cast<ssize_t>(size - received)) ? static_cast<ssize_t>(size) : -1;
+    }
+    if (received != static_cast<ssize_t>(size) || (msg.msg_flags & MSG_CTRUNC)) {
+        for (int passed : passedFds) {
+            ::close(passed);
+        }
+        passedFds.clear();
+        return -1;
+    }
+    return received;
+}
+
+bool ServerSocket::isUnixSocket(int fd) {
+    int domain = -1;
+    socklen_t len = sizeof(domain);
+    return getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len) == 0 && domain == AF_UNIX;
+}
@@ -0,0 +1,294 @@
+#include "session_reaper.h"
+#include <algorithm>
+#include <chrono>
+#include <sys/socket.h>
+#include <pthread.h>
+
+namespace {
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Re-check interval when no limit applies (limits may be set later)
+const int64_t UNLIMITED_RECHECK_MS = 5000;
+
+// Grace period for the throughput floor when there is no progress timeout
+const int64_t DEFAULT_FLOOR_GRACE_MS = 5000;
+
+} // namespace
+
+SessionWatch::SessionWatch(int fd)
+    : fd_(fd),
+      released_(false),
+      busy_(false),
+      lastActivityMs_(nowMs()),
+      commandStartMs_(0),
+      bytes_(0),
+      reapReason_(nullptr) {
+}
+
+void SessionWatch::beginCommand() {
+    int64_t now = nowMs();
+    commandStartMs_.store(now, std::memory_order_relaxed);
+    lastActivityMs_.store(now, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+    busy_.store(true, std::memory_order_release);
+}
+
+void SessionWatch::progress(uint64_t bytes) {
+    bytes_.store(bytes, std::memory_order_relaxed);
+    lastActivityMs_.store(nowMs(), std::memory_order_relaxed);
+}
+
+void SessionWatch::endCommand() {
+    lastActivityMs_.store(nowMs(), std::memory_order_relaxed);
+    // seq_cst: a draining server reads this after clearing the session's
+    // active flag, and the session reads that flag after this store
+    busy_.store(false, std::memory_order_seq_cst);
+}
+
+bool SessionWatch::isBusy() const {
+    return busy_.load(std::memory_order_seq_cst);
+}
+
+void SessionWatch::release() {
+    std::lock_guard<std::mutex> lock(fdMutex_);
+    released_ = true;
+}
+
+const char* SessionWatch::reapReason() const {
+    return reapReason_.load();
+}
+
+SessionReaper::SessionReaper()
+    : idleSeconds_(0),
+      progressSeconds_(0),
+      minBytesPerSecond_(0),
+      metrics_(nullptr),
+      wheel_(SLOTS),
+      currentTick_(0),
+      epochMs_(nowMs()),
+      watched_(0),
+      running_(false) {
+}
+
+SessionReaper::~SessionReaper() {
+    stop();
+}
+
+void SessionReaper::configure(int idleSeconds, int progressSeconds, uint64_t minBytesPerSecond) {
+    idleSeconds_ = std::max(idleSeconds, 0);
+    progressSeconds_ = std::max(progressSeconds, 0);
+    minBytesPerSecond_ = minBytesPerSecond;
+}
+
+void SessionReaper::setMetrics(ServerMetrics* metrics) {
+    metrics_ = metrics;
+}
+
+void SessionReaper::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    epochMs_ = nowMs();
+    currentTick_ = 0;
+    thread_ = std::make_unique<std::thread>(&SessionReaper::run, this);
+}
+
+void SessionReaper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_ && thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : wheel_) {
+        slot.clear();
+    }
+    watched_ = 0;
+}
+
+std::shared_ptr<SessionWatch> SessionReaper::watch(int fd) {
+    auto record = std::make_shared<SessionWatch>(fd);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        const char* reason = nullptr;
+        scheduleLocked(record, nextCheck(*record, nowMs(), reason));
+        watched_++;
+    }
+    return record;
+}
+
+size_t SessionReaper::watchedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watched_;
+}
+
+void SessionReaper::run() {
+    pthread_setname_np(pthread_self(), "ft-reaper");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        uint64_t nextTick = currentTick_ + 1;
+        auto wakeAt = std::chrono::steady_clock::time_point(
+            std::chrono::milliseconds(epochMs_ + static_cast<int64_t>(nextTick) * TICK_MS));
+        if (cv_.wait_until(lock, wakeAt, [this] { return !running_; })) {
+            break;
+        }
+
+        // Catch up on every tick that has elapsed (e.g. after a stall)
+        uint64_t dueTick = static_cast<uint64_t>((nowMs() - epochMs_) / TICK_MS);
+        while (running_ && currentTick_ < dueTick) {
+            uint64_t tick = currentTick_ + 1;
+            lock.unlock();
+            processTick(tick);
+            lock.lock();
+        }
+    }
+}
+
+void SessionReaper::processTick(uint64_t tick) {
+    std::vector<Timer> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        currentTick_ = tick;
+
+        // Entries for later revolutions stay in the slot
+        auto& slot = wheel_[tick % SLOTS];
+        auto split = std::partition(slot.begin(), slot.end(),
+                                    [tick](const Timer& timer) { return timer.tick > tick; });
+        due.assign(std::make_move_iterator(split), std::make_move_iterator(slot.end()));
+        slot.erase(split, slot.end());
+    }
+    if (due.empty()) {
+        return;
+    }
+
+    int64_t now = nowMs();
+    std::vector<std::pair<std::shared_ptr<SessionWatch>, int64_t>> rearm;
+    rearm.reserve(due.size());
+    size_t dropped = 0;
+
+    for (auto& timer : due) {
+        SessionWatch& watch = *timer.watch;
+        bool released;
+        {
+            std::lock_guard<std::mutex> lock(watch.fdMutex_);
+            released = watch.released_;
+        }
+        if (released) {
+            dropped++;
+            continue;
+        }
+
+        const char* reason = nullptr;
+        int64_t next = nextCheck(watch, now, reason);
+        if (reason) {
+            reap(watch, reason);
+            dropped++;
+            continue;
+        }
+        rearm.emplace_back(std::move(timer.watch), next);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+        return;
+    }
+    for (auto& entry : rearm) {
+        scheduleLocked(std::move(entry.first), entry.second);
+    }
+    watched_ -= std::min(dropped, watched_);
+}
+
+int64_t SessionReaper::nextCheck(SessionWatch& watch, int64_t nowMs, const char*& reason) const {
+    int64_t idleMs = static_cast<int64_t>(idleSeconds_.load()) * 1000;
+    int64_t progressMs = static_cast<int64_t>(progressSeconds_.load()) * 1000;
+    uint64_t floor = minBytesPerSecond_.load();
+    int64_t last = watch.lastActivityMs_.load(std::memory_order_relaxed);
+    reason = nullptr;
+
+    // An idle session may start a command at any time; look often enough
+    // that a stall inside that command isn't only noticed at the idle deadline
+    int64_t busyPoll = UNLIMITED_RECHECK_MS;
+    if (progressMs > 0) {
+        busyPoll = std::max<int64_t>(1000, progressMs / 4);
+    } else if (floor > 0) {
+        busyPoll = 1000;
+    }
+
+    if (!watch.busy_.load(std::memory_order_acquire)) {
+        int64_t next = nowMs + busyPoll;
+        if (idleMs > 0) {
+            int64_t deadline = last + idleMs;
+            if (nowMs >= deadline) {
+                reason = "idle";
+                return -1;
+            }
+            next = std::min(next, deadline);
+        }
+        return next;
+    }
+
+    int64_t next = nowMs + busyPoll;
+    if (progressMs > 0) {
+        int64_t deadline = last + progressMs;
+        if (nowMs >= deadline) {
+            reason = "stalled";
+            return -1;
+        }
+        next = std::min(next, deadline);
+    }
+
+    if (floor > 0) {
+        int64_t start = watch.commandStartMs_.load(std::memory_order_relaxed);
+        int64_t grace = progressMs > 0 ? progressMs : DEFAULT_FLOOR_GRACE_MS;
+        int64_t elapsed = nowMs - start;
+        if (elapsed >= grace) {
+            uint64_t bytes = watch.bytes_.load(std::memory_order_relaxed);
+            if (bytes * 1000 / static_cast<uint64_t>(elapsed) < floor) {
+                reason = "too slow";
+                return -1;
+            }
+            next = std::min(next, nowMs + 1000);
+        } else {
+            next = std::min(next, start + grace);
+        }
+    }
+    return next;
+}
+
+void SessionReaper::reap(SessionWatch& watch, const char* reason) {
+    std::lock_guard<std::mutex> lock(watch.fdMutex_);
+    if (watch.released_) {
+        return;
+    }
+
+    // Wakes the session thread out of recv()/send()/sendfile(); it closes the fd
+    shutdown(watch.fd_, SHUT_RDWR);
+    watch.reapReason_ = reason;
+
+    ServerMetrics* metrics = metrics_.load();
+    if (metrics) {
+        metrics->sessionsReaped++;
+    }
+}
+
+void SessionReaper::scheduleLocked(std::shared_ptr<SessionWatch> watch, int64_t atMs) {
+    int64_t offset = atMs - epochMs_;
+    uint64_t tick = offset > 0 ? static_cast<uint64_t>((offset + TICK_MS - 1) / TICK_MS) : 0;
+    tick = std::max(tick, currentTick_ + 1);
+    wheel_[tick % SLOTS].push_back(Timer{std::move(watch), tick});
+}
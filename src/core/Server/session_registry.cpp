@@ -0,0 +1,180 @@
+#include "session_registry.h"
+#include "client_session.h"
+#include <cstring>
+#include <algorithm>
+
+SessionRegistry::SessionRegistry()
+    : slotCount_(0),
+      freeHead_(NO_SLOT),
+      size_(0),
+      closed_(false) {
+    for (auto& chunk : chunks_) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SessionRegistry::~SessionRegistry() {
+    for (auto& chunk : chunks_) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+SessionRegistry::Slot& SessionRegistry::slotAt(uint32_t index) const {
+    return chunks_[index / CHUNK_SLOTS].load(std::memory_order_acquire)[index % CHUNK_SLOTS];
+}
+
+SessionRegistry::Handle SessionRegistry::add(std::shared_ptr<ClientSession> session, const std::string& clientAddr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return INVALID_HANDLE;
+    }
+
+    uint32_t index = freeHead_;
+    if (index != NO_SLOT) {
+        freeHead_ = slotAt(index).nextFree;
+    } else {
+        index = slotCount_.load(std::memory_order_relaxed);
+        if (index / CHUNK_SLOTS >= MAX_CHUNKS) {
+            return INVALID_HANDLE;
+        }
+        if (index % CHUNK_SLOTS == 0) {
+            chunks_[index / CHUNK_SLOTS].store(new Slot[CHUNK_SLOTS], std::memory_order_release);
+        }
+    }
+
+    Slot& slot = slotAt(index);
+    slot.session = std::move(session);
+    slot.nextFree = NO_SLOT;
+    publishAddress(slot, clientAddr);
+
+    // Publish the slot to readers only once it is filled in
+    if (index == slotCount_.load(std::memory_order_relaxed)) {
+        slotCount_.store(index + 1, std::memory_order_release);
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return (static_cast<Handle>(slot.generation) << 32) | index;
+}
+
+void SessionRegistry::remove(Handle handle) {
+    uint32_t index = static_cast<uint32_t>(handle);
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+
+    // The last reference may be dropped here; do that outside the lock
+    std::shared_ptr<ClientSession> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (handle == INVALID_HANDLE || index >= slotCount_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        Slot& slot = slotAt(index);
+        if (slot.generation != generation || !slot.session) {
+            return;
+        }
+
+        released = std::move(slot.session);
+        slot.generation++;
+        publishAddress(slot, std::string());
+        slot.nextFree = freeHead_;
+        freeHead_ = index;
+
+        if (size_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+            emptyCv_.notify_all();
+        }
+    }
+}
+
+size_t SessionRegistry::size() const {
+    return size_.load(std::memory_order_relaxed);
+}
+
+std::vector<std::string> SessionRegistry::clientAddresses() const {
+    std::vector<std::string> addresses;
+    uint32_t count = slotCount_.load(std::memory_order_acquire);
+    addresses.reserve(size());
+
+    for (uint32_t index = 0; index < count; ++index) {
+        const Slot& slot = slotAt(index);
+        char text[ADDRESS_WORDS * sizeof(uint64_t)];
+        uint32_t before;
+        uint32_t after;
+        do {
+            // Seqlock read: retry if a writer was (or became) active meanwhile
+            before = slot.version.load(std::memory_order_acquire);
+            for (size_t w = 0; w < ADDRESS_WORDS; ++w) {
+                uint64_t word = slot.address[w].load(std::memory_order_relaxed);
+                std::memcpy(text + w * sizeof(word), &word, sizeof(word));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = slot.version.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+
+        if (text[0] != '\0') {
+            addresses.emplace_back(text, strnlen(text, sizeof(text)));
+        }
+    }
+    return addresses;
+}
+
+std::vector<std::shared_ptr<ClientSession>> SessionRegistry::sessions() const {
+    std::vector<std::shared_ptr<ClientSession>> sessions;
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions.reserve(size_.load(std::memory_order_relaxed));
+    uint32_t count = slotCount_.load(std::memory_order_relaxed);
+    for (uint32_t index = 0; index < count; ++index) {
+        if (slotAt(index).session) {
+            sessions.push_back(slotAt(index).session);
+        }
+    }
+    return sessions;
+}
+
+std::vector<std::shared_ptr<ClientSession>> SessionRegistry::closeAndCollect() {
+    std::vector<std::shared_ptr<ClientSession>> sessions;
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    uint32_t count = slotCount_.load(std::memory_order_relaxed);
+    for (uint32_t index = 0; index < count; ++index) {
+        if (slotAt(index).session) {
+            sessions.push_back(slotAt(index).session);
+        }
+    }
+    return sessions;
+}
+
+void SessionRegistry::closeAndStopAll() {
+    // stop() wakes the session thread, which then removes itself
+    for (auto& session : closeAndCollect()) {
+        session->stop();
+    }
+}
+
+void SessionRegistry::closeAndDrainAll() {
+    for (auto& session : closeAndCollect()) {
+        session->drain();
+    }
+}
+
+void SessionRegistry::waitEmpty() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    emptyCv_.wait(lock, [this] { return size_.load(std::memory_order_relaxed) == 0; });
+}
+
+bool SessionRegistry::waitEmptyUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return emptyCv_.wait_until(lock, deadline, [this] { return size_.load(std::memory_order_relaxed) == 0; });
+}
+
+void SessionRegistry::publishAddress(Slot& slot, const std::string& clientAddr) {
+    char text[ADDRESS_WORDS * sizeof(uint64_t)] = {0};
+    std::memcpy(text, clientAddr.data(), std::min(clientAddr.size(), sizeof(text) - 1));
+
+    uint32_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t w = 0; w < ADDRESS_WORDS; ++w) {
+        uint64_t word;
+        std::memcpy(&word, text + w * sizeof(word), sizeof(word));
+        slot.address[w].store(word, std::memory_order_relaxed);
+    }
+    slot.version.store(version + 2, std::memory_order_release);
+}
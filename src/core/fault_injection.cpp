@@ -0,0 +1,237 @@
+#include "core/fault_injection.h"
+#include <iostream>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sys/uio.h>
+
+namespace {
+
+std::atomic<double> shortProbability{0.0};
+std::atomic<double> eintrProbability{0.0};
+std::atomic<double> eagainProbability{0.0};
+std::atomic<double> resetProbability{0.0};
+std::atomic<uint32_t> seed{0};
+std::atomic<bool> active{false};
+
+// Bumped by configure(); a thread reseeds when it sees a new value
+std::atomic<uint64_t> generation{1};
+std::atomic<uint32_t> threadsSeeded{0};
+
+std::atomic<uint64_t> calls{0};
+std::atomic<uint64_t> shortCounts{0};
+std::atomic<uint64_t> eintrCount{0};
+std::atomic<uint64_t> eagainCount{0};
+std::atomic<uint64_t> resetCount{0};
+
+std::once_flag environmentOnce;
+
+void store(const FaultInjector::Config& config) {
+    shortProbability = config.shortProbability;
+    eintrProbability = config.eintrProbability;
+    eagainProbability = config.eagainProbability;
+    resetProbability = config.resetProbability;
+    seed = config.seed;
+    threadsSeeded = 0;
+    generation++;
+    active = config.shortProbability > 0 || config.eintrProbability > 0 || config.eagainProbability > 0 ||
+             config.resetProbability > 0;
+}
+
+void loadEnvironment() {
+    const char* spec = std::getenv("FT_FAULTS");
+    if (!spec || !*spec) {
+        return;
+    }
+    FaultInjector::Config config;
+    if (!FaultInjector::parse(spec, config)) {
+        std::cerr << "[Faults] Ignoring invalid FT_FAULTS: " << spec << "\n";
+        return;
+    }
+    store(config);
+    std::cerr << "[Faults] Injecting faults from FT_FAULTS: " << spec << "\n";
+}
+
+std::mt19937& generator() {
+    thread_local std::mt19937 random;
+    thread_local uint64_t seededGeneration = 0;
+    uint64_t current = generation.load();
+    if (seededGeneration != current) {
+        uint32_t base = seed.load();
+        // Each thread gets its own stream; with a seed, the nth thread to
+        // draw gets the same stream every run
+        random.seed(base != 0 ? base + threadsSeeded++ : std::random_device()());
+        seededGeneration = current;
+    }
+    return random;
+}
+
+// Make the connection fail the way a reset does: an RST for a TCP peer,
+// a hangup for a Unix socket one. The descriptor itself stays valid.
+void abortConnection(int fd) {
+    struct sockaddr unspecified;
+    std::memset(&unspecified, 0, sizeof(unspecified));
+    unspecified.sa_family = AF_UNSPEC;
+    if (connect(fd, &unspecified, sizeof(unspecified)) < 0) {
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+} // namespace
+
+bool FaultInjector::compiledIn() {
+#ifdef FT_FAULT_INJECTION
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FaultInjector::configure(const Config& config) {
+    // Whatever FT_FAULTS says must not override this later
+    std::call_once(environmentOnce, [] {});
+    store(config);
+}
+
+FaultInjector::Config FaultInjector::getConfig() {
+    Config config;
+    config.shortProbability = shortProbability;
+    config.eintrProbability = eintrProbability;
+    config.eagainProbability = eagainProbability;
+    config.resetProbability = resetProbability;
+    config.seed = seed;
+    return config;
+}
+
+bool FaultInjector::parse(const std::string& spec, Config& config) {
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string key = item.substr(0, equals);
+        const char* text = item.c_str() + equals + 1;
+        char* end = nullptr;
+        if (key == "seed") {
+            config.seed = static_cast<uint32_t>(std::strtoul(text, &end, 10));
+            if (end == text || *end) {
+                return false;
+            }
+            continue;
+        }
+
+        double value = std::strtod(text, &end);
+        if (end == text || *end || value < 0.0 || value > 1.0) {
+            return false;
+        }
+        if (key == "short") {
+            config.shortProbability = value;
+        } else if (key == "eintr") {
+            config.eintrProbability = value;
+        } else if (key == "eagain") {
+            config.eagainProbability = value;
+        } else if (key == "reset") {
+            config.resetProbability = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+FaultInjector::Counts FaultInjector::getCounts() {
+    Counts counts;
+    counts.calls = calls;
+    counts.shortCounts = shortCounts;
+    counts.eintr = eintrCount;
+    counts.eagain = eagainCount;
+    counts.resets = resetCount;
+    return counts;
+}
+
+void FaultInjector::resetCounts() {
+    calls = 0;
+    shortCounts = 0;
+    eintrCount = 0;
+    eagainCount = 0;
+    resetCount = 0;
+}
+
+int FaultInjector::draw(Site site, int fd, size_t& len) {
+    std::call_once(environmentOnce, loadEnvironment);
+    if (!active.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    calls++;
+
+    std::mt19937& random = generator();
+    double roll = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+
+    // One roll, split into bands: at most one fault per call
+    double band = eintrProbability;
+    if (roll < band) {
+        eintrCount++;
+        return EINTR;
+    }
+    if (site == Site::Socket) {
+        band += eagainProbability;
+        if (roll < band) {
+            eagainCount++;
+            return EAGAIN;
+        }
+        band += resetProbability;
+        if (roll < band) {
+            resetCount++;
+            abortConnection(fd);
+            return ECONNRESET;
+        }
+    }
+    band += shortProbability;
+    if (roll < band && len > 1) {
+        len = std::uniform_int_distribution<size_t>(1, len - 1)(random);
+        shortCounts++;
+    }
+    return 0;
+}
+
+#ifdef FT_FAULT_INJECTION
+ssize_t ftMessageCall(bool sending, int fd, struct msghdr* msg, int flags) {
+    size_t total = 0;
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        total += msg->msg_iov[i].iov_len;
+    }
+    size_t len = total;
+    int error = FaultInjector::draw(FaultInjector::Site::Socket, fd, len);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    if (len == total) {
+        return sending ? ::sendmsg(fd, msg, flags) : ::recvmsg(fd, msg, flags);
+    }
+
+    size_t first = 0;
+    while (msg->msg_iov[first].iov_len == 0) {
+        first++;
+    }
+    struct iovec part = msg->msg_iov[first];
+    part.iov_len = std::min(part.iov_len, len);
+    struct msghdr shortMsg = *msg;
+    shortMsg.msg_iov = &part;
+    shortMsg.msg_iovlen = 1;
+
+    ssize_t n = sending ? ::sendmsg(fd, &shortMsg, flags) : ::recvmsg(fd, &shortMsg, flags);
+    msg->msg_controllen = shortMsg.msg_controllen;
+    msg->msg_flags = shortMsg.msg_flags;
+    return n;
+}
+#endif
@@ -0,0 +1,413 @@
+#include "core/link_emulator.h"
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <pthread.h>
+
+namespace {
+
+const size_t MIN_QUEUE_BYTES = 64 * 1024;
+const size_t UNLIMITED_QUEUE_BYTES = 4 * 1024 * 1024;
+const size_t MIN_CHUNK_BYTES = 1448; // One Ethernet-sized segment
+const size_t MAX_CHUNK_BYTES = 64 * 1024;
+
+void setNoDelay(int fd) {
+    // The relay forwards what it gets at once; Nagle would add its own delay
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+} // namespace
+
+LinkEmulator::Connection::~Connection() {
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    if (clientFd >= 0) {
+        close(clientFd);
+    }
+    if (serverFd >= 0) {
+        close(serverFd);
+    }
+}
+
+LinkEmulator::LinkEmulator()
+    : listenFd_(-1),
+      port_(0),
+      targetPort_(0),
+      queueLimit_(0),
+      chunkBytes_(MAX_CHUNK_BYTES),
+      running_(false),
+      connections_(0),
+      bytesRelayed_(0),
+      resets_(0) {
+}
+
+LinkEmulator::~LinkEmulator() {
+    stop();
+}
+
+bool LinkEmulator::start(const std::string& targetIp, uint16_t targetPort, const LinkConditions& conditions,
+                         uint16_t listenPort) {
+    if (running_) {
+        std::cerr << "[Link] Emulator is already running\n";
+        return false;
+    }
+
+    struct sockaddr_in target;
+    std::memset(&target, 0, sizeof(target));
+    if (inet_pton(AF_INET, targetIp.c_str(), &target.sin_addr) <= 0) {
+        std::cerr << "[Link] Invalid target address: " << targetIp << "\n";
+        return false;
+    }
+    targetIp_ = targetIp;
+    targetPort_ = targetPort;
+    conditions_ = conditions;
+
+    // The queue holds what waits for the bottleneck plus what is on the
+    // wire; chunks are about a millisecond of link time
+    double bytesPerSecond = conditions_.bandwidthMbps * 1e6 / 8.0;
+    if (bytesPerSecond > 0) {
+        size_t onWire = static_cast<size_t>(bytesPerSecond * conditions_.rttMs / 2000.0);
+        size_t bdp = static_cast<size_t>(bytesPerSecond * conditions_.rttMs / 1000.0);
+        size_t queue = conditions_.queueBytes > 0 ? conditions_.queueBytes : std::max(bdp, MIN_QUEUE_BYTES);
+        queueLimit_ = queue + onWire;
+        chunkBytes_ = std::min(std::max(static_cast<size_t>(bytesPerSecond / 1000.0), MIN_CHUNK_BYTES),
+                               MAX_CHUNK_BYTES);
+    } else {
+        queueLimit_ = conditions_.queueBytes > 0 ? conditions_.queueBytes : UNLIMITED_QUEUE_BYTES;
+        chunkBytes_ = MAX_CHUNK_BYTES;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        std::cerr << "[Link] Failed to create socket: " << strerror(errno) << "\n";
+        return false;
+    }
+    int opt = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(listenPort);
+    socklen_t addrLen = sizeof(addr);
+    if (bind(listenFd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listenFd_, SOMAXCONN) < 0 ||
+        getsockname(listenFd_, reinterpret_cast<struct sockaddr*>(&addr), &addrLen) < 0) {
+        std::cerr << "[Link] Failed to listen on port " << listenPort << ": " << strerror(errno) << "\n";
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+
+    running_ = true;
+    connections_ = 0;
+    bytesRelayed_ = 0;
+    resets_ = 0;
+    acceptThread_ = std::thread(&LinkEmulator::acceptLoop, this);
+    std::cout << "[Link] 127.0.0.1:" << port_ << " -> " << targetIp_ << ":" << targetPort_ << " (rtt "
+              << conditions_.rttMs << " ms, ";
+    if (conditions_.bandwidthMbps > 0) {
+        std::cout << conditions_.bandwidthMbps << " Mbps";
+    } else {
+        std::cout << "unlimited";
+    }
+    if (conditions_.jitterMs > 0) {
+        std::cout << ", jitter " << conditions_.jitterMs << " ms";
+    }
+    if (conditions_.resetMeanBytes > 0) {
+        std::cout << ", reset every ~" << conditions_.resetMeanBytes << " bytes";
+    }
+    std::cout << ", queue " << queueLimit_ << " bytes)\n";
+    return true;
+}
+
+void LinkEmulator::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // accept() returns once the listener is shut down
+    shutdown(listenFd_, SHUT_RDWR);
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    close(listenFd_);
+    listenFd_ = -1;
+
+    std::vector<std::unique_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        connections.swap(active_);
+    }
+    for (auto& connection : connections) {
+        shutdownBoth(*connection);
+        for (Direction* direction : {&connection->up, &connection->down}) {
+            std::lock_guard<std::mutex> lock(direction->mutex);
+            direction->cv.notify_all();
+        }
+    }
+    connections.clear(); // Joins the threads
+}
+
+uint16_t LinkEmulator::getPort() const {
+    return port_;
+}
+
+const LinkConditions& LinkEmulator::getConditions() const {
+    return conditions_;
+}
+
+uint64_t LinkEmulator::getConnectionCount() const {
+    return connections_;
+}
+
+uint64_t LinkEmulator::getBytesRelayed() const {
+    return bytesRelayed_;
+}
+
+uint64_t LinkEmulator::getResetCount() const {
+    return resets_;
+}
+
+void LinkEmulator::acceptLoop() {
+    pthread_setname_np(pthread_self(), "ft-link");
+    while (running_) {
+        int clientFd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            if (running_ && errno != EINTR && errno != ECONNABORTED) {
+                // Out of descriptors or similar: don't spin
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            continue;
+        }
+
+        int serverFd = connectTarget();
+        if (serverFd < 0) {
+            close(clientFd);
+            continue;
+        }
+        setNoDelay(clientFd);
+        setNoDelay(serverFd);
+
+        reapFinished();
+        auto connection = std::make_unique<Connection>();
+        connection->clientFd = clientFd;
+        connection->serverFd = serverFd;
+        connection->up.from = clientFd;
+        connection->up.to = serverFd;
+        connection->down.from = serverFd;
+        connection->down.to = clientFd;
+        connection->running = 4;
+
+        // Seeded per connection and direction, so a fixed seed replays the
+        // same jitter and resets for the same traffic
+        uint64_t index = connections_;
+        uint32_t seed = conditions_.seed != 0 ? conditions_.seed : std::random_device()();
+        connection->up.random.seed(seed + static_cast<uint32_t>(2 * index));
+        connection->down.random.seed(seed + static_cast<uint32_t>(2 * index + 1));
+
+        Connection& relayed = *connection;
+        for (Direction* direction : {&relayed.up, &relayed.down}) {
+            relayed.threads.emplace_back([this, &relayed, direction]() {
+                readLoop(relayed, *direction);
+                relayed.running--;
+            });
+            relayed.threads.emplace_back([this, &relayed, direction]() {
+                writeLoop(relayed, *direction);
+                relayed.running--;
+            });
+        }
+        connections_++;
+
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        active_.push_back(std::move(connection));
+    }
+}
+
+int LinkEmulator::connectTarget() const {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(targetPort_);
+    inet_pton(AF_INET, targetIp_.c_str(), &addr.sin_addr);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "[Link] Failed to connect to " << targetIp_ << ":" << targetPort_ << ": " << strerror(errno)
+                  << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void LinkEmulator::reapFinished() {
+    std::vector<std::unique_ptr<Connection>> finished;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        auto done = std::partition(active_.begin(), active_.end(),
+                                   [](const std::unique_ptr<Connection>& c) { return c->running > 0; });
+        std::move(done, active_.end(), std::back_inserter(finished));
+        active_.erase(done, active_.end());
+    }
+    // Destroying them joins the threads and closes the sockets
+}
+
+void LinkEmulator::readLoop(Connection& connection, Direction& direction) {
+    const double oneWayMs = conditions_.rttMs / 2.0;
+    const double bytesPerSecond = conditions_.bandwidthMbps * 1e6 / 8.0;
+    std::uniform_real_distribution<double> jitter(-conditions_.jitterMs, conditions_.jitterMs);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::vector<uint8_t> buffer(chunkBytes_);
+
+    while (running_) {
+        {
+            // A full queue stops the reading, which is what the sender feels
+            std::unique_lock<std::mutex> lock(direction.mutex);
+            direction.cv.wait(lock, [&]() {
+                return direction.queuedBytes < queueLimit_ || direction.broken || !running_;
+            });
+            if (direction.broken || !running_) {
+                break;
+            }
+        }
+
+        ssize_t n = recv(direction.from, buffer.data(), buffer.size(), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        bytesRelayed_ += n;
+
+        // Resets come as a Poisson process over the bytes relayed
+        if (conditions_.resetMeanBytes > 0 &&
+            chance(direction.random) < 1.0 - std::exp(-static_cast<double>(n) / conditions_.resetMeanBytes)) {
+            reset(connection);
+            break;
+        }
+
+        Chunk chunk;
+        chunk.data.assign(buffer.begin(), buffer.begin() + n);
+        Clock::time_point now = Clock::now();
+        double delayMs = oneWayMs;
+        if (conditions_.jitterMs > 0) {
+            delayMs = std::max(0.0, delayMs + jitter(direction.random));
+        }
+
+        std::lock_guard<std::mutex> lock(direction.mutex);
+        Clock::time_point sendStart = std::max(now, direction.lineFree);
+        direction.lineFree = sendStart;
+        if (bytesPerSecond > 0) {
+            direction.lineFree += std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(n) / bytesPerSecond));
+        }
+        chunk.deliverAt = std::max(direction.lineFree + std::chrono::duration_cast<Clock::duration>(
+                                                            std::chrono::duration<double, std::milli>(delayMs)),
+                                   direction.lastDeliverAt);
+        direction.lastDeliverAt = chunk.deliverAt;
+        direction.queuedBytes += n;
+        direction.queue.push_back(std::move(chunk));
+        direction.cv.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(direction.mutex);
+    direction.eof = true;
+    direction.cv.notify_all();
+}
+
+void LinkEmulator::writeLoop(Connection& connection, Direction& direction) {
+    std::unique_lock<std::mutex> lock(direction.mutex);
+    while (running_) {
+        direction.cv.wait(lock, [&]() {
+            return !direction.queue.empty() || direction.eof || direction.broken || !running_;
+        });
+        if (direction.broken || !running_) {
+            break;
+        }
+        if (direction.queue.empty()) {
+            // Everything before the end of the stream is delivered: pass the EOF on
+            shutdown(direction.to, SHUT_WR);
+            break;
+        }
+
+        Clock::time_point deliverAt = direction.queue.front().deliverAt;
+        if (direction.cv.wait_until(lock, deliverAt, [&]() { return direction.broken || !running_; })) {
+            break;
+        }
+
+        Chunk chunk = std::move(direction.queue.front());
+        direction.queue.pop_front();
+        lock.unlock();
+
+        size_t sent = 0;
+        while (sent < chunk.data.size()) {
+            ssize_t n = send(direction.to, chunk.data.data() + sent, chunk.data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            sent += n;
+        }
+
+        lock.lock();
+        direction.queuedBytes -= chunk.data.size();
+        direction.cv.notify_all();
+        if (sent < chunk.data.size()) {
+            // The receiving end is gone: so is the connection
+            direction.broken = true;
+            lock.unlock();
+            shutdownBoth(connection);
+            return;
+        }
+    }
+}
+
+void LinkEmulator::reset(Connection& connection) {
+    if (connection.reset.exchange(true)) {
+        return;
+    }
+    resets_++;
+
+    // Disconnecting a TCP socket with AF_UNSPEC sends an RST, and unlike
+    // close() keeps the descriptor valid for the threads still using it
+    struct sockaddr unspec;
+    std::memset(&unspec, 0, sizeof(unspec));
+    unspec.sa_family = AF_UNSPEC;
+    connect(connection.clientFd, &unspec, sizeof(unspec));
+    connect(connection.serverFd, &unspec, sizeof(unspec));
+
+    // Whatever was still on the wire is lost with the connection
+    for (Direction* direction : {&connection.up, &connection.down}) {
+        std::lock_guard<std::mutex> lock(direction->mutex);
+        direction->broken = true;
+        direction->cv.notify_all();
+    }
+    shutdownBoth(connection);
+}
+
+void LinkEmulator::shutdownBoth(Connection& connection) {
+    shutdown(connection.clientFd, SHUT_RDWR);
+    shutdown(connection.serverFd, SHUT_RDWR);
+}
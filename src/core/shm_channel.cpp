@@ -0,0 +1,364 @@
+#include "core/shm_channel.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace {
+
+// The peer maps the memfd read-write; with its size sealed it can't
+// truncate the rings away under us (our next access would be a SIGBUS)
+const int RING_SEALS = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+// A sleeping side re-checks the peer socket this often
+const long WAIT_SLICE_NS = 100 * 1000 * 1000;
+
+// Polls before sleeping; only worth it when the peer runs on another CPU
+const int SPIN_ITERATIONS = 4000;
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Not FUTEX_PRIVATE: the word lives in memory shared with another process
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+    struct timespec timeout = {0, WAIT_SLICE_NS};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+size_t roundCapacity(size_t capacity) {
+    size_t rounded = ShmChannel::MIN_CAPACITY;
+    while (rounded < capacity && rounded < ShmChannel::MAX_CAPACITY) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+} // namespace
+
+/**
+ * Shared layout: [header][data] for server-to-client, then the same for
+ * client-to-server. Indices are free-running byte counts; producer and
+ * consumer fields sit on separate cache lines.
+ */
+struct ShmChannel::RingHeader {
+    alignas(64) std::atomic<uint64_t> head;            // Bytes consumed (reader's)
+    alignas(64) std::atomic<uint64_t> tail;            // Bytes produced (writer's)
+    alignas(64) std::atomic<uint32_t> dataSeq;         // Futex: data arrived
+    std::atomic<uint32_t> readerWaiting;
+    alignas(64) std::atomic<uint32_t> spaceSeq;        // Futex: space freed
+    std::atomic<uint32_t> writerWaiting;
+    alignas(64) std::atomic<uint32_t> closed;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32-bit");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free across processes");
+
+std::unique_ptr<ShmChannel> ShmChannel::create(size_t capacity) {
+    capacity = roundCapacity(capacity);
+    size_t mappedSize = 2 * (sizeof(RingHeader) + capacity);
+
+    int fd = memfd_create("ft-shm-channel", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        std::cerr << "[ShmChannel] memfd_create failed: " << strerror(errno) << "\n";
+        return nullptr;
+    }
+    if (ftruncate(fd, mappedSize) < 0) {
+        std::cerr << "[ShmChannel] Failed to size rings: " << strerror(errno) << "\n";
+        ::close(fd);
+        return nullptr;
+    }
+    if (fcntl(fd, F_ADD_SEALS, RING_SEALS) < 0) {
+        std::cerr << "[ShmChannel] Failed to seal rings: " << strerror(errno) << "\n";
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "[ShmChannel] Failed to map rings: " << strerror(errno) << "\n";
+        ::close(fd);
+        return nullptr;
+    }
+
+    // A fresh memfd is zero-filled, which is a valid empty ring pair
+    return std::unique_ptr<ShmChannel>(new ShmChannel(fd, base, mappedSize, capacity, true));
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::attach(int memfd, size_t capacity) {
+    size_t mappedSize = 2 * (sizeof(RingHeader) + capacity);
+    struct stat st;
+    if (capacity != roundCapacity(capacity) || fstat(memfd, &st) < 0 ||
+        static_cast<size_t>(st.st_size) != mappedSize) {
+        std::cerr << "[ShmChannel] Passed descriptor does not hold " << capacity << "-byte rings\n";
+        ::close(memfd);
+        return nullptr;
+    }
+
+    // Unsealed, the server could shrink the memfd and crash us the same way
+    int seals = fcntl(memfd, F_GET_SEALS);
+    if (seals < 0 || (seals & RING_SEALS) != RING_SEALS) {
+        std::cerr << "[ShmChannel] Passed descriptor is not sealed against resizing\n";
+        ::close(memfd);
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (base == MAP_FAILED) {
+        std::cerr << "[ShmChannel] Failed to map rings: " << strerror(errno) << "\n";
+        ::close(memfd);
+        return nullptr;
+    }
+    return std::unique_ptr<ShmChannel>(new ShmChannel(memfd, base, mappedSize, capacity, false));
+}
+
+ShmChannel::ShmChannel(int memfd, void* base, size_t mappedSize, size_t capacity, bool serverSide)
+    : memfd_(memfd),
+      base_(base),
+      mappedSize_(mappedSize),
+      capacity_(capacity),
+      peerFd_(-1),
+      spin_(sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+    uint8_t* bytes = static_cast<uint8_t*>(base);
+    Ring toClient = {reinterpret_cast<RingHeader*>(bytes), bytes + sizeof(RingHeader)};
+    bytes += sizeof(RingHeader) + capacity;
+    Ring toServer = {reinterpret_cast<RingHeader*>(bytes), bytes + sizeof(RingHeader)};
+
+    tx_ = serverSide ? toClient : toServer;
+    rx_ = serverSide ? toServer : toClient;
+}
+
+ShmChannel::~ShmChannel() {
+    close();
+    munmap(base_, mappedSize_);
+    ::close(memfd_);
+}
+
+int ShmChannel::memfd() const {
+    return memfd_;
+}
+
+size_t ShmChannel::capacity() const {
+    return capacity_;
+}
+
+void ShmChannel::setPeerSocket(int fd) {
+    peerFd_ = fd;
+}
+
+ssize_t ShmChannel::send(const uint8_t* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        if (isClosed()) {
+            errno = EPIPE;
+            return -1;
+        }
+
+        uint64_t tail = tx_.header->tail.load(std::memory_order_relaxed);
+        uint64_t used = tail - tx_.header->head.load(std::memory_order_acquire);
+        if (used > capacity_) {
+            std::cerr << "[ShmChannel] Ring indices corrupted\n";
+            close();
+            return -1;
+        }
+        if (used == capacity_) {
+            if (!waitForSpace()) {
+                errno = EPIPE;
+                return -1;
+            }
+            continue;
+        }
+
+        // Copy into the free space, which may wrap around the end
+        size_t n = std::min<size_t>(capacity_ - used, size - done);
+        size_t pos = tail & (capacity_ - 1);
+        size_t first = std::min(n, capacity_ - pos);
+        std::memcpy(tx_.data + pos, data + done, first);
+        std::memcpy(tx_.data, data + done + first, n - first);
+
+        tx_.header->tail.store(tail + n, std::memory_order_release);
+        wake(tx_.header->dataSeq, tx_.header->readerWaiting);
+        done += n;
+    }
+    return static_cast<ssize_t>(size);
+}
+
+ssize_t ShmChannel::sendVectored(const struct iovec* iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (send(static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len) < 0) {
+            return -1;
+        }
+        total += iov[i].iov_len;
+    }
+    return static_cast<ssize_t>(total);
+}
+
+ssize_t ShmChannel::sendFromFile(int fileFd, off_t* offset, size_t count) {
+    while (true) {
+        if (isClosed()) {
+            errno = EPIPE;
+            return -1;
+        }
+
+        uint64_t tail = tx_.header->tail.load(std::memory_order_relaxed);
+        uint64_t used = tail - tx_.header->head.load(std::memory_order_acquire);
+        if (used > capacity_) {
+            std::cerr << "[ShmChannel] Ring indices corrupted\n";
+            close();
+            return -1;
+        }
+        if (used == capacity_) {
+            if (!waitForSpace()) {
+                errno = EPIPE;
+                return -1;
+            }
+            continue;
+        }
+
+        // One pread up to the end of the buffer; the next call wraps
+        size_t pos = tail & (capacity_ - 1);
+        size_t n = std::min<size_t>({capacity_ - used, capacity_ - pos, count});
+        ssize_t got = pread(fileFd, tx_.data + pos, n, *offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return got;
+        }
+
+        tx_.header->tail.store(tail + got, std::memory_order_release);
+        wake(tx_.header->dataSeq, tx_.header->readerWaiting);
+        *offset += got;
+        return got;
+    }
+}
+
+ssize_t ShmChannel::receive(uint8_t* buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        uint64_t head = rx_.header->head.load(std::memory_order_relaxed);
+        uint64_t available = rx_.header->tail.load(std::memory_order_acquire) - head;
+        if (available > capacity_) {
+            std::cerr << "[ShmChannel] Ring indices corrupted\n";
+            close();
+            return -1;
+        }
+        if (available == 0) {
+            if (!waitForData()) {
+                break; // Closed: report what arrived before
+            }
+            continue;
+        }
+
+        size_t n = std::min<size_t>(available, size - done);
+        size_t pos = head & (capacity_ - 1);
+        size_t first = std::min(n, capacity_ - pos);
+        std::memcpy(buffer + done, rx_.data + pos, first);
+        std::memcpy(buffer + done + first, rx_.data, n - first);
+
+        rx_.header->head.store(head + n, std::memory_order_release);
+        wake(rx_.header->spaceSeq, rx_.header->writerWaiting);
+        done += n;
+    }
+    return static_cast<ssize_t>(done);
+}
+
+void ShmChannel::close() {
+    for (Ring* ring : {&tx_, &rx_}) {
+        ring->header->closed.store(1, std::memory_order_release);
+        ring->header->dataSeq.fetch_add(1, std::memory_order_release);
+        ring->header->spaceSeq.fetch_add(1, std::memory_order_release);
+        futexWake(ring->header->dataSeq);
+        futexWake(ring->header->spaceSeq);
+    }
+}
+
+bool ShmChannel::isClosed() const {
+    return tx_.header->closed.load(std::memory_order_acquire) != 0 ||
+           rx_.header->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool ShmChannel::waitForData() {
+    return waitUntil(rx_.header->dataSeq, rx_.header->readerWaiting, true);
+}
+
+bool ShmChannel::waitForSpace() {
+    return waitUntil(tx_.header->spaceSeq, tx_.header->writerWaiting, false);
+}
+
+bool ShmChannel::ready(bool forData) const {
+    if (forData) {
+        return rx_.header->tail.load(std::memory_order_acquire) != rx_.header->head.load(std::memory_order_relaxed);
+    }
+    uint64_t used = tx_.header->tail.load(std::memory_order_relaxed) - tx_.header->head.load(std::memory_order_acquire);
+    return used != capacity_;
+}
+
+bool ShmChannel::waitUntil(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting, bool forData) {
+    if (spin_) {
+        for (int i = 0; i < SPIN_ITERATIONS; ++i) {
+            if (ready(forData)) {
+                return true;
+            }
+            cpuRelax();
+        }
+    }
+
+    while (true) {
+        // Announce the sleep, then re-check: the other side either sees the
+        // flag after publishing, or we see what it published
+        uint32_t observed = seq.load(std::memory_order_acquire);
+        waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready(forData)) {
+            waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        if (isClosed()) {
+            waiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+
+        futexWait(seq, observed);
+        waiting.store(0, std::memory_order_relaxed);
+        if (!ready(forData) && !peerAlive()) {
+            return false;
+        }
+    }
+}
+
+bool ShmChannel::peerAlive() const {
+    if (isClosed()) {
+        return false;
+    }
+    if (peerFd_ < 0) {
+        return true;
+    }
+    struct pollfd pfd = {peerFd_, POLLRDHUP, 0};
+    return poll(&pfd, 1, 0) == 0 || !(pfd.revents & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL));
+}
+
+void ShmChannel::wake(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting) {
+    // Pairs with the fence in waitUntil()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) {
+        seq.fetch_add(1, std::memory_order_release);
+        futexWake(seq);
+    }
+}
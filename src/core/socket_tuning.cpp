@@ -0,0 +1,168 @@
+#include "core/socket_tuning.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace {
+
+// Floor for BDP-sized buffers: below this a LAN path would get less than
+// the kernel's own defaults
+const uint64_t MIN_BUFFER_BYTES = 128 * 1024;
+
+// Unsent bytes a bdp socket may hold beyond what is in flight; enough to
+// keep the pipe full between two wakeups of the sending thread
+const int NOTSENT_LOWAT_BYTES = 128 * 1024;
+
+bool setIntOption(int fd, int level, int option, int value, const char* name) {
+    if (setsockopt(fd, level, option, &value, sizeof(value)) == 0) {
+        return true;
+    }
+    std::cerr << "[Socket] Warning: Failed to set " << name << "=" << value << ": " << strerror(errno) << "\n";
+    return false;
+}
+
+// SO_SNDBUF/SO_RCVBUF are capped by net.core.wmem_max/rmem_max without an error
+void checkBuffer(int fd, int option, int requested, const char* name) {
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    if (getsockopt(fd, SOL_SOCKET, option, &actual, &len) == 0 && actual / 2 < requested) {
+        std::cerr << "[Socket] Warning: " << name << " capped at " << actual / 2 << " bytes (asked for "
+                  << requested << "); raise net.core." << (option == SO_SNDBUF ? "wmem_max" : "rmem_max") << "\n";
+    }
+}
+
+} // namespace
+
+std::vector<std::string> SocketTuning::profileNames() {
+    return {"default", "interactive", "bdp", "bbr", "paced"};
+}
+
+bool SocketTuning::forProfile(const std::string& name, double linkMbps, double rttMs, SocketTuning& tuning) {
+    tuning = SocketTuning();
+    if (name == "default") {
+        return true;
+    }
+
+    // Small writes (LIST, PING, request headers) leave at once; a response
+    // made of several writes still goes out in full segments
+    tuning.noDelay = true;
+    tuning.cork = true;
+    if (name == "interactive") {
+        return true;
+    }
+
+    if (name != "bdp" && name != "bbr" && name != "paced") {
+        std::cerr << "[Socket] Unknown tuning profile: " << name << "\n";
+        return false;
+    }
+    if (linkMbps <= 0 || rttMs <= 0) {
+        std::cerr << "[Socket] Profile " << name << " needs the link bandwidth and RTT\n";
+        return false;
+    }
+
+    // The kernel doubles the value for its own bookkeeping, so about the
+    // requested amount is left for data: one BDP keeps the link busy
+    uint64_t buffer = std::min<uint64_t>(std::max(bdpBytes(linkMbps, rttMs), MIN_BUFFER_BYTES), INT_MAX / 2);
+    tuning.sendBufferBytes = static_cast<int>(buffer);
+    tuning.receiveBufferBytes = static_cast<int>(buffer);
+    tuning.notSentLowat = NOTSENT_LOWAT_BYTES;
+
+    if (name == "bbr") {
+        tuning.congestion = "bbr";
+    } else if (name == "paced") {
+        tuning.maxPacingRate = static_cast<uint64_t>(linkMbps * 1e6 / 8.0);
+    }
+    return true;
+}
+
+uint64_t SocketTuning::bdpBytes(double linkMbps, double rttMs) {
+    if (linkMbps <= 0 || rttMs <= 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(linkMbps * 1e6 / 8.0 * rttMs / 1000.0);
+}
+
+bool SocketTuning::isDefault() const {
+    return sendBufferBytes == 0 && receiveBufferBytes == 0 && !noDelay && !cork && congestion.empty() &&
+           maxPacingRate == 0 && notSentLowat == 0;
+}
+
+std::string SocketTuning::describe() const {
+    if (isDefault()) {
+        return "kernel defaults";
+    }
+
+    std::ostringstream out;
+    if (sendBufferBytes > 0) {
+        out << " sndbuf=" << sendBufferBytes;
+    }
+    if (receiveBufferBytes > 0) {
+        out << " rcvbuf=" << receiveBufferBytes;
+    }
+    if (noDelay) {
+        out << " nodelay";
+    }
+    if (cork) {
+        out << " cork";
+    }
+    if (!congestion.empty()) {
+        out << " cc=" << congestion;
+    }
+    if (maxPacingRate > 0) {
+        out << " pacing=" << maxPacingRate << "B/s";
+    }
+    if (notSentLowat > 0) {
+        out << " notsent_lowat=" << notSentLowat;
+    }
+    return out.str().substr(1);
+}
+
+bool SocketTuning::apply(int fd) const {
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = true;
+    if (sendBufferBytes > 0) {
+        ok = setIntOption(fd, SOL_SOCKET, SO_SNDBUF, sendBufferBytes, "SO_SNDBUF") && ok;
+        checkBuffer(fd, SO_SNDBUF, sendBufferBytes, "SO_SNDBUF");
+    }
+    if (receiveBufferBytes > 0) {
+        ok = setIntOption(fd, SOL_SOCKET, SO_RCVBUF, receiveBufferBytes, "SO_RCVBUF") && ok;
+        checkBuffer(fd, SO_RCVBUF, receiveBufferBytes, "SO_RCVBUF");
+    }
+    if (noDelay) {
+        ok = setIntOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY") && ok;
+    }
+    if (!congestion.empty() &&
+        setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, congestion.c_str(), congestion.size()) < 0) {
+        std::cerr << "[Socket] Warning: Failed to set TCP_CONGESTION=" << congestion << ": " << strerror(errno)
+                  << " (see net.ipv4.tcp_available_congestion_control)\n";
+        ok = false;
+    }
+    if (maxPacingRate > 0) {
+        // The kernel takes 32 bits on older versions, 64 since 4.19
+        if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &maxPacingRate, sizeof(maxPacingRate)) < 0) {
+            uint32_t rate = static_cast<uint32_t>(std::min<uint64_t>(maxPacingRate, UINT32_MAX));
+            if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) < 0) {
+                std::cerr << "[Socket] Warning: Failed to set SO_MAX_PACING_RATE: " << strerror(errno) << "\n";
+                ok = false;
+            }
+        }
+    }
+    if (notSentLowat > 0) {
+        ok = setIntOption(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, notSentLowat, "TCP_NOTSENT_LOWAT") && ok;
+    }
+    return ok;
+}
+
+bool SocketTuning::setCork(int fd, bool on) {
+    int value = on ? 1 : 0;
+    return setsockopt(fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0;
+}
@@ -0,0 +1,156 @@
+#include "core/tcp_stats.h"
+#include <linux/tcp.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <cstring>
+
+namespace {
+
+// Shares of the transfer time that decide its TransferBound
+const double LIMITED_SHARE = 0.2;
+const double BUSY_SHARE = 0.5;
+const int64_t MIN_CLASSIFIED_US = 1000;
+
+} // namespace
+
+bool TcpStats::sample(int fd, TcpStats& stats, bool queues) {
+    stats = TcpStats();
+    if (fd < 0) {
+        return false;
+    }
+
+    // A shorter reply from an older kernel leaves the newer fields zeroed
+    struct tcp_info info;
+    std::memset(&info, 0, sizeof(info));
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) {
+        return false;
+    }
+
+    stats.rttUs = info.tcpi_rtt;
+    stats.rttVarUs = info.tcpi_rttvar;
+    stats.minRttUs = info.tcpi_min_rtt;
+    stats.cwnd = info.tcpi_snd_cwnd;
+    stats.mss = info.tcpi_snd_mss;
+    stats.retransmits = info.tcpi_retransmits;
+    stats.totalRetrans = info.tcpi_total_retrans;
+    stats.lost = info.tcpi_lost;
+    stats.unacked = info.tcpi_unacked;
+    stats.notSentBytes = info.tcpi_notsent_bytes;
+    stats.deliveryRate = info.tcpi_delivery_rate;
+    stats.bytesAcked = info.tcpi_bytes_acked;
+    stats.bytesReceived = info.tcpi_bytes_received;
+    stats.busyUs = info.tcpi_busy_time;
+    stats.rwndLimitedUs = info.tcpi_rwnd_limited;
+    stats.sndbufLimitedUs = info.tcpi_sndbuf_limited;
+    stats.segmentsOut = info.tcpi_segs_out;
+    if (!queues) {
+        return true;
+    }
+
+    int queued = 0;
+    if (ioctl(fd, SIOCOUTQ, &queued) == 0) {
+        stats.sendQueueBytes = static_cast<uint32_t>(queued);
+    }
+    if (ioctl(fd, SIOCINQ, &queued) == 0) {
+        stats.receiveQueueBytes = static_cast<uint32_t>(queued);
+    }
+    return true;
+}
+
+const char* transferBoundName(TransferBound bound) {
+    switch (bound) {
+        case TransferBound::Network:
+            return "network";
+        case TransferBound::Receiver:
+            return "receiver";
+        case TransferBound::SendBuffer:
+            return "sndbuf";
+        case TransferBound::Sender:
+            return "sender";
+        default:
+            return "unknown";
+    }
+}
+
+void TcpTransferSampler::begin(int fd, bool sending) {
+    fd_ = -1;
+    result_ = TcpTransferStats();
+    if (fd < 0 || fd == notTcpFd_) {
+        return;
+    }
+    if (!TcpStats::sample(fd, first_, false)) {
+        notTcpFd_ = fd;
+        return;
+    }
+
+    fd_ = fd;
+    sending_ = sending;
+    start_ = last_ = Clock::now();
+    result_.samples = 1;
+}
+
+void TcpTransferSampler::poll() {
+    if (fd_ < 0) {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    if (now - last_ >= std::chrono::milliseconds(INTERVAL_MS)) {
+        last_ = now;
+        take(true);
+    }
+}
+
+TcpTransferStats TcpTransferSampler::end() {
+    if (fd_ < 0) {
+        return result_;
+    }
+    take(false);
+    fd_ = -1;
+
+    // Only the sender's counters say what held the data back; busyUs does
+    // not grow on the side that merely receives
+    int64_t elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+    if (sending_ && elapsedUs >= MIN_CLASSIFIED_US) {
+        double elapsed = static_cast<double>(elapsedUs);
+        if (result_.rwndLimitedUs >= LIMITED_SHARE * elapsed) {
+            result_.bound = TransferBound::Receiver;
+        } else if (result_.sndbufLimitedUs >= LIMITED_SHARE * elapsed) {
+            result_.bound = TransferBound::SendBuffer;
+        } else if (result_.busyUs < BUSY_SHARE * elapsed) {
+            result_.bound = TransferBound::Sender;
+        } else {
+            result_.bound = TransferBound::Network;
+        }
+    }
+    return result_;
+}
+
+bool TcpTransferSampler::isActive() const {
+    return fd_ >= 0;
+}
+
+void TcpTransferSampler::take(bool queues) {
+    TcpStats now;
+    if (!TcpStats::sample(fd_, now, queues)) {
+        return;
+    }
+
+    result_.samples++;
+    result_.rttUs = now.rttUs;
+    result_.rttVarUs = now.rttVarUs;
+    result_.cwnd = now.cwnd;
+    if (now.deliveryRate > 0) {
+        result_.deliveryRate = now.deliveryRate;
+    }
+    result_.retransmits = now.totalRetrans - first_.totalRetrans;
+    result_.segmentsOut = now.segmentsOut - first_.segmentsOut;
+    result_.busyUs = now.busyUs - first_.busyUs;
+    result_.rwndLimitedUs = now.rwndLimitedUs - first_.rwndLimitedUs;
+    result_.sndbufLimitedUs = now.sndbufLimitedUs - first_.sndbufLimitedUs;
+    if (now.sendQueueBytes > result_.maxSendQueueBytes) {
+        result_.maxSendQueueBytes = now.sendQueueBytes;
+    }
+}
@@ -3,18 +3,34 @@
 #include <iomanip>
 #include <algorithm>
 #include <thread>
+#include <cstring>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 
 Server::Server()
-    : socket_(std::make_unique<ServerSocket>()),
-      protocol_(std::make_unique<ServerProtocol>()),
+    : protocol_(std::make_unique<ServerProtocol>()),
+      shardCount_(1),
+      shmRingBytes_(0),
+      commandProfiling_(false),
+      topology_(CpuTopology::detect()),
+      incomingCpuSteering_(false),
+      handedOff_(false),
+      drainTimeout_(30),
+      acceptLoops_(0),
       running_(false),
       sharedDirectory_(std::make_shared<std::string>("./shared")),
       port_(0),
       maxConnections_(0),
-      timeout_(30),
+      timeout_(300),
+      progressTimeout_(60),
+      minTransferRate_(0),
       verbose_(false) {
+    fileCache_.setMetrics(&metrics_);
+    reaper_.setMetrics(&metrics_);
+    rateLimiter_.setMetrics(&metrics_);
+    reaper_.configure(timeout_, progressTimeout_, minTransferRate_);
+    sessionStatsProvider_ = [this]() { return getSessionStats(); };
 }
 
 Server::~Server() {
@@ -22,13 +38,14 @@ Server::~Server() {
         stop();
     }
     
-    // Ensure thread is cleaned up
-    if (acceptThread_ && acceptThread_->joinable()) {
-        try {
-            acceptThread_->join();
-        } catch (...) {
-            // Ignore exceptions during cleanup
+    // Ensure shard threads are cleaned up
+    try {
+        joinShardThreads();
+        if (handoffThread_ && handoffThread_->joinable()) {
+            handoffThread_->join(); // Finishes a drain after a handoff
         }
+    } catch (...) {
+        // Ignore exceptions during cleanup
     }
 }
 
@@ -43,24 +60,172 @@ bool Server::start(uint16_t port, const std::string& sharedDir) {
         return false;
     }
 
-    // Bind and listen
-    if (!socket_->bind(port)) {
+    // Sessions of pinned acceptors would inherit the acceptor's CPU; they
+    // get this mask back unless worker CPUs are configured
+    defaultCpus_ = CpuTopology::currentAffinity();
+
+    joinShardThreads();
+    if (handoffThread_ && handoffThread_->joinable()) {
+        handoffThread_->join();
+    }
+    handoffThread_.reset();
+    handoffSocket_.reset();
+    shards_.clear();
+
+    // Hot restart: take over the listeners of a server using the same
+    // control socket instead of binding new ones
+    ListenerHandoff handoff;
+    std::vector<int> inherited;
+    bool inheriting = !handoffPath_.empty() && handoff.requestListeners(handoffPath_, inherited);
+
+    if (!createShards(port, inherited)) {
+        // The predecessor still serves on inherited listeners: only let go
+        for (auto& shard : shards_) {
+            if (shard->inherited) {
+                shard->socket->relinquish();
+            }
+        }
+        shards_.clear();
         return false;
     }
 
-    port_ = port;
+    // From the acknowledgement on, the predecessor stops accepting and drains
+    if (inheriting && !handoff.complete()) {
+        std::cerr << "[Server] Previous server did not confirm the handoff\n";
+    }
+    if (!handoffPath_.empty()) {
+        handoffSocket_ = std::make_unique<ServerSocket>();
+        if (!handoffSocket_->bindUnix(handoffPath_)) {
+            std::cerr << "[Server] Warning: Hot restart unavailable, cannot listen on " << handoffPath_ << "\n";
+            handoffSocket_.reset();
+        }
+    }
+
+    handedOff_ = false;
     running_ = true;
+    reaper_.start();
+    if (handoffSocket_) {
+        handoffThread_ = std::make_unique<std::thread>(&Server::handoffLoop, this);
+    }
 
     if (verbose_) {
-        std::cout << "[Server] Server started on port " << port_ << "\n";
-        std::cout << "[Server] Shared directory: " << sharedDirectory_ << "\n";
+        std::cout << "[Server] Server started on port " << port_
+                  << " (" << shards_.size() << " listener shard" << (shards_.size() > 1 ? "s" : "") << ")\n";
+        std::cout << "[Server] Shared directory: " << *sharedDirectory_ << "\n";
+        if (!unixSocketPath_.empty()) {
+            std::cout << "[Server] Unix socket: " << unixSocketPath_ << "\n";
+        }
+        if (handoffSocket_) {
+            std::cout << "[Server] Hot restart control socket: " << handoffPath_ << "\n";
+        }
+        std::cout << "[Server] CPU topology: " << topology_.describe();
+        if (!acceptorCpus_.empty() || !workerCpus_.empty()) {
+            std::cout << "[Server] Acceptor CPUs: "
+                      << (acceptorCpus_.empty() ? "any" : CpuTopology::formatCpuList(acceptorCpus_))
+                      << ", worker CPUs: "
+                      << (workerCpus_.empty() ? "any" : CpuTopology::formatCpuList(workerCpus_))
+                      << (incomingCpuSteering_ ? ", SO_INCOMING_CPU steering" : "") << "\n";
+        }
     }
 
     logEvent("Server started");
     return true;
 }
 
+uint16_t Server::getPort() const {
+    return port_;
+}
+
+bool Server::createShards(uint16_t port, std::vector<int>& inherited) {
+    // Inherited TCP listeners become the first shards, an inherited Unix
+    // one the Unix shard
+    std::vector<std::unique_ptr<ServerSocket>> inheritedTcp;
+    std::unique_ptr<ServerSocket> inheritedUnix;
+    for (int fd : inherited) {
+        bool isUnix = ServerSocket::isUnixSocket(fd);
+        auto socket = std::make_unique<ServerSocket>();
+        if (!socket->adopt(fd)) {
+            continue;
+        }
+        if (!isUnix) {
+            inheritedTcp.push_back(std::move(socket));
+        } else if (!inheritedUnix) {
+            inheritedUnix = std::move(socket);
+        } else {
+            socket->relinquish();
+        }
+    }
+    inherited.clear();
+
+    if (!inheritedTcp.empty()) {
+        port_ = inheritedTcp[0]->getPort();
+        if (port != 0 && port != port_) {
+            std::cerr << "[Server] Warning: Keeping inherited port " << port_ << " instead of " << port << "\n";
+        }
+    }
+
+    // Bind and listen: every shard binds the same port (SO_REUSEPORT)
+    size_t tcpShards = std::max(shardCount_, inheritedTcp.size());
+    for (size_t i = 0; i < tcpShards; ++i) {
+        auto shard = std::make_unique<ListenerShard>();
+        shard->index = i;
+        if (!acceptorCpus_.empty()) {
+            shard->cpu = acceptorCpus_[i % acceptorCpus_.size()];
+        }
+
+        if (i < inheritedTcp.size()) {
+            shard->socket = std::move(inheritedTcp[i]);
+            shard->inherited = true;
+        } else {
+            // The first shard may ask for an ephemeral port; the rest join it
+            shard->socket = std::make_unique<ServerSocket>();
+            if (!shard->socket->bind(i == 0 ? port : port_)) {
+                return false;
+            }
+            if (i == 0) {
+                port_ = shard->socket->getPort();
+            }
+        }
+        if (incomingCpuSteering_ && shard->cpu >= 0) {
+            shard->socket->setIncomingCpu(shard->cpu);
+        }
+        if (!socketTuning_.isDefault()) {
+            socketTuning_.apply(shard->socket->getSocketFd());
+        }
+        shards_.push_back(std::move(shard));
+    }
+
+    // Same-host clients: one more shard listening on the Unix socket
+    if (inheritedUnix || !unixSocketPath_.empty()) {
+        auto shard = std::make_unique<ListenerShard>();
+        shard->index = shards_.size();
+        shard->isUnix = true;
+        if (!acceptorCpus_.empty()) {
+            shard->cpu = acceptorCpus_[shard->index % acceptorCpus_.size()];
+        }
+        if (inheritedUnix) {
+            shard->socket = std::move(inheritedUnix);
+            shard->inherited = true;
+            if (!unixSocketPath_.empty() && unixSocketPath_ != shard->socket->getUnixPath()) {
+                std::cerr << "[Server] Warning: Keeping inherited Unix socket " << shard->socket->getUnixPath()
+                          << " instead of " << unixSocketPath_ << "\n";
+            }
+            unixSocketPath_ = shard->socket->getUnixPath();
+            shards_.push_back(std::move(shard));
+        } else {
+            shard->socket = std::make_unique<ServerSocket>();
+            bool bound = shard->socket->bindUnix(unixSocketPath_);
+            shards_.push_back(std::move(shard));
+            if (!bound) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void Server::stop() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
     if (!running_) {
         return;
     }
@@ -71,37 +236,123 @@ void Server::stop() {
 
     // Set running flag to false first
     running_ = false;
-    
-    // Stop all client sessions first
-    {
-        std::lock_guard<std::mutex> lock(sessionsMutex_);
-        for (auto& session : sessions_) {
-            if (session) {
-                session->stop();
-            }
-        }
-        sessions_.clear();
+    reaper_.stop();
+    stopAccepting();
+    stopSessions();
+
+    if (verbose_) {
+        std::cout << "[Server] Server stopped\n";
+    }
+
+    logEvent("Server stopped");
+}
+
+bool Server::drain(int timeoutSeconds) {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    if (!running_) {
+        return true;
     }
 
-    // Close socket to unblock accept()
-    if (socket_) {
-        socket_->close();
+    std::cout << "[Server] Draining " << getActiveSessionCount() << " session(s), up to "
+              << timeoutSeconds << " s...\n";
+
+    // Idle and progress timeouts stay in force while draining
+    running_ = false;
+    stopAccepting();
+
+    // A connection accepted just now still gets its session
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(std::max(timeoutSeconds, 0));
+    waitAcceptLoops(deadline);
+    for (auto& shard : shards_) {
+        shard->sessions.closeAndDrainAll();
     }
 
-    // Wait for accept thread to finish (with timeout)
-    if (acceptThread_ && acceptThread_->joinable()) {
-        try {
-            acceptThread_->join();
-        } catch (const std::exception& e) {
-            std::cerr << "[Server] Error joining accept thread: " << e.what() << "\n";
-        }
+    bool drained = true;
+    for (auto& shard : shards_) {
+        drained = shard->sessions.waitEmptyUntil(deadline) && drained;
+    }
+    if (!drained) {
+        std::cout << "[Server] Drain deadline passed, closing " << getActiveSessionCount() << " session(s)\n";
     }
 
+    reaper_.stop();
+    stopSessions();
+
     if (verbose_) {
         std::cout << "[Server] Server stopped\n";
     }
 
-    logEvent("Server stopped");
+    logEvent(drained ? "Server drained" : "Server drained (deadline passed)");
+    return drained;
+}
+
+void Server::stopAccepting() {
+    for (auto& shard : shards_) {
+        if (handedOff_) {
+            // The successor accepts on these now: close only our descriptor
+            shard->socket->interrupt();
+            shard->socket->relinquish();
+        } else {
+            // Close socket to unblock accept(); run() joins the shard threads
+            shard->socket->close();
+        }
+    }
+    if (handoffSocket_) {
+        handoffSocket_->close();
+    }
+}
+
+void Server::stopSessions() {
+    // Late accepts are refused from here on
+    for (auto& shard : shards_) {
+        shard->sessions.closeAndStopAll();
+    }
+
+    // Session threads use the shards and the caches: let them finish
+    for (auto& shard : shards_) {
+        shard->sessions.waitEmpty();
+    }
+}
+
+bool Server::waitAcceptLoops(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(acceptLoopsMutex_);
+    return acceptLoopsCv_.wait_until(lock, deadline, [this] { return acceptLoops_ == 0; });
+}
+
+void Server::handoffLoop() {
+    pthread_setname_np(pthread_self(), "ft-handoff");
+    while (running_) {
+        std::string peer;
+        int connFd = handoffSocket_->acceptConnection(peer);
+        if (connFd < 0) {
+            continue;
+        }
+
+        bool handedOff = false;
+        {
+            // Keep accepting until the successor confirms it has the listeners
+            std::lock_guard<std::mutex> lock(lifecycleMutex_);
+            if (running_) {
+                std::vector<int> listenerFds;
+                for (const auto& shard : shards_) {
+                    listenerFds.push_back(shard->socket->getSocketFd());
+                }
+                handedOff = ListenerHandoff::serve(connFd, listenerFds);
+                if (handedOff) {
+                    handedOff_ = true;
+                    // The successor binds the control path once it sees EOF
+                    handoffSocket_->relinquish();
+                }
+            }
+        }
+        close(connFd);
+
+        if (handedOff) {
+            logEvent("Listeners handed off");
+            drain(drainTimeout_);
+            return;
+        }
+    }
 }
 
 bool Server::isRunning() const {
@@ -114,10 +365,191 @@ void Server::run() {
         return;
     }
 
-    acceptLoop();
+    // Extra shards accept on their own threads; shard 0 uses the caller's
+    for (size_t i = 1; i < shards_.size(); ++i) {
+        ListenerShard& shard = *shards_[i];
+        shard.thread = std::make_unique<std::thread>(&Server::acceptLoop, this, std::ref(shard));
+    }
+
+    acceptLoop(*shards_[0]);
+    joinShardThreads();
     std::cout << "[Server] accept loop fine\n";
 }
 
+void Server::joinShardThreads() {
+    for (auto& shard : shards_) {
+        if (shard->thread && shard->thread->joinable()) {
+            shard->thread->join();
+        }
+        shard->thread.reset();
+    }
+}
+
+bool Server::setHandoffSocket(const std::string& path) {
+    if (running_) {
+        std::cerr << "[Server] Cannot change the hot restart socket while running\n";
+        return false;
+    }
+    handoffPath_ = path;
+    return true;
+}
+
+std::string Server::getHandoffSocket() const {
+    return handoffPath_;
+}
+
+void Server::setDrainTimeout(int seconds) {
+    drainTimeout_ = seconds > 0 ? seconds : 0;
+}
+
+bool Server::wasHandedOff() const {
+    return handedOff_;
+}
+
+bool Server::setListenerShards(size_t count) {
+    if (running_) {
+        std::cerr << "[Server] Cannot change listener shards while running\n";
+        return false;
+    }
+    shardCount_ = count > 0 ? count : 1;
+
+    if (verbose_) {
+        std::cout << "[Server] Listener shards set to: " << shardCount_ << "\n";
+    }
+    return true;
+}
+
+size_t Server::getListenerShards() const {
+    return shardCount_;
+}
+
+bool Server::setUnixSocket(const std::string& path) {
+    if (running_) {
+        std::cerr << "[Server] Cannot change the Unix socket while running\n";
+        return false;
+    }
+    const std::string scheme = "unix:";
+    unixSocketPath_ = path.compare(0, scheme.size(), scheme) == 0 ? path.substr(scheme.size()) : path;
+
+    if (verbose_) {
+        std::cout << "[Server] Unix socket set to: "
+                  << (unixSocketPath_.empty() ? "none" : unixSocketPath_) << "\n";
+    }
+    return true;
+}
+
+std::string Server::getUnixSocket() const {
+    return unixSocketPath_;
+}
+
+void Server::setSharedMemoryRings(size_t ringBytes) {
+    shmRingBytes_ = ringBytes;
+
+    if (verbose_) {
+        std::cout << "[Server] Shared-memory rings: "
+                  << (ringBytes == 0 ? std::string("off") : std::to_string(ringBytes) + " bytes") << "\n";
+    }
+}
+
+void Server::setCommandProfiling(bool enable) {
+    commandProfiling_ = enable;
+
+    if (verbose_) {
+        std::cout << "[Server] Command profiling: " << (enable ? "on" : "off") << "\n";
+    }
+}
+
+bool Server::getCommandProfiling() const {
+    return commandProfiling_;
+}
+
+std::vector<uint64_t> Server::getAcceptedPerShard() const {
+    std::vector<uint64_t> accepted;
+    for (const auto& shard : shards_) {
+        accepted.push_back(shard->accepted.load());
+    }
+    return accepted;
+}
+
+bool Server::setCpuAffinity(const std::string& acceptorCpus, const std::string& workerCpus) {
+    if (running_) {
+        std::cerr << "[Server] Cannot change CPU affinity while running\n";
+        return false;
+    }
+
+    std::vector<int> acceptors;
+    std::vector<int> workers;
+    if (!CpuTopology::parseCpuList(acceptorCpus, acceptors) || !CpuTopology::parseCpuList(workerCpus, workers)) {
+        std::cerr << "[Server] Invalid CPU list: \"" << acceptorCpus << "\" / \"" << workerCpus << "\"\n";
+        return false;
+    }
+    for (const auto* list : {&acceptors, &workers}) {
+        for (int cpu : *list) {
+            if (!topology_.isUsable(cpu)) {
+                std::cerr << "[Server] CPU " << cpu << " is offline or outside this process's affinity\n";
+                return false;
+            }
+        }
+    }
+
+    acceptorCpus_ = acceptors;
+    workerCpus_ = workers;
+
+    if (verbose_) {
+        std::cout << "[Server] CPU affinity: acceptors "
+                  << (acceptorCpus_.empty() ? "any" : CpuTopology::formatCpuList(acceptorCpus_))
+                  << ", workers " << (workerCpus_.empty() ? "any" : CpuTopology::formatCpuList(workerCpus_)) << "\n";
+    }
+    return true;
+}
+
+void Server::setIncomingCpuSteering(bool enable) {
+    incomingCpuSteering_ = enable;
+
+    if (verbose_) {
+        std::cout << "[Server] SO_INCOMING_CPU steering " << (enable ? "enabled" : "disabled") << "\n";
+    }
+}
+
+bool Server::setSocketTuning(const SocketTuning& tuning) {
+    if (running_) {
+        std::cerr << "[Server] Cannot change socket tuning while running\n";
+        return false;
+    }
+    socketTuning_ = tuning;
+
+    if (verbose_) {
+        std::cout << "[Server] Socket tuning set to: " << socketTuning_.describe() << "\n";
+    }
+    return true;
+}
+
+const SocketTuning& Server::getSocketTuning() const {
+    return socketTuning_;
+}
+
+const CpuTopology& Server::getCpuTopology() const {
+    return topology_;
+}
+
+std::vector<int> Server::workerCpusNear(int cpu) const {
+    if (workerCpus_.empty()) {
+        return defaultCpus_;
+    }
+    if (cpu < 0 || topology_.nodeCount() < 2) {
+        return workerCpus_;
+    }
+
+    int node = topology_.nodeOf(cpu);
+    std::vector<int> local;
+    for (int worker : workerCpus_) {
+        if (topology_.nodeOf(worker) == node) {
+            local.push_back(worker);
+        }
+    }
+    return local.empty() ? workerCpus_ : local;
+}
+
 bool Server::setSharedDirectory(const std::string& directory) {
     // Check if directory exists
     struct stat info;
@@ -159,6 +591,15 @@ size_t Server::getMaxConnections() const {
     return maxConnections_;
 }
 
+void Server::setFileCacheLimits(size_t capacityBytes, size_t maxFileSize) {
+    fileCache_.configure(capacityBytes, maxFileSize);
+
+    if (verbose_) {
+        std::cout << "[Server] File cache: " << capacityBytes << " bytes, files up to "
+                  << maxFileSize << " bytes\n";
+    }
+}
+
 void Server::setVerbose(bool enable) {
     verbose_ = enable;
     
@@ -169,12 +610,38 @@ void Server::setVerbose(bool enable) {
 
 void Server::setTimeout(int seconds) {
     timeout_ = seconds;
+    reaper_.configure(timeout_, progressTimeout_, minTransferRate_);
     
     if (verbose_) {
         std::cout << "[Server] Timeout set to " << timeout_ << " seconds\n";
     }
 }
 
+void Server::setTransferTimeouts(int progressSeconds, uint64_t minBytesPerSecond) {
+    progressTimeout_ = progressSeconds;
+    minTransferRate_ = minBytesPerSecond;
+    reaper_.configure(timeout_, progressTimeout_, minTransferRate_);
+
+    if (verbose_) {
+        std::cout << "[Server] Transfer timeouts: " << progressTimeout_ << " s without progress, "
+                  << "floor " << minTransferRate_ << " bytes/s\n";
+    }
+}
+
+void Server::setBandwidthLimits(uint64_t globalBytesPerSecond, uint64_t perClientBytesPerSecond,
+                                uint64_t perSessionBytesPerSecond) {
+    rateLimiter_.setLimits(globalBytesPerSecond, perClientBytesPerSecond, perSessionBytesPerSecond);
+
+    if (verbose_) {
+        auto describe = [](uint64_t limit) {
+            return limit == 0 ? std::string("unlimited") : std::to_string(limit) + " B/s";
+        };
+        std::cout << "[Server] Bandwidth limits: global " << describe(globalBytesPerSecond)
+                  << ", per client " << describe(perClientBytesPerSecond)
+                  << ", per session " << describe(perSessionBytesPerSecond) << "\n";
+    }
+}
+
 const ServerMetrics& Server::getMetrics() const {
     return metrics_;
 }
@@ -202,32 +669,76 @@ void Server::displayMetrics() const {
 }
 
 size_t Server::getActiveSessionCount() const {
-    std::lock_guard<std::mutex> lock(sessionsMutex_);
-    return sessions_.size();
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        count += shard->sessions.size();
+    }
+    return count;
+}
+
+std::vector<SessionStatsRecord> Server::getSessionStats() const {
+    std::vector<SessionStatsRecord> records;
+    auto now = std::chrono::system_clock::now();
+
+    for (const auto& shard : shards_) {
+        for (const auto& session : shard->sessions.sessions()) {
+            SessionStatsRecord record{};
+            std::string addr = session->getClientAddress();
+            std::strncpy(record.clientAddr, addr.c_str(), sizeof(record.clientAddr) - 1);
+            record.connectedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - session->getStartTime()).count();
+            record.isTcp = session->sampleTcpStats(record.tcp) ? 1 : 0;
+            records.push_back(record);
+        }
+    }
+    return records;
 }
 
 std::vector<std::string> Server::getActiveClients() const {
     std::vector<std::string> clients;
     
-    std::lock_guard<std::mutex> lock(sessionsMutex_);
-    for (const auto& session : sessions_) {
-        if (session && session->isActive()) {
-            clients.push_back(session->getClientAddress());
-        }
+    for (const auto& shard : shards_) {
+        std::vector<std::string> shardClients = shard->sessions.clientAddresses();
+        clients.insert(clients.end(), shardClients.begin(), shardClients.end());
     }
     
     return clients;
 }
 
-void Server::acceptLoop() {
-    std::cout << "[Server] Accepting client connections...\n";
+bool Server::pollEvent(ServerEvent& event) {
+    return events_.tryPop(event);
+}
 
-    while (running_) {
-        // Clean up finished sessions
-        cleanupFinishedSessions();
+bool Server::waitEvent(ServerEvent& event, int timeout_ms) {
+    return events_.waitPop(event, timeout_ms);
+}
+
+uint64_t Server::getDroppedEventCount() const {
+    return events_.droppedCount();
+}
+
+void Server::acceptLoop(ListenerShard& shard) {
+    // Shard 0 runs on the caller's thread: give it its mask back afterwards
+    std::vector<int> previousCpus;
+    if (&shard != shards_[0].get()) {
+        pthread_setname_np(pthread_self(), "ft-accept");
+    }
+    if (shard.cpu >= 0) {
+        previousCpus = CpuTopology::currentAffinity();
+        if (!CpuTopology::pinCurrentThread({shard.cpu})) {
+            std::cerr << "[Server] Failed to pin shard " << shard.index << " to CPU " << shard.cpu << "\n";
+        }
+    }
 
-        // Check if max connections reached
-        if (maxConnections_ > 0 && getActiveSessionCount() >= maxConnections_) {
+    {
+        std::lock_guard<std::mutex> lock(acceptLoopsMutex_);
+        acceptLoops_++;
+    }
+    std::cout << "[Server] Shard " << shard.index << " accepting client connections...\n";
+
+    while (running_) {
+        // Check if max connections reached (across all shards)
+        if (maxConnections_ > 0 && metrics_.activeConnections.load() >= maxConnections_) {
             if (verbose_) {
                 std::cout << "[Server] Max connections reached, waiting...\n";
             }
@@ -236,7 +747,7 @@ void Server::acceptLoop() {
         }
         // Accept new connection
         std::string clientAddr;
-        int clientFd = socket_->acceptConnection(clientAddr);
+        int clientFd = shard.socket->acceptConnection(clientAddr);
 
         if (clientFd < 0) {
             // If server is stopping, exit gracefully
@@ -258,22 +769,52 @@ void Server::acceptLoop() {
 
         // Update metrics
         metrics_.incrementConnections();
+        shard.accepted++;
 
         // Create and start new session
-        auto session = std::make_unique<ClientSession>(clientFd, clientAddr, sharedDirectory_, &metrics_);
-        session->start();
+        auto session = std::make_shared<ClientSession>(clientFd, clientAddr, sharedDirectory_, &metrics_, &events_,
+                                                       &fileCache_, &fdCache_);
+        session->setWatch(reaper_.watch(clientFd));
+        session->setRateLimiter(&rateLimiter_);
+        session->setSharedMemory(shmRingBytes_);
+        session->setCommandProfiling(commandProfiling_);
+        session->setSessionStatsProvider(&sessionStatsProvider_);
+        session->setCork(socketTuning_.cork && !shard.isUnix);
+        if (shard.cpu >= 0 || !workerCpus_.empty()) {
+            int nearCpu = incomingCpuSteering_ ? ServerSocket::getIncomingCpu(clientFd) : -1;
+            session->setCpuAffinity(workerCpusNear(nearCpu >= 0 ? nearCpu : shard.cpu));
+        }
 
-        {
-            std::lock_guard<std::mutex> lock(sessionsMutex_);
-            sessions_.push_back(std::move(session));
+        // Register before starting, so the session can always deregister
+        SessionRegistry::Handle handle = shard.sessions.add(session, clientAddr);
+        if (handle == SessionRegistry::INVALID_HANDLE) {
+            // stop() got here first; dropping the session closes the socket
+            metrics_.decrementActiveConnections();
+            continue;
         }
+        session->setOnFinished([this, &shard, handle]() {
+            // stop() may return as soon as the session is removed
+            metrics_.decrementActiveConnections();
+            shard.sessions.remove(handle);
+        });
+        session->start();
 
         logEvent("Client connected: " + clientAddr);
     }
     
+    if (!previousCpus.empty()) {
+        CpuTopology::pinCurrentThread(previousCpus);
+    }
+
     if (verbose_) {
-        std::cout << "[Server] Accept loop terminated\n";
+        std::cout << "[Server] Shard " << shard.index << " accept loop terminated\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(acceptLoopsMutex_);
+        acceptLoops_--;
     }
+    acceptLoopsCv_.notify_all();
 }
 
 void Server::handleClient(int clientFd, const std::string& clientAddr) {
@@ -287,22 +828,6 @@ void Server::handleClient(int clientFd, const std::string& clientAddr) {
     // This method can be used for additional per-client processing if needed
 }
 
-void Server::cleanupFinishedSessions() {
-    std::lock_guard<std::mutex> lock(sessionsMutex_);
-    
-    // Remove inactive sessions - destructor will handle thread cleanup
-    auto it = std::remove_if(sessions_.begin(), sessions_.end(),
-        [this](const std::unique_ptr<ClientSession>& session) {
-            if (!session->isActive()) {
-                metrics_.decrementActiveConnections();
-                return true;
-            }
-            return false;
-        });
-    
-    sessions_.erase(it, sessions_.end());
-}
-
 void Server::logEvent(const std::string& event) {
     if (verbose_) {
         auto now = std::chrono::system_clock::now();
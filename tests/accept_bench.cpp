@@ -0,0 +1,135 @@
+/**
+ * Accept Benchmark - connections per second vs. number of listener shards
+ *
+ * Runs an in-process server on an ephemeral port and hammers it with
+ * connect()/close() from several client threads, once per shard count.
+ * Clients close with an RST (SO_LINGER 0) so the run doesn't exhaust
+ * ephemeral ports with TIME_WAIT sockets.
+ *
+ * Usage: ./accept_bench [seconds] [client_threads] [max_shards]
+ * Example: ./accept_bench 3 8 4
+ */
+
+#include "../include/server.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static bool connectOnce(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+
+    struct linger lingerOpt = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
+    close(fd);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 3;
+    int clientThreads = (argc > 2) ? atoi(argv[2]) : 8;
+    int maxShards = (argc > 3) ? atoi(argv[3]) : 4;
+    if (seconds <= 0 || clientThreads <= 0 || maxShards <= 0) {
+        cerr << "Usage: " << argv[0] << " [seconds] [client_threads] [max_shards]\n";
+        return 1;
+    }
+
+    // Server logs every connection; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    char dirTemplate[] = "/tmp/accept_bench_XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        report << "Error: Cannot create temporary directory\n";
+        return 1;
+    }
+
+    report << "Accept benchmark: " << seconds << " s per run, " << clientThreads << " client threads\n";
+    report << string(60, '-') << "\n";
+    report << left << setw(10) << "Shards"
+           << setw(16) << "Conns/sec"
+           << setw(10) << "Failed"
+           << "Accepted per shard" << "\n";
+    report << string(60, '-') << "\n";
+
+    for (int shards = 1; shards <= maxShards; shards *= 2) {
+        Server server;
+        server.setListenerShards(shards);
+        if (!server.start(0, dirTemplate)) {
+            report << "Error: Cannot start server\n";
+            return 1;
+        }
+        uint16_t port = server.getPort();
+        thread serverThread([&server]() { server.run(); });
+
+        atomic<bool> stopClients{false};
+        atomic<uint64_t> connected{0};
+        atomic<uint64_t> failed{0};
+        vector<thread> clients;
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < clientThreads; ++i) {
+            clients.emplace_back([&]() {
+                while (!stopClients) {
+                    if (connectOnce(port)) {
+                        connected++;
+                    } else {
+                        failed++;
+                    }
+                }
+            });
+        }
+
+        this_thread::sleep_for(std::chrono::seconds(seconds));
+        stopClients = true;
+        for (auto& t : clients) {
+            t.join();
+        }
+        double elapsed = duration<double>(steady_clock::now() - start).count();
+
+        // Give the last sessions time to see the reset before tearing down
+        this_thread::sleep_for(milliseconds(200));
+        vector<uint64_t> perShard = server.getAcceptedPerShard();
+        server.stop();
+        serverThread.join();
+
+        string distribution;
+        for (uint64_t n : perShard) {
+            distribution += (distribution.empty() ? "" : " / ") + to_string(n);
+        }
+
+        report << left << setw(10) << shards
+               << fixed << setprecision(0)
+               << setw(16) << (connected / elapsed)
+               << setw(10) << failed.load()
+               << distribution << endl;
+    }
+    report << string(60, '-') << "\n";
+
+    rmdir(dirTemplate);
+    return 0;
+}
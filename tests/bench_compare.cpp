@@ -0,0 +1,565 @@
+/**
+ * Benchmark Comparator - regression gate for transfer_bench results
+ *
+ * Compares transfer_bench JSON from the current build against a stored
+ * baseline and exits non-zero when GET/PUT throughput or p99 latency got
+ * worse by more than a threshold.
+ *
+ * Both sides can hold several repetitions (a file is either one
+ * transfer_bench document or a JSON array of them). Each metric is
+ * compared by its mean with a 95% confidence interval for the change
+ * (Welch's t), and a cell only counts as regressed when the change is
+ * past the threshold and the interval excludes zero, so ordinary run to
+ * run noise does not fail the gate. With a single run on either side
+ * only the threshold applies.
+ *
+ * Without a CURRENT file, transfer_bench (next to this executable, or
+ * --bench) is run --runs times; it starts its own in-process server, so
+ * nothing outside this machine is involved. Arguments after "--" are
+ * passed to it. --save stores those runs as the new baseline instead of
+ * comparing.
+ *
+ * Exit status: 0 no regression, 1 regression, 2 usage or I/O error.
+ *
+ * Usage: ./bench_compare [options] BASELINE [CURRENT] [-- transfer_bench args]
+ *   --runs N                 Repetitions when running the bench (default 5)
+ *   --threshold PCT          Allowed throughput drop (default 5)
+ *   --latency-threshold PCT  Allowed p99 increase (default 10)
+ *   --ops LIST               Operations that gate (default GET,PUT)
+ *   --bench PATH             transfer_bench executable
+ *   --save                   Write the runs to BASELINE and exit
+ * Example: ./bench_compare --save baseline.json -- --sizes 64K,1M --seconds 1
+ *          ./bench_compare baseline.json -- --sizes 64K,1M --seconds 1
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// Just enough JSON for benchmark documents
+struct Json {
+    enum Type { Null, Bool, Number, String, Array, Object };
+    Type type = Null;
+    double number = 0.0;
+    string text;
+    vector<Json> items;
+    vector<pair<string, Json>> members;
+
+    const Json* get(const string& key) const {
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const string& text) : text_(text), pos_(0) {
+    }
+
+    bool parse(Json& out) {
+        if (!value(out)) {
+            return false;
+        }
+        skipSpace();
+        return pos_ == text_.size();
+    }
+
+private:
+    void skipSpace() {
+        while (pos_ < text_.size() && isspace(static_cast<unsigned char>(text_[pos_]))) {
+            pos_++;
+        }
+    }
+
+    bool literal(const char* word) {
+        size_t len = strlen(word);
+        if (text_.compare(pos_, len, word) != 0) {
+            return false;
+        }
+        pos_ += len;
+        return true;
+    }
+
+    bool string_(string& out) {
+        if (text_[pos_] != '"') {
+            return false;
+        }
+        pos_++;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) {
+                pos_++;
+                char c = text_[pos_];
+                out += c == 'n' ? '\n' : c == 't' ? '\t' : c;
+            } else {
+                out += text_[pos_];
+            }
+            pos_++;
+        }
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+        pos_++;
+        return true;
+    }
+
+    bool value(Json& out) {
+        skipSpace();
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+        char c = text_[pos_];
+        if (c == '{') {
+            out.type = Json::Object;
+            pos_++;
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                pos_++;
+                return true;
+            }
+            while (true) {
+                skipSpace();
+                string key;
+                Json member;
+                if (pos_ >= text_.size() || !string_(key)) {
+                    return false;
+                }
+                skipSpace();
+                if (pos_ >= text_.size() || text_[pos_++] != ':' || !value(member)) {
+                    return false;
+                }
+                out.members.emplace_back(key, move(member));
+                skipSpace();
+                if (pos_ < text_.size() && text_[pos_] == ',') {
+                    pos_++;
+                } else if (pos_ < text_.size() && text_[pos_] == '}') {
+                    pos_++;
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+        }
+        if (c == '[') {
+            out.type = Json::Array;
+            pos_++;
+            skipSpace();
+            if (pos_ < text_.size() && text_[pos_] == ']') {
+                pos_++;
+                return true;
+            }
+            while (true) {
+                Json item;
+                if (!value(item)) {
+                    return false;
+                }
+                out.items.push_back(move(item));
+                skipSpace();
+                if (pos_ < text_.size() && text_[pos_] == ',') {
+                    pos_++;
+                } else if (pos_ < text_.size() && text_[pos_] == ']') {
+                    pos_++;
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+        }
+        if (c == '"') {
+            out.type = Json::String;
+            return string_(out.text);
+        }
+        if (literal("null")) {
+            out.type = Json::Null;
+            return true;
+        }
+        if (literal("true") || literal("false")) {
+            out.type = Json::Bool;
+            out.number = text_[pos_ - 2] == 'u' ? 1.0 : 0.0;
+            return true;
+        }
+        const char* start = text_.c_str() + pos_;
+        char* end = nullptr;
+        out.type = Json::Number;
+        out.number = strtod(start, &end);
+        if (end == start) {
+            return false;
+        }
+        pos_ += end - start;
+        return true;
+    }
+
+    const string& text_;
+    size_t pos_;
+};
+
+struct Sample {
+    vector<double> opsPerSec;
+    vector<double> p99Us;
+};
+
+struct CellKey {
+    string op;
+    uint64_t size;
+    int concurrency;
+
+    bool operator<(const CellKey& other) const {
+        return tie(op, size, concurrency) < tie(other.op, other.size, other.concurrency);
+    }
+
+    string label() const {
+        string sizeText = size == 0 ? "-" : size % (1024 * 1024) == 0 ? to_string(size / (1024 * 1024)) + "M"
+                                          : size % 1024 == 0        ? to_string(size / 1024) + "K"
+                                                                    : to_string(size);
+        return op + " " + sizeText + " x" + to_string(concurrency);
+    }
+};
+
+typedef map<CellKey, Sample> Samples;
+
+// Adds one transfer_bench document (or an array of them) to samples
+static bool collect(const Json& doc, Samples& samples, int& runs) {
+    if (doc.type == Json::Array) {
+        for (const Json& item : doc.items) {
+            if (!collect(item, samples, runs)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const Json* name = doc.get("benchmark");
+    const Json* results = doc.get("results");
+    if (!name || name->text != "transfer_bench" || !results || results->type != Json::Array) {
+        return false;
+    }
+    for (const Json& row : results->items) {
+        const Json* op = row.get("op");
+        const Json* size = row.get("size");
+        const Json* concurrency = row.get("concurrency");
+        const Json* opsPerSec = row.get("ops_per_sec");
+        const Json* p99 = row.get("p99_us");
+        const Json* errors = row.get("errors");
+        if (!op || !size || !concurrency || !opsPerSec || !p99) {
+            return false;
+        }
+        if (errors && errors->number > 0) {
+            continue; // A cell with errors did not measure the normal path
+        }
+        Sample& sample = samples[{op->text, static_cast<uint64_t>(size->number), static_cast<int>(concurrency->number)}];
+        sample.opsPerSec.push_back(opsPerSec->number);
+        sample.p99Us.push_back(p99->number);
+    }
+    runs++;
+    return true;
+}
+
+static bool readFile(const string& path, string& text) {
+    ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    stringstream buffer;
+    buffer << in.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+static bool load(const string& path, Samples& samples, int& runs, string& raw) {
+    Json doc;
+    if (!readFile(path, raw) || !JsonParser(raw).parse(doc) || !collect(doc, samples, runs)) {
+        cerr << "Error: " << path << " is not transfer_bench JSON\n";
+        return false;
+    }
+    return true;
+}
+
+static string shellQuote(const string& arg) {
+    string quoted = "'";
+    for (char c : arg) {
+        quoted += c == '\'' ? string("'\\''") : string(1, c);
+    }
+    return quoted + "'";
+}
+
+// Runs the bench once; its stdout is the JSON document
+static bool runBench(const string& command, string& output) {
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    output.clear();
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, n);
+    }
+    int status = pclose(pipe);
+    return status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double mean(const vector<double>& v) {
+    double sum = 0.0;
+    for (double x : v) {
+        sum += x;
+    }
+    return sum / v.size();
+}
+
+static double variance(const vector<double>& v) {
+    if (v.size() < 2) {
+        return 0.0;
+    }
+    double m = mean(v);
+    double sum = 0.0;
+    for (double x : v) {
+        sum += (x - m) * (x - m);
+    }
+    return sum / (v.size() - 1);
+}
+
+// Two-sided 95% Student t quantile
+static double tQuantile(double df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086};
+    if (df < 1) {
+        return table[0];
+    }
+    if (df <= 20) {
+        return table[static_cast<int>(df) - 1];
+    }
+    return df <= 30 ? 2.042 : 1.960;
+}
+
+struct Comparison {
+    double baseline = 0.0;
+    double current = 0.0;
+    double changePct = 0.0;   // Current against baseline
+    double marginPct = -1.0;  // 95% CI half-width of the change, -1 without variance
+    bool regressed = false;
+};
+
+// higherIsBetter: throughput; otherwise latency
+static Comparison compare(const vector<double>& base, const vector<double>& cur, double thresholdPct,
+                          bool higherIsBetter) {
+    Comparison c;
+    c.baseline = mean(base);
+    c.current = mean(cur);
+    if (c.baseline <= 0.0) {
+        return c;
+    }
+    c.changePct = (c.current - c.baseline) / c.baseline * 100.0;
+    double worse = higherIsBetter ? -c.changePct : c.changePct;
+
+    bool significant = true;
+    if (base.size() >= 2 && cur.size() >= 2) {
+        double vb = variance(base) / base.size();
+        double vc = variance(cur) / cur.size();
+        double se = sqrt(vb + vc);
+        if (se > 0.0) {
+            double df = (vb + vc) * (vb + vc) /
+                        (vb * vb / (base.size() - 1) + vc * vc / (cur.size() - 1));
+            c.marginPct = tQuantile(df) * se / c.baseline * 100.0;
+            significant = fabs(c.changePct) > c.marginPct;
+        } else {
+            c.marginPct = 0.0;
+        }
+    }
+    c.regressed = worse > thresholdPct && significant;
+    return c;
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [options] BASELINE [CURRENT] [-- transfer_bench args]\n"
+         << "  --runs N                 Repetitions when running the bench (default 5)\n"
+         << "  --threshold PCT          Allowed throughput drop (default 5)\n"
+         << "  --latency-threshold PCT  Allowed p99 increase (default 10)\n"
+         << "  --ops LIST               Operations that gate (default GET,PUT)\n"
+         << "  --bench PATH             transfer_bench executable\n"
+         << "  --save                   Write the runs to BASELINE and exit\n";
+}
+
+int main(int argc, char* argv[]) {
+    int repetitions = 5;
+    double threshold = 5.0;
+    double latencyThreshold = 10.0;
+    set<string> gated = {"GET", "PUT"};
+    string bench;
+    bool save = false;
+    vector<string> files;
+    vector<string> benchArgs;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--") {
+            benchArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "--save") {
+            save = true;
+        } else if (arg.compare(0, 2, "--") == 0 && i + 1 < argc) {
+            string value = argv[++i];
+            if (arg == "--runs") {
+                repetitions = atoi(value.c_str());
+            } else if (arg == "--threshold") {
+                threshold = atof(value.c_str());
+            } else if (arg == "--latency-threshold") {
+                latencyThreshold = atof(value.c_str());
+            } else if (arg == "--ops") {
+                gated.clear();
+                stringstream list(value);
+                string op;
+                while (getline(list, op, ',')) {
+                    gated.insert(op);
+                }
+            } else if (arg == "--bench") {
+                bench = value;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg.compare(0, 2, "--") != 0) {
+            files.push_back(arg);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (files.empty() || files.size() > 2 || repetitions < 1 || threshold < 0 || latencyThreshold < 0 ||
+        (save && files.size() != 1)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Samples baseline;
+    Samples current;
+    int baselineRuns = 0;
+    int currentRuns = 0;
+    string raw;
+
+    if (files.size() == 2) {
+        if (!load(files[1], current, currentRuns, raw)) {
+            return 2;
+        }
+    } else {
+        if (bench.empty()) {
+            char self[PATH_MAX];
+            ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+            string dir = len > 0 ? string(self, len) : string(argv[0]);
+            bench = dir.substr(0, dir.rfind('/') + 1) + "transfer_bench";
+        }
+        string command = shellQuote(bench);
+        for (const string& arg : benchArgs) {
+            command += " " + shellQuote(arg);
+        }
+        string runs = "[\n";
+        for (int r = 1; r <= repetitions; ++r) {
+            cout << "[Compare] Run " << r << "/" << repetitions << ": " << command << endl;
+            string output;
+            Json doc;
+            if (!runBench(command, output) || !JsonParser(output).parse(doc) || !collect(doc, current, currentRuns)) {
+                cerr << "Error: " << bench << " failed or did not print transfer_bench JSON\n";
+                return 2;
+            }
+            runs += output + (r < repetitions ? ",\n" : "");
+        }
+        runs += "]\n";
+
+        if (save) {
+            ofstream out(files[0]);
+            out << runs;
+            if (!out.good()) {
+                cerr << "Error: Cannot write " << files[0] << "\n";
+                return 2;
+            }
+            cout << "[Compare] Baseline of " << repetitions << " runs saved to " << files[0] << "\n";
+            return 0;
+        }
+    }
+    if (!load(files[0], baseline, baselineRuns, raw)) {
+        return 2;
+    }
+
+    cout << "\nBaseline: " << baselineRuns << " run(s), current: " << currentRuns << " run(s); "
+         << "gate: throughput -" << threshold << "%, p99 +" << latencyThreshold << "%\n";
+    if (baselineRuns < 2 || currentRuns < 2) {
+        cout << "Fewer than 2 runs on a side: no confidence interval, threshold only\n";
+    }
+    cout << string(100, '-') << "\n";
+    cout << left << setw(18) << "Cell" << setw(10) << "Metric" << setw(14) << "Baseline" << setw(14) << "Current"
+         << setw(12) << "Change" << setw(12) << "95% CI" << "Verdict\n";
+    cout << string(100, '-') << "\n";
+
+    int regressions = 0;
+    int missing = 0;
+    for (const auto& entry : baseline) {
+        const CellKey& key = entry.first;
+        auto found = current.find(key);
+        if (found == current.end()) {
+            if (gated.count(key.op)) {
+                cout << left << setw(18) << key.label() << "missing from the current results\n";
+                missing++;
+            }
+            continue;
+        }
+        bool gate = gated.count(key.op) > 0;
+        struct {
+            const char* name;
+            const vector<double>& base;
+            const vector<double>& cur;
+            double threshold;
+            bool higherIsBetter;
+        } metrics[] = {
+            {"ops/s", entry.second.opsPerSec, found->second.opsPerSec, threshold, true},
+            {"p99 us", entry.second.p99Us, found->second.p99Us, latencyThreshold, false},
+        };
+        for (const auto& metric : metrics) {
+            Comparison c = compare(metric.base, metric.cur, metric.threshold, metric.higherIsBetter);
+            double better = metric.higherIsBetter ? c.changePct : -c.changePct;
+            bool improved = better > metric.threshold && fabs(c.changePct) > c.marginPct;
+            const char* verdict = !gate ? "(not gated)" : c.regressed ? "REGRESSED" : improved ? "improved" : "ok";
+            regressions += gate && c.regressed ? 1 : 0;
+
+            ostringstream change;
+            change << showpos << fixed << setprecision(1) << c.changePct << "%";
+            ostringstream margin;
+            if (c.marginPct >= 0.0) {
+                margin << "+/-" << fixed << setprecision(1) << c.marginPct << "%";
+            } else {
+                margin << "-";
+            }
+            cout << left << setw(18) << key.label() << setw(10) << metric.name << fixed << setprecision(1)
+                 << setw(14) << c.baseline << setw(14) << c.current << setw(12) << change.str() << setw(12)
+                 << margin.str() << verdict << "\n";
+        }
+    }
+    cout << string(100, '-') << "\n";
+
+    if (regressions > 0 || missing > 0) {
+        cout << "FAIL: " << regressions << " regressed metric(s)";
+        if (missing > 0) {
+            cout << ", " << missing << " missing cell(s)";
+        }
+        cout << endl;
+        return 1;
+    }
+    cout << "PASS: no regression past the thresholds" << endl;
+    return 0;
+}
@@ -0,0 +1,312 @@
+/**
+ * Cache and History Test - pass/fail checks for FileCache and RequestHistory
+ *
+ * Exercises the two data structures directly, without a server:
+ *   - FileCache (S3-FIFO): a key evicted from the small queue and inserted
+ *     again goes to the main queue, a one-off scan cycles through the small
+ *     queue without flushing the hot set, and a changed inode, size or mtime
+ *     turns a hit into a miss,
+ *   - RequestHistory: the ring keeps the newest records in order while the
+ *     per-operation aggregates cover every request, and a spill log reads
+ *     back what was recorded (an older format version is refused).
+ *
+ * Prints one line per check and exits nonzero if any of them fails.
+ *
+ * Usage: ./cache_history_test
+ */
+
+#include "../include/core/Server/file_cache.h"
+#include "../include/core/Client/request_history.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    cout << "  " << (ok ? "ok      " : "FAILED  ") << what << "\n";
+    if (!ok) {
+        failures++;
+    }
+}
+
+static struct stat fakeStat(ino_t inode, off_t size, time_t mtime) {
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_ino = inode;
+    st.st_size = size;
+    st.st_mtim.tv_sec = mtime;
+    return st;
+}
+
+// A cached file of `size` bytes whose stat() says the same
+struct FakeFile {
+    string path;
+    struct stat st;
+    FileCache::Buffer data;
+
+    FakeFile(const string& name, ino_t inode, size_t size)
+        : path("/shared/" + name),
+          st(fakeStat(inode, static_cast<off_t>(size), 1000)),
+          data(make_shared<const string>(size, static_cast<char>('a' + inode % 26))) {
+    }
+};
+
+static vector<FakeFile> makeFiles(const string& prefix, ino_t firstInode, size_t count, size_t size) {
+    vector<FakeFile> files;
+    for (size_t i = 0; i < count; ++i) {
+        files.emplace_back(prefix + to_string(i), firstInode + i, size);
+    }
+    return files;
+}
+
+static void testGhostPromotion() {
+    cout << "FileCache: ghost hit promotion\n";
+
+    // 10 KB budget, so the small queue gets 1 KB: one of these files
+    const size_t KB = 1024;
+    FileCache cache(10 * KB, 4 * KB);
+
+    // The 11th insert overflows with an empty main queue: f0 leaves the
+    // small queue unread and becomes a ghost
+    vector<FakeFile> files = makeFiles("f", 100, 11, KB);
+    for (auto& file : files) {
+        cache.insert(file.path, file.st, file.data);
+    }
+    check(cache.lookup(files[0].path, files[0].st) == nullptr, "unread file at the small queue's tail is evicted");
+    check(cache.ghostCount() == 1, "evicted file is remembered as a ghost");
+
+    // Coming back while a ghost skips probation; the overflow it causes
+    // evicts the next unread small entry instead
+    cache.insert(files[0].path, files[0].st, files[0].data);
+    check(cache.ghostCount() == 1, "ghost hit drops the ghost and the overflow adds the next one");
+    check(cache.lookup(files[1].path, files[1].st) == nullptr, "next unread small entry is evicted instead");
+
+    // A file in the main queue outlives many small queue turnovers; had it
+    // gone back to probation, nine more inserts would push it out
+    vector<FakeFile> scan = makeFiles("s", 200, 30, KB);
+    for (auto& file : scan) {
+        cache.insert(file.path, file.st, file.data);
+    }
+    check(cache.lookup(files[0].path, files[0].st) != nullptr, "promoted file survives 30 later inserts");
+    check(cache.sizeBytes() <= cache.capacityBytes(), "cache stays within its byte budget");
+}
+
+static void testGhostRehit() {
+    cout << "FileCache: ghost bookkeeping after a ghost hit\n";
+
+    const size_t KB = 1024;
+    FileCache cache(10 * KB, 4 * KB);
+    FakeFile key("key", 1, KB);
+    int next = 10;
+    auto evictOne = [&]() {
+        FakeFile filler("filler" + to_string(next), next, KB);
+        next++;
+        cache.insert(filler.path, filler.st, filler.data);
+    };
+
+    // Make the key a ghost, hit it, then make it a ghost again from the
+    // small queue; the first ghosting must leave nothing behind
+    cache.insert(key.path, key.st, key.data);
+    for (int i = 0; i < 10; ++i) {
+        evictOne();
+    }
+    cache.insert(key.path, key.st, key.data);
+    cache.invalidate(key.path);
+    cache.insert(key.path, key.st, key.data);
+    for (int i = 0; i < 10; ++i) {
+        evictOne();
+    }
+    check(cache.lookup(key.path, key.st) == nullptr, "key is evicted from the small queue a second time");
+
+    // Fill the ghost list to its limit; the key is not the oldest ghost,
+    // so it must still be remembered
+    while (cache.ghostCount() < 64) {
+        evictOne();
+    }
+    cache.insert(key.path, key.st, key.data);
+    for (int i = 0; i < 20; ++i) {
+        evictOne();
+    }
+    check(cache.lookup(key.path, key.st) != nullptr, "key is still a ghost and goes to the main queue");
+    check(cache.ghostCount() <= 64, "ghost count stays at its limit");
+}
+
+static void testScanResistance() {
+    cout << "FileCache: eviction order under a scan\n";
+
+    const size_t KB = 1024;
+    FileCache cache(10 * KB, 4 * KB);
+
+    // A hot set that is read again while on probation...
+    vector<FakeFile> hot = makeFiles("hot", 1000, 5, KB);
+    for (auto& file : hot) {
+        cache.insert(file.path, file.st, file.data);
+    }
+    for (auto& file : hot) {
+        cache.lookup(file.path, file.st);
+    }
+
+    // ...then a one-off scan over twenty times the budget
+    vector<FakeFile> scan = makeFiles("scan", 2000, 200, KB);
+    for (auto& file : scan) {
+        cache.insert(file.path, file.st, file.data);
+    }
+
+    bool hotKept = true;
+    for (auto& file : hot) {
+        hotKept = cache.lookup(file.path, file.st) != nullptr && hotKept;
+    }
+    check(hotKept, "every hot file survives the scan");
+    check(cache.lookup(scan[0].path, scan[0].st) == nullptr, "oldest scanned file is evicted first");
+    check(cache.lookup(scan.back().path, scan.back().st) != nullptr, "newest scanned file is still cached");
+    check(cache.entryCount() == 10 && cache.sizeBytes() == 10 * KB, "cache is full but within budget");
+}
+
+static void testInvalidation() {
+    cout << "FileCache: invalidation on change\n";
+
+    FileCache cache(64 * 1024, 4 * 1024);
+    FakeFile file("data.bin", 42, 100);
+
+    cache.insert(file.path, file.st, file.data);
+    FileCache::Buffer held = cache.lookup(file.path, file.st);
+    check(held && *held == *file.data, "unchanged file is served from the cache");
+
+    struct stat newer = file.st;
+    newer.st_mtim.tv_nsec += 1;
+    check(cache.lookup(file.path, newer) == nullptr, "mtime change is a miss");
+    check(cache.entryCount() == 0, "stale entry is dropped");
+    check(cache.lookup(file.path, file.st) == nullptr, "dropped entry is not served for the old stat either");
+    check(held && *held == *file.data, "buffer handed out earlier stays valid");
+
+    cache.insert(file.path, file.st, file.data);
+    struct stat resized = file.st;
+    resized.st_size += 1;
+    check(cache.lookup(file.path, resized) == nullptr, "size change is a miss");
+
+    cache.insert(file.path, file.st, file.data);
+    struct stat replaced = file.st;
+    replaced.st_ino += 1;
+    check(cache.lookup(file.path, replaced) == nullptr, "inode change (file replaced) is a miss");
+
+    cache.insert(file.path, file.st, file.data);
+    cache.invalidate(file.path);
+    check(cache.lookup(file.path, file.st) == nullptr, "invalidate() drops the entry");
+
+    // Same name in another directory is a different file
+    FakeFile other("data.bin", 43, 100);
+    other.path = "/elsewhere/data.bin";
+    cache.insert(file.path, file.st, file.data);
+    check(cache.lookup(other.path, other.st) == nullptr, "keys are full paths, not bare names");
+}
+
+static void testHistoryRing() {
+    cout << "RequestHistory: ring wraparound and aggregates\n";
+
+    RequestHistory history(4);
+    for (int i = 0; i < 10; ++i) {
+        bool success = (i % 2 == 0);
+        history.emplace_back("GET", "file" + to_string(i), success, success ? 1000 : 0, 1.0 + i,
+                             success ? "" : "Connection reset");
+    }
+    history.emplace_back("PUT", "upload", true, 500, 2.0);
+
+    check(history.size() == 4 && history.capacity() == 4, "ring holds capacity() records");
+    check(history.totalRecorded() == 11, "totalRecorded() counts every request");
+
+    vector<RequestRecord> records = history.recent();
+    bool ordered = records.size() == 4 && string(records[0].filename) == "file7" &&
+                   string(records[1].filename) == "file8" && string(records[2].filename) == "file9" &&
+                   string(records[3].filename) == "upload";
+    check(ordered, "recent() returns the newest records, oldest first");
+
+    records = history.recent(2);
+    check(records.size() == 2 && string(records[0].filename) == "file9" && records[1].operation() == "PUT",
+          "recent(n) returns the last n records");
+    check(!history.recent(4)[2].success && history.recent(4)[2].errorMessage() == "Connection reset",
+          "failed record keeps its error message");
+
+    RequestStats get = history.statsFor("GET");
+    check(get.count == 10 && get.failures == 5 && get.bytes == 5000, "GET aggregates cover overwritten records");
+    check(get.min_duration_ms == 1.0 && get.max_duration_ms == 10.0, "GET latency range covers every request");
+    RequestStats put = history.statsFor("PUT");
+    check(put.count == 1 && put.failures == 0 && put.bytes == 500, "PUT aggregates are kept apart");
+    check(history.statsFor("LIST").count == 0, "an operation never recorded has empty aggregates");
+
+    history.setCapacity(2);
+    records = history.recent();
+    check(records.size() == 2 && string(records[0].filename) == "file9", "shrinking keeps the newest records");
+    check(history.statsFor("GET").count == 10, "shrinking keeps the aggregates");
+}
+
+static void testSpill() {
+    cout << "RequestHistory: spill file round trip\n";
+
+    string path = "/tmp/cache_history_test_" + to_string(getpid()) + ".log";
+    remove(path.c_str());
+
+    RequestHistory history(8);
+    check(history.enableSpill(path), "spill to a new file");
+    history.emplace_back("GET", "a.txt", true, 1234, 5.5);
+    history.emplace_back("PUT", "b.txt", false, 0, 7.25, "Disk full");
+    history.disableSpill();
+
+    // Appending to a log of the same version continues it
+    check(history.enableSpill(path), "append to an existing log");
+    history.emplace_back("LIST", "", true, 0, 1.0);
+    history.disableSpill();
+    history.emplace_back("GET", "not-spilled.txt", true, 1, 1.0);
+
+    vector<RequestRecord> records;
+    check(RequestHistory::readSpill(path, records), "read the log back");
+    bool same = records.size() == 3 && records[0].operation() == "GET" && string(records[0].filename) == "a.txt" &&
+                records[0].bytes_transferred == 1234 && records[0].success && records[0].duration_ms == 5.5f &&
+                records[1].operation() == "PUT" && !records[1].success && records[1].errorMessage() == "Disk full" &&
+                records[2].operation() == "LIST" && records[2].filename[0] == '\0';
+    check(same, "log holds exactly the spilled records, fields intact");
+
+    // A cut-off log reads back what precedes the damage and reports it
+    {
+        ifstream in(path, ios::binary);
+        string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(bytes.data(), static_cast<streamsize>(bytes.size() - 3));
+    }
+    records.clear();
+    check(!RequestHistory::readSpill(path, records) && records.size() == 2, "truncated log is reported as such");
+
+    // A log of the previous layout must not get new records mixed in
+    {
+        ofstream out(path, ios::binary | ios::trunc);
+        uint32_t version = 1;
+        out.write("FTRH", 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    check(!history.enableSpill(path) && !history.isSpilling(), "log of another format version is refused");
+    ifstream in(path, ios::binary | ios::ate);
+    check(in.tellg() == 8, "refused log is left untouched");
+
+    remove(path.c_str());
+}
+
+int main() {
+    // Keep library error logging (expected for the refused log) out of the report
+    cerr.rdbuf(nullptr);
+
+    testGhostPromotion();
+    testGhostRehit();
+    testScanResistance();
+    testInvalidation();
+    testHistoryRing();
+    testSpill();
+
+    cout << "\n" << (failures == 0 ? "PASSED" : "FAILED (" + to_string(failures) + " checks)") << "\n";
+    return failures == 0 ? 0 : 1;
+}
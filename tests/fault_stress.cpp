@@ -0,0 +1,466 @@
+/**
+ * Fault Stress - many concurrent transfers while socket and file calls fail
+ *
+ * Starts an in-process server and a pool of client threads that run
+ * thousands of GETs and PUTs of seeded contents (4 KB, 64 KB and 1 MB)
+ * against it. With fault injection compiled in (cmake
+ * -DFILETRANSFER_FAULT_INJECTION=ON), send/recv/sendmsg/recvmsg/sendfile
+ * and the server's file reads and writes return short counts, EINTR,
+ * EAGAIN and ECONNRESET at the rates given by --faults, on both ends.
+ * A client reconnects after every failed transfer.
+ *
+ * Transfers may fail; what must hold anyway:
+ *   - a GET that reports success has exactly the server's bytes, and one
+ *     that fails leaves no file behind,
+ *   - a PUT confirmed by a PING is stored exactly, and no PUT ever shows
+ *     up half-written or leaves a temporary upload file,
+ *   - once every session has closed, the process holds no more threads
+ *     and descriptors than before the clients started (descriptors the
+ *     server's file cache keeps on shared files aside).
+ *
+ * Before the load, GET and GET_FD (over the server's Unix socket) of
+ * "../<file>", an absolute path, "." and ".." must all come back as a
+ * missing file, size 0 and no descriptor.
+ *
+ * Without fault injection compiled in it runs the same load fault-free,
+ * and then every transfer must succeed.
+ *
+ * Usage: ./fault_stress [--clients 64] [--transfers 2000]
+ *                       [--faults short=0.05,eintr=0.02,eagain=0.002,reset=0.002,seed=1]
+ *                       [--dir DIR]
+ * Example: ./fault_stress --clients 128 --transfers 5000 --faults short=0.2,reset=0.01
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include "../include/core/fault_injection.h"
+#include "../include/core/Client/client_protocol.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static const size_t FILE_SIZES[] = {4 * 1024, 64 * 1024, 1024 * 1024};
+static const int FILES_PER_SIZE = 4;
+
+struct SourceFile {
+    string name;
+    size_t size;
+};
+
+struct PutRecord {
+    string name;
+    size_t size;
+    bool confirmed;
+};
+
+struct WorkerResult {
+    uint64_t gets = 0;
+    uint64_t getsOk = 0;
+    uint64_t puts = 0;
+    uint64_t putsOk = 0;
+    uint64_t connectFailures = 0;
+    vector<PutRecord> putRecords;
+    vector<string> problems;
+};
+
+// Contents follow from the name, so any copy can be checked on its own
+static string contentFor(const string& name, size_t size) {
+    uint64_t state = 1469598103934665603ULL;
+    for (char c : name) {
+        state = (state ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+    string data(size, '\0');
+    for (size_t i = 0; i < size; i += 8) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        memcpy(&data[i], &state, min<size_t>(8, size - i));
+    }
+    return data;
+}
+
+static bool writeContent(const string& path, const string& name, size_t size) {
+    ofstream out(path, ios::binary);
+    string data = contentFor(name, size);
+    out.write(data.data(), data.size());
+    return out.good();
+}
+
+static bool matchesContent(const string& path, const string& name, size_t size) {
+    ifstream in(path, ios::binary);
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return data == contentFor(name, size);
+}
+
+static size_t pickSize(mt19937& random) {
+    // Mostly small files, so thousands of transfers stay quick
+    unsigned roll = random() % 10;
+    return roll < 6 ? FILE_SIZES[0] : roll < 9 ? FILE_SIZES[1] : FILE_SIZES[2];
+}
+
+static void worker(int index, int transfers, uint16_t port, const vector<SourceFile>& files,
+                   const string& clientDir, WorkerResult& result) {
+    mt19937 random(index + 1);
+    string dir = clientDir + "/w" + to_string(index);
+    mkdir(dir.c_str(), 0755);
+
+    Client client;
+    client.setVerbose(false);
+    for (int i = 0; i < transfers; ++i) {
+        if (!client.isConnected() && !client.connect("127.0.0.1", port)) {
+            result.connectFailures++;
+            this_thread::sleep_for(milliseconds(10));
+            continue;
+        }
+
+        bool ok;
+        if (random() % 2 == 0) {
+            const SourceFile& file = files[random() % files.size()];
+            string local = dir + "/" + file.name;
+            result.gets++;
+            ok = client.getFile(file.name, dir);
+            if (ok) {
+                if (matchesContent(local, file.name, file.size)) {
+                    result.getsOk++;
+                } else {
+                    result.problems.push_back("GET " + file.name + " reported success with wrong content");
+                }
+            } else if (access(local.c_str(), F_OK) == 0) {
+                result.problems.push_back("GET " + file.name + " failed and left a partial file");
+            }
+            unlink(local.c_str());
+        } else {
+            size_t size = pickSize(random);
+            string name = "up_" + to_string(index) + "_" + to_string(i) + ".bin";
+            string local = dir + "/" + name;
+            writeContent(local, name, size);
+            result.puts++;
+            // The PONG comes back only after the server has handled the PUT
+            ok = client.putFile(local) && client.ping() > 0.0;
+            result.putRecords.push_back({name, size, ok});
+            if (ok) {
+                result.putsOk++;
+            }
+            unlink(local.c_str());
+        }
+
+        if (!ok) {
+            // The stream may have stopped mid-message; start over
+            client.disconnect();
+        }
+    }
+    client.disconnect();
+    rmdir(dir.c_str());
+}
+
+// A GET or GET_FD of a name that leads out of the shared directory must
+// look like a missing file: size 0 and no descriptor
+static void checkNamesStayInside(uint16_t port, const string& socketPath, const string& outsidePath,
+                                 vector<string>& problems) {
+    const string names[] = {"../" + outsidePath.substr(outsidePath.rfind('/') + 1), outsidePath, "..", "."};
+    for (const string& name : names) {
+        ClientSocket tcp;
+        uint64_t fileSize = 1;
+        if (tcp.connectToServer("127.0.0.1", port)) {
+            uint8_t cmd = CMD_GET;
+            char filenameBuf[256] = {0};
+            strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+            struct iovec iov[2] = {{&cmd, sizeof(cmd)}, {filenameBuf, sizeof(filenameBuf)}};
+            if (tcp.sendVectored(iov, 2) < 0 ||
+                tcp.receiveData(reinterpret_cast<uint8_t*>(&fileSize), sizeof(fileSize)) != sizeof(fileSize)) {
+                fileSize = 1;
+            }
+        }
+        if (fileSize != 0) {
+            problems.push_back("GET \"" + name + "\" was not refused with size 0");
+        }
+
+        ClientSocket local;
+        int fd = -1;
+        fileSize = 1;
+        if (local.connectUnix(socketPath)) {
+            ClientProtocol protocol(local);
+            fd = protocol.request_get_fd(name, fileSize);
+        }
+        if (fd >= 0 || fileSize != 0) {
+            problems.push_back("GET_FD \"" + name + "\" was not refused with size 0");
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+static int countThreads() {
+    int count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return -1;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+// Descriptors on files in the shared directory belong to the server's
+// descriptor cache, which keeps them open on purpose
+static int countDescriptors(const string& serverDir) {
+    int count = 0;
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return -1;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        string linkPath = string("/proc/self/fd/") + entry->d_name;
+        char target[512];
+        ssize_t len = readlink(linkPath.c_str(), target, sizeof(target) - 1);
+        if (len > 0) {
+            target[len] = '\0';
+            if (strncmp(target, serverDir.c_str(), serverDir.size()) == 0) {
+                continue;
+            }
+        }
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+static void removeTree(const string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            string name = entry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            string child = path + "/" + name;
+            struct stat st;
+            if (lstat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                removeTree(child);
+            } else {
+                unlink(child.c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path.c_str());
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [--clients 64] [--transfers 2000]\n"
+         << "       [--faults short=0.05,eintr=0.02,eagain=0.002,reset=0.002,seed=1] [--dir DIR]\n";
+}
+
+int main(int argc, char* argv[]) {
+    int clients = 64;
+    int transfers = 2000;
+    string faults = "short=0.05,eintr=0.02,eagain=0.002,reset=0.002,seed=1";
+    string baseDir = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--clients") {
+            clients = atoi(value.c_str());
+        } else if (arg == "--transfers") {
+            transfers = atoi(value.c_str());
+        } else if (arg == "--faults") {
+            faults = value;
+        } else if (arg == "--dir") {
+            baseDir = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    FaultInjector::Config config;
+    if (clients <= 0 || transfers <= 0 || !FaultInjector::parse(faults, config)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Every injected fault logs an error somewhere; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    string rootDir = baseDir + "/fault_stress_XXXXXX";
+    if (!mkdtemp(&rootDir[0])) {
+        report << "Error: Cannot create a directory in " << baseDir << "\n";
+        return 1;
+    }
+    string serverDir = rootDir + "/server";
+    string clientDir = rootDir + "/client";
+    mkdir(serverDir.c_str(), 0755);
+    mkdir(clientDir.c_str(), 0755);
+
+    vector<SourceFile> files;
+    for (size_t size : FILE_SIZES) {
+        for (int i = 0; i < FILES_PER_SIZE; ++i) {
+            SourceFile file{"src_" + to_string(size / 1024) + "k_" + to_string(i) + ".bin", size};
+            writeContent(serverDir + "/" + file.name, file.name, file.size);
+            files.push_back(file);
+        }
+    }
+
+    // Readable, but outside the shared directory
+    string outsidePath = rootDir + "/outside.bin";
+    writeContent(outsidePath, "outside.bin", 4096);
+    string socketPath = rootDir + "/server.sock";
+
+    Server server;
+    server.setVerbose(false);
+    server.setTimeout(0);
+    server.setUnixSocket(socketPath);
+    if (!server.start(0, serverDir)) {
+        report << "Error: Cannot start the server\n";
+        removeTree(rootDir);
+        return 1;
+    }
+    thread serverThread([&server]() { server.run(); });
+    this_thread::sleep_for(milliseconds(100));
+
+    vector<string> problems;
+    checkNamesStayInside(server.getPort(), socketPath, outsidePath, problems);
+    this_thread::sleep_for(milliseconds(100));
+
+    int threadsBefore = countThreads();
+    int fdsBefore = countDescriptors(serverDir);
+
+    bool injecting = FaultInjector::compiledIn();
+    if (injecting) {
+        FaultInjector::configure(config);
+        FaultInjector::resetCounts();
+    }
+
+    report << "Fault stress: " << clients << " clients, " << transfers << " transfers, files in " << baseDir << "\n";
+    if (injecting) {
+        report << "Faults: " << faults << "\n";
+    } else {
+        report << "Fault injection not compiled in (cmake -DFILETRANSFER_FAULT_INJECTION=ON); running fault-free\n";
+    }
+
+    auto start = steady_clock::now();
+    vector<WorkerResult> results(clients);
+    vector<thread> workers;
+    for (int i = 0; i < clients; ++i) {
+        int share = transfers / clients + (i < transfers % clients ? 1 : 0);
+        workers.emplace_back(worker, i, share, server.getPort(), cref(files), cref(clientDir), ref(results[i]));
+    }
+    for (thread& t : workers) {
+        t.join();
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    // Checks below must not be disturbed, and session teardown runs unfaulted
+    FaultInjector::Counts injected = FaultInjector::getCounts();
+    if (injecting) {
+        FaultInjector::configure(FaultInjector::Config());
+    }
+
+    // Sessions close on their own threads; give them time to finish
+    int threadsAfter = countThreads();
+    int fdsAfter = countDescriptors(serverDir);
+    auto deadline = steady_clock::now() + seconds(10);
+    while (steady_clock::now() < deadline &&
+           (server.getActiveSessionCount() > 0 || threadsAfter > threadsBefore || fdsAfter > fdsBefore)) {
+        this_thread::sleep_for(milliseconds(50));
+        threadsAfter = countThreads();
+        fdsAfter = countDescriptors(serverDir);
+    }
+
+    WorkerResult total;
+    for (const WorkerResult& result : results) {
+        total.gets += result.gets;
+        total.getsOk += result.getsOk;
+        total.puts += result.puts;
+        total.putsOk += result.putsOk;
+        total.connectFailures += result.connectFailures;
+        problems.insert(problems.end(), result.problems.begin(), result.problems.end());
+
+        for (const PutRecord& put : result.putRecords) {
+            string path = serverDir + "/" + put.name;
+            bool exists = access(path.c_str(), F_OK) == 0;
+            if (put.confirmed && !exists) {
+                problems.push_back("PUT " + put.name + " confirmed but not stored");
+            } else if (exists && !matchesContent(path, put.name, put.size)) {
+                problems.push_back("PUT " + put.name + " stored with wrong content" +
+                                   (put.confirmed ? "" : " (unconfirmed)"));
+            }
+        }
+    }
+
+    DIR* dir = opendir(serverDir.c_str());
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (strncmp(entry->d_name, UPLOAD_TEMP_PREFIX, strlen(UPLOAD_TEMP_PREFIX)) == 0) {
+                problems.push_back(string("Temporary upload left behind: ") + entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+
+    if (server.getActiveSessionCount() > 0) {
+        problems.push_back(to_string(server.getActiveSessionCount()) + " session(s) still open");
+    }
+    if (threadsAfter > threadsBefore) {
+        problems.push_back("Threads leaked: " + to_string(threadsBefore) + " before, " + to_string(threadsAfter) +
+                           " after");
+    }
+    if (fdsAfter > fdsBefore) {
+        problems.push_back("Descriptors leaked: " + to_string(fdsBefore) + " before, " + to_string(fdsAfter) +
+                           " after");
+    }
+    uint64_t failed = (total.gets - total.getsOk) + (total.puts - total.putsOk);
+    if (!injecting && (failed > 0 || total.connectFailures > 0)) {
+        problems.push_back(to_string(failed) + " transfer(s) failed without injected faults");
+    }
+
+    server.stop();
+    serverThread.join();
+    removeTree(rootDir);
+
+    report << "GET: " << total.getsOk << "/" << total.gets << " ok | PUT: " << total.putsOk << "/" << total.puts
+           << " ok | connect failures: " << total.connectFailures << " | " << elapsed << " s\n";
+    if (injecting) {
+        report << "Injected: " << injected.calls << " calls, " << injected.shortCounts << " short, " << injected.eintr
+               << " EINTR, " << injected.eagain << " EAGAIN, " << injected.resets << " resets\n";
+    }
+    report << "Threads: " << threadsBefore << " before, " << threadsAfter << " after | descriptors: " << fdsBefore
+           << " before, " << fdsAfter << " after\n";
+
+    if (!problems.empty()) {
+        report << "FAILED: " << problems.size() << " problem(s)\n";
+        for (size_t i = 0; i < problems.size() && i < 20; ++i) {
+            report << "  " << problems[i] << "\n";
+        }
+        return 1;
+    }
+    report << "PASSED\n";
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * Handoff Benchmark - connection failures across hot restarts
+ *
+ * Starts an in-process server with a hot restart control socket, keeps
+ * client threads doing connect + PING + disconnect in a loop, and
+ * replaces the server with a new instance several times (the new one
+ * inherits the listeners, the old one drains). For each restart it
+ * reports how long the takeover and the drain took and how many client
+ * cycles failed; then the same for a plain stop-and-rebind restart.
+ *
+ * Usage: ./handoff_bench [restarts] [client_threads]
+ * Example: ./handoff_bench 5 4
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static bool ping(ClientSocket& socket) {
+    uint8_t cmd = CMD_PING;
+    uint8_t reply = 0;
+    return socket.sendData(&cmd, sizeof(cmd)) == sizeof(cmd) &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+struct Load {
+    atomic<bool> done{false};
+    atomic<uint64_t> ok{0};
+    atomic<uint64_t> failed{0};
+    vector<thread> threads;
+
+    void start(int count, uint16_t port) {
+        for (int i = 0; i < count; ++i) {
+            threads.emplace_back([this, port]() {
+                while (!done) {
+                    ClientSocket client;
+                    bool success = client.connectToServer("127.0.0.1", port) && ping(client);
+                    client.disconnect();
+                    (success ? ok : failed)++;
+                }
+            });
+        }
+    }
+
+    void stop() {
+        done = true;
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+};
+
+struct Running {
+    unique_ptr<Server> server;
+    thread runner;
+};
+
+static Running launch(const string& dir, const string& controlPath, uint16_t port) {
+    Running running;
+    running.server = make_unique<Server>();
+    running.server->setHandoffSocket(controlPath);
+    running.server->setDrainTimeout(5);
+    if (running.server->start(port, dir)) {
+        Server* server = running.server.get();
+        running.runner = thread([server]() { server->run(); });
+    }
+    return running;
+}
+
+int main(int argc, char* argv[]) {
+    int restarts = (argc > 1) ? atoi(argv[1]) : 5;
+    int clients = (argc > 2) ? atoi(argv[2]) : 4;
+    if (restarts <= 0 || clients <= 0) {
+        cerr << "Usage: " << argv[0] << " [restarts] [client_threads]\n";
+        return 1;
+    }
+
+    // Client and server log every connection; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    char serverTemplate[] = "/tmp/handoff_bench_XXXXXX";
+    if (!mkdtemp(serverTemplate)) {
+        report << "Error: Cannot create temporary directory\n";
+        return 1;
+    }
+    string serverDir = serverTemplate;
+    string controlPath = serverDir + "/control.sock";
+
+    report << "Handoff benchmark: " << restarts << " restarts per mode, " << clients << " client threads\n";
+    report << string(66, '-') << "\n";
+    report << left << setw(10) << "Mode" << setw(10) << "Restart" << setw(16) << "Takeover ms"
+           << setw(14) << "Drain ms" << "Failed cycles" << "\n";
+    report << string(66, '-') << "\n";
+
+    bool allOk = true;
+    for (bool handoff : {true, false}) {
+        string mode = handoff ? "handoff" : "rebind";
+        Running current = launch(serverDir, handoff ? controlPath : "", 0);
+        if (!current.runner.joinable()) {
+            report << "Error: Cannot start server\n";
+            return 1;
+        }
+        uint16_t port = current.server->getPort();
+
+        Load load;
+        load.start(clients, port);
+        this_thread::sleep_for(milliseconds(200));
+
+        uint64_t totalFailed = 0;
+        for (int i = 1; i <= restarts; ++i) {
+            uint64_t failedBefore = load.failed;
+            auto start = steady_clock::now();
+            double takeoverMs = 0.0;
+            Running next;
+            if (handoff) {
+                next = launch(serverDir, controlPath, port);
+                takeoverMs = duration<double, milli>(steady_clock::now() - start).count();
+                current.runner.join();
+                current.server->stop(); // Waits for the drain
+            } else {
+                current.server->stop();
+                current.runner.join();
+                next = launch(serverDir, "", port);
+                takeoverMs = duration<double, milli>(steady_clock::now() - start).count();
+            }
+            double drainMs = duration<double, milli>(steady_clock::now() - start).count() - takeoverMs;
+            current.server.reset();
+            if (!next.runner.joinable()) {
+                report << left << setw(10) << mode << setw(10) << i << "cannot start\n";
+                allOk = false;
+                break;
+            }
+            current = move(next);
+
+            // Let cycles that straddled the switch finish before counting
+            this_thread::sleep_for(milliseconds(200));
+            uint64_t failed = load.failed - failedBefore;
+            totalFailed += failed;
+            report << left << setw(10) << mode << setw(10) << i << fixed << setprecision(2) << setw(16) << takeoverMs;
+            if (handoff) {
+                report << setw(14) << drainMs;
+            } else {
+                report << setw(14) << "-"; // The old server stops before the new one binds
+            }
+            report << failed << endl;
+        }
+
+        load.stop();
+        if (current.server) {
+            current.server->stop();
+            current.runner.join();
+        }
+        report << left << setw(10) << mode << "total: " << load.ok << " cycles, " << totalFailed << " failed" << endl;
+        if (handoff && totalFailed > 0) {
+            allOk = false;
+        }
+    }
+    report << string(66, '-') << "\n";
+
+    rmdir(serverDir.c_str());
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/**
+ * Link Relay - network impairment proxy for WAN benchmarks on one host
+ *
+ * Sits between a client and a server on this machine and makes the
+ * connection look like a WAN path (e.g. a Tailscale link): added round
+ * trip time with jitter, a bandwidth bottleneck with a bounded queue, and
+ * connections reset at random. Needs neither root nor netem; it is a
+ * userspace relay (LinkEmulator), see link_emulator.h for what that
+ * means for the endpoints' TCP_INFO.
+ *
+ * Every stats interval it prints the connections relayed, throughput and
+ * resets so far. Runs until Ctrl+C or for --seconds.
+ *
+ * Usage: ./link_relay <listen_port> <server_ip> <server_port>
+ *                     [--rtt MS] [--jitter MS] [--bandwidth MBPS] [--queue BYTES]
+ *                     [--reset-every BYTES] [--seed N] [--stats SECONDS] [--seconds S]
+ * Example: ./link_relay 9100 127.0.0.1 9000 --rtt 40 --jitter 5 --bandwidth 50
+ *          ./load_generator --server 127.0.0.1:9100 --rates 50,100,200
+ */
+
+#include "../include/core/link_emulator.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <signal.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static atomic<bool> keepRunning(true);
+
+static void signalHandler(int) {
+    keepRunning = false;
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " <listen_port> <server_ip> <server_port>\n"
+         << "       [--rtt MS] [--jitter MS] [--bandwidth MBPS] [--queue BYTES]\n"
+         << "       [--reset-every BYTES] [--seed N] [--stats SECONDS] [--seconds S]\n"
+         << "Example: " << program << " 9100 127.0.0.1 9000 --rtt 40 --jitter 5 --bandwidth 50\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int listenPort = atoi(argv[1]);
+    string serverIp = argv[2];
+    int serverPort = atoi(argv[3]);
+    LinkConditions conditions;
+    double statsSeconds = 5.0;
+    double seconds = 0.0; // 0 = until Ctrl+C
+
+    for (int i = 4; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--rtt") {
+            conditions.rttMs = atof(value.c_str());
+        } else if (arg == "--jitter") {
+            conditions.jitterMs = atof(value.c_str());
+        } else if (arg == "--bandwidth") {
+            conditions.bandwidthMbps = atof(value.c_str());
+        } else if (arg == "--queue") {
+            conditions.queueBytes = strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--reset-every") {
+            conditions.resetMeanBytes = strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--seed") {
+            conditions.seed = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--stats") {
+            statsSeconds = atof(value.c_str());
+        } else if (arg == "--seconds") {
+            seconds = atof(value.c_str());
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (listenPort < 0 || listenPort > 65535 || serverPort <= 0 || serverPort > 65535 || conditions.rttMs < 0 ||
+        conditions.jitterMs < 0 || conditions.bandwidthMbps < 0 || statsSeconds <= 0 || seconds < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    LinkEmulator relay;
+    if (!relay.start(serverIp, static_cast<uint16_t>(serverPort), conditions, static_cast<uint16_t>(listenPort))) {
+        return 1;
+    }
+    cout << "[Relay] Clients connect to 127.0.0.1:" << relay.getPort() << ", press Ctrl+C to stop" << endl;
+
+    auto start = steady_clock::now();
+    auto nextStats = start + duration_cast<steady_clock::duration>(duration<double>(statsSeconds));
+    uint64_t lastBytes = 0;
+    auto lastTime = start;
+    while (keepRunning) {
+        this_thread::sleep_for(milliseconds(100));
+        auto now = steady_clock::now();
+        bool finished = seconds > 0 && duration<double>(now - start).count() >= seconds;
+        if (now < nextStats && !finished) {
+            continue;
+        }
+
+        uint64_t bytes = relay.getBytesRelayed();
+        double interval = duration<double>(now - lastTime).count();
+        cout << "[Relay] " << fixed << setprecision(1) << duration<double>(now - start).count() << "s"
+             << " | connections: " << relay.getConnectionCount()
+             << " | relayed: " << setprecision(2) << (bytes / (1024.0 * 1024.0)) << " MB"
+             << " (" << ((bytes - lastBytes) / (1024.0 * 1024.0) / interval) << " MB/s)"
+             << " | resets: " << relay.getResetCount() << endl;
+        lastBytes = bytes;
+        lastTime = now;
+        nextStats = now + duration_cast<steady_clock::duration>(duration<double>(statsSeconds));
+        if (finished) {
+            break;
+        }
+    }
+
+    relay.stop();
+    cout << "[Relay] Stopped after " << relay.getConnectionCount() << " connection(s), "
+         << relay.getResetCount() << " reset(s)" << endl;
+    return 0;
+}
@@ -0,0 +1,587 @@
+/**
+ * Load Generator - open-loop request schedule with latency histograms
+ *
+ * Unlike concurrent_client_test (closed loop: the next request waits for
+ * the previous one), requests here are issued on a fixed arrival schedule
+ * that does not slow down when the server does. Each connection follows
+ * its own schedule at rate/connections, Poisson or evenly spaced, and
+ * latency is measured from the intended send time. A request that has to
+ * wait for the one before it on the same connection therefore counts its
+ * queueing time as latency, so coordinated omission does not hide it.
+ *
+ * The offered rate is stepped through a list. Each step reports achieved
+ * throughput and percentiles from an HDR-style histogram; the sweep
+ * stops after the first step where the server cannot keep up (achieved
+ * below 90% of offered, or scheduled requests left unsent at the end).
+ *
+ * Operations and file sizes are picked per request from weighted mixes.
+ * The files for GET are uploaded first. Without --server an in-process
+ * server on an ephemeral port is used.
+ *
+ * Usage: ./load_generator [--server HOST:PORT] [--connections N]
+ *                         [--rates R1,R2,...] [--seconds S]
+ *                         [--arrival poisson|constant]
+ *                         [--mix GET:70,PUT:10,LIST:5,PING:15]
+ *                         [--sizes 4K:80,64K:15,1M:5] [--output FILE]
+ * Example: ./load_generator --connections 32 --rates 1000,2000,4000,8000
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/uio.h>
+
+using namespace std;
+using namespace std::chrono;
+
+// Log-linear histogram in the HdrHistogram layout: 2048 linear
+// sub-buckets, then each power of two split in 1024, so every recorded
+// value keeps 3 significant digits. Values are nanoseconds, up to ~137 s.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 11;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+    static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr int MAX_SHIFT = 26;
+
+    LatencyHistogram() : counts_((MAX_SHIFT + 2) * SUB_BUCKET_HALF, 0), total_(0), max_(0) {
+    }
+
+    void record(uint64_t value) {
+        counts_[indexOf(value)]++;
+        total_++;
+        max_ = std::max(max_, value);
+    }
+
+    void add(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const {
+        return total_;
+    }
+
+    uint64_t max() const {
+        return max_;
+    }
+
+    // Highest value equivalent to the bucket holding the given percentile
+    uint64_t percentile(double p) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(ceil(p / 100.0 * total_));
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                return std::min(highestEquivalent(i), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    static size_t indexOf(uint64_t value) {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        int shift = 63 - __builtin_clzll(value) - (SUB_BUCKET_BITS - 1);
+        if (shift > MAX_SHIFT) {
+            shift = MAX_SHIFT;
+            value = (SUB_BUCKET_COUNT << shift) - 1;
+        }
+        return static_cast<size_t>((shift + 1) * SUB_BUCKET_HALF + ((value >> shift) - SUB_BUCKET_HALF));
+    }
+
+    static uint64_t highestEquivalent(size_t index) {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        int shift = static_cast<int>(index / SUB_BUCKET_HALF) - 1;
+        uint64_t sub = index % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t max_;
+};
+
+template <typename T>
+struct Weighted {
+    T value;
+    double weight;
+};
+
+struct Step {
+    double offered = 0.0;
+    double achieved = 0.0;
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t unsent = 0;
+    LatencyHistogram latency;
+    bool saturated = false;
+};
+
+static bool parseSize(const string& text, size_t& size) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value <= 0) {
+        return false;
+    }
+    string unit(end);
+    if (unit == "K" || unit == "KB") {
+        value *= 1024;
+    } else if (unit == "M" || unit == "MB") {
+        value *= 1024 * 1024;
+    } else if (!unit.empty()) {
+        return false;
+    }
+    size = static_cast<size_t>(value);
+    return true;
+}
+
+static string formatSize(size_t size) {
+    if (size >= 1024 * 1024 && size % (1024 * 1024) == 0) {
+        return to_string(size / (1024 * 1024)) + "M";
+    }
+    if (size >= 1024 && size % 1024 == 0) {
+        return to_string(size / 1024) + "K";
+    }
+    return to_string(size);
+}
+
+static vector<string> splitList(const string& text) {
+    vector<string> items;
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// "NAME:WEIGHT,..." (a missing weight counts as 1)
+static bool parseWeights(const string& text, vector<Weighted<string>>& out) {
+    out.clear();
+    for (const string& item : splitList(text)) {
+        size_t colon = item.find(':');
+        double weight = colon == string::npos ? 1.0 : atof(item.c_str() + colon + 1);
+        if (weight <= 0) {
+            return false;
+        }
+        out.push_back({item.substr(0, colon), weight});
+    }
+    return !out.empty();
+}
+
+template <typename T>
+static const T& pick(const vector<Weighted<T>>& choices, mt19937_64& rng) {
+    double total = 0.0;
+    for (const auto& choice : choices) {
+        total += choice.weight;
+    }
+    double point = uniform_real_distribution<double>(0.0, total)(rng);
+    for (const auto& choice : choices) {
+        if (point < choice.weight) {
+            return choice.value;
+        }
+        point -= choice.weight;
+    }
+    return choices.back().value;
+}
+
+static bool sendCommand(ClientSocket& socket, uint8_t cmd, const string& name) {
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    struct iovec iov[2] = {{&cmd, sizeof(cmd)}, {filenameBuf, sizeof(filenameBuf)}};
+    return socket.sendVectored(iov, 2) >= 0;
+}
+
+static bool ping(ClientSocket& socket) {
+    uint8_t cmd = CMD_PING;
+    uint8_t reply = 0;
+    return socket.sendData(&cmd, sizeof(cmd)) == sizeof(cmd) &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+static bool get(ClientSocket& socket, const string& name, vector<uint8_t>& buf) {
+    if (!sendCommand(socket, CMD_GET, name)) {
+        return false;
+    }
+    uint64_t size = 0;
+    if (socket.receiveData(reinterpret_cast<uint8_t*>(&size), sizeof(size)) != sizeof(size) || size == 0) {
+        return false;
+    }
+    for (uint64_t received = 0; received < size;) {
+        size_t chunk = static_cast<size_t>(min<uint64_t>(buf.size(), size - received));
+        if (socket.receiveData(buf.data(), chunk) != static_cast<ssize_t>(chunk)) {
+            return false;
+        }
+        received += chunk;
+    }
+    return true;
+}
+
+static bool put(ClientSocket& socket, const string& name, const uint8_t* data, size_t size) {
+    uint8_t cmd = CMD_PUT;
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    uint64_t size64 = size;
+    uint8_t pingCmd = CMD_PING;
+    // PUT has no reply: a PING in the same write returns once it is stored
+    struct iovec iov[5] = {{&cmd, sizeof(cmd)},
+                           {filenameBuf, sizeof(filenameBuf)},
+                           {&size64, sizeof(size64)},
+                           {const_cast<uint8_t*>(data), size},
+                           {&pingCmd, sizeof(pingCmd)}};
+    uint8_t reply = 0;
+    return socket.sendVectored(iov, 5) >= 0 &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+static bool listFiles(ClientSocket& socket) {
+    uint8_t cmd = CMD_LIST;
+    uint32_t count = 0;
+    if (socket.sendData(&cmd, sizeof(cmd)) != sizeof(cmd) ||
+        socket.receiveData(reinterpret_cast<uint8_t*>(&count), sizeof(count)) != sizeof(count)) {
+        return false;
+    }
+    char filenameBuf[256];
+    for (uint32_t i = 0; i < count; ++i) {
+        if (socket.receiveData(reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) != sizeof(filenameBuf)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Target {
+    string host;
+    uint16_t port;
+};
+
+static Step runStep(const Target& target, int connections, double rate, double seconds, bool poisson,
+                    const vector<Weighted<string>>& mix, const vector<Weighted<size_t>>& sizes,
+                    const vector<uint8_t>& payload) {
+    Step step;
+    step.offered = rate;
+
+    vector<ClientSocket> sockets(connections);
+    for (auto& socket : sockets) {
+        if (!socket.connectToServer(target.host, target.port)) {
+            step.errors++;
+        }
+    }
+
+    vector<LatencyHistogram> histograms(connections);
+    vector<uint64_t> errors(connections, 0);
+    vector<uint64_t> unsent(connections, 0);
+    auto start = steady_clock::now() + milliseconds(20); // Let every thread reach its first wait
+    auto end = start + duration_cast<steady_clock::duration>(duration<double>(seconds));
+    // Scheduled requests still unsent this long after the end are given up
+    auto giveUp = end + duration_cast<steady_clock::duration>(duration<double>(seconds));
+    double meanGap = connections / rate; // seconds between requests on one connection
+
+    vector<thread> workers;
+    for (int c = 0; c < connections; ++c) {
+        workers.emplace_back([&, c]() {
+            ClientSocket& socket = sockets[c];
+            mt19937_64 rng(static_cast<uint64_t>(rate) * 7919 + c);
+            exponential_distribution<double> poissonGap(1.0 / meanGap);
+            vector<uint8_t> buf(1024 * 1024);
+            string putName = "load_put_" + to_string(c) + ".bin";
+
+            auto gap = [&]() {
+                double s = poisson ? poissonGap(rng) : meanGap;
+                return duration_cast<steady_clock::duration>(duration<double>(s));
+            };
+            // Constant arrivals: spread the connections across one interval
+            auto intended = start + (poisson ? gap()
+                                             : duration_cast<steady_clock::duration>(
+                                                   duration<double>(meanGap * c / connections)));
+            while (intended < end) {
+                if (!socket.isConnected()) {
+                    // Reconnecting is part of serving this request
+                    this_thread::sleep_until(intended);
+                    if (!socket.connectToServer(target.host, target.port)) {
+                        errors[c]++;
+                        intended += gap();
+                        continue;
+                    }
+                }
+                if (steady_clock::now() > giveUp) {
+                    break;
+                }
+                this_thread::sleep_until(intended);
+
+                const string& op = pick(mix, rng);
+                bool ok;
+                if (op == "GET") {
+                    ok = get(socket, "load_" + formatSize(pick(sizes, rng)) + ".bin", buf);
+                } else if (op == "PUT") {
+                    ok = put(socket, putName, payload.data(), pick(sizes, rng));
+                } else if (op == "LIST") {
+                    ok = listFiles(socket);
+                } else {
+                    ok = ping(socket);
+                }
+                if (ok) {
+                    histograms[c].record(static_cast<uint64_t>(
+                        duration_cast<nanoseconds>(steady_clock::now() - intended).count()));
+                } else {
+                    errors[c]++;
+                    socket.disconnect();
+                }
+                intended += gap();
+            }
+            while (intended < end) {
+                unsent[c]++;
+                intended += gap();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    for (auto& socket : sockets) {
+        socket.disconnect();
+    }
+
+    for (int c = 0; c < connections; ++c) {
+        step.latency.add(histograms[c]);
+        step.errors += errors[c];
+        step.unsent += unsent[c];
+    }
+    step.completed = step.latency.count();
+    step.achieved = step.completed / std::max(elapsed, seconds);
+    step.saturated = step.achieved < 0.9 * rate || step.unsent > 0;
+    return step;
+}
+
+static double ms(uint64_t ns) {
+    return ns / 1e6;
+}
+
+static void writeJson(ostream& out, const vector<Step>& steps, int connections, double seconds, bool poisson,
+                      const string& mixText, const string& sizesText) {
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << fixed << setprecision(3);
+    out << "{\n";
+    out << "  \"benchmark\": \"load_generator\",\n";
+    out << "  \"timestamp\": \"" << timestamp << "\",\n";
+    out << "  \"config\": {\"connections\": " << connections << ", \"seconds\": " << seconds
+        << ", \"arrival\": \"" << (poisson ? "poisson" : "constant") << "\", \"mix\": \"" << mixText
+        << "\", \"sizes\": \"" << sizesText << "\"},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const Step& s = steps[i];
+        out << "    {\"offered_per_sec\": " << s.offered << ", \"ops_per_sec\": " << s.achieved
+            << ", \"ops\": " << s.completed << ", \"errors\": " << s.errors << ", \"unsent\": " << s.unsent
+            << ", \"p50_us\": " << s.latency.percentile(50) / 1e3 << ", \"p90_us\": " << s.latency.percentile(90) / 1e3
+            << ", \"p99_us\": " << s.latency.percentile(99) / 1e3
+            << ", \"p999_us\": " << s.latency.percentile(99.9) / 1e3 << ", \"max_us\": " << s.latency.max() / 1e3
+            << ", \"saturated\": " << (s.saturated ? "true" : "false") << "}" << (i + 1 < steps.size() ? "," : "")
+            << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [--server HOST:PORT] [--connections N] [--rates R1,R2,...]\n"
+         << "       [--seconds S] [--arrival poisson|constant] [--mix GET:70,PUT:10,LIST:5,PING:15]\n"
+         << "       [--sizes 4K:80,64K:15,1M:5] [--output FILE]\n";
+}
+
+int main(int argc, char* argv[]) {
+    string server;
+    int connections = 16;
+    vector<double> rates = {500, 1000, 2000, 4000, 8000, 16000, 32000, 64000};
+    double seconds = 3.0;
+    bool poisson = true;
+    string mixText = "GET:70,PUT:10,LIST:5,PING:15";
+    string sizesText = "4K:80,64K:15,1M:5";
+    string output;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--server") {
+            server = value;
+        } else if (arg == "--connections") {
+            connections = atoi(value.c_str());
+        } else if (arg == "--rates") {
+            rates.clear();
+            for (const string& item : splitList(value)) {
+                rates.push_back(atof(item.c_str()));
+            }
+        } else if (arg == "--seconds") {
+            seconds = atof(value.c_str());
+        } else if (arg == "--arrival" && (value == "poisson" || value == "constant")) {
+            poisson = value == "poisson";
+        } else if (arg == "--mix") {
+            mixText = value;
+        } else if (arg == "--sizes") {
+            sizesText = value;
+        } else if (arg == "--output") {
+            output = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<Weighted<string>> mix;
+    vector<Weighted<string>> sizeNames;
+    vector<Weighted<size_t>> sizes;
+    bool valid = connections > 0 && seconds > 0 && !rates.empty() && parseWeights(mixText, mix) &&
+                 parseWeights(sizesText, sizeNames);
+    for (const auto& op : mix) {
+        valid = valid && (op.value == "GET" || op.value == "PUT" || op.value == "LIST" || op.value == "PING");
+    }
+    for (const auto& name : sizeNames) {
+        size_t size = 0;
+        valid = valid && parseSize(name.value, size);
+        sizes.push_back({size, name.weight});
+    }
+    for (double rate : rates) {
+        valid = valid && rate > 0;
+    }
+    Target target{"127.0.0.1", 0};
+    if (!server.empty()) {
+        size_t colon = server.rfind(':');
+        valid = valid && colon != string::npos;
+        if (valid) {
+            target.host = server.substr(0, colon);
+            target.port = static_cast<uint16_t>(atoi(server.c_str() + colon + 1));
+        }
+    }
+    if (!valid) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Client and server log every request; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    Server localServer;
+    thread serverThread;
+    string serverDir;
+    if (server.empty()) {
+        serverDir = (access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp") + string("/load_generator_XXXXXX");
+        if (!mkdtemp(&serverDir[0])) {
+            report << "Error: Cannot create temporary directory\n";
+            return 1;
+        }
+        localServer.setTimeout(0);
+        localServer.setMaxConnections(connections + 8);
+        if (!localServer.start(0, serverDir)) {
+            report << "Error: Cannot start server\n";
+            return 1;
+        }
+        target.port = localServer.getPort();
+        serverThread = thread([&localServer]() { localServer.run(); });
+    }
+
+    size_t largest = 0;
+    for (const auto& size : sizes) {
+        largest = max(largest, size.value);
+    }
+    vector<uint8_t> payload(largest);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>('a' + i % 26);
+    }
+
+    // Upload the files GET asks for
+    ClientSocket setup;
+    bool ready = setup.connectToServer(target.host, target.port);
+    for (const auto& size : sizes) {
+        ready = ready && put(setup, "load_" + formatSize(size.value) + ".bin", payload.data(), size.value);
+    }
+    setup.disconnect();
+    if (!ready) {
+        report << "Error: Cannot upload test files to " << target.host << ":" << target.port << "\n";
+    }
+
+    report << "Open-loop load: " << connections << " connections, " << (poisson ? "Poisson" : "constant")
+           << " arrivals, " << seconds << " s per rate\n";
+    report << "Mix " << mixText << ", sizes " << sizesText << "; latency from intended send time (ms)\n";
+    report << string(100, '-') << "\n";
+    report << left << setw(11) << "Offered/s" << setw(12) << "Achieved/s" << setw(9) << "Errors" << setw(9) << "Unsent"
+           << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99" << setw(10) << "p99.9" << setw(10) << "max"
+           << "\n";
+    report << string(100, '-') << "\n";
+
+    vector<Step> steps;
+    bool allOk = ready;
+    for (double rate : rates) {
+        if (!ready) {
+            break;
+        }
+        steps.push_back(runStep(target, connections, rate, seconds, poisson, mix, sizes, payload));
+        const Step& s = steps.back();
+        report << left << fixed << setprecision(0) << setw(11) << s.offered << setw(12) << s.achieved << setw(9)
+               << s.errors << setw(9) << s.unsent << setprecision(2) << setw(10) << ms(s.latency.percentile(50))
+               << setw(10) << ms(s.latency.percentile(90)) << setw(10) << ms(s.latency.percentile(99)) << setw(10)
+               << ms(s.latency.percentile(99.9)) << setw(10) << ms(s.latency.max())
+               << (s.saturated ? "saturated" : "") << endl;
+        allOk = allOk && s.errors == 0;
+        if (s.saturated) {
+            break;
+        }
+    }
+    report << string(100, '-') << "\n";
+
+    if (!output.empty()) {
+        ofstream out(output);
+        writeJson(out, steps, connections, seconds, poisson, mixText, sizesText);
+        report << (out.good() ? "JSON written to " : "Error: Cannot write ") << output << "\n";
+    }
+
+    if (server.empty()) {
+        localServer.stop();
+        serverThread.join();
+        for (const auto& size : sizes) {
+            unlink((serverDir + "/load_" + formatSize(size.value) + ".bin").c_str());
+        }
+        for (int c = 0; c < connections; ++c) {
+            unlink((serverDir + "/load_put_" + to_string(c) + ".bin").c_str());
+        }
+        rmdir(serverDir.c_str());
+    }
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/**
+ * Reaper Benchmark - cost of timeout enforcement for many sessions
+ *
+ * Registers N session watches with a SessionReaper (no real sockets; the
+ * watches use fd -1) and measures:
+ *   - registration rate,
+ *   - reaper CPU usage while all sessions sit inside their idle timeout,
+ *   - how long it takes to reap all of them once the idle timeout expires.
+ *
+ * Usage: ./reaper_bench [sessions] [idle_seconds]
+ * Example: ./reaper_bench 100000 2
+ */
+
+#include "../include/core/Server/session_reaper.h"
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    int sessions = (argc > 1) ? atoi(argv[1]) : 100000;
+    int idleSeconds = (argc > 2) ? atoi(argv[2]) : 2;
+    if (sessions <= 0 || idleSeconds <= 0) {
+        cerr << "Usage: " << argv[0] << " [sessions] [idle_seconds]\n";
+        return 1;
+    }
+
+    ServerMetrics metrics;
+    SessionReaper reaper;
+    reaper.setMetrics(&metrics);
+    reaper.configure(idleSeconds, 60, 0);
+    reaper.start();
+
+    cout << "Reaper benchmark: " << sessions << " sessions, idle timeout " << idleSeconds << " s\n";
+    cout << string(60, '-') << "\n";
+
+    vector<shared_ptr<SessionWatch>> watches;
+    watches.reserve(sessions);
+    auto start = steady_clock::now();
+    for (int i = 0; i < sessions; ++i) {
+        watches.push_back(reaper.watch(-1));
+    }
+    double registerSec = duration<double>(steady_clock::now() - start).count();
+    cout << left << setw(28) << "Register:" << fixed << setprecision(0)
+         << (sessions / registerSec) << " watches/sec\n";
+
+    // Idle phase: every timer fires once per busy-poll interval at most
+    double idleWindow = idleSeconds * 0.8;
+    double cpuBefore = cpuSeconds();
+    this_thread::sleep_for(duration<double>(idleWindow));
+    double cpuIdle = cpuSeconds() - cpuBefore;
+    cout << left << setw(28) << "Reaper CPU while waiting:" << setprecision(2)
+         << (cpuIdle / idleWindow * 100.0) << " % of one core\n";
+
+    // Expiry phase: wait until every session has been reaped
+    start = steady_clock::now();
+    while (metrics.sessionsReaped.load() < static_cast<uint64_t>(sessions) &&
+           duration<double>(steady_clock::now() - start).count() < idleSeconds + 10) {
+        this_thread::sleep_for(milliseconds(10));
+    }
+    double reapSec = duration<double>(steady_clock::now() - start).count();
+    cout << left << setw(28) << "Reaped:" << metrics.sessionsReaped.load() << " sessions, "
+         << setprecision(2) << reapSec << " s after the idle phase\n";
+    cout << left << setw(28) << "Still watched:" << reaper.watchedCount() << "\n";
+    cout << string(60, '-') << "\n";
+
+    for (auto& watch : watches) {
+        watch->release();
+    }
+    reaper.stop();
+
+    return metrics.sessionsReaped.load() == static_cast<uint64_t>(sessions) ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/**
+ * Registry Benchmark - connection churn next to many idle sessions
+ *
+ * Runs an in-process server, opens N idle connections, then measures
+ * connect + PING + disconnect cycles (one at a time) for a fixed time:
+ *   - once with nothing else going on,
+ *   - once with a thread polling getActiveSessionCount() and
+ *     getActiveClients() back-to-back, the way a monitor or GUI would.
+ * Reports cycles/s, cycle latency p50/p99, the poller's call rate and how
+ * long stop() takes to end all sessions.
+ *
+ * Usage: ./registry_bench [idle_sessions] [seconds_per_case]
+ * Example: ./registry_bench 2000 2
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static bool ping(ClientSocket& socket) {
+    uint8_t cmd = CMD_PING;
+    uint8_t reply = 0;
+    return socket.sendData(&cmd, sizeof(cmd)) == sizeof(cmd) &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+int main(int argc, char* argv[]) {
+    int idle = (argc > 1) ? atoi(argv[1]) : 2000;
+    double seconds = (argc > 2) ? atof(argv[2]) : 2.0;
+    if (idle < 0 || seconds <= 0) {
+        cerr << "Usage: " << argv[0] << " [idle_sessions] [seconds_per_case]\n";
+        return 1;
+    }
+
+    // Client and server log every connection; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    char serverTemplate[] = "/tmp/registry_bench_XXXXXX";
+    if (!mkdtemp(serverTemplate)) {
+        report << "Error: Cannot create temporary directory\n";
+        return 1;
+    }
+    string serverDir = serverTemplate;
+
+    Server server;
+    server.setTimeout(0);
+    if (!server.start(0, serverDir)) {
+        report << "Error: Cannot start server\n";
+        return 1;
+    }
+    uint16_t port = server.getPort();
+    thread serverThread([&server]() { server.run(); });
+
+    vector<unique_ptr<ClientSocket>> idleClients;
+    for (int i = 0; i < idle; ++i) {
+        auto client = make_unique<ClientSocket>();
+        if (!client->connectToServer("127.0.0.1", port)) {
+            break;
+        }
+        idleClients.push_back(move(client));
+    }
+    // Wait for the server to register them all
+    auto settle = steady_clock::now() + std::chrono::seconds(10);
+    while (server.getActiveSessionCount() < idleClients.size() && steady_clock::now() < settle) {
+        this_thread::sleep_for(milliseconds(10));
+    }
+
+    report << "Registry benchmark: " << idleClients.size() << " idle sessions, " << seconds << " s per case\n";
+    report << string(70, '-') << "\n";
+    report << left << setw(10) << "Poller" << setw(13) << "cycles/s" << setw(13) << "p50 us"
+           << setw(13) << "p99 us" << "poller calls/s" << "\n";
+    report << string(70, '-') << "\n";
+
+    bool allOk = idleClients.size() == static_cast<size_t>(idle);
+    for (bool polling : {false, true}) {
+        atomic<bool> done(false);
+        atomic<uint64_t> polls(0);
+        thread poller;
+        if (polling) {
+            poller = thread([&]() {
+                while (!done) {
+                    size_t count = server.getActiveSessionCount();
+                    vector<string> clients = server.getActiveClients();
+                    polls += (count > 0 && !clients.empty()) ? 1 : 0;
+                }
+            });
+        }
+
+        vector<double> latency;
+        bool ok = true;
+        auto start = steady_clock::now();
+        auto deadline = start + duration<double>(seconds);
+        while (ok && steady_clock::now() < deadline) {
+            auto cycleStart = steady_clock::now();
+            ClientSocket client;
+            ok = client.connectToServer("127.0.0.1", port) && ping(client);
+            client.disconnect();
+            latency.push_back(duration<double, micro>(steady_clock::now() - cycleStart).count());
+        }
+        double elapsed = duration<double>(steady_clock::now() - start).count();
+        done = true;
+        if (poller.joinable()) {
+            poller.join();
+        }
+
+        sort(latency.begin(), latency.end());
+        double p50 = latency.empty() ? 0.0 : latency[latency.size() / 2];
+        double p99 = latency.empty() ? 0.0 : latency[latency.size() * 99 / 100];
+        report << left << setw(10) << (polling ? "on" : "off") << fixed << setprecision(0)
+               << setw(13) << latency.size() / elapsed << setprecision(1) << setw(13) << p50 << setw(13) << p99;
+        if (polling) {
+            report << setprecision(0) << polls / elapsed;
+        } else {
+            report << "-";
+        }
+        report << (ok ? "" : "  FAILED") << endl;
+        allOk = allOk && ok;
+    }
+    report << string(70, '-') << "\n";
+
+    // stop() shuts down the idle sessions and waits for their threads
+    auto stopStart = steady_clock::now();
+    server.stop();
+    serverThread.join();
+    report << "stop() with " << idleClients.size() << " open sessions: " << fixed << setprecision(1)
+           << duration<double, milli>(steady_clock::now() - stopStart).count() << " ms, "
+           << server.getActiveSessionCount() << " left" << endl;
+
+    idleClients.clear();
+    rmdir(serverDir.c_str());
+    return allOk ? 0 : 1;
+}
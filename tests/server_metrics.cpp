@@ -1,17 +1,26 @@
 /**
  * Server Metrics Monitor
- * 
+ *
  * Monitors server-side metrics including:
- * - Number of concurrent connections
- * - CPU and Memory usage
- * - Network throughput
- * - Thread count
- * 
+ * - CPU, memory, file descriptors and sockets of the process
+ * - I/O accounting (/proc/<pid>/io) and context switches
+ * - CPU time, scheduler delay and context switches of every thread
+ * - TCP_INFO of every client connection (RTT, cwnd, retransmits, queues),
+ *   queried from the server over its Unix socket (SESSION_STATS)
+ *
  * This program runs alongside the server and periodically collects metrics.
- * Results are logged to CSV for analysis.
- * 
- * Usage: ./server_metrics <server_pid> <sampling_interval_ms> [output_csv] [duration_seconds]
- * Example: ./server_metrics 12345 1000 server_metrics.csv 300
+ * Each sample appends rows to three tab-separated time series, all keyed by
+ * the time since the start in the first column:
+ *   <prefix>_process.tsv  one row per sample
+ *   <prefix>_threads.tsv  one row per thread and sample
+ *   <prefix>_sockets.tsv  one row per TCP session and sample
+ *
+ * Usage: ./server_metrics <server_pid> <sampling_interval_ms> [output_prefix] [duration_seconds] [unix_socket]
+ * Example: ./server_metrics 12345 1000 run1 300 /tmp/ft.sock
+ *
+ * Without unix_socket the sockets file stays empty and the server byte
+ * counters are 0. The admin query is only answered for the server's own
+ * user; /proc/<pid>/io needs the same (or root).
  */
 
 #include <iostream>
@@ -24,62 +33,75 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fstream>
 #include <sstream>
 #include <cstring>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <dirent.h>
+#include "../include/core/Client/client_socket.h"
+#include "../include/core/Server/server_protocol.h"
 
 using namespace std;
 using namespace std::chrono;
 
-struct ServerMetrics {
-    string timestamp{""};
-    
+struct ProcessSample {
+    double elapsedSec{0.0};
+
     // Process info
-    int pid{0};
     int numThreads{0};
-    
-    // CPU metrics
+    unsigned long long utime{0};  // in clock ticks
+    unsigned long long stime{0};
     double cpuPercent{0.0};
-    unsigned long long cpuTime{0};  // in jiffies
-    
+    double userPercent{0.0};
+    double systemPercent{0.0};
+
     // Memory metrics
     uint64_t memoryRssKB{0};      // Resident Set Size
     uint64_t memoryVmsKB{0};      // Virtual Memory Size
-    double memoryPercent{0.0};
-    
-    // Network metrics (estimated from /proc/net/dev)
-    uint64_t bytesReceived{0};
-    uint64_t bytesSent{0};
-    double rxThroughputMBps{0.0};
-    double txThroughputMBps{0.0};
-    
+
     // File descriptors (proxy for connections)
     int numFileDescriptors{0};
     int numSockets{0};
+
+    // Context switches, summed over the live threads (the status file of
+    // the process only counts its main thread)
+    uint64_t voluntarySwitches{0};
+    uint64_t involuntarySwitches{0};
+
+    // I/O accounting (/proc/<pid>/io): rchar/wchar include sockets,
+    // readBytes/writeBytes are what reached the block layer
+    bool haveIo{false};
+    uint64_t rchar{0};
+    uint64_t wchar{0};
+    uint64_t syscr{0};
+    uint64_t syscw{0};
+    uint64_t readBytes{0};
+    uint64_t writeBytes{0};
+
+    // Server totals from SESSION_STATS
+    bool haveServer{false};
+    uint64_t serverBytesSent{0};
+    uint64_t serverBytesReceived{0};
+    uint32_t sessions{0};
 };
 
-static bool keepRunning = true;
+struct ThreadSample {
+    string name;
+    char state{'?'};
+    unsigned long long utime{0};  // in clock ticks
+    unsigned long long stime{0};
+    uint64_t runNs{0};            // schedstat: time on a CPU
+    uint64_t waitNs{0};           // schedstat: time runnable, waiting for a CPU
+    uint64_t timeslices{0};
+    uint64_t voluntarySwitches{0};
+    uint64_t involuntarySwitches{0};
+};
 
-void signalHandler(int signum) {
-    cout << "\nInterrupt signal received. Stopping monitoring..." << endl;
-    keepRunning = false;
-}
+static volatile sig_atomic_t keepRunning = 1;
 
-/**
- * Get current timestamp as string
- */
-string getCurrentTimestamp() {
-    auto now = system_clock::now();
-    auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
-    auto timer = system_clock::to_time_t(now);
-    
-    ostringstream oss;
-    oss << put_time(localtime(&timer), "%Y-%m-%d %H:%M:%S");
-    oss << '.' << setfill('0') << setw(3) << ms.count();
-    return oss.str();
+void signalHandler(int signum) {
+    keepRunning = 0;
 }
 
 /**
@@ -90,397 +112,505 @@ bool processExists(int pid) {
 }
 
 /**
- * Get total system memory in KB
+ * Read the first line of a file
  */
-uint64_t getTotalSystemMemoryKB() {
-    ifstream meminfo("/proc/meminfo");
-    string line;
-    while (getline(meminfo, line)) {
-        if (line.find("MemTotal:") == 0) {
-            istringstream iss(line);
-            string label;
-            uint64_t value;
-            iss >> label >> value;
-            return value;
-        }
-    }
-    return 0;
+bool readLine(const string& path, string& line) {
+    ifstream file(path);
+    return file.is_open() && static_cast<bool>(getline(file, line));
 }
 
 /**
- * Get number of CPU cores
+ * Split a /proc stat line into fields
+ *
+ * comm (the second field) may contain spaces and parentheses, so it is
+ * taken up to the last ')'. Field n of proc(5) ends up at index n - 1.
  */
-int getNumCPUCores() {
-    return sysconf(_SC_NPROCESSORS_ONLN);
+vector<string> parseStatLine(const string& line) {
+    vector<string> tokens;
+    size_t open = line.find('(');
+    size_t close = line.rfind(')');
+    if (open == string::npos || close == string::npos || close < open) {
+        return tokens;
+    }
+
+    tokens.push_back(line.substr(0, open - 1));
+    tokens.push_back(line.substr(open + 1, close - open - 1));
+    istringstream iss(line.substr(close + 1));
+    string token;
+    while (iss >> token) {
+        tokens.push_back(token);
+    }
+    return tokens;
 }
 
 /**
- * Read process statistics from /proc/[pid]/stat
+ * Read "Key: value" lines of a /proc status or io file
  */
-bool readProcStat(int pid, ServerMetrics& metrics) {
-    string statPath = "/proc/" + to_string(pid) + "/stat";
-    ifstream statFile(statPath);
-    
-    if (!statFile.is_open()) {
-        return false;
-    }
-    
+map<string, uint64_t> readKeyValues(const string& path) {
+    map<string, uint64_t> values;
+    ifstream file(path);
     string line;
-    getline(statFile, line);
-    
-    // Parse stat file (fields are space-separated)
-    // We need: pid, comm, state, ..., utime(14), stime(15), ..., num_threads(20)
-    istringstream iss(line);
-    string token;
-    vector<string> tokens;
-    
-    // Special handling for comm field which can contain spaces
-    int parenCount = 0;
-    string currentToken;
-    for (char c : line) {
-        if (c == '(') parenCount++;
-        if (c == ')') parenCount--;
-        
-        if (c == ' ' && parenCount == 0) {
-            if (!currentToken.empty()) {
-                tokens.push_back(currentToken);
-                currentToken.clear();
-            }
-        } else {
-            currentToken += c;
+    while (getline(file, line)) {
+        size_t colon = line.find(':');
+        if (colon == string::npos) {
+            continue;
+        }
+        istringstream iss(line.substr(colon + 1));
+        uint64_t value;
+        if (iss >> value) {
+            values[line.substr(0, colon)] = value;
         }
     }
-    if (!currentToken.empty()) {
-        tokens.push_back(currentToken);
-    }
-    
-    if (tokens.size() >= 20) {
-        unsigned long long utime = stoull(tokens[13]);
-        unsigned long long stime = stoull(tokens[14]);
-        metrics.cpuTime = utime + stime;
-        metrics.numThreads = stoi(tokens[19]);
-    }
-    
-    return true;
+    return values;
 }
 
 /**
- * Read memory statistics from /proc/[pid]/status
+ * Read process statistics from /proc/[pid]/stat and /proc/[pid]/status
  */
-bool readProcStatus(int pid, ServerMetrics& metrics) {
-    string statusPath = "/proc/" + to_string(pid) + "/status";
-    ifstream statusFile(statusPath);
-    
-    if (!statusFile.is_open()) {
+bool readProcess(int pid, ProcessSample& sample) {
+    string base = "/proc/" + to_string(pid);
+    string line;
+    if (!readLine(base + "/stat", line)) {
         return false;
     }
-    
-    string line;
-    while (getline(statusFile, line)) {
-        if (line.find("VmRSS:") == 0) {
-            istringstream iss(line);
-            string label;
-            uint64_t value;
-            iss >> label >> value;
-            metrics.memoryRssKB = value;
-        } else if (line.find("VmSize:") == 0) {
-            istringstream iss(line);
-            string label;
-            uint64_t value;
-            iss >> label >> value;
-            metrics.memoryVmsKB = value;
-        }
+
+    vector<string> tokens = parseStatLine(line);
+    if (tokens.size() < 20) {
+        return false;
+    }
+    sample.utime = stoull(tokens[13]);
+    sample.stime = stoull(tokens[14]);
+    sample.numThreads = stoi(tokens[19]);
+
+    map<string, uint64_t> status = readKeyValues(base + "/status");
+    sample.memoryRssKB = status["VmRSS"];
+    sample.memoryVmsKB = status["VmSize"];
+
+    // Not readable for another user's process
+    map<string, uint64_t> io = readKeyValues(base + "/io");
+    if (!io.empty()) {
+        sample.haveIo = true;
+        sample.rchar = io["rchar"];
+        sample.wchar = io["wchar"];
+        sample.syscr = io["syscr"];
+        sample.syscw = io["syscw"];
+        sample.readBytes = io["read_bytes"];
+        sample.writeBytes = io["write_bytes"];
     }
-    
     return true;
 }
 
 /**
- * Count file descriptors for a process
+ * Read every thread of the process from /proc/[pid]/task
  */
-int countFileDescriptors(int pid) {
-    string fdPath = "/proc/" + to_string(pid) + "/fd";
-    int count = 0;
-    
-    DIR* dir = opendir(fdPath.c_str());
-    if (!dir) return 0;
-    
+map<int, ThreadSample> readThreads(int pid) {
+    map<int, ThreadSample> threads;
+    string taskPath = "/proc/" + to_string(pid) + "/task";
+
+    DIR* dir = opendir(taskPath.c_str());
+    if (!dir) return threads;
+
     struct dirent* entry;
     while ((entry = readdir(dir)) != nullptr) {
-        string name = entry->d_name;
-        if (name != "." && name != "..") {
-            count++;
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
         }
+
+        // A thread may exit between readdir() and the reads below
+        string base = taskPath + "/" + entry->d_name;
+        string line;
+        if (!readLine(base + "/stat", line)) {
+            continue;
+        }
+        vector<string> tokens = parseStatLine(line);
+        if (tokens.size() < 15) {
+            continue;
+        }
+
+        ThreadSample thread;
+        thread.name = tokens[1];
+        thread.state = tokens[2].empty() ? '?' : tokens[2][0];
+        thread.utime = stoull(tokens[13]);
+        thread.stime = stoull(tokens[14]);
+
+        // Needs CONFIG_SCHEDSTATS; the fields stay 0 without it
+        if (readLine(base + "/schedstat", line)) {
+            istringstream iss(line);
+            iss >> thread.runNs >> thread.waitNs >> thread.timeslices;
+        }
+
+        map<string, uint64_t> status = readKeyValues(base + "/status");
+        thread.voluntarySwitches = status["voluntary_ctxt_switches"];
+        thread.involuntarySwitches = status["nonvoluntary_ctxt_switches"];
+
+        threads[atoi(entry->d_name)] = thread;
     }
     closedir(dir);
-    
-    return count;
+
+    return threads;
 }
 
 /**
- * Count sockets for a process
+ * Count file descriptors and sockets for a process
  */
-int countSockets(int pid) {
+void countFileDescriptors(int pid, int& fds, int& sockets) {
     string fdPath = "/proc/" + to_string(pid) + "/fd";
-    int count = 0;
-    
+    fds = 0;
+    sockets = 0;
+
     DIR* dir = opendir(fdPath.c_str());
-    if (!dir) return 0;
-    
+    if (!dir) return;
+
     struct dirent* entry;
     while ((entry = readdir(dir)) != nullptr) {
         string name = entry->d_name;
         if (name == "." || name == "..") continue;
-        
+        fds++;
+
         string linkPath = fdPath + "/" + name;
         char buffer[256];
         ssize_t len = readlink(linkPath.c_str(), buffer, sizeof(buffer) - 1);
         if (len > 0) {
             buffer[len] = '\0';
-            string target(buffer);
-            if (target.find("socket:") == 0) {
-                count++;
+            if (strncmp(buffer, "socket:", 7) == 0) {
+                sockets++;
             }
         }
     }
     closedir(dir);
-    
-    return count;
 }
 
 /**
- * Read network statistics from /proc/net/dev
+ * Ask the server for its per-session TCP statistics
+ *
+ * Keeps one admin session open across samples and reconnects after a
+ * failure. An empty reply with zero totals means the server refused.
  */
-bool readNetworkStats(uint64_t& bytesRx, uint64_t& bytesTx) {
-    ifstream netdev("/proc/net/dev");
-    if (!netdev.is_open()) {
+bool querySessionStats(ClientSocket& admin, const string& socketPath,
+                       SessionStatsHeader& header, vector<SessionStatsRecord>& records) {
+    records.clear();
+    if (!admin.isConnected() && !admin.connectUnix(socketPath)) {
         return false;
     }
-    
-    string line;
-    // Skip header lines
-    getline(netdev, line);
-    getline(netdev, line);
-    
-    bytesRx = 0;
-    bytesTx = 0;
-    
-    while (getline(netdev, line)) {
-        // Skip loopback interface
-        if (line.find("lo:") != string::npos) {
-            continue;
-        }
-        
-        // Parse line: interface: rx_bytes ... tx_bytes ...
-        size_t colonPos = line.find(':');
-        if (colonPos == string::npos) continue;
-        
-        string stats = line.substr(colonPos + 1);
-        istringstream iss(stats);
-        
-        uint64_t rx, tx;
-        iss >> rx;  // bytes received
-        
-        // Skip 7 fields to get to bytes transmitted
-        for (int i = 0; i < 7; i++) {
-            uint64_t dummy;
-            iss >> dummy;
+
+    uint8_t cmd = CMD_SESSION_STATS;
+    if (admin.sendData(&cmd, sizeof(cmd)) != sizeof(cmd) ||
+        admin.receiveData(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header)) {
+        admin.disconnect();
+        return false;
+    }
+
+    // Records may grow at the end in later versions: copy what we know
+    vector<uint8_t> record(header.recordSize);
+    for (uint32_t i = 0; i < header.sessions; ++i) {
+        if (admin.receiveData(record.data(), record.size()) != static_cast<ssize_t>(record.size())) {
+            admin.disconnect();
+            return false;
         }
-        iss >> tx;  // bytes transmitted
-        
-        bytesRx += rx;
-        bytesTx += tx;
+        SessionStatsRecord parsed{};
+        memcpy(&parsed, record.data(), min(record.size(), sizeof(parsed)));
+        parsed.clientAddr[sizeof(parsed.clientAddr) - 1] = '\0';
+        records.push_back(parsed);
     }
-    
     return true;
 }
 
 /**
- * Collect all metrics for the server process
+ * Percentage of one CPU used by a tick delta over an interval
  */
-ServerMetrics collectMetrics(int pid, const ServerMetrics& previousMetrics, double intervalSec) {
-    ServerMetrics metrics;
-    metrics.timestamp = getCurrentTimestamp();
-    metrics.pid = pid;
-    
-    // Read process stats
-    if (!readProcStat(pid, metrics)) {
-        cerr << "Warning: Could not read process stats" << endl;
-        return metrics;
-    }
-    
-    // Read memory stats
-    if (!readProcStatus(pid, metrics)) {
-        cerr << "Warning: Could not read process status" << endl;
-        return metrics;
-    }
-    
-    // Calculate CPU percentage
-    if (previousMetrics.cpuTime > 0 && intervalSec > 0) {
-        unsigned long long cpuDelta = metrics.cpuTime - previousMetrics.cpuTime;
-        int numCores = getNumCPUCores();
-        // Convert jiffies to seconds (assuming 100 jiffies per second)
-        double cpuTimeSec = cpuDelta / 100.0;
-        metrics.cpuPercent = (cpuTimeSec / intervalSec) * 100.0;
-        
-        // Normalize to single core percentage (optional)
-        // metrics.cpuPercent /= numCores;
-    }
-    
-    // Calculate memory percentage
-    uint64_t totalMemKB = getTotalSystemMemoryKB();
-    if (totalMemKB > 0) {
-        metrics.memoryPercent = (static_cast<double>(metrics.memoryRssKB) / totalMemKB) * 100.0;
-    }
-    
-    // Read network stats
-    uint64_t totalRx, totalTx;
-    if (readNetworkStats(totalRx, totalTx)) {
-        metrics.bytesReceived = totalRx;
-        metrics.bytesSent = totalTx;
-        
-        // Calculate throughput
-        if (previousMetrics.bytesReceived > 0 && intervalSec > 0) {
-            uint64_t rxDelta = totalRx - previousMetrics.bytesReceived;
-            uint64_t txDelta = totalTx - previousMetrics.bytesSent;
-            
-            metrics.rxThroughputMBps = (rxDelta / intervalSec) / (1024.0 * 1024.0);
-            metrics.txThroughputMBps = (txDelta / intervalSec) / (1024.0 * 1024.0);
-        }
-    }
-    
-    // Count file descriptors and sockets
-    metrics.numFileDescriptors = countFileDescriptors(pid);
-    metrics.numSockets = countSockets(pid);
-    
-    return metrics;
+double ticksPercent(unsigned long long ticks, double intervalSec) {
+    static const double ticksPerSec = static_cast<double>(sysconf(_SC_CLK_TCK));
+    return intervalSec > 0 ? ticks / ticksPerSec / intervalSec * 100.0 : 0.0;
+}
+
+/**
+ * Growth of a counter; 0 when the sum went down because threads exited
+ */
+uint64_t counterDelta(uint64_t current, uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+double rateMBps(uint64_t current, uint64_t previous, double intervalSec) {
+    return (intervalSec > 0 && current >= previous) ? (current - previous) / intervalSec / (1024.0 * 1024.0) : 0.0;
+}
+
+/**
+ * Write the header lines of the three time series
+ */
+void writeHeaders(ofstream& process, ofstream& threads, ofstream& sockets) {
+    process << "t_s\tthreads\tcpu_pct\tuser_pct\tsys_pct\trss_kb\tvms_kb\tfds\tsockets\t"
+            << "vol_cs\tinvol_cs\trchar_mbps\twchar_mbps\tsyscr_per_s\tsyscw_per_s\t"
+            << "disk_read_mbps\tdisk_write_mbps\tsessions\tserver_rx_mbps\tserver_tx_mbps\n";
+    threads << "t_s\ttid\tname\tstate\tcpu_pct\tuser_pct\tsys_pct\trun_ms\twait_ms\t"
+            << "timeslices\tvol_cs\tinvol_cs\n";
+    sockets << "t_s\tclient\tconnected_s\trtt_us\trttvar_us\tmin_rtt_us\tcwnd\tmss\t"
+            << "retrans\ttotal_retrans\tlost\tunacked\tdelivery_mbps\tsend_q\tnot_sent\trecv_q\t"
+            << "busy_ms\trwnd_limited_ms\tsndbuf_limited_ms\n";
+}
+
+/**
+ * Append one process row; counters are reported as deltas over the interval
+ */
+void writeProcessRow(ofstream& file, const ProcessSample& sample, const ProcessSample& previous,
+                     double intervalSec) {
+    double perSec = intervalSec > 0 ? 1.0 / intervalSec : 0.0;
+    file << fixed << setprecision(3) << sample.elapsedSec << "\t"
+         << sample.numThreads << "\t"
+         << setprecision(2) << sample.cpuPercent << "\t"
+         << sample.userPercent << "\t"
+         << sample.systemPercent << "\t"
+         << sample.memoryRssKB << "\t"
+         << sample.memoryVmsKB << "\t"
+         << sample.numFileDescriptors << "\t"
+         << sample.numSockets << "\t"
+         << counterDelta(sample.voluntarySwitches, previous.voluntarySwitches) << "\t"
+         << counterDelta(sample.involuntarySwitches, previous.involuntarySwitches) << "\t"
+         << setprecision(3)
+         << rateMBps(sample.rchar, previous.rchar, intervalSec) << "\t"
+         << rateMBps(sample.wchar, previous.wchar, intervalSec) << "\t"
+         << setprecision(1)
+         << (sample.syscr - previous.syscr) * perSec << "\t"
+         << (sample.syscw - previous.syscw) * perSec << "\t"
+         << setprecision(3)
+         << rateMBps(sample.readBytes, previous.readBytes, intervalSec) << "\t"
+         << rateMBps(sample.writeBytes, previous.writeBytes, intervalSec) << "\t"
+         << sample.sessions << "\t"
+         << rateMBps(sample.serverBytesReceived, previous.serverBytesReceived, intervalSec) << "\t"
+         << rateMBps(sample.serverBytesSent, previous.serverBytesSent, intervalSec) << "\n";
 }
 
 /**
- * Write CSV header
+ * Append one row per thread; threads new since the last sample count from 0
  */
-void writeCSVHeader(ofstream& file) {
-    file << "Timestamp,PID,NumThreads,";
-    file << "CPUPercent,MemoryRssKB,MemoryVmsKB,MemoryPercent,";
-    file << "RxThroughputMBps,TxThroughputMBps,";
-    file << "NumFileDescriptors,NumSockets" << endl;
+void writeThreadRows(ofstream& file, double elapsedSec, const map<int, ThreadSample>& threads,
+                     const map<int, ThreadSample>& previousThreads, double intervalSec) {
+    static const ThreadSample empty;
+    for (const auto& entry : threads) {
+        const ThreadSample& thread = entry.second;
+        auto found = previousThreads.find(entry.first);
+        const ThreadSample& before = found != previousThreads.end() ? found->second : empty;
+
+        unsigned long long user = thread.utime - before.utime;
+        unsigned long long system = thread.stime - before.stime;
+        file << fixed << setprecision(3) << elapsedSec << "\t"
+             << entry.first << "\t"
+             << thread.name << "\t"
+             << thread.state << "\t"
+             << setprecision(2) << ticksPercent(user + system, intervalSec) << "\t"
+             << ticksPercent(user, intervalSec) << "\t"
+             << ticksPercent(system, intervalSec) << "\t"
+             << setprecision(3) << (thread.runNs - before.runNs) / 1e6 << "\t"
+             << (thread.waitNs - before.waitNs) / 1e6 << "\t"
+             << thread.timeslices - before.timeslices << "\t"
+             << thread.voluntarySwitches - before.voluntarySwitches << "\t"
+             << thread.involuntarySwitches - before.involuntarySwitches << "\n";
+    }
 }
 
 /**
- * Write metrics to CSV
+ * Append one row per TCP session (Unix socket sessions have no TCP_INFO)
  */
-void writeMetricsToCSV(ofstream& file, const ServerMetrics& metrics) {
-    file << metrics.timestamp << ","
-         << metrics.pid << ","
-         << metrics.numThreads << ","
-         << fixed << setprecision(2) << metrics.cpuPercent << ","
-         << metrics.memoryRssKB << ","
-         << metrics.memoryVmsKB << ","
-         << fixed << setprecision(2) << metrics.memoryPercent << ","
-         << fixed << setprecision(3) << metrics.rxThroughputMBps << ","
-         << fixed << setprecision(3) << metrics.txThroughputMBps << ","
-         << metrics.numFileDescriptors << ","
-         << metrics.numSockets << endl;
+void writeSocketRows(ofstream& file, double elapsedSec, const vector<SessionStatsRecord>& records) {
+    for (const SessionStatsRecord& record : records) {
+        if (!record.isTcp) {
+            continue;
+        }
+        const TcpStats& tcp = record.tcp;
+        file << fixed << setprecision(3) << elapsedSec << "\t"
+             << record.clientAddr << "\t"
+             << record.connectedMs / 1000.0 << "\t"
+             << tcp.rttUs << "\t"
+             << tcp.rttVarUs << "\t"
+             << tcp.minRttUs << "\t"
+             << tcp.cwnd << "\t"
+             << tcp.mss << "\t"
+             << tcp.retransmits << "\t"
+             << tcp.totalRetrans << "\t"
+             << tcp.lost << "\t"
+             << tcp.unacked << "\t"
+             << tcp.deliveryRate / (1024.0 * 1024.0) << "\t"
+             << tcp.sendQueueBytes << "\t"
+             << tcp.notSentBytes << "\t"
+             << tcp.receiveQueueBytes << "\t"
+             << tcp.busyUs / 1000.0 << "\t"
+             << tcp.rwndLimitedUs / 1000.0 << "\t"
+             << tcp.sndbufLimitedUs / 1000.0 << "\n";
+    }
 }
 
 /**
  * Print metrics to console
  */
-void printMetrics(const ServerMetrics& metrics) {
-    cout << "\r[" << metrics.timestamp << "] "
-         << "Threads: " << metrics.numThreads << " | "
-         << "CPU: " << fixed << setprecision(1) << metrics.cpuPercent << "% | "
-         << "Mem: " << (metrics.memoryRssKB / 1024) << " MB | "
-         << "Sockets: " << metrics.numSockets << " | "
-         << "RX: " << fixed << setprecision(2) << metrics.rxThroughputMBps << " MB/s | "
-         << "TX: " << fixed << setprecision(2) << metrics.txThroughputMBps << " MB/s   ";
+void printMetrics(const ProcessSample& sample, const ProcessSample& previous, double intervalSec,
+                  const map<int, ThreadSample>& threads, const map<int, ThreadSample>& previousThreads) {
+    // The busiest thread says more than the total on a many-core host
+    string busiest = "-";
+    unsigned long long busiestTicks = 0;
+    for (const auto& entry : threads) {
+        auto found = previousThreads.find(entry.first);
+        unsigned long long ticks = entry.second.utime + entry.second.stime;
+        if (found != previousThreads.end()) {
+            ticks -= found->second.utime + found->second.stime;
+        }
+        if (ticks > busiestTicks) {
+            busiestTicks = ticks;
+            busiest = entry.second.name;
+        }
+    }
+
+    cout << "\r[" << fixed << setprecision(1) << sample.elapsedSec << "s] "
+         << "Threads: " << sample.numThreads << " | "
+         << "CPU: " << sample.cpuPercent << "% (" << busiest << " "
+         << ticksPercent(busiestTicks, intervalSec) << "%) | "
+         << "Mem: " << (sample.memoryRssKB / 1024) << " MB | "
+         << "Sockets: " << sample.numSockets << " | "
+         << "CS: " << counterDelta(sample.voluntarySwitches, previous.voluntarySwitches) << "/"
+         << counterDelta(sample.involuntarySwitches, previous.involuntarySwitches);
+    if (sample.haveServer) {
+        cout << " | RX: " << setprecision(2)
+             << rateMBps(sample.serverBytesReceived, previous.serverBytesReceived, intervalSec) << " MB/s"
+             << " | TX: " << rateMBps(sample.serverBytesSent, previous.serverBytesSent, intervalSec) << " MB/s";
+    }
+    cout << "   ";
     cout.flush();
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        cerr << "Usage: " << argv[0] << " <server_pid> <sampling_interval_ms> [output_csv] [duration_seconds]" << endl;
-        cerr << "Example: " << argv[0] << " 12345 1000 server_metrics.csv 300" << endl;
+        cerr << "Usage: " << argv[0]
+             << " <server_pid> <sampling_interval_ms> [output_prefix] [duration_seconds] [unix_socket]" << endl;
+        cerr << "Example: " << argv[0] << " 12345 1000 run1 300 /tmp/ft.sock" << endl;
         return 1;
     }
-    
+
     int serverPid = stoi(argv[1]);
     int samplingIntervalMs = stoi(argv[2]);
-    string outputCsv = (argc >= 4) ? argv[3] : "server_metrics_" + to_string(time(nullptr)) + ".csv";
+    string outputPrefix = (argc >= 4) ? argv[3] : "server_metrics_" + to_string(time(nullptr));
     int durationSeconds = (argc >= 5) ? stoi(argv[4]) : 0;  // 0 means run indefinitely
-    
+    string unixSocket = (argc >= 6) ? argv[5] : "";
+
     cout << "=== Server Metrics Monitor ===" << endl;
     cout << "Server PID: " << serverPid << endl;
     cout << "Sampling Interval: " << samplingIntervalMs << " ms" << endl;
-    cout << "Output CSV: " << outputCsv << endl;
+    cout << "Output: " << outputPrefix << "_{process,threads,sockets}.tsv" << endl;
     if (durationSeconds > 0) {
         cout << "Duration: " << durationSeconds << " seconds" << endl;
     } else {
         cout << "Duration: Indefinite (press Ctrl+C to stop)" << endl;
     }
+    cout << "Session stats: " << (unixSocket.empty() ? string("off (no Unix socket given)") : unixSocket) << endl;
     cout << "============================\n" << endl;
-    
+
     // Check if process exists
     if (!processExists(serverPid)) {
         cerr << "Error: Process with PID " << serverPid << " does not exist" << endl;
         return 1;
     }
-    
+
     // Setup signal handler
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
-    
-    // Open CSV file
-    ofstream csvFile(outputCsv);
-    if (!csvFile.is_open()) {
-        cerr << "Error: Cannot open output CSV file: " << outputCsv << endl;
+    signal(SIGPIPE, SIG_IGN); // A server that goes away must not kill the monitor
+
+    // Open output files
+    ofstream processFile(outputPrefix + "_process.tsv");
+    ofstream threadsFile(outputPrefix + "_threads.tsv");
+    ofstream socketsFile(outputPrefix + "_sockets.tsv");
+    if (!processFile.is_open() || !threadsFile.is_open() || !socketsFile.is_open()) {
+        cerr << "Error: Cannot open output files: " << outputPrefix << "_*.tsv" << endl;
         return 1;
     }
-    writeCSVHeader(csvFile);
-    
+    writeHeaders(processFile, threadsFile, socketsFile);
+
+    // The client library logs every failure; a refused query is reported once below
+    ClientSocket admin;
+    streambuf* clientLog = cerr.rdbuf();
+    bool warnedRefused = false;
+
     cout << "Monitoring started. Press Ctrl+C to stop...\n" << endl;
-    
-    ServerMetrics previousMetrics;
+
+    ProcessSample previous;
+    map<int, ThreadSample> previousThreads;
     auto startTime = steady_clock::now();
-    
+    auto previousTime = startTime;
+    bool first = true;
+
     // Monitoring loop
     while (keepRunning) {
+        auto now = steady_clock::now();
+
         // Check if duration limit reached
-        if (durationSeconds > 0) {
-            auto elapsed = duration_cast<seconds>(steady_clock::now() - startTime).count();
-            if (elapsed >= durationSeconds) {
-                cout << "\nDuration limit reached. Stopping..." << endl;
-                break;
-            }
+        if (durationSeconds > 0 && duration_cast<seconds>(now - startTime).count() >= durationSeconds) {
+            cout << "\nDuration limit reached. Stopping..." << endl;
+            break;
         }
-        
+
         // Check if process still exists
         if (!processExists(serverPid)) {
             cout << "\nServer process terminated. Stopping monitoring..." << endl;
             break;
         }
-        
-        // Collect metrics
-        double intervalSec = samplingIntervalMs / 1000.0;
-        ServerMetrics metrics = collectMetrics(serverPid, previousMetrics, intervalSec);
-        
-        // Write to CSV
-        writeMetricsToCSV(csvFile, metrics);
-        csvFile.flush();
-        
-        // Print to console
-        printMetrics(metrics);
-        
+
+        // The real interval, not the requested one: sampling takes time too
+        ProcessSample sample;
+        sample.elapsedSec = duration<double>(now - startTime).count();
+        double intervalSec = duration<double>(now - previousTime).count();
+        if (!readProcess(serverPid, sample)) {
+            cerr << "Warning: Could not read process stats" << endl;
+            this_thread::sleep_for(milliseconds(samplingIntervalMs));
+            continue;
+        }
+        map<int, ThreadSample> threads = readThreads(serverPid);
+        for (const auto& entry : threads) {
+            sample.voluntarySwitches += entry.second.voluntarySwitches;
+            sample.involuntarySwitches += entry.second.involuntarySwitches;
+        }
+        countFileDescriptors(serverPid, sample.numFileDescriptors, sample.numSockets);
+
+        SessionStatsHeader header{};
+        vector<SessionStatsRecord> records;
+        if (!unixSocket.empty()) {
+            cerr.rdbuf(nullptr);
+            bool answered = querySessionStats(admin, unixSocket, header, records);
+            cerr.rdbuf(clientLog);
+            // A granted reply always lists at least our own admin session
+            sample.haveServer = answered && header.sessions > 0;
+            if (answered && !sample.haveServer && !warnedRefused) {
+                cerr << "Warning: Server refused SESSION_STATS (different user?)" << endl;
+                warnedRefused = true;
+            }
+            sample.serverBytesSent = header.bytesSent;
+            sample.serverBytesReceived = header.bytesReceived;
+            sample.sessions = header.sessions;
+        }
+
+        // The first sample only establishes the baseline for the deltas
+        if (!first) {
+            sample.userPercent = ticksPercent(sample.utime - previous.utime, intervalSec);
+            sample.systemPercent = ticksPercent(sample.stime - previous.stime, intervalSec);
+            sample.cpuPercent = sample.userPercent + sample.systemPercent;
+
+            writeProcessRow(processFile, sample, previous, intervalSec);
+            writeThreadRows(threadsFile, sample.elapsedSec, threads, previousThreads, intervalSec);
+            writeSocketRows(socketsFile, sample.elapsedSec, records);
+            processFile.flush();
+            threadsFile.flush();
+            socketsFile.flush();
+
+            printMetrics(sample, previous, intervalSec, threads, previousThreads);
+        }
+
         // Save for next iteration
-        previousMetrics = metrics;
-        
+        previous = sample;
+        previousThreads = threads;
+        previousTime = now;
+        first = false;
+
         // Wait for next sample
         this_thread::sleep_for(milliseconds(samplingIntervalMs));
     }
-    
-    csvFile.close();
-    
-    cout << "\n\nMonitoring stopped. Results saved to: " << outputCsv << endl;
-    
+
+    cout << "\n\nMonitoring stopped. Results saved to: " << outputPrefix << "_*.tsv" << endl;
+
     return 0;
 }
@@ -10,7 +10,7 @@
 Server* g_server = nullptr;
 
 void signalHandler(int signal) {
-    if (signal == SIGINT || signal == SIGTERM) {
+    if (signal == SIGINT) {
         std::cout << "\n\n[SERVER] Received shutdown signal. Stopping server...\n";
         if (g_server) {
             g_server->stop();
@@ -20,6 +20,22 @@ void signalHandler(int signal) {
     }
 }
 
+// Deploy tools send SIGTERM: let running transfers finish first. drain()
+// locks and waits, so it runs here and not in a signal handler; SIGTERM is
+// blocked in every other thread.
+void drainOnSigterm(sigset_t termSignal) {
+    int signal = 0;
+    if (sigwait(&termSignal, &signal) != 0) {
+        return;
+    }
+    std::cout << "\n\n[SERVER] Received SIGTERM. Draining sessions...\n";
+    if (g_server) {
+        g_server->drain(30);
+    }
+    std::cout << "[SERVER] Cleanup completed. Exiting...\n";
+    std::exit(0);
+}
+
 void printBanner() {
     std::cout << "\n"
               << "╔═══════════════════════════════════════════════════════════╗\n"
@@ -38,6 +54,8 @@ void printHelp() {
     std::cout << "│  export      - Export metrics to CSV file                 │\n";
     std::cout << "│  dir         - Change shared directory                    │\n";
     std::cout << "│  verbose     - Toggle verbose logging                     │\n";
+    std::cout << "│  profile     - Toggle per-command CPU counters            │\n";
+    std::cout << "│  drain       - Finish transfers (30 s max), then exit     │\n";
     std::cout << "│  help        - Display this help menu                     │\n";
     std::cout << "│  quit/exit   - Stop server and exit                       │\n";
     std::cout << "└───────────────────────────────────────────────────────────┘\n";
@@ -57,6 +75,9 @@ int main(int argc, char* argv[]) {
     // Default configuration
     uint16_t port = 8080;
     std::string sharedDir = "./shared";
+    size_t shards = 1;
+    std::string unixSocket;
+    std::string handoffSocket;
     bool verbose = true;
 
     // Parse command line arguments
@@ -71,6 +92,20 @@ int main(int argc, char* argv[]) {
     if (argc >= 3) {
         sharedDir = argv[2];
     }
+    if (argc >= 4) {
+        try {
+            shards = static_cast<size_t>(std::stoul(argv[3]));
+        } catch (...) {
+            std::cerr << "[ERROR] Invalid listener shard count: " << argv[3] << std::endl;
+            return 1;
+        }
+    }
+    if (argc >= 5) {
+        unixSocket = argv[4];
+    }
+    if (argc >= 6) {
+        handoffSocket = argv[5];
+    }
 
     printBanner();
 
@@ -78,18 +113,31 @@ int main(int argc, char* argv[]) {
     Server server;
     g_server = &server;
 
-    // Setup signal handlers
+    // Setup signal handlers; threads started from here on inherit the blocked SIGTERM
     signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
+    sigset_t termSignal;
+    sigemptyset(&termSignal);
+    sigaddset(&termSignal, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &termSignal, nullptr);
 
     // Configure server
     server.setVerbose(verbose);
     server.setMaxConnections(10); // Allow up to 10 concurrent connections
     server.setTimeout(300); // 5 minutes timeout
+    server.setListenerShards(shards); // SO_REUSEPORT accept loops
+    server.setUnixSocket(unixSocket); // Same-host clients
+    if (!unixSocket.empty()) {
+        server.setSharedMemoryRings(ShmChannel::DEFAULT_CAPACITY); // ... and "shm:" clients
+    }
+    server.setHandoffSocket(handoffSocket); // Hot restart: a new server_test takes over
+    server.setDrainTimeout(30);
 
     std::cout << "[SERVER] Starting file transfer server...\n";
     std::cout << "[CONFIG] Port: " << port << "\n";
     std::cout << "[CONFIG] Shared Directory: " << sharedDir << "\n";
+    std::cout << "[CONFIG] Listener Shards: " << server.getListenerShards() << "\n";
+    std::cout << "[CONFIG] Unix Socket: " << (unixSocket.empty() ? "none" : unixSocket) << "\n";
+    std::cout << "[CONFIG] Hot Restart Socket: " << (handoffSocket.empty() ? "none" : handoffSocket) << "\n";
     std::cout << "[CONFIG] Verbose Mode: " << (verbose ? "ON" : "OFF") << "\n";
     std::cout << std::endl;
 
@@ -97,10 +145,12 @@ int main(int argc, char* argv[]) {
     if (!server.start(port, sharedDir)) {
         std::cerr << "[ERROR] Failed to start server on port " << port << std::endl;
         std::cerr << "[TIP] Make sure the port is not already in use.\n";
-        std::cerr << "[TIP] Try using a different port: ./server_test <port> [shared_dir]\n";
+        std::cerr << "[TIP] Try using a different port: ./server_test <port> [shared_dir] [listener_shards] [unix_socket] [handoff_socket]\n";
         return 1;
     }
 
+    std::thread(drainOnSigterm, termSignal).detach();
+
     std::cout << "[SUCCESS] Server started successfully!\n";
     std::cout << "[INFO] Server is listening on port " << port << "\n";
     std::cout << "[INFO] Shared directory: " << sharedDir << "\n";
@@ -112,6 +162,13 @@ int main(int argc, char* argv[]) {
     // Run server in a separate thread
     std::thread serverThread([&server]() {
         server.run();
+
+        // A newer server_test took over the listeners: exit once drained
+        if (server.wasHandedOff()) {
+            server.stop();
+            std::cout << "\n[SERVER] Handed over to the new server. Goodbye!\n\n";
+            std::exit(0);
+        }
     });
     serverThread.detach(); // Detach so we don't block on join
 
@@ -180,11 +237,22 @@ int main(int argc, char* argv[]) {
                 std::cout << "[ERROR] Failed to change directory. Make sure it exists.\n\n";
             }
         }
+        else if (command == "drain") {
+            std::cout << "\n[SERVER] Draining sessions...\n";
+            running = false;
+            server.drain(30);
+            break;
+        }
         else if (command == "verbose") {
             verbose = !verbose;
             server.setVerbose(verbose);
             std::cout << "[INFO] Verbose mode: " << (verbose ? "ON" : "OFF") << "\n\n";
         }
+        else if (command == "profile") {
+            server.setCommandProfiling(!server.getCommandProfiling());
+            std::cout << "[INFO] Per-command CPU counters: " << (server.getCommandProfiling() ? "ON" : "OFF")
+                      << " (new connections; shown by 'metrics')\n\n";
+        }
         else if (command == "status") {
             displayStatus(server);
         }
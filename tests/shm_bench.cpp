@@ -0,0 +1,224 @@
+/**
+ * Shared-Memory Benchmark - ring transport against sockets
+ *
+ * Runs an in-process server with a Unix socket and shared-memory rings
+ * enabled, and drives the unchanged protocol over loopback TCP, the Unix
+ * socket, and the rings:
+ *   - PING round-trip latency (p50/p99),
+ *   - 1 KB GET and PUT operations per second (PUTs are pipelined; a PING
+ *     every 64 PUTs waits for the server to catch up),
+ *   - 16 MB GET throughput.
+ *
+ * Usage: ./shm_bench [seconds_per_case] [pings]
+ * Example: ./shm_bench 1 20000
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static const size_t SMALL_SIZE = 1024;
+static const size_t LARGE_SIZE = 16 * 1024 * 1024;
+static const int PUT_BATCH = 64;
+
+static bool writeFile(const string& path, size_t size) {
+    ofstream out(path, ios::binary);
+    string data(size, 'x');
+    out.write(data.data(), data.size());
+    return out.good();
+}
+
+static bool ping(ClientSocket& socket) {
+    uint8_t cmd = CMD_PING;
+    uint8_t reply = 0;
+    return socket.sendData(&cmd, sizeof(cmd)) == sizeof(cmd) &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+// GET with the file landing in buf
+static bool get(ClientSocket& socket, const string& name, vector<uint8_t>& buf) {
+    uint8_t cmd = CMD_GET;
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    struct iovec iov[2] = {{&cmd, sizeof(cmd)}, {filenameBuf, sizeof(filenameBuf)}};
+    if (socket.sendVectored(iov, 2) < 0) {
+        return false;
+    }
+
+    uint64_t size = 0;
+    if (socket.receiveData(reinterpret_cast<uint8_t*>(&size), sizeof(size)) != sizeof(size) ||
+        size == 0 || size > buf.size()) {
+        return false;
+    }
+    return socket.receiveData(buf.data(), size) == static_cast<ssize_t>(size);
+}
+
+// PUT has no reply; the caller syncs with a PING
+static bool put(ClientSocket& socket, const string& name, const vector<uint8_t>& data) {
+    uint8_t cmd = CMD_PUT;
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    uint64_t size = data.size();
+    struct iovec iov[4] = {{&cmd, sizeof(cmd)},
+                           {filenameBuf, sizeof(filenameBuf)},
+                           {&size, sizeof(size)},
+                           {const_cast<uint8_t*>(data.data()), data.size()}};
+    return socket.sendVectored(iov, 4) >= 0;
+}
+
+static bool connectTo(ClientSocket& socket, const string& transport, uint16_t port, const string& path) {
+    if (transport == "tcp") {
+        return socket.connectToServer("127.0.0.1", port);
+    }
+    return socket.connectToServer(transport + ":" + path, 0);
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+    int pings = (argc > 2) ? atoi(argv[2]) : 20000;
+    if (seconds <= 0 || pings <= 0) {
+        cerr << "Usage: " << argv[0] << " [seconds_per_case] [pings]\n";
+        return 1;
+    }
+
+    // Client and server log every request; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    char serverTemplate[] = "/tmp/shm_bench_XXXXXX";
+    if (!mkdtemp(serverTemplate)) {
+        report << "Error: Cannot create temporary directory\n";
+        return 1;
+    }
+    string serverDir = serverTemplate;
+    string socketPath = serverDir + "/server.sock";
+    writeFile(serverDir + "/small.bin", SMALL_SIZE);
+    writeFile(serverDir + "/large.bin", LARGE_SIZE);
+
+    Server server;
+    server.setUnixSocket(socketPath);
+    server.setSharedMemoryRings(ShmChannel::DEFAULT_CAPACITY);
+    if (!server.start(0, serverDir)) {
+        report << "Error: Cannot start server\n";
+        return 1;
+    }
+    uint16_t port = server.getPort();
+    thread serverThread([&server]() { server.run(); });
+
+    report << "Shared-memory benchmark: " << seconds << " s per case, " << pings << " pings, "
+           << sysconf(_SC_NPROCESSORS_ONLN) << " CPU(s) online\n";
+    report << string(78, '-') << "\n";
+    report << left << setw(11) << "Transport"
+           << setw(13) << "PING p50 us" << setw(13) << "PING p99 us"
+           << setw(14) << "GET 1KB op/s" << setw(14) << "PUT 1KB op/s" << "GET 16MB MB/s" << "\n";
+    report << string(78, '-') << "\n";
+
+    vector<uint8_t> buf(LARGE_SIZE);
+    vector<uint8_t> upload(SMALL_SIZE, 'u');
+    bool allOk = true;
+    int connections = 0;
+    for (const string transport : {"tcp", "unix", "shm"}) {
+        ClientSocket socket;
+        if (!connectTo(socket, transport, port, socketPath)) {
+            report << left << setw(11) << transport << "cannot connect\n";
+            allOk = false;
+            continue;
+        }
+        connections++;
+        bool ok = true;
+
+        // Latency: one outstanding PING at a time
+        for (int i = 0; i < 100 && ok; ++i) {
+            ok = ping(socket);
+        }
+        vector<double> rtt;
+        rtt.reserve(pings);
+        for (int i = 0; i < pings && ok; ++i) {
+            auto start = steady_clock::now();
+            ok = ping(socket);
+            rtt.push_back(duration<double, micro>(steady_clock::now() - start).count());
+        }
+        sort(rtt.begin(), rtt.end());
+        double p50 = rtt.empty() ? 0.0 : rtt[rtt.size() / 2];
+        double p99 = rtt.empty() ? 0.0 : rtt[rtt.size() * 99 / 100];
+
+        // Small GETs back-to-back
+        uint64_t gets = 0;
+        auto start = steady_clock::now();
+        auto deadline = start + duration<double>(seconds);
+        while (ok && steady_clock::now() < deadline) {
+            ok = get(socket, "small.bin", buf);
+            gets += ok ? 1 : 0;
+        }
+        double getRate = gets / duration<double>(steady_clock::now() - start).count();
+
+        // Small PUTs, pipelined in batches
+        uint64_t puts = 0;
+        string putName = "put_" + transport + ".bin";
+        start = steady_clock::now();
+        deadline = start + duration<double>(seconds);
+        while (ok && steady_clock::now() < deadline) {
+            for (int i = 0; i < PUT_BATCH && ok; ++i) {
+                ok = put(socket, putName, upload);
+            }
+            ok = ok && ping(socket);
+            puts += ok ? PUT_BATCH : 0;
+        }
+        double putRate = puts / duration<double>(steady_clock::now() - start).count();
+
+        // Large GETs
+        uint64_t large = 0;
+        start = steady_clock::now();
+        deadline = start + duration<double>(seconds);
+        while (ok && steady_clock::now() < deadline) {
+            ok = get(socket, "large.bin", buf);
+            large += ok ? 1 : 0;
+        }
+        double largeRate = large * (LARGE_SIZE / (1024.0 * 1024.0)) /
+                           duration<double>(steady_clock::now() - start).count();
+        socket.disconnect();
+        unlink((serverDir + "/" + putName).c_str());
+
+        report << left << setw(11) << transport << fixed
+               << setprecision(1) << setw(13) << p50 << setw(13) << p99
+               << setprecision(0) << setw(14) << getRate << setw(14) << putRate
+               << largeRate << (ok ? "" : "  FAILED") << endl;
+        allOk = allOk && ok;
+    }
+    report << string(78, '-') << "\n";
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        report << "Single CPU: the rings never spin, every wait is a futex sleep.\n";
+    }
+
+    // Let the session threads finish before the server tears sessions down
+    int closed = 0;
+    ServerEvent event;
+    while (closed < connections && server.waitEvent(event, 1000)) {
+        if (event.type == ServerEventType::SessionClosed) {
+            closed++;
+        }
+    }
+    this_thread::sleep_for(milliseconds(50));
+    server.stop();
+    serverThread.join();
+
+    unlink((serverDir + "/small.bin").c_str());
+    unlink((serverDir + "/large.bin").c_str());
+    rmdir(serverDir.c_str());
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/**
+ * Small File Benchmark - GET/PUT operations per second for small files
+ *
+ * Runs an in-process server on an ephemeral port and a single client
+ * connection against it, then measures back-to-back GET and PUT requests
+ * for 1 KB - 64 KB files.
+ *
+ * Usage: ./small_file_bench [ops_per_size]
+ * Example: ./small_file_bench 2000
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static bool writeFile(const string& path, size_t size) {
+    ofstream out(path, ios::binary);
+    string data(size, 'x');
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<char>('a' + (i % 26));
+    }
+    out.write(data.data(), data.size());
+    return out.good();
+}
+
+int main(int argc, char* argv[]) {
+    int ops = (argc > 1) ? atoi(argv[1]) : 2000;
+    if (ops <= 0) {
+        cerr << "Usage: " << argv[0] << " [ops_per_size]\n";
+        return 1;
+    }
+
+    // Client and server log every request; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    char serverTemplate[] = "/tmp/small_bench_srv_XXXXXX";
+    char clientTemplate[] = "/tmp/small_bench_cli_XXXXXX";
+    if (!mkdtemp(serverTemplate) || !mkdtemp(clientTemplate)) {
+        report << "Error: Cannot create temporary directories\n";
+        return 1;
+    }
+    string serverDir = serverTemplate;
+    string clientDir = clientTemplate;
+
+    Server server;
+    Client client;
+    if (!server.start(0, serverDir)) {
+        report << "Error: Cannot start server\n";
+        return 1;
+    }
+    uint16_t port = server.getPort();
+    thread serverThread([&server]() { server.run(); });
+
+    if (!client.connect("127.0.0.1", port)) {
+        report << "Error: Cannot connect to 127.0.0.1:" << port << "\n";
+        server.stop();
+        serverThread.join();
+        return 1;
+    }
+
+    report << "Small file benchmark: " << ops << " ops per size, port " << port << "\n";
+    report << string(60, '-') << "\n";
+    report << left << setw(10) << "Size"
+           << setw(16) << "GET ops/sec"
+           << setw(16) << "PUT ops/sec"
+           << setw(10) << "Failures" << "\n";
+    report << string(60, '-') << "\n";
+
+    const vector<size_t> sizes = {1024, 4 * 1024, 16 * 1024, 64 * 1024};
+    bool allOk = true;
+
+    for (size_t size : sizes) {
+        string name = "bench_" + to_string(size / 1024) + "k.bin";
+        string localPath = clientDir + "/" + name;
+        writeFile(localPath, size);
+
+        int failures = 0;
+
+        // Seed the server copy
+        if (!client.putFile(localPath)) {
+            failures++;
+        }
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < ops; ++i) {
+            if (!client.putFile(localPath)) {
+                failures++;
+            }
+        }
+        // PUT has no reply; a LIST round trip waits for the server to drain
+        client.getFileList();
+        double putSec = duration<double>(steady_clock::now() - start).count();
+
+        start = steady_clock::now();
+        for (int i = 0; i < ops; ++i) {
+            if (!client.getFile(name, clientDir)) {
+                failures++;
+            }
+        }
+        double getSec = duration<double>(steady_clock::now() - start).count();
+
+        double getOps = ops / getSec;
+        double putOps = ops / putSec;
+
+        report << left << setw(10) << (to_string(size / 1024) + " KB")
+               << fixed << setprecision(0)
+               << setw(16) << getOps
+               << setw(16) << putOps
+               << setw(10) << failures << endl;
+        allOk = allOk && failures == 0;
+
+        unlink(localPath.c_str());
+        unlink((serverDir + "/" + name).c_str());
+    }
+    report << string(60, '-') << "\n";
+
+    // Let the session thread finish before the server tears sessions down
+    client.disconnect();
+    ServerEvent event;
+    while (server.waitEvent(event, 1000)) {
+        if (event.type == ServerEventType::SessionClosed) {
+            break;
+        }
+    }
+    this_thread::sleep_for(milliseconds(50));
+    server.stop();
+    serverThread.join();
+    rmdir(serverDir.c_str());
+    rmdir(clientDir.c_str());
+
+    return allOk ? 0 : 1;
+}
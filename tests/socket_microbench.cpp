@@ -0,0 +1,387 @@
+/**
+ * Socket Microbenchmark - send/receive primitives in isolation
+ *
+ * Streams fixed-size chunks from one thread to another and times the
+ * innermost transfer loops on their own, without protocol or file I/O:
+ *   - raw:          bare send()/recv() loops, the floor to compare against
+ *   - ServerSocket: ServerSocket::sendData -> ServerSocket::receiveData
+ *   - upload:       ClientSocket::sendData -> ServerSocket::receiveData
+ *   - download:     ServerSocket::sendData -> ClientSocket::receiveData
+ * over a socketpair (raw and ServerSocket only; ClientSocket cannot wrap
+ * one) and over loopback TCP, for chunk sizes from 1 B to 8 MiB. The
+ * difference to the raw row at the same size is what the wrappers' loops
+ * and checks cost per call.
+ *
+ * A second table times the error paths, where the wrappers log: receive
+ * at EOF and send to a closed peer, with the log streams writing to
+ * /dev/null so the formatting is paid for.
+ *
+ * Socket options for the sweep: --sndbuf/--rcvbuf BYTES, --nodelay,
+ * --more (ServerSocket::sendData with MSG_MORE).
+ *
+ * Usage: ./socket_microbench [--sizes 1,64,4K,64K,1M,8M] [--budget MB]
+ *                            [--max-calls N] [--sndbuf B] [--rcvbuf B]
+ *                            [--nodelay] [--more]
+ * Example: ./socket_microbench --sizes 4K,64K --nodelay
+ */
+
+#include "../include/client.h"
+#include "../include/core/Server/server_socket.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace std::chrono;
+
+struct Options {
+    int sndbuf = 0;
+    int rcvbuf = 0;
+    bool nodelay = false;
+    bool more = false;
+    size_t budget = 128 * 1024 * 1024; // Bytes per cell
+    size_t maxCalls = 100000;
+};
+
+static void tune(int fd, const Options& options, bool tcp) {
+    if (options.sndbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &options.sndbuf, sizeof(options.sndbuf));
+    }
+    if (options.rcvbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.rcvbuf, sizeof(options.rcvbuf));
+    }
+    if (tcp && options.nodelay) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+// Loopback TCP listener on an ephemeral port
+static int listenTcp(uint16_t& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &len) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+struct Result {
+    size_t calls = 0;
+    double seconds = 0.0;
+    bool ok = false;
+};
+
+// Runs sender and receiver on their own threads; each returns false on error
+static Result stream(size_t calls, const function<bool(size_t)>& send, const function<bool(size_t)>& receive) {
+    Result result;
+    result.calls = calls;
+    atomic<bool> receiveOk(true);
+    auto start = steady_clock::now();
+    thread receiver([&]() {
+        for (size_t i = 0; i < calls; ++i) {
+            if (!receive(i)) {
+                receiveOk = false;
+                return;
+            }
+        }
+    });
+    bool sendOk = true;
+    for (size_t i = 0; i < calls && sendOk; ++i) {
+        sendOk = send(i);
+    }
+    receiver.join();
+    result.seconds = duration<double>(steady_clock::now() - start).count();
+    result.ok = sendOk && receiveOk;
+    return result;
+}
+
+static bool rawSend(int fd, const uint8_t* data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+static bool rawReceive(int fd, uint8_t* buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n <= 0) {
+            return false;
+        }
+        received += n;
+    }
+    return true;
+}
+
+static string formatSize(size_t size) {
+    if (size >= 1024 * 1024 && size % (1024 * 1024) == 0) {
+        return to_string(size / (1024 * 1024)) + "M";
+    }
+    if (size >= 1024 && size % 1024 == 0) {
+        return to_string(size / 1024) + "K";
+    }
+    return to_string(size);
+}
+
+static bool parseSize(const string& text, size_t& size) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 1) {
+        return false;
+    }
+    string unit(end);
+    if (unit == "K") {
+        value *= 1024;
+    } else if (unit == "M") {
+        value *= 1024 * 1024;
+    } else if (!unit.empty()) {
+        return false;
+    }
+    size = static_cast<size_t>(value);
+    return true;
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [--sizes 1,64,4K,64K,1M,8M] [--budget MB] [--max-calls N]\n"
+         << "       [--sndbuf B] [--rcvbuf B] [--nodelay] [--more]\n";
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    vector<size_t> sizes;
+    for (size_t size = 1; size <= 8 * 1024 * 1024; size *= 4) {
+        sizes.push_back(size);
+    }
+    sizes.push_back(8 * 1024 * 1024);
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--nodelay") {
+            options.nodelay = true;
+        } else if (arg == "--more") {
+            options.more = true;
+        } else if (i + 1 < argc && arg == "--sizes") {
+            sizes.clear();
+            stringstream list(argv[++i]);
+            string item;
+            while (getline(list, item, ',')) {
+                size_t size = 0;
+                if (!parseSize(item, size)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                sizes.push_back(size);
+            }
+        } else if (i + 1 < argc && arg == "--budget") {
+            options.budget = static_cast<size_t>(atof(argv[++i]) * 1024 * 1024);
+        } else if (i + 1 < argc && arg == "--max-calls") {
+            options.maxCalls = static_cast<size_t>(atol(argv[++i]));
+        } else if (i + 1 < argc && arg == "--sndbuf") {
+            options.sndbuf = atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--rcvbuf") {
+            options.rcvbuf = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (sizes.empty() || options.budget == 0 || options.maxCalls == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // ClientSocket::sendData does not pass MSG_NOSIGNAL
+    signal(SIGPIPE, SIG_IGN);
+
+    // The wrappers log on errors only; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    ofstream devNull("/dev/null");
+    cout.rdbuf(devNull.rdbuf());
+    cerr.rdbuf(devNull.rdbuf());
+
+    size_t largest = *max_element(sizes.begin(), sizes.end());
+    vector<uint8_t> out(largest, 'x');
+    vector<uint8_t> in(largest);
+
+    // Connections live for the whole sweep
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        report << "Error: socketpair failed\n";
+        return 1;
+    }
+    tune(pair[0], options, false);
+    tune(pair[1], options, false);
+
+    uint16_t port = 0;
+    int listener = listenTcp(port);
+    int tcpA = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listener < 0 || connect(tcpA, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        report << "Error: Cannot set up loopback TCP\n";
+        return 1;
+    }
+    int tcpB = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    ClientSocket client;
+    if (tcpB < 0 || !client.connectToServer("127.0.0.1", port)) {
+        report << "Error: Cannot set up loopback TCP\n";
+        return 1;
+    }
+    int clientPeer = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    tune(tcpA, options, true);
+    tune(tcpB, options, true);
+    tune(client.getSocketFd(), options, true);
+    tune(clientPeer, options, true);
+
+    report << "Socket microbenchmark: up to " << options.budget / (1024 * 1024) << " MB or " << options.maxCalls
+           << " calls per cell";
+    if (options.sndbuf || options.rcvbuf) {
+        report << ", SO_SNDBUF " << options.sndbuf << ", SO_RCVBUF " << options.rcvbuf;
+    }
+    report << (options.nodelay ? ", TCP_NODELAY" : "") << (options.more ? ", MSG_MORE" : "") << "\n";
+    report << string(84, '-') << "\n";
+    report << left << setw(12) << "Transport" << setw(14) << "Path" << setw(8) << "Chunk" << setw(10) << "Calls"
+           << setw(12) << "ns/op" << setw(10) << "GB/s" << "vs raw\n";
+    report << string(84, '-') << "\n";
+
+    bool more = options.more;
+    bool allOk = true;
+    for (size_t size : sizes) {
+        size_t calls = min(options.maxCalls, max<size_t>(options.budget / size, 16));
+        struct Case {
+            const char* transport;
+            const char* path;
+            function<bool(size_t)> send;
+            function<bool(size_t)> receive;
+        };
+        vector<Case> cases = {
+            {"socketpair", "raw", [&](size_t) { return rawSend(pair[0], out.data(), size); },
+             [&](size_t) { return rawReceive(pair[1], in.data(), size); }},
+            {"socketpair", "ServerSocket",
+             [&](size_t) { return ServerSocket::sendData(pair[0], out.data(), size, more) == (ssize_t)size; },
+             [&](size_t) { return ServerSocket::receiveData(pair[1], in.data(), size) == (ssize_t)size; }},
+            {"tcp", "raw", [&](size_t) { return rawSend(tcpA, out.data(), size); },
+             [&](size_t) { return rawReceive(tcpB, in.data(), size); }},
+            {"tcp", "ServerSocket",
+             [&](size_t) { return ServerSocket::sendData(tcpA, out.data(), size, more) == (ssize_t)size; },
+             [&](size_t) { return ServerSocket::receiveData(tcpB, in.data(), size) == (ssize_t)size; }},
+            {"tcp", "upload", [&](size_t) { return client.sendData(out.data(), size) == (ssize_t)size; },
+             [&](size_t) { return ServerSocket::receiveData(clientPeer, in.data(), size) == (ssize_t)size; }},
+            {"tcp", "download",
+             [&](size_t) { return ServerSocket::sendData(clientPeer, out.data(), size, more) == (ssize_t)size; },
+             [&](size_t) { return client.receiveData(in.data(), size) == (ssize_t)size; }},
+        };
+
+        double rawNs = 0.0;
+        for (const Case& c : cases) {
+            Result r = stream(calls, c.send, c.receive);
+            double ns = r.seconds * 1e9 / r.calls;
+            bool raw = string(c.path) == "raw";
+            if (raw) {
+                rawNs = ns;
+            }
+            report << left << setw(12) << c.transport << setw(14) << c.path << setw(8) << formatSize(size) << setw(10)
+                   << r.calls << fixed << setprecision(1) << setw(12) << ns << setprecision(3) << setw(10)
+                   << (static_cast<double>(size) * r.calls / r.seconds / 1e9);
+            if (!r.ok) {
+                report << "FAILED";
+                allOk = false;
+            } else if (!raw && rawNs > 0.0) {
+                report << showpos << setprecision(1) << (ns / rawNs - 1.0) * 100.0 << "%" << noshowpos;
+            }
+            report << endl;
+            if (!r.ok) {
+                break; // The stream is out of step now
+            }
+        }
+        if (!allOk) {
+            break;
+        }
+    }
+    report << string(84, '-') << "\n";
+
+    // Error paths: every call fails and logs (to /dev/null)
+    const size_t errorCalls = 100000;
+    int eofPair[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, eofPair);
+    close(eofPair[1]);
+    client.disconnect();
+    ClientSocket closedClient;
+    closedClient.connectToServer("127.0.0.1", port);
+    int closedPeer = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    close(closedPeer);
+    usleep(10000); // Let the FIN arrive
+    uint8_t byte = 0;
+    closedClient.sendData(&byte, 1); // Draws the RST; sends fail from here on
+
+    struct ErrorCase {
+        const char* name;
+        function<bool()> call;
+    };
+    vector<ErrorCase> errorCases = {
+        {"raw recv at EOF", [&]() { return recv(eofPair[0], in.data(), 1, 0) == 0; }},
+        {"ServerSocket::receiveData at EOF (logs)",
+         [&]() { return ServerSocket::receiveData(eofPair[0], in.data(), 1) == 0; }},
+        {"ClientSocket::receiveData at EOF", [&]() { return closedClient.receiveData(in.data(), 1) <= 0; }},
+        {"raw send to closed peer", [&]() { return send(eofPair[0], out.data(), 1, MSG_NOSIGNAL) < 0; }},
+        {"ServerSocket::sendData to closed peer (logs)",
+         [&]() { return ServerSocket::sendData(eofPair[0], out.data(), 1) < 0; }},
+        {"ClientSocket::sendData to closed peer (logs)", [&]() { return closedClient.sendData(out.data(), 1) < 0; }},
+    };
+    report << left << setw(48) << "Error path" << setw(10) << "Calls" << "ns/op\n";
+    report << string(84, '-') << "\n";
+    for (const ErrorCase& c : errorCases) {
+        bool ok = true;
+        auto start = steady_clock::now();
+        for (size_t i = 0; i < errorCalls && ok; ++i) {
+            ok = c.call();
+        }
+        double ns = duration<double, nano>(steady_clock::now() - start).count() / errorCalls;
+        report << left << setw(48) << c.name << setw(10) << errorCalls << fixed << setprecision(1) << ns
+               << (ok ? "" : "  (call did not fail as expected)") << endl;
+    }
+    report << string(84, '-') << "\n";
+
+    cout.rdbuf(report.rdbuf());
+    cerr.rdbuf(report.rdbuf());
+    close(pair[0]);
+    close(pair[1]);
+    close(eofPair[0]);
+    close(tcpA);
+    close(tcpB);
+    close(clientPeer);
+    close(listener);
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,532 @@
+/**
+ * Transfer Benchmark - loopback GET/PUT/LIST/PING matrix with JSON output
+ *
+ * Self-contained replacement for the hand-run throughput tests: starts an
+ * in-process server on an ephemeral port, generates the test files in a
+ * tmpfs directory (/dev/shm when available), and runs every operation at
+ * every file size and concurrency level for a fixed time. Each client
+ * thread has its own connection and issues one request at a time.
+ *
+ * Per cell it reports:
+ *   - ops/s and MB/s (file bytes only),
+ *   - latency p50/p99/max; a PUT is timed until a PING behind it returns,
+ *     i.e. until the server has stored the file,
+ *   - process CPU seconds (client and server together) per GB moved,
+ *   - syscalls per op: exact when the raw_syscalls tracepoint can be
+ *     counted with perf_event_open, otherwise read/write-class syscalls
+ *     from /proc/self/io (socket send/recv are not in that count);
+ *     "syscall_source" in the output says which.
+ *
+ * The JSON document goes to stdout, or to --output with a table on stdout.
+ *
+ * Usage: ./transfer_bench [--seconds S] [--sizes 4K,64K,1M,16M]
+ *                         [--concurrency 1,4,16] [--ops GET,PUT,LIST,PING]
+ *                         [--dir DIR] [--output FILE]
+ * Example: ./transfer_bench --seconds 2 --sizes 1M --output build.json
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+using namespace std::chrono;
+
+struct Cell {
+    string op;
+    size_t size = 0;
+    int concurrency = 0;
+    uint64_t ops = 0;
+    uint64_t errors = 0;
+    double seconds = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+    double cpuSeconds = 0.0;
+    uint64_t syscalls = 0;
+};
+
+// Whole-process syscall counter: the raw_syscalls:sys_enter tracepoint if
+// perf allows it, /proc/self/io otherwise
+class SyscallCounter {
+public:
+    SyscallCounter() : fd_(-1) {
+        for (const char* path : {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                                 "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"}) {
+            ifstream idFile(path);
+            uint64_t id = 0;
+            if (!(idFile >> id)) {
+                continue;
+            }
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_TRACEPOINT;
+            attr.size = sizeof(attr);
+            attr.config = id;
+            attr.inherit = 1; // Threads created from here on count too
+            fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+            if (fd_ >= 0) {
+                break;
+            }
+        }
+    }
+
+    ~SyscallCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    const char* source() const {
+        return fd_ >= 0 ? "tracepoint" : "proc_io";
+    }
+
+    // Inherited counts of a thread are added once it exits: read with
+    // the threads of interest gone
+    uint64_t read() const {
+        if (fd_ >= 0) {
+            uint64_t value = 0;
+            return ::read(fd_, &value, sizeof(value)) == sizeof(value) ? value : 0;
+        }
+        ifstream io("/proc/self/io");
+        string key;
+        uint64_t value;
+        uint64_t total = 0;
+        while (io >> key >> value) {
+            if (key == "syscr:" || key == "syscw:") {
+                total += value;
+            }
+        }
+        return total;
+    }
+
+private:
+    int fd_;
+};
+
+static double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static bool parseSize(const string& text, size_t& size) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value <= 0) {
+        return false;
+    }
+    string unit(end);
+    if (unit == "K" || unit == "KB") {
+        value *= 1024;
+    } else if (unit == "M" || unit == "MB") {
+        value *= 1024 * 1024;
+    } else if (unit == "G" || unit == "GB") {
+        value *= 1024.0 * 1024 * 1024;
+    } else if (!unit.empty()) {
+        return false;
+    }
+    size = static_cast<size_t>(value);
+    return true;
+}
+
+static string formatSize(size_t size) {
+    if (size >= 1024 * 1024 && size % (1024 * 1024) == 0) {
+        return to_string(size / (1024 * 1024)) + "M";
+    }
+    if (size >= 1024 && size % 1024 == 0) {
+        return to_string(size / 1024) + "K";
+    }
+    return to_string(size);
+}
+
+static vector<string> splitList(const string& text) {
+    vector<string> items;
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static bool writeFile(const string& path, size_t size) {
+    ofstream out(path, ios::binary);
+    string chunk(1024 * 1024, 'x');
+    for (size_t i = 0; i < chunk.size(); ++i) {
+        chunk[i] = static_cast<char>('a' + (i % 26));
+    }
+    for (size_t written = 0; written < size; written += chunk.size()) {
+        out.write(chunk.data(), min(chunk.size(), size - written));
+    }
+    return out.good();
+}
+
+static bool sendCommand(ClientSocket& socket, uint8_t cmd, const string& name) {
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    struct iovec iov[2] = {{&cmd, sizeof(cmd)}, {filenameBuf, sizeof(filenameBuf)}};
+    return socket.sendVectored(iov, 2) >= 0;
+}
+
+static bool ping(ClientSocket& socket) {
+    uint8_t cmd = CMD_PING;
+    uint8_t reply = 0;
+    return socket.sendData(&cmd, sizeof(cmd)) == sizeof(cmd) &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+static bool get(ClientSocket& socket, const string& name, vector<uint8_t>& buf) {
+    if (!sendCommand(socket, CMD_GET, name)) {
+        return false;
+    }
+    uint64_t size = 0;
+    if (socket.receiveData(reinterpret_cast<uint8_t*>(&size), sizeof(size)) != sizeof(size) || size == 0) {
+        return false;
+    }
+    // Stream through a fixed buffer, as a client writing to disk would
+    for (uint64_t received = 0; received < size;) {
+        size_t chunk = static_cast<size_t>(min<uint64_t>(buf.size(), size - received));
+        if (socket.receiveData(buf.data(), chunk) != static_cast<ssize_t>(chunk)) {
+            return false;
+        }
+        received += chunk;
+    }
+    return true;
+}
+
+static bool put(ClientSocket& socket, const string& name, const vector<uint8_t>& data) {
+    uint8_t cmd = CMD_PUT;
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    uint64_t size = data.size();
+    uint8_t pingCmd = CMD_PING;
+    // PUT has no reply: the PING behind it returns once the file is stored.
+    // Both go in one write so Nagle does not hold the PING back.
+    struct iovec iov[5] = {{&cmd, sizeof(cmd)},
+                           {filenameBuf, sizeof(filenameBuf)},
+                           {&size, sizeof(size)},
+                           {const_cast<uint8_t*>(data.data()), data.size()},
+                           {&pingCmd, sizeof(pingCmd)}};
+    uint8_t reply = 0;
+    return socket.sendVectored(iov, 5) >= 0 &&
+           socket.receiveData(&reply, sizeof(reply)) == sizeof(reply) && reply == CMD_PING;
+}
+
+static bool listFiles(ClientSocket& socket) {
+    uint8_t cmd = CMD_LIST;
+    uint32_t count = 0;
+    if (socket.sendData(&cmd, sizeof(cmd)) != sizeof(cmd) ||
+        socket.receiveData(reinterpret_cast<uint8_t*>(&count), sizeof(count)) != sizeof(count)) {
+        return false;
+    }
+    char filenameBuf[256];
+    for (uint32_t i = 0; i < count; ++i) {
+        if (socket.receiveData(reinterpret_cast<uint8_t*>(filenameBuf), sizeof(filenameBuf)) != sizeof(filenameBuf)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Cell runCell(Server& server, const SyscallCounter& counter, const string& op, size_t size,
+                    int concurrency, double seconds) {
+    Cell cell;
+    cell.op = op;
+    cell.size = size;
+    cell.concurrency = concurrency;
+
+    vector<ClientSocket> sockets(concurrency);
+    for (auto& socket : sockets) {
+        if (!socket.connectToServer("127.0.0.1", server.getPort())) {
+            cell.errors++;
+        }
+    }
+    while (server.getActiveSessionCount() < static_cast<size_t>(concurrency) - cell.errors) {
+        this_thread::sleep_for(milliseconds(1));
+    }
+
+    string getName = "get_" + formatSize(size) + ".bin";
+    vector<vector<double>> latencies(concurrency);
+    vector<uint64_t> errors(concurrency, 0);
+    atomic<int> ready(0);
+    atomic<bool> go(false);
+    time_point<steady_clock> deadline;
+
+    vector<thread> workers;
+    for (int w = 0; w < concurrency; ++w) {
+        workers.emplace_back([&, w]() {
+            ClientSocket& socket = sockets[w];
+            vector<uint8_t> buf(op == "PUT" ? size : min<size_t>(max<size_t>(size, 1), 1024 * 1024));
+            string putName = "put_" + to_string(w) + ".bin";
+            latencies[w].reserve(1 << 16);
+            ready++;
+            while (!go) {
+                this_thread::yield();
+            }
+            bool ok = socket.isConnected();
+            while (ok && steady_clock::now() < deadline) {
+                auto start = steady_clock::now();
+                if (op == "GET") {
+                    ok = get(socket, getName, buf);
+                } else if (op == "PUT") {
+                    ok = put(socket, putName, buf);
+                } else if (op == "LIST") {
+                    ok = listFiles(socket);
+                } else {
+                    ok = ping(socket);
+                }
+                if (ok) {
+                    latencies[w].push_back(duration<double, micro>(steady_clock::now() - start).count());
+                }
+            }
+            errors[w] += ok ? 0 : 1;
+        });
+    }
+    while (ready < concurrency) {
+        this_thread::yield();
+    }
+
+    uint64_t syscallsBefore = counter.read();
+    double cpuBefore = cpuSeconds();
+    auto start = steady_clock::now();
+    deadline = start + duration_cast<steady_clock::duration>(duration<double>(seconds));
+    go = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    cell.seconds = duration<double>(steady_clock::now() - start).count();
+
+    // Session threads must exit before their syscalls show in the counter
+    for (auto& socket : sockets) {
+        socket.disconnect();
+    }
+    while (server.getActiveSessionCount() > 0) {
+        this_thread::sleep_for(milliseconds(1));
+    }
+    cell.cpuSeconds = cpuSeconds() - cpuBefore;
+    cell.syscalls = counter.read() - syscallsBefore;
+
+    vector<double> all;
+    for (int w = 0; w < concurrency; ++w) {
+        all.insert(all.end(), latencies[w].begin(), latencies[w].end());
+        cell.errors += errors[w];
+    }
+    sort(all.begin(), all.end());
+    cell.ops = all.size();
+    if (!all.empty()) {
+        cell.p50Us = all[all.size() / 2];
+        cell.p99Us = all[min(all.size() - 1, all.size() * 99 / 100)];
+        cell.maxUs = all.back();
+    }
+    return cell;
+}
+
+static void writeJson(ostream& out, const vector<Cell>& cells, double seconds, const string& dir,
+                      const char* syscallSource) {
+    struct utsname host;
+    uname(&host);
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << fixed << setprecision(3);
+    out << "{\n";
+    out << "  \"benchmark\": \"transfer_bench\",\n";
+    out << "  \"timestamp\": \"" << timestamp << "\",\n";
+    out << "  \"host\": {\"cpus\": " << sysconf(_SC_NPROCESSORS_ONLN) << ", \"kernel\": \"" << host.release << "\"},\n";
+    out << "  \"config\": {\"seconds\": " << seconds << ", \"dir\": \"" << dir
+        << "\", \"syscall_source\": \"" << syscallSource << "\"},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const Cell& c = cells[i];
+        double bytes = static_cast<double>(c.size) * c.ops;
+        out << "    {\"op\": \"" << c.op << "\", \"size\": " << c.size << ", \"concurrency\": " << c.concurrency
+            << ", \"ops\": " << c.ops << ", \"errors\": " << c.errors << ", \"seconds\": " << c.seconds
+            << ", \"ops_per_sec\": " << (c.ops / c.seconds)
+            << ", \"mb_per_sec\": " << (bytes / (1024.0 * 1024.0) / c.seconds)
+            << ", \"p50_us\": " << c.p50Us << ", \"p99_us\": " << c.p99Us << ", \"max_us\": " << c.maxUs
+            << ", \"cpu_seconds\": " << c.cpuSeconds << ", \"cpu_seconds_per_gb\": ";
+        if (bytes > 0) {
+            out << c.cpuSeconds / (bytes / 1e9);
+        } else {
+            out << "null";
+        }
+        out << ", \"syscalls_per_op\": ";
+        if (c.ops > 0) {
+            out << static_cast<double>(c.syscalls) / c.ops;
+        } else {
+            out << "null";
+        }
+        out << "}" << (i + 1 < cells.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void writeTable(ostream& out, const vector<Cell>& cells) {
+    out << string(96, '-') << "\n";
+    out << left << setw(6) << "Op" << setw(8) << "Size" << setw(6) << "Conc" << setw(12) << "ops/s"
+        << setw(11) << "MB/s" << setw(11) << "p50 us" << setw(11) << "p99 us" << setw(12) << "CPU s/GB"
+        << setw(11) << "sys/op" << "Errors\n";
+    out << string(96, '-') << "\n";
+    for (const Cell& c : cells) {
+        double bytes = static_cast<double>(c.size) * c.ops;
+        out << left << setw(6) << c.op << setw(8) << (c.size ? formatSize(c.size) : "-") << setw(6) << c.concurrency
+            << fixed << setprecision(0) << setw(12) << c.ops / c.seconds << setprecision(1)
+            << setw(11) << bytes / (1024.0 * 1024.0) / c.seconds << setw(11) << c.p50Us << setw(11) << c.p99Us;
+        if (bytes > 0) {
+            out << setprecision(2) << setw(12) << c.cpuSeconds / (bytes / 1e9);
+        } else {
+            out << setw(12) << "-";
+        }
+        out << setprecision(1) << setw(11) << (c.ops ? static_cast<double>(c.syscalls) / c.ops : 0.0) << c.errors << endl;
+    }
+    out << string(96, '-') << "\n";
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [--seconds S] [--sizes 4K,64K,1M,16M] [--concurrency 1,4,16]\n"
+         << "       [--ops GET,PUT,LIST,PING] [--dir DIR] [--output FILE]\n";
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 1.0;
+    vector<size_t> sizes = {4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    vector<int> levels = {1, 4, 16};
+    vector<string> ops = {"GET", "PUT", "LIST", "PING"};
+    string baseDir = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+    string output;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--seconds") {
+            seconds = atof(value.c_str());
+        } else if (arg == "--sizes") {
+            sizes.clear();
+            for (const string& item : splitList(value)) {
+                size_t size = 0;
+                if (!parseSize(item, size)) {
+                    cerr << "Invalid size: " << item << "\n";
+                    return 1;
+                }
+                sizes.push_back(size);
+            }
+        } else if (arg == "--concurrency") {
+            levels.clear();
+            for (const string& item : splitList(value)) {
+                levels.push_back(atoi(item.c_str()));
+            }
+        } else if (arg == "--ops") {
+            ops = splitList(value);
+        } else if (arg == "--dir") {
+            baseDir = value;
+        } else if (arg == "--output") {
+            output = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    bool valid = seconds > 0 && !sizes.empty() && !levels.empty() && !ops.empty();
+    for (int level : levels) {
+        valid = valid && level > 0;
+    }
+    for (const string& op : ops) {
+        valid = valid && (op == "GET" || op == "PUT" || op == "LIST" || op == "PING");
+    }
+    if (!valid) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Client and server log every request; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    string serverDir = baseDir + "/transfer_bench_XXXXXX";
+    if (!mkdtemp(&serverDir[0])) {
+        report << "Error: Cannot create a directory in " << baseDir << "\n";
+        return 1;
+    }
+    for (size_t size : sizes) {
+        writeFile(serverDir + "/get_" + formatSize(size) + ".bin", size);
+    }
+
+    // Open the counter before any thread exists, so all of them inherit it
+    SyscallCounter counter;
+    Server server;
+    server.setTimeout(0);
+    server.setFileCacheLimits(0, 0); // Measure the transfer path, not the cache
+    if (!server.start(0, serverDir)) {
+        report << "Error: Cannot start server\n";
+        return 1;
+    }
+    thread serverThread([&server]() { server.run(); });
+
+    vector<Cell> cells;
+    bool allOk = true;
+    for (const string& op : ops) {
+        bool sized = op == "GET" || op == "PUT";
+        for (size_t size : sized ? sizes : vector<size_t>{0}) {
+            for (int level : levels) {
+                cells.push_back(runCell(server, counter, op, size, level, seconds));
+                allOk = allOk && cells.back().errors == 0;
+            }
+        }
+    }
+
+    server.stop();
+    serverThread.join();
+
+    if (output.empty()) {
+        writeJson(report, cells, seconds, baseDir, counter.source());
+    } else {
+        ofstream out(output);
+        writeJson(out, cells, seconds, baseDir, counter.source());
+        report << "Transfer benchmark: " << seconds << " s per cell, files in " << baseDir
+               << ", syscalls from " << counter.source() << "\n";
+        writeTable(report, cells);
+        report << "JSON written to " << output << "\n";
+        if (!out.good()) {
+            report << "Error: Cannot write " << output << "\n";
+            allOk = false;
+        }
+    }
+
+    for (size_t size : sizes) {
+        unlink((serverDir + "/get_" + formatSize(size) + ".bin").c_str());
+    }
+    for (int w = 0; w < *max_element(levels.begin(), levels.end()); ++w) {
+        unlink((serverDir + "/put_" + to_string(w) + ".bin").c_str());
+    }
+    rmdir(serverDir.c_str());
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,353 @@
+/**
+ * Tuning Benchmark - socket tuning profiles across emulated links
+ *
+ * For every link and every SocketTuning profile, starts an in-process
+ * server and a client with that profile on both ends, puts a LinkEmulator
+ * (delay + bandwidth, userspace relay) between them, and measures:
+ *   - LIST and PING latency p50 (small replies: Nagle, delayed ACKs, cork),
+ *   - GET and PUT throughput of one file, in MB/s; a PUT is timed until a
+ *     PING behind it returns, i.e. until the server has stored the file.
+ *
+ * BDP-sized profiles are derived from each link's bandwidth and RTT.
+ * The relay terminates TCP, so the endpoints' kernels see a loopback
+ * peer: buffer sizes and congestion control act on the hop to the relay,
+ * not on the emulated RTT. Point real clients at a netem or WAN link to
+ * judge those; this sweep shows the application-visible effects.
+ *
+ * Links are name:rtt_ms:mbps (mbps 0 = unlimited).
+ *
+ * Usage: ./tuning_bench [--links lan:0.5:1000,wan:40:100] [--profiles default,bdp]
+ *                       [--size 4M] [--rounds 2] [--pings 10] [--dir DIR]
+ *                       [--output FILE]
+ * Example: ./tuning_bench --links wan:40:100 --size 8M --output tuning.json
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include "../include/core/link_emulator.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace std::chrono;
+
+struct Link {
+    string name;
+    double rttMs = 0.0;
+    double mbps = 0.0;
+};
+
+struct Cell {
+    string link;
+    string profile;
+    string tuning;
+    double listP50Ms = 0.0;
+    double pingP50Ms = 0.0;
+    double getMBps = 0.0;
+    double putMBps = 0.0;
+    uint64_t errors = 0;
+};
+
+static bool parseSize(const string& text, size_t& size) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value <= 0) {
+        return false;
+    }
+    string unit(end);
+    if (unit == "K" || unit == "KB") {
+        value *= 1024;
+    } else if (unit == "M" || unit == "MB") {
+        value *= 1024 * 1024;
+    } else if (unit == "G" || unit == "GB") {
+        value *= 1024.0 * 1024 * 1024;
+    } else if (!unit.empty()) {
+        return false;
+    }
+    size = static_cast<size_t>(value);
+    return true;
+}
+
+static vector<string> splitList(const string& text, char separator = ',') {
+    vector<string> items;
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, separator)) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static bool parseLink(const string& text, Link& link) {
+    vector<string> parts = splitList(text, ':');
+    if (parts.size() != 3) {
+        return false;
+    }
+    link.name = parts[0];
+    link.rttMs = atof(parts[1].c_str());
+    link.mbps = atof(parts[2].c_str());
+    return link.rttMs >= 0 && link.mbps >= 0;
+}
+
+static bool writeFile(const string& path, size_t size) {
+    ofstream out(path, ios::binary);
+    string chunk(1024 * 1024, 'x');
+    for (size_t i = 0; i < chunk.size(); ++i) {
+        chunk[i] = static_cast<char>('a' + (i % 26));
+    }
+    for (size_t written = 0; written < size; written += chunk.size()) {
+        out.write(chunk.data(), min(chunk.size(), size - written));
+    }
+    return out.good();
+}
+
+static double median(vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static double elapsedMs(steady_clock::time_point start) {
+    return duration<double, milli>(steady_clock::now() - start).count();
+}
+
+static Cell runCell(const Link& link, const string& profile, const string& serverDir, const string& clientDir,
+                    size_t size, int rounds, int pings) {
+    Cell cell;
+    cell.link = link.name;
+    cell.profile = profile;
+
+    SocketTuning tuning;
+    if (!SocketTuning::forProfile(profile, link.mbps, link.rttMs, tuning)) {
+        cell.tuning = "n/a";
+        cell.errors++;
+        return cell;
+    }
+    cell.tuning = tuning.describe();
+
+    Server server;
+    server.setTimeout(0);
+    server.setFileCacheLimits(0, 0); // Measure the transfer path, not the cache
+    server.setSocketTuning(tuning);
+    if (!server.start(0, serverDir)) {
+        cell.errors++;
+        return cell;
+    }
+    thread serverThread([&server]() { server.run(); });
+
+    LinkConditions conditions;
+    conditions.rttMs = link.rttMs;
+    conditions.bandwidthMbps = link.mbps;
+    LinkEmulator emulator;
+    Client client;
+    client.setSocketTuning(tuning);
+    if (!emulator.start("127.0.0.1", server.getPort(), conditions) ||
+        !client.connect("127.0.0.1", emulator.getPort())) {
+        cell.errors++;
+    } else {
+        vector<double> lists;
+        vector<double> pingTimes;
+        for (int i = 0; i < pings; ++i) {
+            auto start = steady_clock::now();
+            if (client.getFileList().empty()) {
+                cell.errors++;
+            }
+            lists.push_back(elapsedMs(start));
+
+            start = steady_clock::now();
+            if (client.ping() <= 0.0) {
+                cell.errors++;
+            }
+            pingTimes.push_back(elapsedMs(start));
+        }
+        cell.listP50Ms = median(lists);
+        cell.pingP50Ms = median(pingTimes);
+
+        double getMs = 0.0;
+        double putMs = 0.0;
+        for (int i = 0; i < rounds; ++i) {
+            auto start = steady_clock::now();
+            if (!client.getFile("get.bin", clientDir)) {
+                cell.errors++;
+            }
+            getMs += elapsedMs(start);
+
+            start = steady_clock::now();
+            if (!client.putFile(clientDir + "/put.bin") || client.ping() <= 0.0) {
+                cell.errors++;
+            }
+            putMs += elapsedMs(start);
+        }
+        double megabytes = static_cast<double>(size) * rounds / (1024.0 * 1024.0);
+        cell.getMBps = getMs > 0 ? megabytes / (getMs / 1000.0) : 0.0;
+        cell.putMBps = putMs > 0 ? megabytes / (putMs / 1000.0) : 0.0;
+    }
+
+    client.disconnect();
+    emulator.stop();
+    server.stop();
+    serverThread.join();
+    return cell;
+}
+
+static void writeJson(ostream& out, const vector<Link>& links, const vector<Cell>& cells, size_t size, int rounds) {
+    out << fixed << setprecision(3);
+    out << "{\n  \"benchmark\": \"tuning_bench\",\n  \"file_bytes\": " << size << ",\n  \"rounds\": " << rounds
+        << ",\n  \"links\": [\n";
+    for (size_t i = 0; i < links.size(); ++i) {
+        out << "    {\"name\": \"" << links[i].name << "\", \"rtt_ms\": " << links[i].rttMs
+            << ", \"mbps\": " << links[i].mbps << "}" << (i + 1 < links.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"cells\": [\n";
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const Cell& c = cells[i];
+        out << "    {\"link\": \"" << c.link << "\", \"profile\": \"" << c.profile << "\", \"tuning\": \""
+            << c.tuning << "\", \"list_p50_ms\": " << c.listP50Ms << ", \"ping_p50_ms\": " << c.pingP50Ms
+            << ", \"get_mb_per_s\": " << c.getMBps << ", \"put_mb_per_s\": " << c.putMBps
+            << ", \"errors\": " << c.errors << "}" << (i + 1 < cells.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+static void writeTable(ostream& out, const vector<Cell>& cells) {
+    out << left << setw(8) << "link" << setw(13) << "profile" << right << setw(11) << "LIST p50" << setw(11)
+        << "PING p50" << setw(10) << "GET MB/s" << setw(10) << "PUT MB/s" << setw(8) << "errors"
+        << "  tuning\n";
+    out << fixed << setprecision(2);
+    for (const Cell& c : cells) {
+        out << left << setw(8) << c.link << setw(13) << c.profile << right << setw(8) << c.listP50Ms << " ms"
+            << setw(8) << c.pingP50Ms << " ms" << setw(10) << c.getMBps << setw(10) << c.putMBps << setw(8)
+            << c.errors << "  " << c.tuning << "\n";
+    }
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [--links name:rtt_ms:mbps,...] [--profiles default,interactive,bdp,bbr,paced]\n"
+         << "       [--size 4M] [--rounds 2] [--pings 10] [--dir DIR] [--output FILE]\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<Link> links = {{"lan", 0.5, 1000.0}, {"wan", 40.0, 100.0}, {"lfn", 100.0, 200.0}};
+    vector<string> profiles = SocketTuning::profileNames();
+    size_t size = 4 * 1024 * 1024;
+    int rounds = 2;
+    int pings = 10;
+    string baseDir = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+    string output;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--links") {
+            links.clear();
+            for (const string& item : splitList(value)) {
+                Link link;
+                if (!parseLink(item, link)) {
+                    cerr << "Invalid link: " << item << "\n";
+                    return 1;
+                }
+                links.push_back(link);
+            }
+        } else if (arg == "--profiles") {
+            profiles = splitList(value);
+        } else if (arg == "--size") {
+            if (!parseSize(value, size)) {
+                cerr << "Invalid size: " << value << "\n";
+                return 1;
+            }
+        } else if (arg == "--rounds") {
+            rounds = atoi(value.c_str());
+        } else if (arg == "--pings") {
+            pings = atoi(value.c_str());
+        } else if (arg == "--dir") {
+            baseDir = value;
+        } else if (arg == "--output") {
+            output = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    vector<string> known = SocketTuning::profileNames();
+    bool valid = !links.empty() && !profiles.empty() && rounds > 0 && pings > 0;
+    for (const string& profile : profiles) {
+        valid = valid && find(known.begin(), known.end(), profile) != known.end();
+    }
+    if (!valid) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Client, server and relay log every request; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    ostream errors(cerr.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    string serverDir = baseDir + "/tuning_bench_XXXXXX";
+    if (!mkdtemp(&serverDir[0])) {
+        report << "Error: Cannot create a directory in " << baseDir << "\n";
+        return 1;
+    }
+    string clientDir = serverDir + "/client";
+    mkdir(clientDir.c_str(), 0755);
+    writeFile(serverDir + "/get.bin", size);
+    writeFile(clientDir + "/put.bin", size);
+    // A LIST reply of several writes shows whether they leave together
+    for (int i = 0; i < 8; ++i) {
+        writeFile(serverDir + "/list_" + to_string(i) + ".txt", 64);
+    }
+
+    vector<Cell> cells;
+    bool allOk = true;
+    for (const Link& link : links) {
+        for (const string& profile : profiles) {
+            cells.push_back(runCell(link, profile, serverDir, clientDir, size, rounds, pings));
+            allOk = allOk && cells.back().errors == 0;
+            errors << "[" << link.name << "/" << profile << "] done\n";
+        }
+    }
+
+    report << "Tuning benchmark: " << (size / 1024) << " KB x " << rounds << " rounds, " << pings
+           << " LIST/PING per cell, files in " << baseDir << "\n";
+    writeTable(report, cells);
+    if (!output.empty()) {
+        ofstream out(output);
+        writeJson(out, links, cells, size, rounds);
+        if (out.good()) {
+            report << "JSON written to " << output << "\n";
+        } else {
+            report << "Error: Cannot write " << output << "\n";
+            allOk = false;
+        }
+    }
+
+    unlink((serverDir + "/get.bin").c_str());
+    unlink((serverDir + "/put.bin").c_str());
+    unlink((clientDir + "/get.bin").c_str());
+    unlink((clientDir + "/put.bin").c_str());
+    for (int i = 0; i < 8; ++i) {
+        unlink((serverDir + "/list_" + to_string(i) + ".txt").c_str());
+    }
+    rmdir(clientDir.c_str());
+    rmdir(serverDir.c_str());
+    return allOk ? 0 : 1;
+}
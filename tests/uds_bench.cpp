@@ -0,0 +1,212 @@
+/**
+ * UDS Benchmark - same-host transports compared
+ *
+ * Runs an in-process server listening on both loopback TCP and a Unix
+ * domain socket, and reads files of several sizes back-to-back over:
+ *   - tcp-stream:  GET over 127.0.0.1, data streamed through the socket
+ *   - uds-stream:  GET over the Unix socket, data streamed through it
+ *   - uds-fd+read: GET_FD, then pread() the passed descriptor
+ *   - uds-fd:      GET_FD only (hand-off cost, no data touched)
+ * Every mode except uds-fd ends with the whole file in a client buffer.
+ *
+ * Usage: ./uds_bench [seconds_per_case]
+ * Example: ./uds_bench 1
+ */
+
+#include "../include/server.h"
+#include "../include/client.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+enum class Mode { TcpStream, UdsStream, UdsFdRead, UdsFd };
+
+static const size_t READ_CHUNK = 1024 * 1024;
+
+static bool writeFile(const string& path, size_t size) {
+    ofstream out(path, ios::binary);
+    string block(READ_CHUNK, 'x');
+    for (size_t written = 0; written < size; written += block.size()) {
+        out.write(block.data(), min<size_t>(block.size(), size - written));
+    }
+    return out.good();
+}
+
+static string sizeText(size_t size) {
+    if (size >= 1024 * 1024) {
+        return to_string(size / (1024 * 1024)) + " MB";
+    }
+    return to_string(size / 1024) + " KB";
+}
+
+// Plain GET: size header, then the file streamed into buf
+static bool streamGet(ClientSocket& socket, const string& name, vector<uint8_t>& buf) {
+    uint8_t cmd = CMD_GET;
+    char filenameBuf[256] = {0};
+    strncpy(filenameBuf, name.c_str(), sizeof(filenameBuf) - 1);
+    struct iovec iov[2] = {{&cmd, sizeof(cmd)}, {filenameBuf, sizeof(filenameBuf)}};
+    if (socket.sendVectored(iov, 2) < 0) {
+        return false;
+    }
+
+    uint64_t size = 0;
+    if (socket.receiveData(reinterpret_cast<uint8_t*>(&size), sizeof(size)) != sizeof(size) || size == 0) {
+        return false;
+    }
+    for (uint64_t done = 0; done < size;) {
+        size_t want = min<uint64_t>(READ_CHUNK, size - done);
+        if (socket.receiveData(buf.data() + done, want) != static_cast<ssize_t>(want)) {
+            return false;
+        }
+        done += want;
+    }
+    return true;
+}
+
+// GET_FD: the server passes an open descriptor; optionally read it all
+static bool fdGet(ClientProtocol& protocol, const string& name, vector<uint8_t>& buf, bool read) {
+    uint64_t size = 0;
+    int fd = protocol.request_get_fd(name, size);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (uint64_t done = 0; read && done < size;) {
+        ssize_t n = pread(fd, buf.data() + done, min<uint64_t>(READ_CHUNK, size - done), done);
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        done += n;
+    }
+    close(fd);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+    if (seconds <= 0) {
+        cerr << "Usage: " << argv[0] << " [seconds_per_case]\n";
+        return 1;
+    }
+
+    // Client and server log every request; keep the report on its own stream
+    ostream report(cout.rdbuf());
+    cout.rdbuf(nullptr);
+    cerr.rdbuf(nullptr);
+
+    char serverTemplate[] = "/tmp/uds_bench_XXXXXX";
+    if (!mkdtemp(serverTemplate)) {
+        report << "Error: Cannot create temporary directory\n";
+        return 1;
+    }
+    string serverDir = serverTemplate;
+    string socketPath = serverDir + "/server.sock";
+
+    const vector<size_t> sizes = {4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    for (size_t size : sizes) {
+        writeFile(serverDir + "/file_" + to_string(size), size);
+    }
+
+    Server server;
+    server.setUnixSocket("unix:" + socketPath);
+    if (!server.start(0, serverDir)) {
+        report << "Error: Cannot start server\n";
+        return 1;
+    }
+    uint16_t port = server.getPort();
+    thread serverThread([&server]() { server.run(); });
+
+    const vector<pair<Mode, const char*>> modes = {
+        {Mode::TcpStream, "tcp-stream"},
+        {Mode::UdsStream, "uds-stream"},
+        {Mode::UdsFdRead, "uds-fd+read"},
+        {Mode::UdsFd, "uds-fd"},
+    };
+
+    report << "UDS benchmark: " << seconds << " s per case\n";
+    report << string(60, '-') << "\n";
+    report << left << setw(10) << "Size" << setw(14) << "Transport"
+           << setw(12) << "Ops/sec" << setw(12) << "MB/sec" << "us/op" << "\n";
+    report << string(60, '-') << "\n";
+
+    vector<uint8_t> buf(sizes.back());
+    bool allOk = true;
+    int connections = 0;
+    for (size_t size : sizes) {
+        string name = "file_" + to_string(size);
+        for (const auto& mode : modes) {
+            ClientSocket socket;
+            bool connected = mode.first == Mode::TcpStream ? socket.connectToServer("127.0.0.1", port)
+                                                           : socket.connectUnix(socketPath);
+            if (!connected) {
+                report << "Error: Cannot connect (" << mode.second << ")\n";
+                allOk = false;
+                continue;
+            }
+            connections++;
+            ClientProtocol protocol(socket);
+
+            bool ok = true;
+            uint64_t ops = 0;
+            auto start = steady_clock::now();
+            auto deadline = start + duration<double>(seconds);
+            while (ok && steady_clock::now() < deadline) {
+                switch (mode.first) {
+                    case Mode::TcpStream:
+                    case Mode::UdsStream:
+                        ok = streamGet(socket, name, buf);
+                        break;
+                    case Mode::UdsFdRead:
+                        ok = fdGet(protocol, name, buf, true);
+                        break;
+                    case Mode::UdsFd:
+                        ok = fdGet(protocol, name, buf, false);
+                        break;
+                }
+                ops += ok ? 1 : 0;
+            }
+            double elapsed = duration<double>(steady_clock::now() - start).count();
+            socket.disconnect();
+
+            report << left << setw(10) << sizeText(size) << setw(14) << mode.second
+                   << fixed << setprecision(0) << setw(12) << (ops / elapsed)
+                   << setprecision(1) << setw(12)
+                   << (mode.first == Mode::UdsFd ? string("-") : to_string(lround(ops * size / elapsed / (1024 * 1024))))
+                   << setprecision(1) << (ops ? elapsed * 1e6 / ops : 0.0)
+                   << (ok ? "" : "  FAILED") << endl;
+            allOk = allOk && ok;
+        }
+    }
+    report << string(60, '-') << "\n";
+
+    // Let the session threads finish before the server tears sessions down
+    int closed = 0;
+    ServerEvent event;
+    while (closed < connections && server.waitEvent(event, 1000)) {
+        if (event.type == ServerEventType::SessionClosed) {
+            closed++;
+        }
+    }
+    this_thread::sleep_for(milliseconds(50));
+    server.stop();
+    serverThread.join();
+
+    for (size_t size : sizes) {
+        unlink((serverDir + "/file_" + to_string(size)).c_str());
+    }
+    rmdir(serverDir.c_str());
+    return allOk ? 0 : 1;
+}